@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#ifndef _BOILERPLATE_BINPRINTF_H
+#define _BOILERPLATE_BINPRINTF_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Deferred formatting: the arguments of a printf-like call are
+ * packed into a binary record, which may be formatted later,
+ * possibly by another process running on the same architecture.
+ */
+
+#define BINPRINTF_MAGIC		"XENOBPR1"
+
+/*
+ * Dump file layout: the magic string, followed by records made of
+ * this header, the format string (not null-terminated) then the
+ * packed arguments.
+ */
+struct binprintf_record {
+	uint64_t timestamp;	/* ns */
+	uint32_t seq_no;
+	uint32_t fmtlen;
+	uint32_t argsz;
+	uint32_t pad;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ssize_t binprintf_pack(char *buf, size_t size,
+		       const char *format, va_list args);
+
+int binprintf_format(char *buf, size_t size, const char *format,
+		     const char *args, size_t argsz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOILERPLATE_BINPRINTF_H */
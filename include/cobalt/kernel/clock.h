@@ -258,19 +258,39 @@ static inline xnticks_t xnclock_get_resolution(struct xnclock *clock)
 	return clock->resolution; /* ns */
 }
 
+void xnclock_spread_gravity(struct xnclock *clock);
+
+void xnclock_get_cpu_gravity(struct xnclock *clock, int cpu,
+			     struct xnclock_gravity *gravity);
+
+int xnclock_set_cpu_gravity(struct xnclock *clock, int cpu,
+			    const struct xnclock_gravity *gravity);
+
+/*
+ * Setting or resetting the clock-wide gravity overrides the per-CPU
+ * values.
+ */
 static inline int xnclock_set_gravity(struct xnclock *clock,
 				      const struct xnclock_gravity *gravity)
 {
-	if (clock->ops.set_gravity)
-		return clock->ops.set_gravity(clock, gravity);
+	int ret;
 
-	return -EINVAL;
+	if (clock->ops.set_gravity == NULL)
+		return -EINVAL;
+
+	ret = clock->ops.set_gravity(clock, gravity);
+	if (ret == 0)
+		xnclock_spread_gravity(clock);
+
+	return ret;
 }
 
 static inline void xnclock_reset_gravity(struct xnclock *clock)
 {
-	if (clock->ops.reset_gravity)
+	if (clock->ops.reset_gravity) {
 		clock->ops.reset_gravity(clock);
+		xnclock_spread_gravity(clock);
+	}
 }
 
 #define xnclock_get_gravity(__clock, __type)  ((__clock)->gravity.__type)
@@ -20,6 +20,7 @@
 #define _COBALT_KERNEL_HEAP_H
 
 #include <linux/string.h>
+#include <linux/percpu.h>
 #include <cobalt/kernel/lock.h>
 #include <cobalt/kernel/list.h>
 #include <cobalt/uapi/kernel/types.h>
@@ -56,6 +57,35 @@
 #define XNHEAP_PCONT   1
 #define XNHEAP_PLIST   2
 
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+/* Page-sized blocks are not cached. */
+#define XNHEAP_MAGCLASSES (PAGE_SHIFT - XNHEAP_MINLOG2)
+#define XNHEAP_MAGSZ      16
+#define XNHEAP_MAGBATCH   (XNHEAP_MAGSZ / 2)
+/* All magazines may cache up to 1/XNHEAP_MAGSHARE of the heap. */
+#define XNHEAP_MAGSHARE   8
+
+struct xnheap_magazine {
+	int nrounds;
+	caddr_t rounds[XNHEAP_MAGSZ];
+};
+
+struct xnheap_percpu {
+	/** Serializes the owner CPU with xnheap_flush_magazines() */
+	DECLARE_XNLOCK(lock);
+	/** One magazine per bucketed block size, below a page */
+	struct xnheap_magazine mags[XNHEAP_MAGCLASSES];
+	/** Bytes cached by all magazines */
+	u32 cached;
+	/** Allocations served by the local magazine */
+	unsigned long hits;
+	/** Allocations which required a refill */
+	unsigned long misses;
+};
+
+#endif /* CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
 struct xnpagemap {
 	/** PFREE, PCONT, PLIST or log2 */
 	u32 type : 8;
@@ -88,6 +118,12 @@ struct xnheap {
 	u32 size;
 	/** Used/busy storage size */
 	u32 used;
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	/** Per-CPU magazines, NULL if disabled */
+	struct xnheap_percpu __percpu *percpu;
+	/** Max bytes cached per CPU */
+	u32 magcap;
+#endif
 };
 
 extern struct xnheap cobalt_heap;
@@ -100,10 +136,14 @@ static inline u32 xnheap_get_size(const struct xnheap *heap)
 	return heap->size;
 }
 
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+u32 xnheap_get_free(const struct xnheap *heap);
+#else
 static inline u32 xnheap_get_free(const struct xnheap *heap)
 {
 	return heap->size - heap->used;
 }
+#endif
 
 static inline void *xnheap_get_membase(const struct xnheap *heap)
 {
@@ -143,6 +183,36 @@ void xnheap_free(struct xnheap *heap, void *block);
 
 int xnheap_check_block(struct xnheap *heap, void *block);
 
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+int xnheap_enable_magazines(struct xnheap *heap);
+
+int xnheap_flush_magazines(struct xnheap *heap);
+
+void xnheap_get_magstats(struct xnheap *heap,
+			 unsigned long *hits, unsigned long *misses);
+
+#else /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
+static inline int xnheap_enable_magazines(struct xnheap *heap)
+{
+	return 0;
+}
+
+static inline int xnheap_flush_magazines(struct xnheap *heap)
+{
+	return 0;
+}
+
+static inline void xnheap_get_magstats(struct xnheap *heap,
+				       unsigned long *hits,
+				       unsigned long *misses)
+{
+	*hits = *misses = 0;
+}
+
+#endif /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
 static inline char *xnstrdup(const char *s)
 {
 	char *p;
@@ -283,6 +283,18 @@ static inline void __xnlock_put(struct xnlock *lock /*, */ XNLOCK_DBG_CONTEXT_AR
 
 DECLARE_EXTERN_XNLOCK(nklock);
 
+/*
+ * nklock serializes the state of the scheduler, threads, timers and
+ * synchronization objects, and is always the outermost lock. There
+ * is no per-CPU scheduler, per-object wait queue or per-clock timer
+ * lock. The only core state which may leave nklock is the registry,
+ * with CONFIG_XENO_OPT_REGISTRY_LOCK. The ordering is:
+ *
+ *   nklock
+ *     registry lock
+ *       heap locks (xnheap->lock)
+ */
+
 /** @} */
 
 #endif /* !_COBALT_KERNEL_LOCK_H */
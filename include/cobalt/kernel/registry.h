@@ -45,7 +45,8 @@ struct xnobject {
 	} vfile_u;
 	struct xnvfile *vfilp;
 #endif /* CONFIG_XENO_OPT_VFILE */
-	struct hlist_node hlink; /* !< Link in h-table */
+	struct xnobject *hnext;	/* !< Link in h-table */
+	u32 hash;		/* !< Hash value of key */
 	struct list_head link;
 };
 
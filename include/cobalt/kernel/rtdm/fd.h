@@ -162,6 +162,57 @@ ssize_t rtdm_recvmsg_handler(struct rtdm_fd *fd, struct msghdr *msg, int flags);
  */
 ssize_t rtdm_sendmsg_handler(struct rtdm_fd *fd, const struct msghdr *msg, int flags);
 
+/**
+ * Batched receive handler
+ *
+ * This optional handler receives up to @a vlen messages at once. When
+ * absent, RTDM falls back to calling the receive message handler in a
+ * loop.
+ *
+ * @param[in] fd File descriptor
+ * @param[in,out] msgvec Array of message descriptors as passed by the
+ * user, automatically mirrored to safe kernel memory in case of user
+ * mode call. The handler should set the @a msg_len field of each
+ * descriptor it fills to the number of bytes received.
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags as passed by the user, possibly
+ * including MSG_WAITFORONE.
+ *
+ * @return On success, the number of messages received. On failure
+ * return either -ENOSYS, to request that this handler be called again
+ * from the opposite realtime/non-realtime context, or another
+ * negative error code.
+ *
+ * @see @c recvmmsg() in Linux
+ */
+int rtdm_recvmmsg_handler(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			  unsigned int vlen, unsigned int flags);
+
+/**
+ * Batched transmit handler
+ *
+ * This optional handler transmits up to @a vlen messages at once. When
+ * absent, RTDM falls back to calling the transmit message handler in
+ * a loop.
+ *
+ * @param[in] fd File descriptor
+ * @param[in,out] msgvec Array of message descriptors as passed by the
+ * user, automatically mirrored to safe kernel memory in case of user
+ * mode call. The handler should set the @a msg_len field of each
+ * descriptor it sends to the number of bytes transmitted.
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags as passed by the user
+ *
+ * @return On success, the number of messages transmitted. On failure
+ * return either -ENOSYS, to request that this handler be called again
+ * from the opposite realtime/non-realtime context, or another
+ * negative error code.
+ *
+ * @see @c sendmmsg() in Linux
+ */
+int rtdm_sendmmsg_handler(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			  unsigned int vlen, unsigned int flags);
+
 /**
  * Select handler
  *
@@ -277,6 +328,18 @@ struct rtdm_fd_ops {
 	/** See rtdm_sendmsg_handler(). */
 	ssize_t (*sendmsg_nrt)(struct rtdm_fd *fd,
 			       const struct msghdr *msg, int flags);
+	/** See rtdm_recvmmsg_handler(). */
+	int (*recvmmsg_rt)(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			   unsigned int vlen, unsigned int flags);
+	/** See rtdm_recvmmsg_handler(). */
+	int (*recvmmsg_nrt)(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			    unsigned int vlen, unsigned int flags);
+	/** See rtdm_sendmmsg_handler(). */
+	int (*sendmmsg_rt)(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			   unsigned int vlen, unsigned int flags);
+	/** See rtdm_sendmmsg_handler(). */
+	int (*sendmmsg_nrt)(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			    unsigned int vlen, unsigned int flags);
 	/** See rtdm_select_handler(). */
 	int (*select)(struct rtdm_fd *fd,
 		      struct xnselector *selector,
@@ -368,6 +431,19 @@ ssize_t rtdm_fd_recvmsg(int ufd, struct msghdr *msg, int flags);
 ssize_t rtdm_fd_sendmsg(int ufd, const struct msghdr *msg,
 			int flags);
 
+int __rtdm_fd_recvmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
+		       unsigned int flags, const struct timespec *timeout,
+		       size_t mmsgsz,
+		       int (*get_mmsg)(struct mmsghdr *mmsg, void __user *u_mmsg),
+		       int (*put_mmsg)(void __user *u_mmsg,
+				       const struct mmsghdr *mmsg));
+
+int __rtdm_fd_sendmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
+		       unsigned int flags, size_t mmsgsz,
+		       int (*get_mmsg)(struct mmsghdr *mmsg, void __user *u_mmsg),
+		       int (*put_mmsg)(void __user *u_mmsg,
+				       const struct mmsghdr *mmsg));
+
 int rtdm_fd_mmap(int ufd, struct _rtdm_mmap_request *rma,
 		 void * __user *u_addrp);
 
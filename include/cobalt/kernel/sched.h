@@ -67,6 +67,8 @@ struct xnsched {
 	int cpu;
 	/*!< Mask of CPUs needing rescheduling. */
 	cpumask_t resched;
+	/*!< Number of threads attached to this CPU. */
+	int nr_threads;
 #endif
 	/*!< Context of built-in real-time class. */
 	struct xnsched_rt rt;
@@ -112,6 +114,14 @@ struct xnsched {
 	xnticks_t last_account_switch;
 	/*!< Currently active account */
 	xnstat_exectime_t *current_account;
+#ifdef CONFIG_SMP
+	/*!< Last load sample, for thread placement. */
+	struct {
+		xnticks_t date;
+		xnticks_t idle;
+		int usage;
+	} load;
+#endif
 #endif
 };
 
@@ -119,6 +129,12 @@ DECLARE_PER_CPU(struct xnsched, nksched);
 
 extern cpumask_t cobalt_cpu_affinity;
 
+/* Placement policies for new threads. */
+#define XNSCHED_PLACE_LOCAL	0
+#define XNSCHED_PLACE_BALANCED	1
+
+extern int cobalt_cpu_placement;
+
 extern struct list_head nkthreadq;
 
 extern int cobalt_nrthreads;
@@ -235,6 +251,18 @@ static inline int xnsched_supported_cpu(int cpu)
 	return cpu_isset(cpu, xnsched_realtime_cpus);
 }
 
+static inline void xnsched_inc_nrthreads(struct xnsched *sched)
+{
+	sched->nr_threads++;
+}
+
+static inline void xnsched_dec_nrthreads(struct xnsched *sched)
+{
+	sched->nr_threads--;
+}
+
+int xnsched_pick_cpu(const cpumask_t *affinity, int cpu);
+
 #else /* !CONFIG_SMP */
 
 static inline void xnsched_set_resched(struct xnsched *sched)
@@ -249,6 +277,15 @@ static inline int xnsched_supported_cpu(int cpu)
 	return 1;
 }
 
+static inline void xnsched_inc_nrthreads(struct xnsched *sched) { }
+
+static inline void xnsched_dec_nrthreads(struct xnsched *sched) { }
+
+static inline int xnsched_pick_cpu(const cpumask_t *affinity, int cpu)
+{
+	return cpu;
+}
+
 #endif /* !CONFIG_SMP */
 
 #define for_each_realtime_cpu(cpu)		\
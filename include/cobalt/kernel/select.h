@@ -32,6 +32,9 @@
 #define XNSELECT_EXCEPT    2
 #define XNSELECT_MAX_TYPES 3
 
+/* Selector flags. */
+#define XNSELECT_READYLIST 0x1
+
 struct xnselector {
 	struct xnsynch synchbase;
 	struct fds {
@@ -40,6 +43,10 @@ struct xnselector {
 	} fds [XNSELECT_MAX_TYPES];
 	struct list_head destroy_link;
 	struct list_head bindings; /* only used by xnselector_destroy */
+	/* Ready-list mode only (XNSELECT_READYLIST). */
+	int flags;
+	struct list_head ready;
+	unsigned int nr_ready;
 };
 
 #define __NFDBITS__	(8 * sizeof(unsigned long))
@@ -94,6 +101,12 @@ struct xnselect_binding {
 	unsigned int bit_index;
 	struct list_head link;  /* link in selected fds list. */
 	struct list_head slink; /* link in selector list */
+	struct list_head rlink; /* link in selector ready list */
+};
+
+struct xnselect_event {
+	unsigned int index;
+	unsigned int types;	/* (1 << XNSELECT_*) bits */
 };
 
 void xnselect_init(struct xnselect *select_block);
@@ -130,12 +143,22 @@ void xnselect_destroy(struct xnselect *select_block);
 
 int xnselector_init(struct xnselector *selector);
 
+int xnselector_init_readylist(struct xnselector *selector);
+
+int xnselector_bound_p(struct xnselector *selector, unsigned int index);
+
+int xnselector_unbind(struct xnselector *selector, unsigned int index);
+
 int xnselect(struct xnselector *selector,
 	     fd_set *out_fds[XNSELECT_MAX_TYPES],
 	     fd_set *in_fds[XNSELECT_MAX_TYPES],
 	     int nfds,
 	     xnticks_t timeout, xntmode_t timeout_mode);
 
+int xnselect_ready(struct xnselector *selector,
+		   struct xnselect_event *events, int nrevents,
+		   xnticks_t timeout, xntmode_t timeout_mode);
+
 void xnselector_destroy(struct xnselector *selector);
 
 int xnselect_mount(void);
@@ -19,6 +19,7 @@
 #ifndef _COBALT_KERNEL_SYNCH_H
 #define _COBALT_KERNEL_SYNCH_H
 
+#include <linux/rbtree.h>
 #include <cobalt/kernel/list.h>
 #include <cobalt/kernel/assert.h>
 #include <cobalt/kernel/timer.h>
@@ -53,15 +54,25 @@ struct xnsynch {
 	int wprio;		/** wait prio in claimq */
 	unsigned long status;	 /** Status word */
 	struct list_head pendq;	 /** Pending threads */
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+	struct rb_root prioq;	/** Heads of priority groups in pendq */
+#endif
 	struct xnthread *owner;	/** Thread which owns the resource */
 	atomic_t *fastlock; /** Pointer to fast lock word */
 	void (*cleanup)(struct xnsynch *synch); /* Cleanup handler */
 };
 
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+#define __XNSYNCH_PRIOQ_INITIALIZER	.prioq = RB_ROOT,
+#else
+#define __XNSYNCH_PRIOQ_INITIALIZER
+#endif
+
 #define XNSYNCH_WAITQUEUE_INITIALIZER(__name) {		\
 		.status = XNSYNCH_PRIO,			\
 		.wprio = -1,				\
 		.pendq = LIST_HEAD_INIT((__name).pendq),	\
+		__XNSYNCH_PRIOQ_INITIALIZER		\
 		.owner = NULL,				\
 		.cleanup = NULL,			\
 		.fastlock = NULL,			\
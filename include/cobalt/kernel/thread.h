@@ -133,6 +133,16 @@ struct xnthread {
 	 */
 	struct list_head plink;
 
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+	/**
+	 * Node in xnsynch prioq, linked only while this thread heads
+	 * the group of sleepers sharing its priority in the pendq.
+	 */
+	struct rb_node pnode;
+	/** Weighted priority this thread was queued at in the pendq. */
+	int pprio;
+#endif
+
 	/** Thread holder in global queue. */
 	struct list_head glink;
 
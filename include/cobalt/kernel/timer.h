@@ -159,6 +159,35 @@ typedef struct {} xntimerq_it_t;
 #define xntimerq_it_begin(q, i)   ((void) (i), bheap_gethead(q))
 #define xntimerq_it_next(q, i, h) ((void) (i), bheap_next((q),(h)))
 
+#elif defined(CONFIG_XENO_OPT_TIMER_WHEEL)
+
+#include <cobalt/kernel/twheel.h>
+
+typedef struct xntwholder xntimerh_t;
+
+#define xntimerh_date(h)          xntwholder_key(h)
+#define xntimerh_prio(h)          xntwholder_prio(h)
+#define xntimerh_init(h)          xntwholder_init(h)
+
+typedef struct xntwheel xntimerq_t;
+
+#define xntimerq_init(q)          xntwheel_init(q)
+#define xntimerq_destroy(q)       do { } while (0)
+#define xntimerq_empty(q)         xntwheel_empty(q)
+#define xntimerq_head(q)          xntwheel_head(q)
+#define xntimerq_second(q)        xntwheel_second(q)
+#define xntimerq_insert(q, h)     xntwheel_insert((q),(h))
+#define xntimerq_remove(q, h)     xntwheel_remove((q),(h))
+
+typedef struct { } xntimerq_it_t;
+
+/*
+ * Same warning as with the binary heap: the iterator does NOT
+ * return elements in timestamp order.
+ */
+#define xntimerq_it_begin(q, i)   ((void) (i), xntwheel_first(q))
+#define xntimerq_it_next(q, i, h) ((void) (i), xntwheel_next((q),(h)))
+
 #else /* CONFIG_XENO_OPT_TIMER_LIST */
 
 typedef struct xntlholder xntimerh_t;
@@ -188,6 +217,8 @@ struct xnsched;
 
 struct xntimerdata {
 	xntimerq_t q;
+	/** Gravity of the clock on this CPU (raw clock ticks). */
+	struct xnclock_gravity gravity;
 };
 
 static inline struct xntimerdata *
@@ -223,6 +254,8 @@ struct xntimer {
 	xnticks_t pexpect_ticks;
 	/** Sched structure to which the timer is attached. */
 	struct xnsched *sched;
+	/** Clock gravity on the CPU of the attached sched structure. */
+	const struct xnclock_gravity *gravity;
 	/** Timeout handler. */
 	void (*handler)(struct xntimer *timer);
 #ifdef CONFIG_XENO_OPT_STATS
@@ -284,15 +317,15 @@ static inline xntimerq_t *xntimer_this_queue(struct xntimer *timer)
 
 static inline unsigned long xntimer_gravity(struct xntimer *timer)
 {
-	struct xnclock *clock = xntimer_clock(timer);
+	const struct xnclock_gravity *gravity = timer->gravity;
 
 	if (timer->status & XNTIMER_KGRAVITY)
-		return clock->gravity.kernel;
+		return gravity->kernel;
 
 	if (timer->status & XNTIMER_UGRAVITY)
-		return clock->gravity.user;
+		return gravity->user;
 
-	return clock->gravity.irq;
+	return gravity->irq;
 }
 
 static inline void xntimer_update_date(struct xntimer *timer)
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#ifndef _COBALT_KERNEL_TWHEEL_H
+#define _COBALT_KERNEL_TWHEEL_H
+
+#include <linux/rbtree.h>
+#include <cobalt/kernel/list.h>
+#include <cobalt/kernel/assert.h>
+
+/*
+ * Hierarchical timer wheel, with an exact near-term index.
+ *
+ * Timers due before the wheel horizon are kept in a date-ordered
+ * rbtree, which therefore always holds the earliest outstanding
+ * timer. Later timers are hashed in O(1) to a bucket of the wheel
+ * level covering their distance to the horizon, and only get sorted
+ * when the horizon eventually reaches their bucket. Timeouts which
+ * are cancelled before that point - i.e. most of them - never pay
+ * for ordering.
+ *
+ * All storage is embedded in the holders, so the queue never runs
+ * out of capacity.
+ */
+
+#define XNTWHEEL_LEVELS		4
+#define XNTWHEEL_LVL_BITS	6
+#define XNTWHEEL_LVL_SIZE	(1 << XNTWHEEL_LVL_BITS)
+#define XNTWHEEL_LVL_MASK	(XNTWHEEL_LVL_SIZE - 1)
+#define XNTWHEEL_SHIFT(l)						\
+	(CONFIG_XENO_OPT_TIMER_WHEEL_SHIFT + (l) * XNTWHEEL_LVL_BITS)
+
+/* Special holder levels. */
+#define XNTWHEEL_NEAR		(-1)
+#define XNTWHEEL_OVERFLOW	XNTWHEEL_LEVELS
+
+typedef unsigned long long xntwheel_key_t;
+
+struct xntwholder {
+	struct rb_node rb;
+	struct list_head link;
+	xntwheel_key_t key;
+	int prio;
+	int level;
+	unsigned int slot;
+};
+
+#define xntwholder_key(h)	((h)->key)
+#define xntwholder_prio(h)	((h)->prio)
+#define xntwholder_init(h)	do { } while (0)
+#define xntwholder_lt(h1, h2)	((long long)((h1)->key - (h2)->key) < 0 || \
+				 ((h1)->key == (h2)->key &&		\
+				  (h1)->prio > (h2)->prio))
+
+struct xntwheel {
+	/* Timers due before the horizon, in firing order. */
+	struct rb_root near;
+	struct rb_node *leftmost;
+	/* Start date of the wheel. */
+	xntwheel_key_t horizon;
+	/* Lower bound of the overflow dates. */
+	xntwheel_key_t ovfmin;
+	/* Number of timers hashed to the wheel, overflow included. */
+	unsigned long nr_hashed;
+	unsigned long long pending[XNTWHEEL_LEVELS];
+	struct list_head slots[XNTWHEEL_LEVELS][XNTWHEEL_LVL_SIZE];
+	struct list_head overflow;
+};
+
+void xntwheel_init(struct xntwheel *q);
+
+void xntwheel_cascade(struct xntwheel *q);
+
+void __xntwheel_enqueue(struct xntwheel *q, struct xntwholder *holder);
+
+struct xntwholder *xntwheel_next(struct xntwheel *q,
+				 struct xntwholder *holder);
+
+static inline void xntwheel_near_insert(struct xntwheel *q,
+					struct xntwholder *holder)
+{
+	struct rb_node **new = &q->near.rb_node, *parent = NULL;
+	struct xntwholder *p;
+	int leftmost = 1;
+
+	while (*new) {
+		parent = *new;
+		p = rb_entry(parent, struct xntwholder, rb);
+		if (xntwholder_lt(holder, p))
+			new = &parent->rb_left;
+		else {
+			new = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+
+	rb_link_node(&holder->rb, parent, new);
+	rb_insert_color(&holder->rb, &q->near);
+	holder->level = XNTWHEEL_NEAR;
+	if (leftmost)
+		q->leftmost = &holder->rb;
+}
+
+static inline int xntwheel_empty(struct xntwheel *q)
+{
+	return q->leftmost == NULL && q->nr_hashed == 0;
+}
+
+static inline void xntwheel_insert(struct xntwheel *q,
+				   struct xntwholder *holder)
+{
+	/*
+	 * Restart the wheel from the first date we get, so that a
+	 * lone timer goes straight to the near-term index.
+	 */
+	if (xntwheel_empty(q)) {
+		q->horizon = ((holder->key >> XNTWHEEL_SHIFT(0)) + 1)
+			<< XNTWHEEL_SHIFT(0);
+		xntwheel_near_insert(q, holder);
+		return;
+	}
+
+	__xntwheel_enqueue(q, holder);
+}
+
+static inline void xntwheel_remove(struct xntwheel *q,
+				   struct xntwholder *holder)
+{
+	struct list_head *bucket;
+
+	if (holder->level == XNTWHEEL_NEAR) {
+		if (q->leftmost == &holder->rb)
+			q->leftmost = rb_next(&holder->rb);
+		rb_erase(&holder->rb, &q->near);
+		return;
+	}
+
+	list_del(&holder->link);
+	q->nr_hashed--;
+	if (holder->level == XNTWHEEL_OVERFLOW)
+		return;
+
+	bucket = &q->slots[holder->level][holder->slot];
+	if (list_empty(bucket))
+		q->pending[holder->level] &= ~(1ULL << holder->slot);
+}
+
+static inline struct xntwholder *xntwheel_head(struct xntwheel *q)
+{
+	while (q->leftmost == NULL) {
+		if (q->nr_hashed == 0)
+			return NULL;
+		xntwheel_cascade(q);
+	}
+
+	return rb_entry(q->leftmost, struct xntwholder, rb);
+}
+
+static inline struct xntwholder *xntwheel_second(struct xntwheel *q)
+{
+	struct xntwholder *head = xntwheel_head(q);
+	struct rb_node *next;
+
+	if (head == NULL)
+		return NULL;
+
+	for (;;) {
+		next = rb_next(&head->rb);
+		if (next)
+			return rb_entry(next, struct xntwholder, rb);
+		if (q->nr_hashed == 0)
+			return NULL;
+		xntwheel_cascade(q);
+	}
+}
+
+static inline struct xntwholder *xntwheel_first(struct xntwheel *q)
+{
+	struct rb_node *first = rb_first(&q->near);
+
+	if (first)
+		return rb_entry(first, struct xntwholder, rb);
+
+	return q->nr_hashed ? xntwheel_next(q, NULL) : NULL;
+}
+
+#endif /* !_COBALT_KERNEL_TWHEEL_H */
@@ -106,6 +106,12 @@ void rt_syslog(int priority, const char *format, ...);
 
 void rt_vsyslog(int priority, const char *format, va_list args);
 
+int rt_vfbprintf(FILE *stream, const char *format, va_list args);
+
+int rt_fbprintf(FILE *stream, const char *format, ...);
+
+int rt_bprintf(const char *format, ...);
+
 int rt_print_init(size_t buffer_size, const char *name);
 
 void rt_print_cleanup(void);
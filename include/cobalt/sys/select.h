@@ -21,7 +21,10 @@
 #ifndef _COBALT_SYS_SELECT_H
 #define _COBALT_SYS_SELECT_H
 
+#include <poll.h>
+#include <time.h>
 #include <cobalt/wrappers.h>
+#include <cobalt/uapi/poll.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +34,14 @@ COBALT_DECL(int, select(int __nfds, fd_set *__restrict __readfds,
 			fd_set *__restrict __writefds,
 			fd_set *__restrict __exceptfds,
 			struct timeval *__restrict __timeout));
+
+int cobalt_poll_create(int flags);
+
+int cobalt_poll_ctl(int pfd, int op, int fd, unsigned int events);
+
+int cobalt_poll_wait(int pfd, struct pollfd *fds, int nrfds,
+		     const struct timespec *timeout);
+
 #ifdef __cplusplus
 }
 #endif
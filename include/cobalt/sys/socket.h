@@ -36,6 +36,16 @@ COBALT_DECL(ssize_t, recvmsg(int fd,
 COBALT_DECL(ssize_t, sendmsg(int fd,
 			     const struct msghdr *msg, int flags));
 
+#ifdef _GNU_SOURCE
+
+COBALT_DECL(int, recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+			  unsigned int flags, struct timespec *timeout));
+
+COBALT_DECL(int, sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+			  unsigned int flags));
+
+#endif /* _GNU_SOURCE */
+
 COBALT_DECL(ssize_t, recvfrom(int fd, void *buf, size_t len, int flags,
 			      struct sockaddr *from, socklen_t *fromlen));
 
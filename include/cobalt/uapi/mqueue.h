@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_MQUEUE_H
+#define _COBALT_UAPI_MQUEUE_H
+
+#include <cobalt/uapi/kernel/types.h>
+
+#define COBALT_MQ_PRIOMAX	32768
+
+/*
+ * Small message queues keep their messages in slots laid out in the
+ * shared memory heap, right after the state header. Both the kernel
+ * and userland may queue or dequeue messages there without locking,
+ * the kernel only being involved for waiting or waking up threads.
+ *
+ * @nfree and @nready count the free and queued slots available for
+ * reservation: a slot of the proper kind is guaranteed to exist for
+ * any caller which succeeded in decrementing either count, and may
+ * be claimed next. @flags is only ever updated by the kernel, under
+ * lock.
+ */
+struct cobalt_mq_state {
+	__u32 flags;
+#define COBALT_MQ_RCVWAIT  0x1
+#define COBALT_MQ_SNDWAIT  0x2
+#define COBALT_MQ_SYNC     0x4
+	atomic_t nfree;
+	atomic_t nready;
+	atomic_t seq;
+	__u32 maxmsg;
+	__u32 msgsize;
+	__u32 slotsize;
+	__u32 pad;
+};
+
+/*
+ * The status word of a slot carries a generation count bumped on
+ * every transition, so that a slot which went through a full
+ * free/queued cycle while being looked at is never mistaken for the
+ * one previously observed.
+ *
+ * @owner is the handle of the thread which claimed the slot, valid
+ * only while @claim matches the status word. This allows the kernel
+ * to recover the slots left busy by threads which went away. Since
+ * both are written after the status word, a busy slot also carries
+ * the low bits of the owner's registry index in its status word, so
+ * that the kernel may still recover it if the owner went away in
+ * between.
+ */
+struct cobalt_mq_slot {
+	atomic_t status;
+#define COBALT_MQ_SLOT_FREE   0
+#define COBALT_MQ_SLOT_BUSY   1
+#define COBALT_MQ_SLOT_READY  2
+#define COBALT_MQ_SLOT_MASK   3
+#define COBALT_MQ_SLOT_HINTSHIFT  2
+#define COBALT_MQ_SLOT_HINTMASK   0xfff
+#define COBALT_MQ_SLOT_GEN    (1 << 14)
+	__u32 prio;
+	__u32 seq;
+	__u32 len;
+	__u32 owner;
+	__u32 claim;
+	char data[0];
+};
+
+/* Synchronization events (mq_sync). */
+#define COBALT_MQ_FILLED  0x1
+
+/*
+ * The slot geometry is passed explicitly to the helpers below, so
+ * that the kernel never trusts the copy userland may write to.
+ */
+static inline struct cobalt_mq_slot *
+cobalt_mq_get_slot(struct cobalt_mq_state *state,
+		   unsigned int slotsize, unsigned int n)
+{
+	return (struct cobalt_mq_slot *)((char *)(state + 1) + n * slotsize);
+}
+
+static inline int cobalt_mq_reserve(atomic_t *count)
+{
+	int old, val = atomic_read(count);
+
+	do {
+		if (val <= 0)
+			return 0;
+		old = val;
+		val = atomic_cmpxchg(count, old, old - 1);
+	} while (val != old);
+
+	return 1;
+}
+
+/* Increment a count, returning its previous value. */
+static inline int cobalt_mq_fetch_inc(atomic_t *count)
+{
+	int old, val = atomic_read(count);
+
+	do {
+		old = val;
+		val = atomic_cmpxchg(count, old, old + 1);
+	} while (val != old);
+
+	return old;
+}
+
+static inline int cobalt_mq_slot_hint(int status)
+{
+	return (status >> COBALT_MQ_SLOT_HINTSHIFT) & COBALT_MQ_SLOT_HINTMASK;
+}
+
+static inline int cobalt_mq_next_status(int status, int new,
+					xnhandle_t owner)
+{
+	unsigned int next;
+
+	next = ((unsigned int)status & ~(COBALT_MQ_SLOT_GEN - 1)) +
+		COBALT_MQ_SLOT_GEN;
+	next |= (xnhandle_get_index(owner) & COBALT_MQ_SLOT_HINTMASK)
+		<< COBALT_MQ_SLOT_HINTSHIFT;
+
+	return (int)(next | new);
+}
+
+static inline int cobalt_mq_move_slot(struct cobalt_mq_slot *slot,
+				      int status, int new)
+{
+	int next = cobalt_mq_next_status(status, new, XN_NO_HANDLE);
+
+	return atomic_cmpxchg(&slot->status, status, next) == status;
+}
+
+/* Busy the slot on behalf of @owner. */
+static inline int cobalt_mq_grab_slot(struct cobalt_mq_slot *slot,
+				      int status, xnhandle_t owner)
+{
+	int next = cobalt_mq_next_status(status, COBALT_MQ_SLOT_BUSY, owner);
+
+	if (atomic_cmpxchg(&slot->status, status, next) != status)
+		return 0;
+
+	slot->owner = owner;
+	smp_wmb();
+	slot->claim = next;
+
+	return 1;
+}
+
+/*
+ * Claim a free slot, which the caller must have reserved from
+ * @nfree. At most @maxscans passes are made over the slots, zero
+ * meaning no limit. Returns NULL if none could be claimed.
+ */
+static inline struct cobalt_mq_slot *
+cobalt_mq_claim_free(struct cobalt_mq_state *state,
+		     unsigned int maxmsg, unsigned int slotsize,
+		     unsigned int maxscans, xnhandle_t owner)
+{
+	struct cobalt_mq_slot *slot;
+	unsigned int n, scans;
+	int status;
+
+	for (scans = 0; maxscans == 0 || scans < maxscans; scans++) {
+		for (n = 0; n < maxmsg; n++) {
+			slot = cobalt_mq_get_slot(state, slotsize, n);
+			status = atomic_read(&slot->status);
+			if ((status & COBALT_MQ_SLOT_MASK) == COBALT_MQ_SLOT_FREE &&
+			    cobalt_mq_grab_slot(slot, status, owner))
+				return slot;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Claim the queued slot with the highest priority, the oldest one
+ * among equals. The caller must have reserved it from @nready. Same
+ * rules as cobalt_mq_claim_free() for @maxscans.
+ */
+static inline struct cobalt_mq_slot *
+cobalt_mq_claim_ready(struct cobalt_mq_state *state,
+		      unsigned int maxmsg, unsigned int slotsize,
+		      unsigned int maxscans, xnhandle_t owner)
+{
+	struct cobalt_mq_slot *slot, *best;
+	__u32 prio, seq, bprio = 0, bseq = 0;
+	int status, bstatus = 0;
+	unsigned int n, scans;
+
+	for (scans = 0; maxscans == 0 || scans < maxscans; scans++) {
+		best = NULL;
+		for (n = 0; n < maxmsg; n++) {
+			slot = cobalt_mq_get_slot(state, slotsize, n);
+			status = atomic_read(&slot->status);
+			if ((status & COBALT_MQ_SLOT_MASK) != COBALT_MQ_SLOT_READY)
+				continue;
+			smp_rmb();
+			prio = slot->prio;
+			seq = slot->seq;
+			smp_rmb();
+			if (atomic_read(&slot->status) != status)
+				continue;
+			if (best == NULL || prio > bprio ||
+			    (prio == bprio && (int)(seq - bseq) < 0)) {
+				best = slot;
+				bstatus = status;
+				bprio = prio;
+				bseq = seq;
+			}
+		}
+		if (best && cobalt_mq_grab_slot(best, bstatus, owner))
+			return best;
+	}
+
+	return NULL;
+}
+
+/*
+ * Queue a claimed slot filled with a message. Returns the count of
+ * queued messages before this one.
+ */
+static inline int cobalt_mq_publish(struct cobalt_mq_state *state,
+				    struct cobalt_mq_slot *slot,
+				    unsigned int prio, size_t len)
+{
+	slot->prio = prio;
+	slot->len = len;
+	slot->seq = cobalt_mq_fetch_inc(&state->seq);
+	smp_wmb();
+	cobalt_mq_move_slot(slot, atomic_read(&slot->status),
+			    COBALT_MQ_SLOT_READY);
+
+	return cobalt_mq_fetch_inc(&state->nready);
+}
+
+/*
+ * Release a claimed slot to the free pool. Returns the count of
+ * free slots before this one.
+ */
+static inline int cobalt_mq_release(struct cobalt_mq_state *state,
+				    struct cobalt_mq_slot *slot)
+{
+	smp_mb();
+	cobalt_mq_move_slot(slot, atomic_read(&slot->status),
+			    COBALT_MQ_SLOT_FREE);
+
+	return cobalt_mq_fetch_inc(&state->nfree);
+}
+
+#endif /* !_COBALT_UAPI_MQUEUE_H */
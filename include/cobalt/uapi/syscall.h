@@ -115,6 +115,13 @@
 #define sc_cobalt_backtrace			92
 #define sc_cobalt_serialdbg			93
 #define sc_cobalt_extend			94
+#define sc_cobalt_recvmmsg			95
+#define sc_cobalt_sendmmsg			96
+#define sc_cobalt_poll_create			97
+#define sc_cobalt_poll_ctl			98
+#define sc_cobalt_poll_wait			99
+#define sc_cobalt_mq_state			100
+#define sc_cobalt_mq_sync			101
 
 #define __NR_COBALT_SYSCALLS			128 /* Power of 2 */
 
@@ -73,8 +73,22 @@ void *malloc_ex(size_t size, void *pool);
 void free_ex(void *pool, void *ptr);
 void *tlsf_malloc(size_t size);
 void tlsf_free(void *ptr);
+int tlsf_malloc_batch(size_t size, void **blocks, int nr);
+void tlsf_free_batch(void **blocks, int nr);
 size_t malloc_usable_size_ex(void *ptr, void *pool);
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *pvmalloc(size_t size);
+
+void pvfree(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
 static inline
 void pvheapobj_destroy(struct heapobj *hobj)
 {
@@ -115,16 +129,6 @@ size_t pvheapobj_inquire(struct heapobj *hobj)
 	return get_used_size(hobj->pool);
 }
 
-static inline void *pvmalloc(size_t size)
-{
-	return tlsf_malloc(size);
-}
-
-static inline void pvfree(void *ptr)
-{
-	tlsf_free(ptr);
-}
-
 static inline char *pvstrdup(const char *ptr)
 {
 	char *str;
@@ -451,6 +455,45 @@ static inline char *xnstrdup(const char *ptr)
 
 #endif	/* !CONFIG_XENO_PSHARED */
 
+/*
+ * Pools of fixed-size objects, recycled through a lock-free free
+ * list. Objects are never returned to the underlying heap. A pool
+ * backed by a heap object draws its objects one at a time from it,
+ * so they remain valid blocks of that heap. Otherwise, objects are
+ * rounded up to a cache line and carved out of the main heap by
+ * batches. Pool descriptors may live in shared memory.
+ */
+struct heapobj_slab {
+	uint64_t freelist;
+	uintptr_t heap;
+	unsigned int objsize;
+	int nr_free;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void heapobj_slab_init(struct heapobj_slab *slab,
+		       struct heapobj *hobj, size_t size);
+
+void *heapobj_slab_alloc(struct heapobj_slab *slab);
+
+void heapobj_slab_free(struct heapobj_slab *slab, void *ptr);
+
+void *xnslab_alloc(size_t size);
+
+void xnslab_free(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline size_t heapobj_slab_cached(struct heapobj_slab *slab)
+{
+	return (size_t)slab->nr_free * slab->objsize;
+}
+
 static inline const char *heapobj_name(struct heapobj *hobj)
 {
 	return hobj->name;
@@ -285,14 +285,17 @@ void *__threadobj_alloc(size_t tcb_struct_size,
 			size_t wait_union_size,
 			int thobj_offset);
 
-static inline void __threadobj_free(void *p)
+static inline void __threadobj_free(void *p, size_t size)
 {
-	xnfree(p);
+	xnslab_free(p, size);
 }
 
 static inline void threadobj_free(struct threadobj *thobj)
 {
-	__threadobj_free((unsigned char *)thobj - thobj->core_offset);
+	unsigned char *p = (unsigned char *)thobj - thobj->core_offset;
+
+	__threadobj_free(p, (unsigned char *)thobj->wait_union - p +
+			 thobj->wait_size);
 }
 
 int threadobj_init(struct threadobj *thobj,
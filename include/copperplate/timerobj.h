@@ -24,13 +24,20 @@
 #include <boilerplate/list.h>
 #include <boilerplate/lock.h>
 
+struct timerobj_server;
+
 struct timerobj {
 	struct itimerspec itspec;
 	void (*handler)(struct timerobj *tmobj);
 	timer_t timer;
 	pthread_mutex_t lock;
 	int cancel_state;
-	struct pvholder next;
+	struct timerobj_server *server;
+	/* Pairing heap links, owned by the server. */
+	struct timerobj *child;
+	struct timerobj *sibling;
+	struct timerobj *prev;
+	int queued;
 };
 
 static inline int timerobj_lock(struct timerobj *tmobj)
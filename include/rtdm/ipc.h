@@ -20,7 +20,68 @@
 #ifndef _RTDM_IPC_H
 #define _RTDM_IPC_H
 
+#include <string.h>
 #include <rtdm/rtdm.h>
 #include <rtdm/uapi/ipc.h>
 
+/*
+ * BUFP ring helpers, for the single user space producer or consumer
+ * of a ring mapped via BUFP_MAP. Data moves without any system call
+ * unless the caller has to wait, in which case the regular blocking
+ * send/recv path is used. Return values follow send() and recv().
+ */
+static inline ssize_t bufp_ring_write(int s, struct bufp_ring *ring,
+				      const void *buf, size_t len)
+{
+	volatile struct bufp_ring *r = ring;
+	char *data = (char *)ring + ring->offset;
+	__u32 head = r->head, off;
+	size_t n;
+
+	if (len > ring->size || head - r->tail + len > ring->size)
+		return send(s, buf, len, 0);
+
+	/* Do not overwrite data the consumer may still read. */
+	__sync_synchronize();
+	off = head & (ring->size - 1);
+	n = ring->size - off < len ? ring->size - off : len;
+	memcpy(data + off, buf, n);
+	memcpy(data, (const char *)buf + n, len - n);
+	__sync_synchronize();
+	r->head = head + len;
+	__sync_synchronize();
+
+	if (r->rdwait || r->selwait)
+		setsockopt(s, SOL_BUFP, BUFP_NOTIFY, NULL, 0);
+
+	return len;
+}
+
+static inline ssize_t bufp_ring_read(int s, struct bufp_ring *ring,
+				     void *buf, size_t len)
+{
+	volatile struct bufp_ring *r = ring;
+	char *data = (char *)ring + ring->offset;
+	__u32 tail = r->tail, off;
+	size_t n;
+
+	if (r->head - tail < len)
+		return recv(s, buf, len, 0);
+
+	/* Read the data only after we saw the producer index. */
+	__sync_synchronize();
+	off = tail & (ring->size - 1);
+	n = ring->size - off < len ? ring->size - off : len;
+	memcpy(buf, data + off, n);
+	memcpy((char *)buf + n, data, len - n);
+	__sync_synchronize();
+	r->tail = tail + len;
+	__sync_synchronize();
+
+	if (r->wrwait || r->selwait)
+		setsockopt(s, SOL_BUFP, BUFP_NOTIFY, NULL, 0);
+
+	return len;
+}
+
 #endif /* !_RTDM_IPC_H */
@@ -30,11 +30,21 @@ struct autotune_setup {
 	__u32 quiet;
 };
 
+/* Per-CPU gravity values, in nanoseconds. */
+struct autotune_gravity {
+	__u32 cpu;
+	__u32 irq;
+	__u32 kernel;
+	__u32 user;
+};
+
 #define AUTOTUNE_RTIOC_IRQ		_IOW(RTDM_CLASS_AUTOTUNE, 0, struct autotune_setup)
 #define AUTOTUNE_RTIOC_KERN		_IOW(RTDM_CLASS_AUTOTUNE, 1, struct autotune_setup)
 #define AUTOTUNE_RTIOC_USER		_IOW(RTDM_CLASS_AUTOTUNE, 2, struct autotune_setup)
 #define AUTOTUNE_RTIOC_PULSE		_IOW(RTDM_CLASS_AUTOTUNE, 3, __u64)
 #define AUTOTUNE_RTIOC_RUN		_IOR(RTDM_CLASS_AUTOTUNE, 4, __u32)
 #define AUTOTUNE_RTIOC_RESET		_IO(RTDM_CLASS_AUTOTUNE, 5)
+#define AUTOTUNE_RTIOC_GET_GRAVITY	_IOWR(RTDM_CLASS_AUTOTUNE, 6, struct autotune_gravity)
+#define AUTOTUNE_RTIOC_SET_GRAVITY	_IOW(RTDM_CLASS_AUTOTUNE, 7, struct autotune_gravity)
 
 #endif /* !_RTDM_UAPI_AUTOTUNE_H */
@@ -764,8 +764,199 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define IDDP_POOLSZ		2
+/**
+ * IDDP slot pool configuration
+ *
+ * Set up a pool of fixed-size message slots for the socket, which is
+ * allocated at binding time and can be mapped into user space via
+ * @ref IDDP_MAP. Senders then fill a slot in place and pass its
+ * index, receivers get the location of the payload in the pool and
+ * release the slot when done with it, so that datagrams are never
+ * copied (see @ref IDDP_GETSLOT, @ref IDDP_PUTSLOT, @ref
+ * IDDP_RECVSLOT and @ref IDDP_RELEASE).
+ *
+ * Regular send and receive calls keep working on such socket, moving
+ * data through the slots, in which case datagrams larger than the
+ * slot size are rejected. A slot pool supersedes any local pool size
+ * set via @ref IDDP_POOLSZ.
+ *
+ * It is not allowed to configure a slot pool after the socket was
+ * bound. However, multiple configuration calls are allowed prior to
+ * the binding; the last value set will be used.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_SLOTS
+ * @param [in] optval Pointer to struct iddp_slotconf. Both fields set
+ * to zero disable the slot pool.
+ * @param [in] optlen sizeof(struct iddp_slotconf)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid, or only one of the fields is zero)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_SLOTS		3
+/**
+ * IDDP slot pool mapping
+ *
+ * Map the slot pool of the socket into the address space of the
+ * caller if the socket has one, otherwise the pool of the connected
+ * peer. Slot offsets returned by @ref IDDP_GETSLOT and @ref
+ * IDDP_RECVSLOT are relative to the mapping address. The mapping
+ * remains valid after the socket is closed, until it is unmapped.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_MAP
+ * @param [out] optval Pointer to a variable of type void *, receiving
+ * the address of the mapping.
+ * @param [in,out] optlen sizeof(void *)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * - -ENXIO (neither the socket nor its peer has a slot pool)
+ * - -EPERM (caller is not a user space thread)
+ * .
+ *
+ * @par Calling context:
+ * non-RT
+ */
+#define IDDP_MAP		4
+/**
+ * IDDP slot allocation
+ *
+ * Obtain a free slot from the pool of the connected peer, waiting for
+ * one to be released if none is available, according to the
+ * SO_SNDTIMEO setting. The slot should be filled in place, then
+ * passed to @ref IDDP_PUTSLOT by the same socket. Slots still
+ * unposted when the socket is closed are given back to the peer.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_GETSLOT
+ * @param [out] optval Pointer to struct iddp_slot, receiving the slot
+ * index, its offset in the pool mapping, its size in @a len and the
+ * destination port.
+ * @param [in,out] optlen sizeof(struct iddp_slot)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * - -EDESTADDRREQ (socket is not connected)
+ * - -EOPNOTSUPP (peer has no slot pool)
+ * - -ECONNRESET, -ECONNREFUSED (peer is gone or unbound)
+ * - -ETIMEDOUT (no slot released in time)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_GETSLOT		5
+/**
+ * IDDP slot posting
+ *
+ * Queue a slot obtained via @ref IDDP_GETSLOT to the connected peer,
+ * as a datagram of @a len bytes.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_PUTSLOT
+ * @param [in] optval Pointer to struct iddp_slot, giving the slot
+ * index and the datagram length.
+ * @param [in] optlen sizeof(struct iddp_slot)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid, the slot was not obtained by
+ * this socket or the length exceeds the slot size)
+ * - -EDESTADDRREQ (socket is not connected)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_PUTSLOT		6
+/**
+ * IDDP zero-copy receive
+ *
+ * Pull the next datagram from the input queue of a socket owning a
+ * slot pool, waiting for one according to the SO_RCVTIMEO
+ * setting. The payload is left in place, the caller must pass the
+ * slot index to @ref IDDP_RELEASE once done with it.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_RECVSLOT
+ * @param [out] optval Pointer to struct iddp_slot, receiving the slot
+ * index, the offset of the payload in the pool mapping, its length
+ * and the source port.
+ * @param [in,out] optlen sizeof(struct iddp_slot)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * - -EOPNOTSUPP (socket has no slot pool)
+ * - -ETIMEDOUT (no datagram received in time)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_RECVSLOT		7
+/**
+ * IDDP slot release
+ *
+ * Give back a slot obtained via @ref IDDP_RECVSLOT to the pool.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_RELEASE
+ * @param [in] optval Pointer to a variable of type __u32, containing
+ * the slot index.
+ * @param [in] optlen sizeof(__u32)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid, or the slot is not held by the
+ * receiver)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_RELEASE		8
 /** @} */
 
+/**
+ * IDDP slot pool geometry.
+ */
+struct iddp_slotconf {
+	/** Number of slots. */
+	__u32 count;
+	/** Slot size in bytes, rounded up to the cache line size. */
+	__u32 size;
+};
+
+/**
+ * IDDP slot descriptor.
+ */
+struct iddp_slot {
+	/** Slot index in the pool. */
+	__u32 index;
+	/** Offset of the payload from the pool mapping. */
+	__u32 offset;
+	/** Payload or slot length. */
+	__u32 len;
+	/** Source or destination port. */
+	__s32 port;
+};
+
 #define SOL_BUFP		313
 /**
  * @anchor sockopts_bufp @name BUFP socket options
@@ -833,8 +1024,121 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define BUFP_BUFSZ		2
+/**
+ * BUFP ring mode
+ *
+ * In ring mode, the socket buffer is laid out as a single-producer,
+ * single-consumer byte ring preceded by a control page (see struct
+ * bufp_ring), which user space may map via @ref BUFP_MAP. A mapping
+ * process can then move data in and out of the ring without issuing
+ * any system call, as long as there is no need to wait.
+ *
+ * The regular send/receive calls keep working on a socket in ring
+ * mode, and serialize multiple kernel-side writers as usual. However,
+ * only a single producer and a single consumer may update the ring
+ * indexes directly from user space.
+ *
+ * Ring mode must be enabled prior to binding the socket, and the
+ * buffer size set via @ref BUFP_BUFSZ must be a power of two.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_RING
+ * @param [in] optval Pointer to a variable of type int, containing a
+ * non-zero value to enable ring mode, zero to disable it.
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid, or the buffer size is not a power
+ * of two)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_RING		3
+/**
+ * BUFP ring mapping
+ *
+ * Map the ring of a BUFP socket into the address space of the
+ * caller. If the socket is bound in ring mode, its own ring is mapped
+ * (consumer side), otherwise the ring of the connected peer is
+ * (producer side). The mapping remains valid after the socket is
+ * closed, until it is unmapped.
+ *
+ * The size of the mapping is the offset of the data area plus the
+ * buffer size rounded up to the next page boundary, as found in the
+ * control page.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_MAP
+ * @param [out] optval Pointer to a variable of type void *, receiving
+ * the address of the control page.
+ * @param [in,out] optlen sizeof(void *)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * - -ENXIO (neither the socket nor its peer has a ring)
+ * - -EPERM (caller is not a user space thread)
+ * .
+ *
+ * @par Calling context:
+ * non-RT
+ */
+#define BUFP_MAP		4
+/**
+ * BUFP ring doorbell
+ *
+ * Tell the kernel that the ring indexes were updated from user space,
+ * so that threads waiting for data or room on the socket and on its
+ * connected peer are woken up if they may proceed. A producer or
+ * consumer only needs to ring the doorbell when the @a rdwait or
+ * @a wrwait flag is raised in the control page, or @a selwait once
+ * the socket was bound to a selector.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_NOTIFY
+ * @param [in] optval Ignored
+ * @param [in] optlen Ignored
+ *
+ * @return 0 is returned upon success.
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_NOTIFY		5
 /** @} */
 
+/**
+ * BUFP ring control page.
+ *
+ * @a head and @a tail are free-running byte counts, the fill level
+ * of the ring is @a head - @a tail. The producer and the consumer
+ * indexes live in separate cache lines.
+ */
+struct bufp_ring {
+	/** Size of the data area (power of two). */
+	__u32 size;
+	/** Offset of the data area from the control page. */
+	__u32 offset;
+	/** Non-zero once select() or poll() was bound to the socket. */
+	__u32 selwait;
+	__u32 __pad1[13];
+	/** Producer index. */
+	__u32 head;
+	/** Non-zero when a writer waits for room. */
+	__u32 wrwait;
+	__u32 __pad2[14];
+	/** Consumer index. */
+	__u32 tail;
+	/** Non-zero when a reader waits for data. */
+	__u32 rdwait;
+};
+
 /**
  * @anchor sockopts_socket @name Socket level options
  * Setting and getting supported standard socket level options.
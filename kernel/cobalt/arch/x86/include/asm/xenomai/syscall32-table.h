@@ -68,10 +68,15 @@ __COBALT_CALL32emu_THUNK(monitor_wait)
 __COBALT_CALL32emu_THUNK(event_wait)
 __COBALT_CALL32emu_THUNK(select)
 __COBALT_CALL32x_THUNK(select)
+__COBALT_CALL32emu_THUNK(poll_wait)
 __COBALT_CALL32emu_THUNK(recvmsg)
 __COBALT_CALL32x_THUNK(recvmsg)
 __COBALT_CALL32emu_THUNK(sendmsg)
 __COBALT_CALL32x_THUNK(sendmsg)
+__COBALT_CALL32emu_THUNK(recvmmsg)
+__COBALT_CALL32x_THUNK(recvmmsg)
+__COBALT_CALL32emu_THUNK(sendmmsg)
+__COBALT_CALL32x_THUNK(sendmmsg)
 __COBALT_CALL32emu_THUNK(mmap)
 __COBALT_CALL32x_THUNK(mmap)
 __COBALT_CALL32emu_THUNK(backtrace)
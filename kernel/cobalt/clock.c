@@ -486,12 +486,26 @@ void print_core_clock_status(struct xnclock *clock,
 static int clock_show(struct xnvfile_regular_iterator *it, void *data)
 {
 	struct xnclock *clock = xnvfile_priv(it->vfile);
+	struct xnclock_gravity gravity;
+	int cpu;
 
 	xnvfile_printf(it, "%7s: irq=%Ld kernel=%Ld user=%Ld\n", "gravity",
 		       xnclock_ticks_to_ns(clock, xnclock_get_gravity(clock, irq)),
 		       xnclock_ticks_to_ns(clock, xnclock_get_gravity(clock, kernel)),
 		       xnclock_ticks_to_ns(clock, xnclock_get_gravity(clock, user)));
 
+	/* Only mention the CPUs which have specific settings. */
+	for_each_realtime_cpu(cpu) {
+		xnclock_get_cpu_gravity(clock, cpu, &gravity);
+		if (memcmp(&gravity, &clock->gravity, sizeof(gravity)) == 0)
+			continue;
+		xnvfile_printf(it, "%7s: cpu=%d irq=%Ld kernel=%Ld user=%Ld\n",
+			       "gravity", cpu,
+			       xnclock_ticks_to_ns(clock, gravity.irq),
+			       xnclock_ticks_to_ns(clock, gravity.kernel),
+			       xnclock_ticks_to_ns(clock, gravity.user));
+	}
+
 	xnclock_print_status(clock, it);
 
 	xnvfile_printf(it, "%7s: %Lu\n", "ticks", xnclock_read_raw(clock));
@@ -610,6 +624,7 @@ int xnclock_register(struct xnclock *clock)
 	for_each_online_cpu(cpu) {
 		tmd = xnclock_percpu_timerdata(clock, cpu);
 		xntimerq_init(&tmd->q);
+		tmd->gravity = clock->gravity;
 	}
 
 #ifdef CONFIG_XENO_OPT_STATS
@@ -622,6 +637,86 @@ int xnclock_register(struct xnclock *clock)
 }
 EXPORT_SYMBOL_GPL(xnclock_register);
 
+/**
+ * @fn void xnclock_spread_gravity(struct xnclock *clock)
+ * @brief Apply the clock-wide gravity to all CPUs.
+ *
+ * Timers anticipate their shots according to the gravity set for
+ * the CPU they are attached to. This service copies the clock-wide
+ * gravity to every CPU, dropping any per-CPU setting.
+ *
+ * @param clock The clock to update.
+ *
+ * @coretags{unrestricted}
+ */
+void xnclock_spread_gravity(struct xnclock *clock)
+{
+	struct xntimerdata *tmd;
+	int cpu;
+
+	/* We may be called before the clock is registered. */
+	if (clock->timerdata == NULL)
+		return;
+
+	for_each_online_cpu(cpu) {
+		tmd = xnclock_percpu_timerdata(clock, cpu);
+		tmd->gravity = clock->gravity;
+	}
+}
+EXPORT_SYMBOL_GPL(xnclock_spread_gravity);
+
+/**
+ * @fn void xnclock_get_cpu_gravity(struct xnclock *clock, int cpu, struct xnclock_gravity *gravity)
+ * @brief Get the gravity of a clock on a given CPU.
+ *
+ * @param clock The clock to query.
+ *
+ * @param cpu The CPU to query the gravity for.
+ *
+ * @param gravity Filled with the gravity values in raw clock ticks.
+ *
+ * @coretags{unrestricted}
+ */
+void xnclock_get_cpu_gravity(struct xnclock *clock, int cpu,
+			     struct xnclock_gravity *gravity)
+{
+	*gravity = xnclock_percpu_timerdata(clock, cpu)->gravity;
+}
+EXPORT_SYMBOL_GPL(xnclock_get_cpu_gravity);
+
+/**
+ * @fn int xnclock_set_cpu_gravity(struct xnclock *clock, int cpu, const struct xnclock_gravity *gravity)
+ * @brief Set the gravity of a clock on a given CPU.
+ *
+ * This service sets the amount of time by which timers attached to
+ * @a cpu anticipate their shots, which may differ between CPUs
+ * with unequal wakeup latencies. The new values apply to timers
+ * started next.
+ *
+ * @param clock The clock to update.
+ *
+ * @param cpu The real-time CPU to set the gravity for.
+ *
+ * @param gravity The gravity values in raw clock ticks.
+ *
+ * @return 0 is returned on success, or -EINVAL if @a cpu is not a
+ * real-time CPU.
+ *
+ * @coretags{unrestricted}
+ */
+int xnclock_set_cpu_gravity(struct xnclock *clock, int cpu,
+			    const struct xnclock_gravity *gravity)
+{
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_online(cpu) ||
+	    !xnsched_supported_cpu(cpu))
+		return -EINVAL;
+
+	xnclock_percpu_timerdata(clock, cpu)->gravity = *gravity;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnclock_set_cpu_gravity);
+
 /**
  * @fn void xnclock_deregister(struct xnclock *clock)
  * @brief Deregister a Xenomai clock.
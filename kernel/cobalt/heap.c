@@ -21,6 +21,7 @@
 #include <linux/slab.h>
 #include <linux/kernel.h>
 #include <linux/log2.h>
+#include <linux/percpu.h>
 #include <cobalt/kernel/assert.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/vfile.h>
@@ -57,6 +58,8 @@ struct vfile_priv {
 struct vfile_data {
 	size_t all_mem;
 	size_t free_mem;
+	unsigned long hits;
+	unsigned long misses;
 	char name[XNOBJECT_NAME_LEN];
 };
 
@@ -99,6 +102,7 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 
 	p->all_mem = xnheap_get_size(heap);
 	p->free_mem = xnheap_get_free(heap);
+	xnheap_get_magstats(heap, &p->hits, &p->misses);
 	knamecpy(p->name, heap->name);
 
 	return 1;
@@ -109,12 +113,14 @@ static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 	struct vfile_data *p = data;
 
 	if (p == NULL)
-		xnvfile_printf(it, "%9s %9s  %s\n",
-			       "TOTAL", "FREE", "NAME");
+		xnvfile_printf(it, "%9s %9s %10s %10s  %s\n",
+			       "TOTAL", "FREE", "MAGHIT", "MAGMISS", "NAME");
 	else
-		xnvfile_printf(it, "%9Zu %9Zu  %s\n",
+		xnvfile_printf(it, "%9Zu %9Zu %10lu %10lu  %s\n",
 			       p->all_mem,
 			       p->free_mem,
+			       p->hits,
+			       p->misses,
 			       p->name);
 	return 0;
 }
@@ -228,6 +234,9 @@ int xnheap_init(struct xnheap *heap, void *membase, u32 size)
 
 	xnlock_init(&heap->lock);
 	init_freelist(heap);
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	heap->percpu = NULL;
+#endif
 
 	/* Default name, override with xnheap_set_name() */
 	ksformat(heap->name, sizeof(heap->name), "(%p)", heap);
@@ -263,6 +272,10 @@ void xnheap_destroy(struct xnheap *heap)
 	nrheaps--;
 	xnvfile_touch_tag(&vfile_tag);
 	xnlock_put_irqrestore(&nklock, s);
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	if (heap->percpu)
+		free_percpu(heap->percpu);
+#endif
 	kfree(heap->pagemap);
 }
 EXPORT_SYMBOL_GPL(xnheap_destroy);
@@ -379,122 +392,47 @@ splitpage:
 	return headpage;
 }
 
-/**
- * @fn void *xnheap_alloc(struct xnheap *heap, u32 size)
- * @brief Allocate a memory block from a memory heap.
- *
- * Allocates a contiguous region of memory from an active memory heap.
- * Such allocation is guaranteed to be time-bounded.
- *
- * @param heap The descriptor address of the heap to get memory from.
- *
- * @param size The size in bytes of the requested block. Sizes lower
- * or equal to the page size are rounded either to the minimum
- * allocation size if lower than this value, or to the minimum
- * alignment size if greater or equal to this value. In the current
- * implementation, with MINALLOC = 8 and MINALIGN = 16, a 7 bytes
- * request will be rounded to 8 bytes, and a 17 bytes request will be
- * rounded to 32.
- *
- * @return The address of the allocated region upon success, or NULL
- * if no memory is available from the specified heap.
- *
- * @coretags{unrestricted}
+/*
+ * alloc_block() -- Pick a 2 ** log2size block from the bucketed
+ * memory space, replenishing the bucket with a new page as
+ * needed. The caller must have acquired the heap lock.
  */
-void *xnheap_alloc(struct xnheap *heap, u32 size)
+static caddr_t alloc_block(struct xnheap *heap, int log2size)
 {
-	u32 pagenum, bsize;
-	int log2size, ilog;
+	int ilog = log2size - XNHEAP_MINLOG2;
+	u32 pagenum, bsize = 1 << log2size;
 	caddr_t block;
-	spl_t s;
-
-	if (size == 0)
-		return NULL;
 
-	/*
-	 * Sizes lower or equal to the page size are rounded either to
-	 * the minimum allocation size if lower than this value, or to
-	 * the minimum alignment size if greater or equal to this
-	 * value.
-	 */
-	if (size > XNHEAP_PAGESZ)
-		size = ALIGN(size, XNHEAP_PAGESZ);
-	else if (size <= XNHEAP_MINALIGNSZ)
-		size = ALIGN(size, XNHEAP_MINALLOCSZ);
-	else
-		size = ALIGN(size, XNHEAP_MINALIGNSZ);
-
-	/*
-	 * It is more space efficient to directly allocate pages from
-	 * the free page list whenever the requested size is greater
-	 * than 2 times the page size. Otherwise, use the bucketed
-	 * memory blocks.
-	 */
-	if (likely(size <= XNHEAP_PAGESZ * 2)) {
-		/*
-		 * Find the first power of two greater or equal to the
-		 * rounded size.
-		 */
-		bsize = size < XNHEAP_MINALLOCSZ ? XNHEAP_MINALLOCSZ : size;
-		log2size = order_base_2(bsize);
-		bsize = 1 << log2size;
-		ilog = log2size - XNHEAP_MINLOG2;
-		xnlock_get_irqsave(&heap->lock, s);
-		block = heap->buckets[ilog].freelist;
-		if (block == NULL) {
-			block = get_free_range(heap, bsize, log2size);
-			if (block == NULL)
-				goto out;
-			if (bsize <= XNHEAP_PAGESZ)
-				heap->buckets[ilog].fcount += (XNHEAP_PAGESZ >> log2size) - 1;
-		} else {
-			if (bsize <= XNHEAP_PAGESZ)
-				--heap->buckets[ilog].fcount;
-			XENO_BUG_ON(COBALT, (caddr_t)block < heap->membase ||
-				    (caddr_t)block >= heap->memlim);
-			pagenum = ((caddr_t)block - heap->membase) / XNHEAP_PAGESZ;
-			++heap->pagemap[pagenum].bcount;
-		}
-		heap->buckets[ilog].freelist = *((caddr_t *)block);
-		heap->used += bsize;
-	} else {
-		if (size > heap->size)
+	block = heap->buckets[ilog].freelist;
+	if (block == NULL) {
+		block = get_free_range(heap, bsize, log2size);
+		if (block == NULL)
 			return NULL;
-
-		xnlock_get_irqsave(&heap->lock, s);
-
-		/* Directly request a free page range. */
-		block = get_free_range(heap, size, 0);
-		if (block)
-			heap->used += size;
+		if (bsize <= XNHEAP_PAGESZ)
+			heap->buckets[ilog].fcount += (XNHEAP_PAGESZ >> log2size) - 1;
+	} else {
+		if (bsize <= XNHEAP_PAGESZ)
+			--heap->buckets[ilog].fcount;
+		XENO_BUG_ON(COBALT, (caddr_t)block < heap->membase ||
+			    (caddr_t)block >= heap->memlim);
+		pagenum = ((caddr_t)block - heap->membase) / XNHEAP_PAGESZ;
+		++heap->pagemap[pagenum].bcount;
 	}
-out:
-	xnlock_put_irqrestore(&heap->lock, s);
+	heap->buckets[ilog].freelist = *((caddr_t *)block);
+	heap->used += bsize;
 
 	return block;
 }
-EXPORT_SYMBOL_GPL(xnheap_alloc);
 
-/**
- * @fn void xnheap_free(struct xnheap *heap, void *block)
- * @brief Release a block to a memory heap.
- *
- * Releases a memory block to a heap.
- *
- * @param heap The heap descriptor.
- *
- * @param block The block to be returned to the heap.
- *
- * @coretags{unrestricted}
+/*
+ * free_block() -- Release a block to the bucketed memory space or
+ * the free page list. The caller must have acquired the heap lock.
  */
-void xnheap_free(struct xnheap *heap, void *block)
+static int free_block(struct xnheap *heap, caddr_t block)
 {
 	caddr_t freepage, lastpage, nextpage, tailpage, freeptr, *tailptr;
 	int log2size, npages, nblocks, xpage, ilog;
 	u32 pagenum, pagecont, boffset, bsize;
-	spl_t s;
-
-	xnlock_get_irqsave(&heap->lock, s);
 
 	if ((caddr_t)block < heap->membase || (caddr_t)block >= heap->memlim)
 		goto bad_block;
@@ -507,9 +445,7 @@ void xnheap_free(struct xnheap *heap, void *block)
 	case XNHEAP_PFREE:	/* Unallocated page? */
 	case XNHEAP_PCONT:	/* Not a range heading page? */
 	bad_block:
-		xnlock_put_irqrestore(&heap->lock, s);
-		XENO_BUG(COBALT);
-		return;
+		return -EINVAL;
 
 	case XNHEAP_PLIST:
 		npages = 1;
@@ -625,7 +561,367 @@ void xnheap_free(struct xnheap *heap, void *block)
 
 	heap->used -= bsize;
 
+	return 0;
+}
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+/*
+ * Per-CPU magazines cache blocks of each bucketed size below the
+ * page size. A magazine is only touched by its owner CPU with hard
+ * IRQs off, the per-CPU lock being uncontended unless some CPU runs
+ * short of memory and flushes all magazines. On miss, the magazine is
+ * refilled with a batch of blocks drawn from the shared buckets
+ * under a single heap lock grab, conversely it is half-drained when
+ * full. The bytes cached per CPU are capped to heap->magcap, blocks
+ * beyond that limit go to the shared buckets directly.
+ */
+static caddr_t alloc_from_magazine(struct xnheap *heap, int log2size)
+{
+	struct xnheap_magazine *mag;
+	struct xnheap_percpu *pc;
+	u32 bsize = 1 << log2size;
+	caddr_t block;
+	spl_t s;
+
+	splhigh(s);
+
+	pc = raw_cpu_ptr(heap->percpu);
+	xnlock_get(&pc->lock);
+	mag = &pc->mags[log2size - XNHEAP_MINLOG2];
+	if (likely(mag->nrounds > 0)) {
+		pc->hits++;
+		pc->cached -= bsize;
+		block = mag->rounds[--mag->nrounds];
+		goto out;
+	}
+
+	pc->misses++;
+	xnlock_get(&heap->lock);
+	block = alloc_block(heap, log2size);
+	while (block && mag->nrounds < XNHEAP_MAGBATCH - 1 &&
+	       pc->cached + bsize <= heap->magcap) {
+		mag->rounds[mag->nrounds] = alloc_block(heap, log2size);
+		if (mag->rounds[mag->nrounds] == NULL)
+			break;
+		mag->nrounds++;
+		pc->cached += bsize;
+	}
+	xnlock_put(&heap->lock);
+out:
+	xnlock_put(&pc->lock);
+	splexit(s);
+
+	return block;
+}
+
+static int free_to_magazine(struct xnheap *heap, caddr_t block)
+{
+	struct xnheap_magazine *mag;
+	struct xnheap_percpu *pc;
+	int log2size, n, ret = 0;
+	u32 pagenum, bsize;
+	spl_t s;
+
+	if (block < heap->membase || block >= heap->memlim)
+		return -EINVAL;
+
+	/*
+	 * The page type of a busy block cannot change under our
+	 * feet. Pick the slow path for anything but a properly
+	 * aligned cached block size, so that it gets checked.
+	 */
+	pagenum = (block - heap->membase) / XNHEAP_PAGESZ;
+	log2size = heap->pagemap[pagenum].type;
+	if (log2size < XNHEAP_MINLOG2 || log2size >= PAGE_SHIFT ||
+	    ((block - heap->membase) & ((1 << log2size) - 1)) != 0)
+		return -EINVAL;
+
+	bsize = 1 << log2size;
+
+	splhigh(s);
+
+	pc = raw_cpu_ptr(heap->percpu);
+	xnlock_get(&pc->lock);
+	mag = &pc->mags[log2size - XNHEAP_MINLOG2];
+	if (unlikely(mag->nrounds == XNHEAP_MAGSZ)) {
+		/* Drain the coldest half, keep the hottest rounds. */
+		xnlock_get(&heap->lock);
+		for (n = 0; n < XNHEAP_MAGBATCH; n++) {
+			ret = free_block(heap, mag->rounds[n]);
+			XENO_BUG_ON(COBALT, ret);
+		}
+		xnlock_put(&heap->lock);
+		mag->nrounds -= XNHEAP_MAGBATCH;
+		pc->cached -= XNHEAP_MAGBATCH * bsize;
+		memmove(mag->rounds, mag->rounds + XNHEAP_MAGBATCH,
+			mag->nrounds * sizeof(caddr_t));
+	}
+
+	if (pc->cached + bsize <= heap->magcap) {
+		mag->rounds[mag->nrounds++] = block;
+		pc->cached += bsize;
+	} else
+		ret = -ENOSPC;	/* Over budget, release directly. */
+
+	xnlock_put(&pc->lock);
+	splexit(s);
+
+	return ret;
+}
+
+/**
+ * @fn int xnheap_enable_magazines(struct xnheap *heap)
+ * @brief Enable per-CPU block caching for a memory heap.
+ *
+ * Sets up per-CPU magazines in front of the shared buckets of @a
+ * heap, for all block sizes below the page size. Allocation and
+ * release of such blocks then proceed locklessly from the local
+ * magazine most of the time, which removes the contention on the
+ * heap lock between CPUs.
+ *
+ * @param heap The address of a heap descriptor previously
+ * initialized by xnheap_init(), which must not have served any
+ * allocation yet.
+ *
+ * @return 0 is returned upon success, or -ENOMEM if the per-CPU
+ * storage could not be obtained.
+ *
+ * @note The magazines of all CPUs may cache up to
+ * 1/XNHEAP_MAGSHARE of the heap size. An allocation which cannot be
+ * served otherwise flushes them all before failing.
+ *
+ * @coretags{secondary-only}
+ */
+int xnheap_enable_magazines(struct xnheap *heap)
+{
+	struct xnheap_percpu *pc;
+	int cpu;
+
+	secondary_mode_only();
+
+	heap->percpu = alloc_percpu(struct xnheap_percpu);
+	if (heap->percpu == NULL)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(heap->percpu, cpu);
+		xnlock_init(&pc->lock);
+	}
+
+	heap->magcap = heap->size / XNHEAP_MAGSHARE / num_possible_cpus();
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnheap_enable_magazines);
+
+/**
+ * @fn int xnheap_flush_magazines(struct xnheap *heap)
+ * @brief Return the blocks cached by all CPUs to a memory heap.
+ *
+ * @param heap The heap descriptor.
+ *
+ * @return The number of blocks released to the shared buckets.
+ *
+ * @coretags{unrestricted}
+ */
+int xnheap_flush_magazines(struct xnheap *heap)
+{
+	struct xnheap_magazine *mag;
+	struct xnheap_percpu *pc;
+	int cpu, n, ret, count = 0;
+	u32 bsize;
+	spl_t s;
+
+	if (heap->percpu == NULL)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(heap->percpu, cpu);
+		/* One lock section per magazine, for bounded latency. */
+		for (n = 0; n < XNHEAP_MAGCLASSES; n++) {
+			bsize = 1 << (n + XNHEAP_MINLOG2);
+			xnlock_get_irqsave(&pc->lock, s);
+			mag = &pc->mags[n];
+			if (mag->nrounds > 0) {
+				xnlock_get(&heap->lock);
+				while (mag->nrounds > 0) {
+					ret = free_block(heap, mag->rounds[--mag->nrounds]);
+					XENO_BUG_ON(COBALT, ret);
+					pc->cached -= bsize;
+					count++;
+				}
+				xnlock_put(&heap->lock);
+			}
+			xnlock_put_irqrestore(&pc->lock, s);
+		}
+	}
+
+	return count;
+}
+EXPORT_SYMBOL_GPL(xnheap_flush_magazines);
+
+/* Blocks cached by the magazines are free memory too. */
+u32 xnheap_get_free(const struct xnheap *heap)
+{
+	u32 cached = 0;
+	int cpu;
+
+	if (heap->percpu)
+		for_each_possible_cpu(cpu)
+			cached += ACCESS_ONCE(per_cpu_ptr(heap->percpu, cpu)->cached);
+
+	return heap->size - heap->used + cached;
+}
+EXPORT_SYMBOL_GPL(xnheap_get_free);
+
+void xnheap_get_magstats(struct xnheap *heap,
+			 unsigned long *hits, unsigned long *misses)
+{
+	struct xnheap_percpu *pc;
+	int cpu;
+
+	*hits = *misses = 0;
+
+	if (heap->percpu == NULL)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(heap->percpu, cpu);
+		*hits += pc->hits;
+		*misses += pc->misses;
+	}
+}
+
+#endif /* CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
+/**
+ * @fn void *xnheap_alloc(struct xnheap *heap, u32 size)
+ * @brief Allocate a memory block from a memory heap.
+ *
+ * Allocates a contiguous region of memory from an active memory heap.
+ * Such allocation is guaranteed to be time-bounded.
+ *
+ * @param heap The descriptor address of the heap to get memory from.
+ *
+ * @param size The size in bytes of the requested block. Sizes lower
+ * or equal to the page size are rounded either to the minimum
+ * allocation size if lower than this value, or to the minimum
+ * alignment size if greater or equal to this value. In the current
+ * implementation, with MINALLOC = 8 and MINALIGN = 16, a 7 bytes
+ * request will be rounded to 8 bytes, and a 17 bytes request will be
+ * rounded to 32.
+ *
+ * @return The address of the allocated region upon success, or NULL
+ * if no memory is available from the specified heap.
+ *
+ * @coretags{unrestricted}
+ */
+void *xnheap_alloc(struct xnheap *heap, u32 size)
+{
+	int log2size;
+	caddr_t block;
+	u32 bsize;
+	spl_t s;
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	int flushed = 0;
+#endif
+
+	if (size == 0)
+		return NULL;
+
+	/*
+	 * Sizes lower or equal to the page size are rounded either to
+	 * the minimum allocation size if lower than this value, or to
+	 * the minimum alignment size if greater or equal to this
+	 * value.
+	 */
+	if (size > XNHEAP_PAGESZ)
+		size = ALIGN(size, XNHEAP_PAGESZ);
+	else if (size <= XNHEAP_MINALIGNSZ)
+		size = ALIGN(size, XNHEAP_MINALLOCSZ);
+	else
+		size = ALIGN(size, XNHEAP_MINALIGNSZ);
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+retry:
+#endif
+	/*
+	 * It is more space efficient to directly allocate pages from
+	 * the free page list whenever the requested size is greater
+	 * than 2 times the page size. Otherwise, use the bucketed
+	 * memory blocks.
+	 */
+	if (likely(size <= XNHEAP_PAGESZ * 2)) {
+		/*
+		 * Find the first power of two greater or equal to the
+		 * rounded size.
+		 */
+		bsize = size < XNHEAP_MINALLOCSZ ? XNHEAP_MINALLOCSZ : size;
+		log2size = order_base_2(bsize);
+		bsize = 1 << log2size;
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+		if (heap->percpu && bsize < XNHEAP_PAGESZ) {
+			block = alloc_from_magazine(heap, log2size);
+			goto out;
+		}
+#endif
+		xnlock_get_irqsave(&heap->lock, s);
+		block = alloc_block(heap, log2size);
+	} else {
+		if (size > heap->size)
+			return NULL;
+
+		xnlock_get_irqsave(&heap->lock, s);
+
+		/* Directly request a free page range. */
+		block = get_free_range(heap, size, 0);
+		if (block)
+			heap->used += size;
+	}
+
 	xnlock_put_irqrestore(&heap->lock, s);
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+out:
+	/* Other CPUs may be caching the memory we need. */
+	if (unlikely(block == NULL) && heap->percpu && !flushed) {
+		flushed = 1;
+		if (xnheap_flush_magazines(heap) > 0)
+			goto retry;
+	}
+#endif
+
+	return block;
+}
+EXPORT_SYMBOL_GPL(xnheap_alloc);
+
+/**
+ * @fn void xnheap_free(struct xnheap *heap, void *block)
+ * @brief Release a block to a memory heap.
+ *
+ * Releases a memory block to a heap.
+ *
+ * @param heap The heap descriptor.
+ *
+ * @param block The block to be returned to the heap.
+ *
+ * @coretags{unrestricted}
+ */
+void xnheap_free(struct xnheap *heap, void *block)
+{
+	int ret;
+	spl_t s;
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	if (heap->percpu && free_to_magazine(heap, block) == 0)
+		return;
+#endif
+	xnlock_get_irqsave(&heap->lock, s);
+	ret = free_block(heap, block);
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	XENO_BUG_ON(COBALT, ret);
 }
 EXPORT_SYMBOL_GPL(xnheap_free);
 
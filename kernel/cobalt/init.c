@@ -289,6 +289,10 @@ static __init int sys_init(void)
 	}
 	xnheap_set_name(&cobalt_heap, "system heap");
 
+	ret = xnheap_enable_magazines(&cobalt_heap);
+	if (ret)
+		return ret;
+
 	for_each_online_cpu(cpu) {
 		sched = &per_cpu(nksched, cpu);
 		xnsched_init(sched, cpu);
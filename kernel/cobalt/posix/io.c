@@ -104,6 +104,52 @@ COBALT_SYSCALL(sendmsg, probing,
 	return ret ?: rtdm_fd_sendmsg(fd, &m, flags);
 }
 
+static int get_mmsg(struct mmsghdr *mmsg, void __user *u_mmsg)
+{
+	return cobalt_copy_from_user(mmsg, u_mmsg, sizeof(*mmsg));
+}
+
+static int put_mmsg(void __user *u_mmsg, const struct mmsghdr *mmsg)
+{
+	return cobalt_copy_to_user(u_mmsg, mmsg, sizeof(*mmsg));
+}
+
+static int put_mmsg_len(void __user *u_mmsg, const struct mmsghdr *mmsg)
+{
+	struct mmsghdr __user *u_p = u_mmsg;
+
+	return __xn_put_user(mmsg->msg_len, &u_p->msg_len) ? -EFAULT : 0;
+}
+
+COBALT_SYSCALL(recvmmsg, probing,
+	       (int fd, struct mmsghdr __user *u_msgvec,
+		unsigned int vlen, unsigned int flags,
+		struct timespec __user *u_timeout))
+{
+	struct timespec ts;
+	int ret;
+
+	if (u_timeout) {
+		ret = cobalt_copy_from_user(&ts, u_timeout, sizeof(ts));
+		if (ret)
+			return ret;
+		if (!timespec_valid(&ts))
+			return -EINVAL;
+	}
+
+	return __rtdm_fd_recvmmsg(fd, u_msgvec, vlen, flags,
+				  u_timeout ? &ts : NULL, sizeof(*u_msgvec),
+				  get_mmsg, put_mmsg);
+}
+
+COBALT_SYSCALL(sendmmsg, probing,
+	       (int fd, struct mmsghdr __user *u_msgvec,
+		unsigned int vlen, unsigned int flags))
+{
+	return __rtdm_fd_sendmmsg(fd, u_msgvec, vlen, flags,
+				  sizeof(*u_msgvec), get_mmsg, put_mmsg_len);
+}
+
 COBALT_SYSCALL(mmap, lostage,
 	       (int fd, struct _rtdm_mmap_request __user *u_rma,
 	        void __user **u_addrp))
@@ -31,7 +31,22 @@
 
 #define COBALT_MSGMAX		65536
 #define COBALT_MSGSIZEMAX	(16*1024*1024)
-#define COBALT_MSGPRIOMAX	32768
+#define COBALT_MSGPRIOMAX	COBALT_MQ_PRIOMAX
+
+/*
+ * Queues which fit within these limits keep their messages in the
+ * shared memory heap, where userland can send and receive without
+ * issuing any syscall unless a thread has to wait or be woken up.
+ */
+#define COBALT_MQ_SHAREDMAX	32
+#define COBALT_MQ_SHAREDSZ	4096
+
+/*
+ * Passes over the slots before the kernel gives up claiming the one
+ * it reserved, which may only happen if userland trashed the shared
+ * state.
+ */
+#define COBALT_MQ_CLAIMSCANS	64
 
 struct cobalt_mq {
 	unsigned magic;
@@ -45,6 +60,9 @@ struct cobalt_mq {
 	struct list_head queued;
 	struct list_head avail;
 	int nrqueued;
+	struct cobalt_mq_state *shared;
+	unsigned int slotsize;
+	int selected;
 
 	/* mq_notify */
 	struct siginfo si;
@@ -98,6 +116,44 @@ static inline void mq_msg_free(struct cobalt_mq *mq, struct cobalt_msg * msg)
 	list_add(&msg->link, &mq->avail); /* For earliest re-use of the block. */
 }
 
+static struct cobalt_mq_state *mq_init_shared(struct cobalt_mq *mq,
+					      const struct mq_attr *attr)
+{
+	struct cobalt_mq_state *state;
+	struct cobalt_mq_slot *slot;
+	unsigned int i, slotsize;
+	size_t size;
+
+	if (attr->mq_maxmsg > COBALT_MQ_SHAREDMAX)
+		return NULL;
+
+	slotsize = ALIGN(sizeof(*slot) + attr->mq_msgsize, sizeof(u64));
+	size = sizeof(*state) + slotsize * attr->mq_maxmsg;
+	if (size > COBALT_MQ_SHAREDSZ)
+		return NULL;
+
+	state = cobalt_umm_alloc(&cobalt_kernel_ppd.umm, size);
+	if (state == NULL)
+		return NULL;
+
+	state->flags = 0;
+	atomic_set(&state->nfree, attr->mq_maxmsg);
+	atomic_set(&state->nready, 0);
+	atomic_set(&state->seq, 0);
+	state->maxmsg = attr->mq_maxmsg;
+	state->msgsize = attr->mq_msgsize;
+	state->slotsize = slotsize;
+	state->pad = 0;
+	mq->slotsize = slotsize;
+
+	for (i = 0; i < attr->mq_maxmsg; i++) {
+		slot = cobalt_mq_get_slot(state, slotsize, i);
+		atomic_set(&slot->status, COBALT_MQ_SLOT_FREE);
+	}
+
+	return state;
+}
+
 static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 {
 	unsigned i, msgsize, memsize;
@@ -114,6 +170,15 @@ static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 			return -EINVAL;
 	}
 
+	INIT_LIST_HEAD(&mq->avail);
+	mq->selected = 0;
+	mq->shared = mq_init_shared(mq, attr);
+	if (mq->shared) {
+		mq->mem = NULL;
+		mq->memsize = 0;
+		goto init_synch;
+	}
+
 	msgsize = attr->mq_msgsize + sizeof(struct cobalt_msg);
 
 	/* Align msgsize on natural boundary. */
@@ -131,19 +196,19 @@ static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 		return -ENOSPC;
 
 	mq->memsize = memsize;
-	INIT_LIST_HEAD(&mq->queued);
-	mq->nrqueued = 0;
-	xnsynch_init(&mq->receivers, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
-	xnsynch_init(&mq->senders, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
 	mq->mem = mem;
 
 	/* Fill the pool. */
-	INIT_LIST_HEAD(&mq->avail);
 	for (i = 0; i < attr->mq_maxmsg; i++) {
 		struct cobalt_msg *msg = (struct cobalt_msg *) (mem + i * msgsize);
 		mq_msg_free(mq, msg);
 	}
 
+init_synch:
+	INIT_LIST_HEAD(&mq->queued);
+	mq->nrqueued = 0;
+	xnsynch_init(&mq->receivers, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
+	xnsynch_init(&mq->senders, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
 	mq->attr = *attr;
 	mq->target = NULL;
 	xnselect_init(&mq->read_select);
@@ -167,7 +232,10 @@ static inline void mq_destroy(struct cobalt_mq *mq)
 	xnselect_destroy(&mq->read_select);
 	xnselect_destroy(&mq->write_select);
 	xnregistry_remove(mq->handle);
-	free_pages_exact(mq->mem, mq->memsize);
+	if (mq->shared)
+		cobalt_umm_free(&cobalt_kernel_ppd.umm, mq->shared);
+	else
+		free_pages_exact(mq->mem, mq->memsize);
 	kfree(mq);
 
 	if (resched)
@@ -195,6 +263,49 @@ static int mq_unref(struct cobalt_mq *mq)
 	return mq_unref_inner(mq, s);
 }
 
+/*
+ * Read a count from the shared area, which userland may have
+ * scribbled over. Returns -1 if out of range.
+ */
+static inline int mq_shared_count(struct cobalt_mq *mq, atomic_t *count)
+{
+	int n = atomic_read(count);
+
+	return n < 0 || n > mq->attr.mq_maxmsg ? -1 : n;
+}
+
+static inline int mq_nr_queued(struct cobalt_mq *mq)
+{
+	if (mq->shared)
+		return max(mq_shared_count(mq, &mq->shared->nready), 0);
+
+	return mq->nrqueued;
+}
+
+static inline int mq_has_room(struct cobalt_mq *mq)
+{
+	if (mq->shared)
+		return mq_shared_count(mq, &mq->shared->nfree) > 0;
+
+	return !list_empty(&mq->avail);
+}
+
+/*
+ * Tell userland whether it must call us back after each transfer
+ * through the shared area, for keeping the select() bindings and
+ * the mq_notify() state up to date. nklock held, irqs off.
+ */
+static inline void mq_update_sync(struct cobalt_mq *mq)
+{
+	if (mq->shared == NULL)
+		return;
+
+	if (mq->selected || mq->target)
+		mq->shared->flags |= COBALT_MQ_SYNC;
+	else
+		mq->shared->flags &= ~COBALT_MQ_SYNC;
+}
+
 static void mqd_close(struct rtdm_fd *fd)
 {
 	struct cobalt_mqd *mqd = container_of(fd, struct cobalt_mqd, fd);
@@ -232,7 +343,7 @@ mqd_select(struct rtdm_fd *fd, struct xnselector *selector,
 
 		err = xnselect_bind(&mq->read_select, binding,
 				selector, type, index,
-				!list_empty(&mq->queued));
+				mq_nr_queued(mq) > 0);
 		if (err)
 			goto unlock_and_error;
 		break;
@@ -244,11 +355,13 @@ mqd_select(struct rtdm_fd *fd, struct xnselector *selector,
 
 		err = xnselect_bind(&mq->write_select, binding,
 				selector, type, index,
-				!list_empty(&mq->avail));
+				mq_has_room(mq));
 		if (err)
 			goto unlock_and_error;
 		break;
 	}
+	mq->selected = 1;
+	mq_update_sync(mq);
 	xnlock_put_irqrestore(&nklock, s);
 	return 0;
 
@@ -659,6 +772,278 @@ mq_finish_rcv(struct cobalt_mqd *mqd, struct cobalt_msg *msg)
 	return 0;
 }
 
+/*
+ * Shared mode: messages are transferred through slots in the shared
+ * heap, which userland may fill or drain concurrently without
+ * locking. nklock only serializes waiting and waking up, the
+ * SNDWAIT/RCVWAIT flags telling userland when to call us back.
+ */
+
+/*
+ * Wake up a waiter if it may proceed, update the select() states
+ * and send the mq_notify() signal if the queue was just filled.
+ * nklock held, irqs off.
+ */
+static void mq_sync_shared(struct cobalt_mq *mq, int events)
+{
+	struct cobalt_mq_state *state = mq->shared;
+	struct cobalt_sigpending *sigp;
+	int nready, nfree;
+
+	nready = mq_shared_count(mq, &state->nready);
+	nfree = mq_shared_count(mq, &state->nfree);
+
+	if (nready > 0) {
+		if (xnsynch_pended_p(&mq->receivers))
+			xnsynch_wakeup_one_sleeper(&mq->receivers);
+		else if ((events & COBALT_MQ_FILLED) && mq->target) {
+			sigp = cobalt_signal_alloc();
+			if (sigp) {
+				cobalt_copy_siginfo(SI_MESGQ, &sigp->si, &mq->si);
+				if (cobalt_signal_send(mq->target, sigp, 0) <= 0)
+					cobalt_signal_free(sigp);
+			}
+			mq->target = NULL;
+			mq_update_sync(mq);
+		}
+	}
+
+	if (nfree > 0 && xnsynch_pended_p(&mq->senders))
+		xnsynch_wakeup_one_sleeper(&mq->senders);
+
+	xnselect_signal(&mq->read_select, nready > 0);
+	xnselect_signal(&mq->write_select, nfree > 0);
+}
+
+/*
+ * Give back the slots left busy by threads which went away in the
+ * middle of a transfer, their message being lost. Returns the count
+ * of recovered slots. nklock held, irqs off.
+ */
+/*
+ * Tell whether a thread which may have claimed a slot is still
+ * alive, from the owner hint found in the status word. Any live
+ * thread with a matching registry index may be the owner.
+ */
+static int mq_owner_hint_alive(int hint)
+{
+	xnhandle_t h;
+
+	if (hint == 0)	/* Ambiguous, assume alive. */
+		return 1;
+
+	for (h = hint; h < CONFIG_XENO_OPT_REGISTRY_NRSLOTS;
+	     h += COBALT_MQ_SLOT_HINTMASK + 1)
+		if (xnthread_lookup(h))
+			return 1;
+
+	return 0;
+}
+
+static int mq_recover_shared(struct cobalt_mq *mq)
+{
+	struct cobalt_mq_state *state = mq->shared;
+	struct cobalt_mq_slot *slot;
+	int status, n, nr = 0;
+	xnhandle_t owner;
+
+	for (n = 0; n < mq->attr.mq_maxmsg; n++) {
+		slot = cobalt_mq_get_slot(state, mq->slotsize, n);
+		status = atomic_read(&slot->status);
+		if ((status & COBALT_MQ_SLOT_MASK) != COBALT_MQ_SLOT_BUSY)
+			continue;
+		if (slot->claim == status) {
+			smp_rmb();
+			owner = slot->owner;
+			if (owner == XN_NO_HANDLE || xnthread_lookup(owner))
+				continue;
+		} else if (mq_owner_hint_alive(cobalt_mq_slot_hint(status)))
+			/* The owner may not have filled in its handle yet. */
+			continue;
+		if (cobalt_mq_move_slot(slot, status, COBALT_MQ_SLOT_FREE)) {
+			cobalt_mq_fetch_inc(&state->nfree);
+			nr++;
+		}
+	}
+
+	return nr;
+}
+
+/*
+ * Reserve a slot from @count, waiting on @synch for one to show up
+ * if permitted. @waitbit is raised before each attempt, so that a
+ * peer updating @count concurrently from userland either notices
+ * it and calls us back, or made the slot available to our attempt.
+ */
+static int mq_reserve_shared(struct cobalt_mqd *mqd, atomic_t *count,
+			     struct xnsynch *synch, int waitbit,
+			     const void __user *u_ts,
+			     int (*fetch_timeout)(struct timespec *ts,
+						  const void __user *u_ts))
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_state *state = mq->shared;
+	struct timespec ts;
+	xntmode_t tmode;
+	xnticks_t to;
+	int ret = 0;
+	spl_t s;
+
+	to = XN_INFINITE;
+	tmode = XN_RELATIVE;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (;;) {
+		state->flags |= waitbit;
+		smp_mb();
+		if (mq_shared_count(mq, count) < 0) {
+			ret = -EIO;
+			break;
+		}
+		if (cobalt_mq_reserve(count))
+			break;
+
+		if (mq_recover_shared(mq)) {
+			mq_sync_shared(mq, 0);
+			continue;
+		}
+
+		if (rtdm_fd_flags(&mqd->fd) & O_NONBLOCK) {
+			ret = -EAGAIN;
+			break;
+		}
+
+		if (fetch_timeout) {
+			xnlock_put_irqrestore(&nklock, s);
+			ret = fetch_timeout(&ts, u_ts);
+			if (ret == 0 && (unsigned long)ts.tv_nsec >= ONE_BILLION)
+				ret = -EINVAL;
+			xnlock_get_irqsave(&nklock, s);
+			if (ret)
+				break;
+			to = ts2ns(&ts) + 1;
+			tmode = XN_REALTIME;
+			fetch_timeout = NULL;
+			continue;
+		}
+
+		ret = xnsynch_sleep_on(synch, to, tmode);
+		if (ret & XNRMID) {
+			xnlock_put_irqrestore(&nklock, s);
+			return -EBADF;
+		}
+		if (ret) {
+			ret = (ret & XNTIMEO) ? -ETIMEDOUT : -EINTR;
+			break;
+		}
+	}
+
+	if (!xnsynch_pended_p(synch))
+		state->flags &= ~waitbit;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static int mq_send_shared(struct cobalt_mqd *mqd,
+			  const void __user *u_buf, size_t len,
+			  unsigned int prio, const void __user *u_ts,
+			  int (*fetch_timeout)(struct timespec *ts,
+					       const void __user *u_ts))
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_state *state = mq->shared;
+	struct cobalt_mq_slot *slot;
+	int ret, events = 0;
+	unsigned int flags;
+	spl_t s;
+
+	flags = rtdm_fd_flags(&mqd->fd) & COBALT_PERMS_MASK;
+	if (flags != O_WRONLY && flags != O_RDWR)
+		return -EBADF;
+
+	if (len > mq->attr.mq_msgsize)
+		return -EMSGSIZE;
+
+	ret = mq_reserve_shared(mqd, &state->nfree, &mq->senders,
+				COBALT_MQ_SNDWAIT, u_ts, fetch_timeout);
+	if (ret)
+		return ret;
+
+	slot = cobalt_mq_claim_free(state, mq->attr.mq_maxmsg, mq->slotsize,
+				    COBALT_MQ_CLAIMSCANS,
+				    xnthread_current()->handle);
+	if (slot == NULL) {
+		cobalt_mq_fetch_inc(&state->nfree);
+		return -EIO;
+	}
+
+	ret = cobalt_copy_from_user(slot->data, u_buf, len);
+	if (ret)
+		cobalt_mq_release(state, slot);
+	else if (cobalt_mq_publish(state, slot, prio, len) == 0)
+		events = COBALT_MQ_FILLED;
+
+	xnlock_get_irqsave(&nklock, s);
+	mq_sync_shared(mq, events);
+	xnsched_run();
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static int mq_receive_shared(struct cobalt_mqd *mqd,
+			     void __user *u_buf, ssize_t *lenp,
+			     unsigned int *prio, const void __user *u_ts,
+			     int (*fetch_timeout)(struct timespec *ts,
+						  const void __user *u_ts))
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_state *state = mq->shared;
+	struct cobalt_mq_slot *slot;
+	unsigned int flags;
+	size_t len;
+	int ret;
+	spl_t s;
+
+	flags = rtdm_fd_flags(&mqd->fd) & COBALT_PERMS_MASK;
+	if (flags != O_RDONLY && flags != O_RDWR)
+		return -EBADF;
+
+	if (*lenp < mq->attr.mq_msgsize)
+		return -EMSGSIZE;
+
+	ret = mq_reserve_shared(mqd, &state->nready, &mq->receivers,
+				COBALT_MQ_RCVWAIT, u_ts, fetch_timeout);
+	if (ret)
+		return ret;
+
+	slot = cobalt_mq_claim_ready(state, mq->attr.mq_maxmsg, mq->slotsize,
+				     COBALT_MQ_CLAIMSCANS,
+				     xnthread_current()->handle);
+	if (slot == NULL) {
+		cobalt_mq_fetch_inc(&state->nready);
+		return -EIO;
+	}
+
+	/* Userland may have scribbled over the slot header. */
+	len = min_t(size_t, slot->len, mq->attr.mq_msgsize);
+	*prio = slot->prio;
+	ret = cobalt_copy_to_user(u_buf, slot->data, len);
+	if (ret == 0)
+		*lenp = len;
+	cobalt_mq_release(state, slot);
+
+	xnlock_get_irqsave(&nklock, s);
+	mq_sync_shared(mq, 0);
+	xnsched_run();
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
 static inline int mq_getattr(struct cobalt_mqd *mqd, struct mq_attr *attr)
 {
 	struct cobalt_mq *mq;
@@ -668,7 +1053,7 @@ static inline int mq_getattr(struct cobalt_mqd *mqd, struct mq_attr *attr)
 	*attr = mq->attr;
 	xnlock_get_irqsave(&nklock, s);
 	attr->mq_flags = rtdm_fd_flags(&mqd->fd);
-	attr->mq_curmsgs = mq->nrqueued;
+	attr->mq_curmsgs = mq_nr_queued(mq);
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
@@ -717,6 +1102,7 @@ mq_notify(struct cobalt_mqd *mqd, unsigned index, const struct sigevent *evp)
 		mq->si.si_uid = get_current_uuid();
 	}
 
+	mq_update_sync(mq);
 	xnlock_put_irqrestore(&nklock, s);
 	return 0;
 
@@ -907,6 +1293,11 @@ int __cobalt_mq_timedsend(mqd_t uqd, const void __user *u_buf, size_t len,
 	}
 
 	trace_cobalt_mq_send(uqd, u_buf, len, prio);
+	if (mqd->mq->shared) {
+		ret = mq_send_shared(mqd, u_buf, len, prio, u_ts, fetch_timeout);
+		goto out;
+	}
+
 	msg = mq_timedsend_inner(mqd, len, u_ts, fetch_timeout);
 	if (IS_ERR(msg)) {
 		ret = PTR_ERR(msg);
@@ -956,6 +1347,14 @@ int __cobalt_mq_timedreceive(mqd_t uqd, void __user *u_buf,
 		goto fail;
 	}
 
+	if (mqd->mq->shared) {
+		ret = mq_receive_shared(mqd, u_buf, lenp, &prio,
+					u_ts, fetch_timeout);
+		if (ret)
+			goto fail;
+		goto done;
+	}
+
 	msg = mq_timedrcv_inner(mqd, *lenp, u_ts, fetch_timeout);
 	if (IS_ERR(msg)) {
 		ret = PTR_ERR(msg);
@@ -973,7 +1372,7 @@ int __cobalt_mq_timedreceive(mqd_t uqd, void __user *u_buf,
 	ret = mq_finish_rcv(mqd, msg);
 	if (ret)
 		goto fail;
-
+done:
 	cobalt_mqd_put(mqd);
 
 	if (u_prio && __xn_put_user(prio, u_prio))
@@ -1004,3 +1403,49 @@ COBALT_SYSCALL(mq_timedreceive, primary,
 
 	return ret ?: cobalt_copy_to_user(u_len, &len, sizeof(*u_len));
 }
+
+COBALT_SYSCALL(mq_state, current, (mqd_t uqd))
+{
+	struct cobalt_mqd *mqd;
+	unsigned long off;
+	int ret;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	if (mqd->mq->shared) {
+		off = cobalt_umm_offset(&cobalt_kernel_ppd.umm,
+					mqd->mq->shared);
+		XENO_BUG_ON(COBALT, off > INT_MAX);
+		ret = (int)off;
+	} else
+		ret = -EOPNOTSUPP;
+
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+COBALT_SYSCALL(mq_sync, current, (mqd_t uqd, int events))
+{
+	struct cobalt_mqd *mqd;
+	spl_t s;
+	int ret = 0;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	xnlock_get_irqsave(&nklock, s);
+	if (mqd->mq->shared) {
+		mq_sync_shared(mqd->mq, events);
+		xnsched_run();
+	} else
+		ret = -EOPNOTSUPP;
+	xnlock_put_irqrestore(&nklock, s);
+
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
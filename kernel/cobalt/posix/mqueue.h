@@ -21,6 +21,7 @@
 
 #include <linux/types.h>
 #include <linux/fcntl.h>
+#include <cobalt/uapi/mqueue.h>
 #include <xenomai/posix/syscall.h>
 
 struct mq_attr {
@@ -71,4 +72,8 @@ COBALT_SYSCALL_DECL(mq_timedreceive,
 COBALT_SYSCALL_DECL(mq_notify,
 		    (mqd_t fd, const struct sigevent *__user evp));
 
+COBALT_SYSCALL_DECL(mq_state, (mqd_t uqd));
+
+COBALT_SYSCALL_DECL(mq_sync, (mqd_t uqd, int events));
+
 #endif /* !_COBALT_POSIX_MQUEUE_H */
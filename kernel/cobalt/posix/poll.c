@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <linux/err.h>
+#include <linux/fcntl.h>
+#include <linux/mutex.h>
+#include <linux/uio.h>
+#include <cobalt/kernel/select.h>
+#include <rtdm/fd.h>
+#include "internal.h"
+#include "clock.h"
+#include "poll.h"
+
+/*
+ * A poll set is a persistent interest set: descriptors are bound
+ * once to a ready-list selector, then each wait only collects the
+ * descriptors which are ready, instead of binding and scanning fd
+ * sets like select() does.
+ */
+struct cobalt_poll {
+	struct rtdm_fd fd;
+	struct xnselector *selector;
+	/* Serializes updates to the interest set. */
+	struct mutex lock;
+};
+
+#define COBALT_POLL_EVENTS	(POLLIN | POLLOUT | POLLPRI)
+
+/* Batch size of events collected on the stack. */
+#define COBALT_POLL_BATCH	32
+
+static const unsigned int poll_types[XNSELECT_MAX_TYPES] = {
+	[XNSELECT_READ] = POLLIN,
+	[XNSELECT_WRITE] = POLLOUT,
+	[XNSELECT_EXCEPT] = POLLPRI,
+};
+
+static void poll_close(struct rtdm_fd *fd)
+{
+	struct cobalt_poll *poll = container_of(fd, struct cobalt_poll, fd);
+
+	/* Bindings are dropped asynchronously, along with the selector. */
+	xnselector_destroy(poll->selector);
+	mutex_destroy(&poll->lock);
+	xnfree(poll);
+}
+
+static struct rtdm_fd_ops poll_ops = {
+	.close = poll_close,
+};
+
+static inline struct cobalt_poll *poll_get(int pfd)
+{
+	struct rtdm_fd *fd;
+
+	fd = rtdm_fd_get(pfd, COBALT_POLL_MAGIC);
+	if (IS_ERR(fd))
+		return ERR_CAST(fd);
+
+	return container_of(fd, struct cobalt_poll, fd);
+}
+
+static inline void poll_put(struct cobalt_poll *poll)
+{
+	rtdm_fd_put(&poll->fd);
+}
+
+static int poll_bind(struct cobalt_poll *poll, int fd, unsigned int events)
+{
+	unsigned int type;
+	int ret;
+
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++) {
+		if (!(events & poll_types[type]))
+			continue;
+		ret = rtdm_fd_select(fd, poll->selector, type);
+		if (ret) {
+			xnselector_unbind(poll->selector, fd);
+			return ret == -ENOENT ? -EBADF : ret;
+		}
+	}
+
+	return 0;
+}
+
+COBALT_SYSCALL(poll_create, lostage, (int flags))
+{
+	struct cobalt_poll *poll;
+	int ret, ufd;
+
+	if (flags & ~O_CLOEXEC)
+		return -EINVAL;
+
+	poll = xnmalloc(sizeof(*poll));
+	if (poll == NULL)
+		return -ENOMEM;
+
+	poll->selector = xnmalloc(sizeof(*poll->selector));
+	if (poll->selector == NULL) {
+		ret = -ENOMEM;
+		goto fail_selector;
+	}
+
+	xnselector_init_readylist(poll->selector);
+	mutex_init(&poll->lock);
+
+	ufd = __rtdm_anon_getfd("[cobalt-poll]", O_RDWR | flags);
+	if (ufd < 0) {
+		ret = ufd;
+		goto fail_getfd;
+	}
+
+	ret = rtdm_fd_enter(&poll->fd, ufd, COBALT_POLL_MAGIC, &poll_ops);
+	if (ret < 0)
+		goto fail_enter;
+
+	return ufd;
+
+fail_enter:
+	__rtdm_anon_putfd(ufd);
+fail_getfd:
+	xnselector_destroy(poll->selector);
+	mutex_destroy(&poll->lock);
+fail_selector:
+	xnfree(poll);
+
+	return ret;
+}
+
+COBALT_SYSCALL(poll_ctl, lostage,
+	       (int pfd, int op, int fd, unsigned int events))
+{
+	struct cobalt_poll *poll;
+	int ret;
+
+	if (fd < 0 || fd == pfd)
+		return -EINVAL;
+
+	if (op != COBALT_POLL_CTL_DEL &&
+	    (events == 0 || (events & ~COBALT_POLL_EVENTS)))
+		return -EINVAL;
+
+	poll = poll_get(pfd);
+	if (IS_ERR(poll))
+		return PTR_ERR(poll);
+
+	mutex_lock(&poll->lock);
+
+	switch (op) {
+	case COBALT_POLL_CTL_ADD:
+		if (xnselector_bound_p(poll->selector, fd))
+			ret = -EEXIST;
+		else
+			ret = poll_bind(poll, fd, events);
+		break;
+	case COBALT_POLL_CTL_DEL:
+		ret = xnselector_unbind(poll->selector, fd);
+		break;
+	case COBALT_POLL_CTL_MOD:
+		ret = xnselector_unbind(poll->selector, fd);
+		if (ret == 0)
+			ret = poll_bind(poll, fd, events);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	mutex_unlock(&poll->lock);
+
+	poll_put(poll);
+
+	return ret;
+}
+
+int __cobalt_poll_wait(int pfd, struct pollfd __user *u_fds,
+		       int nrfds, const struct timespec *ts)
+{
+	struct xnselect_event batch[COBALT_POLL_BATCH], *events = batch;
+	xnticks_t timeout = XN_INFINITE;
+	xntmode_t tmode = XN_RELATIVE;
+	struct cobalt_poll *poll;
+	struct pollfd pfds;
+	unsigned int type;
+	int ret, n;
+
+	if (nrfds <= 0 || nrfds > UIO_MAXIOV)
+		return -EINVAL;
+
+	if (ts) {
+		if ((unsigned long)ts->tv_nsec >= ONE_BILLION)
+			return -EINVAL;
+		if (ts->tv_sec == 0 && ts->tv_nsec == 0)
+			timeout = XN_NONBLOCK;
+		else {
+			timeout = clock_get_ticks(CLOCK_MONOTONIC) + ts2ns(ts);
+			tmode = XN_ABSOLUTE;
+		}
+	}
+
+	poll = poll_get(pfd);
+	if (IS_ERR(poll))
+		return PTR_ERR(poll);
+
+	if (nrfds > COBALT_POLL_BATCH) {
+		events = xnmalloc(nrfds * sizeof(*events));
+		if (events == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	ret = xnselect_ready(poll->selector, events, nrfds, timeout, tmode);
+
+	for (n = 0; n < ret; n++) {
+		pfds.fd = events[n].index;
+		pfds.events = 0;
+		pfds.revents = 0;
+		for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+			if (events[n].types & (1 << type))
+				pfds.revents |= poll_types[type];
+		if (cobalt_copy_to_user(u_fds + n, &pfds, sizeof(pfds))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	if (events != batch)
+		xnfree(events);
+out:
+	poll_put(poll);
+
+	return ret;
+}
+
+COBALT_SYSCALL(poll_wait, primary,
+	       (int pfd, struct pollfd __user *u_fds,
+		int nrfds, const struct timespec __user *u_ts))
+{
+	struct timespec ts;
+
+	if (u_ts == NULL)
+		return __cobalt_poll_wait(pfd, u_fds, nrfds, NULL);
+
+	if (cobalt_copy_from_user(&ts, u_ts, sizeof(ts)))
+		return -EFAULT;
+
+	return __cobalt_poll_wait(pfd, u_fds, nrfds, &ts);
+}
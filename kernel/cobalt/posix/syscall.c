@@ -39,6 +39,7 @@
 #include "clock.h"
 #include "event.h"
 #include "timerfd.h"
+#include "poll.h"
 #include "io.h"
 #include "../debug.h"
 #include <trace/events/cobalt-posix.h>
@@ -644,6 +645,8 @@ static const cobalt_syshand cobalt_syscalls[] = {
 	__COBALT_CALL_ENTRY(mq_timedsend),
 	__COBALT_CALL_ENTRY(mq_timedreceive),
 	__COBALT_CALL_ENTRY(mq_notify),
+	__COBALT_CALL_ENTRY(mq_state),
+	__COBALT_CALL_ENTRY(mq_sync),
 	__COBALT_CALL_ENTRY(sigwait),
 	__COBALT_CALL_ENTRY(sigwaitinfo),
 	__COBALT_CALL_ENTRY(sigtimedwait),
@@ -659,6 +662,9 @@ static const cobalt_syshand cobalt_syscalls[] = {
 	__COBALT_CALL_ENTRY(timerfd_gettime),
 	__COBALT_CALL_ENTRY(timerfd_settime),
 	__COBALT_CALL_ENTRY(select),
+	__COBALT_CALL_ENTRY(poll_create),
+	__COBALT_CALL_ENTRY(poll_ctl),
+	__COBALT_CALL_ENTRY(poll_wait),
 	__COBALT_CALL_ENTRY(sched_minprio),
 	__COBALT_CALL_ENTRY(sched_maxprio),
 	__COBALT_CALL_ENTRY(monitor_init),
@@ -683,6 +689,8 @@ static const cobalt_syshand cobalt_syscalls[] = {
 	__COBALT_CALL_ENTRY(write),
 	__COBALT_CALL_ENTRY(recvmsg),
 	__COBALT_CALL_ENTRY(sendmsg),
+	__COBALT_CALL_ENTRY(recvmmsg),
+	__COBALT_CALL_ENTRY(sendmmsg),
 	__COBALT_CALL_ENTRY(migrate),
 	__COBALT_CALL_ENTRY(archcall),
 	__COBALT_CALL_ENTRY(bind),
@@ -747,6 +755,8 @@ static const int cobalt_sysmodes[] = {
 	__COBALT_MODE(mq_timedsend, primary),
 	__COBALT_MODE(mq_timedreceive, primary),
 	__COBALT_MODE(mq_notify, primary),
+	__COBALT_MODE(mq_state, current),
+	__COBALT_MODE(mq_sync, current),
 	__COBALT_MODE(sigwait, primary),
 	__COBALT_MODE(sigwaitinfo, nonrestartable),
 	__COBALT_MODE(sigtimedwait, nonrestartable),
@@ -762,6 +772,9 @@ static const int cobalt_sysmodes[] = {
 	__COBALT_MODE(timerfd_gettime, current),
 	__COBALT_MODE(timerfd_settime, primary),
 	__COBALT_MODE(select, nonrestartable),
+	__COBALT_MODE(poll_create, lostage),
+	__COBALT_MODE(poll_ctl, lostage),
+	__COBALT_MODE(poll_wait, primary),
 	__COBALT_MODE(sched_minprio, current),
 	__COBALT_MODE(sched_maxprio, current),
 	__COBALT_MODE(monitor_init, current),
@@ -786,6 +799,8 @@ static const int cobalt_sysmodes[] = {
 	__COBALT_MODE(write, probing),
 	__COBALT_MODE(recvmsg, probing),
 	__COBALT_MODE(sendmsg, probing),
+	__COBALT_MODE(recvmmsg, probing),
+	__COBALT_MODE(sendmmsg, probing),
 	__COBALT_MODE(migrate, current),
 	__COBALT_MODE(archcall, current),
 	__COBALT_MODE(bind, lostage),
@@ -34,6 +34,7 @@
 #include "event.h"
 #include "mqueue.h"
 #include "io.h"
+#include "poll.h"
 #include "../debug.h"
 
 COBALT_SYSCALL32emu(thread_create, init,
@@ -725,6 +726,23 @@ COBALT_SYSCALL32emu(select, nonrestartable,
 	return err;
 }
 
+COBALT_SYSCALL32emu(poll_wait, primary,
+		    (int pfd, struct pollfd __user *u_fds, int nrfds,
+		     const struct compat_timespec __user *u_ts))
+{
+	struct timespec ts;
+	int ret;
+
+	if (u_ts == NULL)
+		return __cobalt_poll_wait(pfd, u_fds, nrfds, NULL);
+
+	ret = sys32_get_timespec(&ts, u_ts);
+	if (ret)
+		return ret;
+
+	return __cobalt_poll_wait(pfd, u_fds, nrfds, &ts);
+}
+
 COBALT_SYSCALL32emu(recvmsg, probing,
 		    (int fd, struct compat_msghdr __user *umsg,
 		     int flags))
@@ -754,6 +772,57 @@ COBALT_SYSCALL32emu(sendmsg, probing,
 	return ret ?: rtdm_fd_sendmsg(fd, &m, flags);
 }
 
+static int get_mmsg32(struct mmsghdr *mmsg, void __user *u_mmsg)
+{
+	struct compat_mmsghdr __user *u_cmmsg = u_mmsg;
+
+	return sys32_get_msghdr(&mmsg->msg_hdr, &u_cmmsg->msg_hdr);
+}
+
+static int put_mmsg32(void __user *u_mmsg, const struct mmsghdr *mmsg)
+{
+	struct compat_mmsghdr __user *u_cmmsg = u_mmsg;
+
+	return sys32_put_msghdr(&u_cmmsg->msg_hdr, &mmsg->msg_hdr) ?:
+		__xn_put_user(mmsg->msg_len, &u_cmmsg->msg_len) ? -EFAULT : 0;
+}
+
+static int put_mmsg32_len(void __user *u_mmsg, const struct mmsghdr *mmsg)
+{
+	struct compat_mmsghdr __user *u_cmmsg = u_mmsg;
+
+	return __xn_put_user(mmsg->msg_len, &u_cmmsg->msg_len) ? -EFAULT : 0;
+}
+
+COBALT_SYSCALL32emu(recvmmsg, probing,
+		    (int fd, struct compat_mmsghdr __user *u_msgvec,
+		     unsigned int vlen, unsigned int flags,
+		     struct compat_timespec __user *u_timeout))
+{
+	struct timespec ts;
+	int ret;
+
+	if (u_timeout) {
+		ret = sys32_get_timespec(&ts, u_timeout);
+		if (ret)
+			return ret;
+		if (!timespec_valid(&ts))
+			return -EINVAL;
+	}
+
+	return __rtdm_fd_recvmmsg(fd, u_msgvec, vlen, flags,
+				  u_timeout ? &ts : NULL, sizeof(*u_msgvec),
+				  get_mmsg32, put_mmsg32);
+}
+
+COBALT_SYSCALL32emu(sendmmsg, probing,
+		    (int fd, struct compat_mmsghdr __user *u_msgvec,
+		     unsigned int vlen, unsigned int flags))
+{
+	return __rtdm_fd_sendmmsg(fd, u_msgvec, vlen, flags,
+				  sizeof(*u_msgvec), get_mmsg32, put_mmsg32_len);
+}
+
 COBALT_SYSCALL32emu(mmap, lostage,
 		    (int fd, struct compat_rtdm_mmap_request __user *u_crma,
 		     compat_uptr_t __user *u_caddrp))
@@ -25,6 +25,7 @@ struct cobalt_event_shadow;
 struct cobalt_cond_shadow;
 struct cobalt_sem_shadow;
 struct cobalt_monitor_shadow;
+struct pollfd;
 
 COBALT_SYSCALL32emu_DECL(thread_create,
 			 (compat_ulong_t pth,
@@ -174,6 +175,10 @@ COBALT_SYSCALL32emu_DECL(select,
 			  compat_fd_set __user *u_xfds,
 			  struct compat_timeval __user *u_tv));
 
+COBALT_SYSCALL32emu_DECL(poll_wait,
+			 (int pfd, struct pollfd __user *u_fds, int nrfds,
+			  const struct compat_timespec __user *u_ts));
+
 COBALT_SYSCALL32emu_DECL(recvmsg,
 			 (int fd, struct compat_msghdr __user *umsg,
 			  int flags));
@@ -182,6 +187,15 @@ COBALT_SYSCALL32emu_DECL(sendmsg,
 			 (int fd, struct compat_msghdr __user *umsg,
 			  int flags));
 
+COBALT_SYSCALL32emu_DECL(recvmmsg,
+			 (int fd, struct compat_mmsghdr __user *u_msgvec,
+			  unsigned int vlen, unsigned int flags,
+			  struct compat_timespec __user *u_timeout));
+
+COBALT_SYSCALL32emu_DECL(sendmmsg,
+			 (int fd, struct compat_mmsghdr __user *u_msgvec,
+			  unsigned int vlen, unsigned int flags));
+
 COBALT_SYSCALL32emu_DECL(mmap,
 			 (int fd,
 			  struct compat_rtdm_mmap_request __user *u_rma,
@@ -102,6 +102,7 @@ static int latency_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 
 static ssize_t latency_vfile_store(struct xnvfile_input *input)
 {
+	struct xnclock_gravity gravity;
 	ssize_t ret;
 	long val;
 
@@ -109,7 +110,9 @@ static ssize_t latency_vfile_store(struct xnvfile_input *input)
 	if (ret < 0)
 		return ret;
 
-	nkclock.gravity.user = xnclock_ns_to_ticks(&nkclock, val);
+	gravity = nkclock.gravity;
+	gravity.user = xnclock_ns_to_ticks(&nkclock, val);
+	xnclock_set_gravity(&nkclock, &gravity);
 
 	return ret;
 }
@@ -17,6 +17,8 @@
  */
 
 #include <linux/slab.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
 #include <cobalt/kernel/sched.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/registry.h>
@@ -50,9 +52,39 @@ static unsigned int nr_active_objects;
 
 static unsigned long next_object_stamp;
 
-static struct hlist_head *object_index;
+/*
+ * Guards the slot queues, the hash table and the export state of
+ * objects. Callers may hold nklock, which nests outside it. This is
+ * nklock itself unless CONFIG_XENO_OPT_REGISTRY_LOCK is set.
+ */
+#ifdef CONFIG_XENO_OPT_REGISTRY_LOCK
+DEFINE_PRIVATE_XNLOCK(__registry_lock);
+#define registry_lock	(&__registry_lock)
+#else
+#define registry_lock	(&nklock)
+#endif
+
+/*
+ * Named objects are indexed by a hash table which doubles in size as
+ * the population grows, up to the count of registry slots. Lookups
+ * walk the hash chains locklessly, retrying if an update raced with
+ * them. This is safe since chain links may only point at registry
+ * slots, which are never freed, and tables replaced by a larger one
+ * are only released at cleanup.
+ */
+struct registry_hash {
+	unsigned int mask;
+	struct registry_hash *prev;
+	struct xnobject *buckets[0];
+};
+
+#define REGISTRY_HASH_MINSIZE	64
+
+static struct registry_hash *object_index;
 
-static int nr_object_entries;
+static unsigned int object_index_seq;
+
+static unsigned int nr_hashed_objects;
 
 static struct xnsynch register_synch;
 
@@ -90,18 +122,33 @@ static struct xnvfile_regular usage_vfile = {
 
 #endif /* CONFIG_XENO_OPT_VFILE */
 
+static inline unsigned int registry_hash_maxsize(void)
+{
+	return roundup_pow_of_two(CONFIG_XENO_OPT_REGISTRY_NRSLOTS);
+}
+
 unsigned xnregistry_hash_size(void)
 {
-	static const int primes[] = {
-		101, 211, 307, 401, 503, 601,
-		701, 809, 907, 1009, 1103
-	};
+	if (object_index)
+		return object_index->mask + 1;
+
+	return min_t(unsigned int, registry_hash_maxsize(),
+		     REGISTRY_HASH_MINSIZE);
+}
+
+static struct registry_hash *registry_hash_alloc(unsigned int size)
+{
+	struct registry_hash *h;
 
-#define obj_hash_max(n)			 \
-((n) < sizeof(primes) / sizeof(int) ? \
- (n) : sizeof(primes) / sizeof(int) - 1)
+	h = xnmalloc(sizeof(*h) + size * sizeof(h->buckets[0]));
+	if (h == NULL)
+		return NULL;
 
-	return primes[obj_hash_max(CONFIG_XENO_OPT_REGISTRY_NRSLOTS / 100)];
+	memset(h->buckets, 0, size * sizeof(h->buckets[0]));
+	h->mask = size - 1;
+	h->prev = NULL;
+
+	return h;
 }
 
 int xnregistry_init(void)
@@ -145,10 +192,7 @@ int xnregistry_init(void)
 	list_get_entry(&free_object_list, struct xnobject, link);
 	nr_active_objects = 1;
 
-	nr_object_entries = xnregistry_hash_size();
-	object_index = kmalloc(sizeof(*object_index) *
-				      nr_object_entries, GFP_KERNEL);
-
+	object_index = registry_hash_alloc(xnregistry_hash_size());
 	if (object_index == NULL) {
 #ifdef CONFIG_XENO_OPT_VFILE
 		xnvfile_destroy_regular(&usage_vfile);
@@ -158,9 +202,6 @@ int xnregistry_init(void)
 		return -ENOMEM;
 	}
 
-	for (n = 0; n < nr_object_entries; n++)
-		INIT_HLIST_HEAD(&object_index[n]);
-
 	xnsynch_init(&register_synch, XNSYNCH_FIFO, NULL);
 
 	return 0;
@@ -168,17 +209,17 @@ int xnregistry_init(void)
 
 void xnregistry_cleanup(void)
 {
+	struct registry_hash *h;
 #ifdef CONFIG_XENO_OPT_VFILE
-	struct hlist_node *enext;
 	struct xnobject *ecurr;
 	struct xnpnode *pnode;
-	int n;
+	unsigned int n;
 
 	flush_scheduled_work();
 
-	for (n = 0; n < nr_object_entries; n++)
-		hlist_for_each_entry_safe(ecurr, enext, 
-					&object_index[n], hlink) {
+	for (n = 0; n <= object_index->mask; n++)
+		for (ecurr = object_index->buckets[n]; ecurr;
+		     ecurr = ecurr->hnext) {
 			pnode = ecurr->pnode;
 			if (pnode == NULL)
 				continue;
@@ -195,7 +236,12 @@ void xnregistry_cleanup(void)
 		}
 #endif /* CONFIG_XENO_OPT_VFILE */
 
-	kfree(object_index);
+	while (object_index) {
+		h = object_index->prev;
+		xnfree(object_index);
+		object_index = h;
+	}
+
 	xnsynch_destroy(&register_synch);
 
 #ifdef CONFIG_XENO_OPT_VFILE
@@ -235,7 +281,7 @@ static void proc_callback(struct work_struct *work)
 
 	down(&export_mutex);
 
-	xnlock_get_irqsave(&nklock, s);
+	xnlock_get_irqsave(registry_lock, s);
 
 	if (list_empty(&proc_object_list))
 		goto out;
@@ -254,14 +300,15 @@ static void proc_callback(struct work_struct *work)
 		object->vfilp = XNOBJECT_PNODE_RESERVED2;
 		list_add_tail(&object->link, &busy_object_list);
 
-		xnlock_put_irqrestore(&nklock, s);
+		xnlock_put_irqrestore(registry_lock, s);
 
 		if (pnode->entries++ == 0) {
 			if (pnode->root->entries++ == 0) {
 				/* Create the root directory on the fly. */
 				ret = xnvfile_init_dir(rname, rdir, &registry_vfroot);
 				if (ret) {
-					xnlock_get_irqsave(&nklock, s);
+					xnlock_get_irqsave(registry_lock,
+							   s);
 					object->pnode = NULL;
 					pnode->root->entries = 0;
 					pnode->entries = 0;
@@ -275,7 +322,7 @@ static void proc_callback(struct work_struct *work)
 					pnode->root->entries = 0;
 					xnvfile_destroy_dir(rdir);
 				}
-				xnlock_get_irqsave(&nklock, s);
+				xnlock_get_irqsave(registry_lock, s);
 				object->pnode = NULL;
 				pnode->entries = 0;
 				continue;
@@ -287,10 +334,10 @@ static void proc_callback(struct work_struct *work)
 			xnvfile_destroy_dir(dir);
 			if (--pnode->root->entries == 0)
 				xnvfile_destroy_dir(rdir);
-			xnlock_get_irqsave(&nklock, s);
+			xnlock_get_irqsave(registry_lock, s);
 			object->pnode = NULL;
 		} else
-			xnlock_get_irqsave(&nklock, s);
+			xnlock_get_irqsave(registry_lock, s);
 
 		continue;
 
@@ -309,7 +356,7 @@ static void proc_callback(struct work_struct *work)
 			nr_active_objects--;
 		}
 
-		xnlock_put_irqrestore(&nklock, s);
+		xnlock_put_irqrestore(registry_lock, s);
 
 		pnode->ops->unexport(object, pnode);
 
@@ -319,10 +366,10 @@ static void proc_callback(struct work_struct *work)
 				xnvfile_destroy_dir(rdir);
 		}
 
-		xnlock_get_irqsave(&nklock, s);
+		xnlock_get_irqsave(registry_lock, s);
 	}
 out:
-	xnlock_put_irqrestore(&nklock, s);
+	xnlock_put_irqrestore(registry_lock, s);
 
 	up(&export_mutex);
 }
@@ -500,63 +547,150 @@ static inline void registry_unexport_pnode(struct xnobject *object)
 
 #endif /* CONFIG_XENO_OPT_VFILE */
 
-static unsigned registry_hash_crunch(const char *key)
+static inline u32 registry_hash_crunch(const char *key, size_t len)
+{
+	return jhash(key, len, 0);
+}
+
+/*
+ * Updates to the hash table are serialized by the registry lock, and
+ * bracketed by an odd sequence count, so that lockless readers may
+ * detect them.
+ */
+static inline void registry_hash_write_begin(void)
 {
-	unsigned int h = 0, g;
+	object_index_seq++;
+	smp_wmb();
+}
 
-#define HQON    24		/* Higher byte position */
-#define HBYTE   0xf0000000	/* Higher nibble on */
+static inline void registry_hash_write_end(void)
+{
+	smp_wmb();
+	object_index_seq++;
+}
 
-	while (*key) {
-		h = (h << 4) + *key++;
-		if ((g = (h & HBYTE)) != 0)
-			h = (h ^ (g >> HQON)) ^ g;
+/* registry lock held, irqs off */
+static void registry_hash_grow(void)
+{
+	struct registry_hash *old = object_index, *h;
+	struct xnobject *ecurr, *next, **bucket;
+	unsigned int size, n;
+
+	size = (old->mask + 1) * 2;
+	if (size > registry_hash_maxsize())
+		return;
+
+	/* If we cannot grow, longer chains are no big deal. */
+	h = registry_hash_alloc(size);
+	if (h == NULL)
+		return;
+
+	registry_hash_write_begin();
+
+	for (n = 0; n <= old->mask; n++) {
+		for (ecurr = old->buckets[n]; ecurr; ecurr = next) {
+			next = ecurr->hnext;
+			bucket = &h->buckets[ecurr->hash & h->mask];
+			ecurr->hnext = *bucket;
+			*bucket = ecurr;
+		}
 	}
 
-	return h % nr_object_entries;
+	h->prev = old;
+	object_index = h;
+
+	registry_hash_write_end();
 }
 
+/* registry lock held, irqs off */
 static inline int registry_hash_enter(const char *key, struct xnobject *object)
 {
-	struct xnobject *ecurr;
-	unsigned s;
+	struct xnobject *ecurr, **bucket;
+	u32 hash;
 
 	object->key = key;
-	s = registry_hash_crunch(key);
+	hash = registry_hash_crunch(key, strlen(key));
+	bucket = &object_index->buckets[hash & object_index->mask];
 
-	hlist_for_each_entry(ecurr, &object_index[s], hlink)
-		if (ecurr == object || strcmp(key, ecurr->key) == 0)
+	for (ecurr = *bucket; ecurr; ecurr = ecurr->hnext)
+		if (ecurr == object ||
+		    (ecurr->hash == hash && strcmp(key, ecurr->key) == 0))
 			return -EEXIST;
 
-	hlist_add_head(&object->hlink, &object_index[s]);
+	registry_hash_write_begin();
+	object->hash = hash;
+	object->hnext = *bucket;
+	*bucket = object;
+	registry_hash_write_end();
+
+	if (++nr_hashed_objects > 2 * (object_index->mask + 1))
+		registry_hash_grow();
 
 	return 0;
 }
 
+/* registry lock held, irqs off */
 static inline int registry_hash_remove(struct xnobject *object)
 {
-	unsigned int s = registry_hash_crunch(object->key);
-	struct xnobject *ecurr;
-
-	hlist_for_each_entry(ecurr, &object_index[s], hlink)
-		if (ecurr == object) {
-			hlist_del(&ecurr->hlink);
+	struct xnobject **link;
+
+	link = &object_index->buckets[object->hash & object_index->mask];
+	for (; *link; link = &(*link)->hnext) {
+		if (*link == object) {
+			registry_hash_write_begin();
+			*link = object->hnext;
+			registry_hash_write_end();
+			nr_hashed_objects--;
 			return 0;
 		}
+	}
 
 	return -ESRCH;
 }
 
+/*
+ * May be called locklessly. A stale object we may run into while
+ * racing with an update may point at a released key, so we only
+ * compare keys when the hash values match, never reading past the
+ * length of the searched key.
+ */
 static struct xnobject *registry_hash_find(const char *key)
 {
+	struct registry_hash *h;
 	struct xnobject *ecurr;
+	unsigned int seq, n;
+	const char *ekey;
+	size_t len;
+	u32 hash;
+
+	len = strlen(key);
+	hash = registry_hash_crunch(key, len);
+retry:
+	seq = ACCESS_ONCE(object_index_seq);
+	if (seq & 1) {
+		cpu_relax();
+		goto retry;
+	}
+	smp_rmb();
+
+	h = ACCESS_ONCE(object_index);
+	ecurr = ACCESS_ONCE(h->buckets[hash & h->mask]);
+
+	/* Chains may be rearranged under our feet, bound the walk. */
+	for (n = 0; ecurr && n < CONFIG_XENO_OPT_REGISTRY_NRSLOTS; n++) {
+		if (ACCESS_ONCE(ecurr->hash) == hash) {
+			ekey = ACCESS_ONCE(ecurr->key);
+			if (ekey && strncmp(key, ekey, len + 1) == 0)
+				break;
+		}
+		ecurr = ACCESS_ONCE(ecurr->hnext);
+	}
 
-	hlist_for_each_entry(ecurr, 
-			&object_index[registry_hash_crunch(key)], hlink)
-		if (strcmp(key, ecurr->key) == 0)
-			return ecurr;
+	smp_rmb();
+	if (ACCESS_ONCE(object_index_seq) != seq)
+		goto retry;
 
-	return NULL;
+	return n < CONFIG_XENO_OPT_REGISTRY_NRSLOTS ? ecurr : NULL;
 }
 
 struct registry_wait_context {
@@ -634,7 +768,7 @@ int xnregistry_enter(const char *key, void *objaddr,
 	if (objaddr == NULL || (key != NULL && strchr(key, '/')))
 		return -EINVAL;
 
-	xnlock_get_irqsave(&nklock, s);
+	xnlock_get_irqsave(registry_lock, s);
 
 	if (list_empty(&free_object_list)) {
 		ret = -ENOMEM;
@@ -675,12 +809,25 @@ int xnregistry_enter(const char *key, void *objaddr,
 		registry_export_pnode(object, pnode);
 #endif /* CONFIG_XENO_OPT_VFILE */
 
+	xnlock_put_irqrestore(registry_lock, s);
+
+	/*
+	 * Binders look the key up then sleep atomically under
+	 * nklock, so they either found the object already, or wait
+	 * for us to wake them up now.
+	 */
+	xnlock_get_irqsave(&nklock, s);
+
 	if (registry_wakeup_sleepers(key))
 		xnsched_run();
 
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
 unlock_and_exit:
 
-	xnlock_put_irqrestore(&nklock, s);
+	xnlock_put_irqrestore(registry_lock, s);
 
 	return ret;
 }
@@ -752,6 +899,13 @@ int xnregistry_bind(const char *key, xnticks_t timeout, int timeout_mode,
 	if (key == NULL)
 		return -EINVAL;
 
+	/* Fast path: the object exists, no need to grab nklock. */
+	object = registry_hash_find(key);
+	if (object) {
+		*phandle = object - registry_obj_slots;
+		return 0;
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	if (timeout_mode == XN_RELATIVE &&
@@ -815,9 +969,14 @@ int xnregistry_remove(xnhandle_t handle)
 {
 	struct xnobject *object;
 	int ret = 0;
-	spl_t s;
+	spl_t s, s2;
 
+	/*
+	 * Callers of xnregistry_lookup() may rely on nklock for
+	 * keeping the object valid while they use it.
+	 */
 	xnlock_get_irqsave(&nklock, s);
+	xnlock_get_irqsave(registry_lock, s2);
 
 	object = xnregistry_validate(handle);
 	if (object == NULL) {
@@ -851,6 +1010,7 @@ int xnregistry_remove(xnhandle_t handle)
 
 unlock_and_exit:
 
+	xnlock_put_irqrestore(registry_lock, s2);
 	xnlock_put_irqrestore(&nklock, s);
 
 	return ret;
@@ -866,12 +1026,14 @@ int xnregistry_unlink(const char *key)
 {
 	struct xnobject *object;
 	int ret = 0;
-	spl_t s;
+	spl_t s, s2;
 
 	if (key == NULL)
 		return -EINVAL;
 
+	/* Touching the vfile revision tag requires nklock. */
 	xnlock_get_irqsave(&nklock, s);
+	xnlock_get_irqsave(registry_lock, s2);
 
 	object = registry_hash_find(key);
 	if (object == NULL) {
@@ -900,6 +1062,7 @@ int xnregistry_unlink(const char *key)
 	object->key = NULL;
 
 unlock_and_exit:
+	xnlock_put_irqrestore(registry_lock, s2);
 	xnlock_put_irqrestore(&nklock, s);
 
 	return ret;
@@ -118,6 +118,21 @@ static struct rtdm_fd *fetch_fd(struct cobalt_ppd *p, int ufd)
 		}							\
 	while (0)
 
+/*
+ * Optional dual handlers are left NULL if none is implemented, so
+ * that the core may fall back to a generic implementation.
+ */
+#define assign_optional_dual_handlers(__handler)			\
+	do								\
+		if (__rt(__handler) || __nrt(__handler)) {		\
+			assign_default_handler(__rt(__handler));	\
+			assign_default_handler(__nrt(__handler));	\
+		}							\
+	while (0)
+
+/* Number of message headers mirrored to kernel memory at once. */
+#define RTDM_MMSG_BATCH  8
+
 #ifdef CONFIG_XENO_ARCH_SYS3264
 
 static inline void set_compat_bit(struct rtdm_fd *fd)
@@ -163,6 +178,8 @@ int rtdm_fd_enter(struct rtdm_fd *fd, int ufd, unsigned int magic,
 	assign_default_dual_handlers(ops->write);
 	assign_default_dual_handlers(ops->recvmsg);
 	assign_default_dual_handlers(ops->sendmsg);
+	assign_optional_dual_handlers(ops->recvmmsg);
+	assign_optional_dual_handlers(ops->sendmmsg);
 	assign_invalid_default_handler(ops->select);
 	assign_invalid_default_handler(ops->mmap);
 	__assign_default_handler(ops->close, nop_close);
@@ -566,6 +583,205 @@ out:
 }
 EXPORT_SYMBOL_GPL(rtdm_fd_sendmsg);
 
+static int recvmmsg_loop(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			 unsigned int vlen, unsigned int flags)
+{
+	unsigned int n, mflags = flags & ~MSG_WAITFORONE;
+	ssize_t ret;
+
+	for (n = 0; n < vlen; n++) {
+		if (ipipe_root_p)
+			ret = fd->ops->recvmsg_nrt(fd, &msgvec[n].msg_hdr, mflags);
+		else
+			ret = fd->ops->recvmsg_rt(fd, &msgvec[n].msg_hdr, mflags);
+		if (ret < 0)
+			return n ?: ret;
+		msgvec[n].msg_len = ret;
+		if (flags & MSG_WAITFORONE)
+			mflags |= MSG_DONTWAIT;
+	}
+
+	return n;
+}
+
+static int sendmmsg_loop(struct rtdm_fd *fd, struct mmsghdr *msgvec,
+			 unsigned int vlen, unsigned int flags)
+{
+	unsigned int n;
+	ssize_t ret;
+
+	for (n = 0; n < vlen; n++) {
+		if (ipipe_root_p)
+			ret = fd->ops->sendmsg_nrt(fd, &msgvec[n].msg_hdr, flags);
+		else
+			ret = fd->ops->sendmsg_rt(fd, &msgvec[n].msg_hdr, flags);
+		if (ret < 0)
+			return n ?: ret;
+		msgvec[n].msg_len = ret;
+	}
+
+	return n;
+}
+
+/*
+ * Message headers are mirrored to kernel memory by small batches,
+ * which are passed to the native handler of the driver if present,
+ * or to the single message handler in a loop otherwise. Like Linux
+ * does, the timeout is only checked after a batch was received, and
+ * an error is only returned if no message was processed at all.
+ */
+int __rtdm_fd_recvmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
+		       unsigned int flags, const struct timespec *timeout,
+		       size_t mmsgsz,
+		       int (*get_mmsg)(struct mmsghdr *mmsg, void __user *u_mmsg),
+		       int (*put_mmsg)(void __user *u_mmsg,
+				       const struct mmsghdr *mmsg))
+{
+	struct mmsghdr mmsg[RTDM_MMSG_BATCH];
+	unsigned int datagrams = 0, n, i;
+	nanosecs_abs_t deadline = 0;
+	struct rtdm_fd *fd;
+	int ret = 0;
+
+	fd = rtdm_fd_get(ufd, 0);
+	if (IS_ERR(fd)) {
+		ret = PTR_ERR(fd);
+		goto out;
+	}
+
+	set_compat_bit(fd);
+
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	trace_cobalt_fd_recvmmsg(current, fd, ufd, flags);
+
+	if (timeout)
+		deadline = rtdm_clock_read_monotonic() + timespec_to_ns(timeout);
+
+	while (datagrams < vlen) {
+		n = min_t(unsigned int, vlen - datagrams, RTDM_MMSG_BATCH);
+		for (i = 0; i < n; i++) {
+			ret = get_mmsg(&mmsg[i],
+				       u_msgvec + (datagrams + i) * mmsgsz);
+			if (ret)
+				goto done;
+		}
+
+		if (fd->ops->recvmmsg_rt == NULL)
+			ret = recvmmsg_loop(fd, mmsg, n, flags);
+		else if (ipipe_root_p)
+			ret = fd->ops->recvmmsg_nrt(fd, mmsg, n, flags);
+		else
+			ret = fd->ops->recvmmsg_rt(fd, mmsg, n, flags);
+
+		if (!XENO_ASSERT(COBALT, !spltest()))
+			splnone();
+
+		if (ret <= 0)
+			goto done;
+
+		for (i = 0; i < ret; i++) {
+			if (put_mmsg(u_msgvec + (datagrams + i) * mmsgsz,
+				     &mmsg[i])) {
+				ret = -EFAULT;
+				goto done;
+			}
+		}
+
+		datagrams += ret;
+		if (ret < n)
+			break;
+
+		if (flags & MSG_WAITFORONE)
+			flags |= MSG_DONTWAIT;
+
+		if (timeout && rtdm_clock_read_monotonic() >= deadline)
+			break;
+	}
+done:
+	rtdm_fd_put(fd);
+
+	if (datagrams > 0)
+		ret = datagrams;
+out:
+	if (ret < 0)
+		trace_cobalt_fd_recvmmsg_status(current, fd, ufd, ret);
+
+	return ret;
+}
+
+int __rtdm_fd_sendmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
+		       unsigned int flags, size_t mmsgsz,
+		       int (*get_mmsg)(struct mmsghdr *mmsg, void __user *u_mmsg),
+		       int (*put_mmsg)(void __user *u_mmsg,
+				       const struct mmsghdr *mmsg))
+{
+	struct mmsghdr mmsg[RTDM_MMSG_BATCH];
+	unsigned int datagrams = 0, n, i;
+	struct rtdm_fd *fd;
+	int ret = 0;
+
+	fd = rtdm_fd_get(ufd, 0);
+	if (IS_ERR(fd)) {
+		ret = PTR_ERR(fd);
+		goto out;
+	}
+
+	set_compat_bit(fd);
+
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	trace_cobalt_fd_sendmmsg(current, fd, ufd, flags);
+
+	while (datagrams < vlen) {
+		n = min_t(unsigned int, vlen - datagrams, RTDM_MMSG_BATCH);
+		for (i = 0; i < n; i++) {
+			ret = get_mmsg(&mmsg[i],
+				       u_msgvec + (datagrams + i) * mmsgsz);
+			if (ret)
+				goto done;
+		}
+
+		if (fd->ops->sendmmsg_rt == NULL)
+			ret = sendmmsg_loop(fd, mmsg, n, flags);
+		else if (ipipe_root_p)
+			ret = fd->ops->sendmmsg_nrt(fd, mmsg, n, flags);
+		else
+			ret = fd->ops->sendmmsg_rt(fd, mmsg, n, flags);
+
+		if (!XENO_ASSERT(COBALT, !spltest()))
+			splnone();
+
+		if (ret <= 0)
+			goto done;
+
+		/* Only msg_len is updated on output. */
+		for (i = 0; i < ret; i++) {
+			if (put_mmsg(u_msgvec + (datagrams + i) * mmsgsz,
+				     &mmsg[i])) {
+				ret = -EFAULT;
+				goto done;
+			}
+		}
+
+		datagrams += ret;
+		if (ret < n)
+			break;
+	}
+done:
+	rtdm_fd_put(fd);
+
+	if (datagrams > 0)
+		ret = datagrams;
+out:
+	if (ret < 0)
+		trace_cobalt_fd_sendmmsg_status(current, fd, ufd, ret);
+
+	return ret;
+}
+
 static void
 __fd_close(struct cobalt_ppd *p, struct rtdm_fd_index *idx, spl_t s)
 {
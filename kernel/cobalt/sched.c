@@ -17,6 +17,7 @@
  * 02111-1307, USA.
  */
 #include <linux/module.h>
+#include <linux/ctype.h>
 #include <linux/signal.h>
 #include <linux/wait.h>
 #include <cobalt/kernel/sched.h>
@@ -41,6 +42,8 @@ EXPORT_PER_CPU_SYMBOL_GPL(nksched);
 cpumask_t cobalt_cpu_affinity = CPU_MASK_ALL;
 EXPORT_SYMBOL_GPL(cobalt_cpu_affinity);
 
+int cobalt_cpu_placement = XNSCHED_PLACE_LOCAL;
+
 LIST_HEAD(nkthreadq);
 
 int cobalt_nrthreads;
@@ -464,7 +467,9 @@ static void migrate_thread(struct xnthread *thread, struct xnsched *sched)
 	 * result of calling the per-class migration hook.
 	 */
 	xnsched_set_resched(thread->sched);
+	xnsched_dec_nrthreads(thread->sched);
 	thread->sched = sched;
+	xnsched_inc_nrthreads(sched);
 }
 
 /*
@@ -501,6 +506,114 @@ void xnsched_migrate_passive(struct xnthread *thread, struct xnsched *sched)
 	}
 }
 
+#ifdef CONFIG_SMP
+
+#ifdef CONFIG_XENO_OPT_STATS
+
+/* Shortest load sampling window (ns). */
+#define XNSCHED_LOAD_WINDOW	10000000
+/* Usage difference (per mille) placement ignores. */
+#define XNSCHED_LOAD_GRAIN	50
+
+/*
+ * Return the real-time CPU usage (per mille) of @sched since the
+ * last sample, based on the time credited to its root thread. This
+ * is the same accounting data sched/acct reports for ROOT/<cpu>.
+ * Must be called with nklock locked, interrupts off.
+ */
+static int get_cpu_usage(struct xnsched *sched, xnticks_t now)
+{
+	xnstat_exectime_t *account = &sched->rootcb.stat.account;
+	xnticks_t idle, window, delta;
+
+	idle = xnstat_exectime_get_total(account);
+	if (xnstat_exectime_get_current(sched) == account &&
+	    (xnsticks_t)(now - sched->last_account_switch) > 0)
+		idle += now - sched->last_account_switch;
+
+	window = now - sched->load.date;
+	if ((xnsticks_t)window < xnclock_ns_to_ticks(&nkclock,
+						     XNSCHED_LOAD_WINDOW))
+		return sched->load.usage;
+
+	delta = idle - sched->load.idle;
+	if (delta > window)
+		delta = window;
+
+	while (window > 0xffffffffUL) {
+		delta >>= 16;
+		window >>= 16;
+	}
+
+	sched->load.usage = 1000 - xnarch_ulldiv(delta * 1000LL, window, NULL);
+	sched->load.date = now;
+	sched->load.idle = idle;
+
+	return sched->load.usage;
+}
+
+#else /* !CONFIG_XENO_OPT_STATS */
+
+#define XNSCHED_LOAD_GRAIN	1
+
+static inline int get_cpu_usage(struct xnsched *sched, xnticks_t now)
+{
+	return 0;
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS */
+
+/*
+ * Pick a CPU from @affinity for a new thread, according to the
+ * placement policy. With XNSCHED_PLACE_LOCAL, @cpu is kept if
+ * allowed, otherwise the first CPU of the set is picked. With
+ * XNSCHED_PLACE_BALANCED, the CPU with the lowest real-time usage
+ * wins, then the one with the fewest threads attached, which spreads
+ * threads created in a burst before any of them had a chance to
+ * run. @cpu is preferred among equals.
+ */
+int xnsched_pick_cpu(const cpumask_t *affinity, int cpu)
+{
+	int n, usage, nr, best = -1, best_usage = 0, best_nr = 0;
+	struct xnsched *sched;
+	xnticks_t now;
+	spl_t s;
+
+	if (cobalt_cpu_placement != XNSCHED_PLACE_BALANCED) {
+		if (!cpu_isset(cpu, *affinity))
+			cpu = first_cpu(*affinity);
+		return cpu;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	now = xnclock_core_read_raw();
+
+	for_each_realtime_cpu(n) {
+		if (!cpu_isset(n, *affinity))
+			continue;
+		sched = xnsched_struct(n);
+		usage = get_cpu_usage(sched, now) / XNSCHED_LOAD_GRAIN;
+		nr = sched->nr_threads;
+		if (best >= 0) {
+			if (usage > best_usage)
+				continue;
+			if (usage == best_usage &&
+			    (nr > best_nr || (nr == best_nr && n != cpu)))
+				continue;
+		}
+		best = n;
+		best_usage = usage;
+		best_nr = nr;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return best < 0 ? first_cpu(*affinity) : best;
+}
+
+#endif /* CONFIG_SMP */
+
 #ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
 
 void xnsched_initq(struct xnsched_mlq *q)
@@ -1286,18 +1399,42 @@ static int affinity_vfile_show(struct xnvfile_regular_iterator *it,
 			val |= (1UL << cpu);
 
 	xnvfile_printf(it, "%08lx\n", val);
+	xnvfile_printf(it, "placement: %s\n",
+		       cobalt_cpu_placement == XNSCHED_PLACE_BALANCED ?
+		       "balanced" : "local");
 
 	return 0;
 }
 
+/*
+ * Writing a CPU mask sets the dynamic affinity of new threads, 0
+ * resets it to the set of real-time CPUs. Writing "local" or
+ * "balanced" selects the placement policy of new threads within
+ * their allowed set of CPUs.
+ */
 static ssize_t affinity_vfile_store(struct xnvfile_input *input)
 {
 	cpumask_t affinity, set;
+	char buf[16];
 	ssize_t ret;
 	long val;
 	int cpu;
 	spl_t s;
 
+	ret = xnvfile_get_string(input, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	if (isalpha(buf[0])) {
+		if (strcmp(buf, "local") == 0)
+			cobalt_cpu_placement = XNSCHED_PLACE_LOCAL;
+		else if (strcmp(buf, "balanced") == 0)
+			cobalt_cpu_placement = XNSCHED_PLACE_BALANCED;
+		else
+			return -EINVAL;
+		return ret;
+	}
+
 	ret = xnvfile_get_integer(input, &val);
 	if (ret < 0)
 		return ret;
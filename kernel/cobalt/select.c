@@ -45,6 +45,14 @@
  * - a @a struct @a xnselector structure, the selection structure,  passed by
  * the thread calling the xnselect service, where this service does all its
  * housekeeping.
+ *
+ * A selector initialized with xnselector_init_readylist() does not
+ * use file descriptor sets. It rather queues its bindings to a ready
+ * list as the file descriptors they refer to change state, so that
+ * xnselect_ready() only has to walk the descriptors which are ready,
+ * regardless of how many are bound to the selector. This is the
+ * basis of persistent interest sets, which are populated once and
+ * waited for many times.
  * @{
  */
 
@@ -72,6 +80,28 @@ static inline int xnselect_wakeup(struct xnselector *selector)
 	return xnsynch_flush(&selector->synchbase, 0) == XNSYNCH_RESCHED;
 }
 
+static inline int set_ready(struct xnselector *selector,
+			    struct xnselect_binding *binding)
+{
+	if (!list_empty(&binding->rlink))
+		return 0;
+
+	list_add_tail(&binding->rlink, &selector->ready);
+	selector->nr_ready++;
+
+	return xnselect_wakeup(selector);
+}
+
+static inline void clear_ready(struct xnselector *selector,
+			       struct xnselect_binding *binding)
+{
+	if (list_empty(&binding->rlink))
+		return;
+
+	list_del_init(&binding->rlink);
+	selector->nr_ready--;
+}
+
 /**
  * Bind a file descriptor (represented by its @a xnselect structure) to a
  * selector block.
@@ -87,7 +117,8 @@ static inline int xnselect_wakeup(struct xnselector *selector)
  * XNSELECT_EXCEPT);
  *
  * @param index index of the file descriptor (represented by @a
- * select_block) in the bit fields used by the @a selector structure;
+ * select_block) in the bit fields used by the @a selector structure,
+ * or file descriptor number if @a selector maintains a ready list;
  *
  * @param state current state of the file descriptor.
  *
@@ -113,16 +144,27 @@ int xnselect_bind(struct xnselect *select_block,
 {
 	atomic_only();
 
-	if (type >= XNSELECT_MAX_TYPES || index > __FD_SETSIZE)
+	if (type >= XNSELECT_MAX_TYPES)
+		return -EINVAL;
+
+	if (!(selector->flags & XNSELECT_READYLIST) && index > __FD_SETSIZE)
 		return -EINVAL;
 
 	binding->selector = selector;
 	binding->fd = select_block;
 	binding->type = type;
 	binding->bit_index = index;
+	INIT_LIST_HEAD(&binding->rlink);
 
 	list_add_tail(&binding->slink, &selector->bindings);
 	list_add_tail(&binding->link, &select_block->bindings);
+
+	if (selector->flags & XNSELECT_READYLIST) {
+		if (state && set_ready(selector, binding))
+			xnsched_run();
+		return 0;
+	}
+
 	__FD_SET__(index, &selector->fds[type].expected);
 	if (state) {
 		__FD_SET__(index, &selector->fds[type].pending);
@@ -144,6 +186,13 @@ int __xnselect_signal(struct xnselect *select_block, unsigned state)
 
 	list_for_each_entry(binding, &select_block->bindings, link) {
 		selector = binding->selector;
+		if (selector->flags & XNSELECT_READYLIST) {
+			if (state)
+				resched |= set_ready(selector, binding);
+			else
+				clear_ready(selector, binding);
+			continue;
+		}
 		if (state) {
 			if (!__FD_ISSET__(binding->bit_index,
 					&selector->fds[binding->type].pending)) {
@@ -186,6 +235,14 @@ void xnselect_destroy(struct xnselect *select_block)
 	list_for_each_entry_safe(binding, tmp, &select_block->bindings, link) {
 		list_del(&binding->link);
 		selector = binding->selector;
+		/*
+		 * A descriptor going away silently leaves the
+		 * interest set of ready-list selectors.
+		 */
+		if (selector->flags & XNSELECT_READYLIST) {
+			clear_ready(selector, binding);
+			goto unlink;
+		}
 		__FD_CLR__(binding->bit_index,
 			 &selector->fds[binding->type].expected);
 		if (!__FD_ISSET__(binding->bit_index,
@@ -195,6 +252,7 @@ void xnselect_destroy(struct xnselect *select_block)
 			if (xnselect_wakeup(selector))
 				resched = 1;
 		}
+	unlink:
 		list_del(&binding->slink);
 		xnlock_put_irqrestore(&nklock, s);
 		xnfree(binding);
@@ -289,11 +347,115 @@ int xnselector_init(struct xnselector *selector)
 		__FD_ZERO__(&selector->fds[i].pending);
 	}
 	INIT_LIST_HEAD(&selector->bindings);
+	INIT_LIST_HEAD(&selector->ready);
+	selector->nr_ready = 0;
+	selector->flags = 0;
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnselector_init);
 
+/**
+ * Initialize a selector structure maintaining a ready list.
+ *
+ * Such selector may only be waited for with xnselect_ready(). File
+ * descriptors bound to it are not limited to the range of a @a
+ * fd_set.
+ *
+ * @param selector The selector structure to be initialized.
+ *
+ * @retval 0
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselector_init_readylist(struct xnselector *selector)
+{
+	xnselector_init(selector);
+	selector->flags = XNSELECT_READYLIST;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselector_init_readylist);
+
+/**
+ * Test whether a file descriptor is bound to a selector.
+ *
+ * @param selector the selector to search;
+ * @param index index of the file descriptor, as passed to
+ * xnselect_bind().
+ *
+ * @return non-zero if any binding refers to @a index.
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselector_bound_p(struct xnselector *selector, unsigned int index)
+{
+	struct xnselect_binding *binding;
+	int ret = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	list_for_each_entry(binding, &selector->bindings, slink) {
+		if (binding->bit_index == index) {
+			ret = 1;
+			break;
+		}
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnselector_bound_p);
+
+/**
+ * Unbind a file descriptor from a selector.
+ *
+ * All bindings of the file descriptor to @a selector are dropped,
+ * for every event type.
+ *
+ * @param selector the selector to unbind from;
+ * @param index index of the file descriptor, as passed to
+ * xnselect_bind().
+ *
+ * @retval -ENOENT if @a index is not bound to @a selector;
+ * @retval 0 otherwise.
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselector_unbind(struct xnselector *selector, unsigned int index)
+{
+	struct xnselect_binding *binding;
+	int ret = -ENOENT;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+restart:
+	list_for_each_entry(binding, &selector->bindings, slink) {
+		if (binding->bit_index != index)
+			continue;
+		list_del(&binding->slink);
+		list_del(&binding->link);
+		if (selector->flags & XNSELECT_READYLIST)
+			clear_ready(selector, binding);
+		else {
+			__FD_CLR__(index, &selector->fds[binding->type].expected);
+			__FD_CLR__(index, &selector->fds[binding->type].pending);
+		}
+		xnlock_put_irqrestore(&nklock, s);
+		xnfree(binding);
+		xnlock_get_irqsave(&nklock, s);
+		ret = 0;
+		goto restart;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnselector_unbind);
+
 /**
  * Check the state of a number of file descriptors, wait for a state change if
  * no descriptor is ready.
@@ -384,6 +546,89 @@ int xnselect(struct xnselector *selector,
 }
 EXPORT_SYMBOL_GPL(xnselect);
 
+/**
+ * Wait for file descriptors bound to a ready-list selector to be
+ * ready.
+ *
+ * Events are reported from the head of the ready list, whose
+ * entries are moved to the tail once collected. Since descriptors
+ * stay on the list for as long as they are ready, this provides
+ * level-triggered semantics, and a caller collecting less events
+ * than there are ready descriptors eventually sees all of them.
+ * The cost is proportional to the number of events collected, not
+ * to the number of bound descriptors.
+ *
+ * Events of the same descriptor are merged into a single entry when
+ * adjacent on the ready list, which is the usual case when they are
+ * bound in a row.
+ *
+ * @param selector the selector to wait on, which must have been
+ * initialized with xnselector_init_readylist();
+ * @param events array receiving the ready events;
+ * @param nrevents the size of @a events, which must be strictly
+ * positive;
+ * @param timeout the timeout, whose meaning depends on @a
+ * timeout_mode, or XN_NONBLOCK to return immediately if no
+ * descriptor is ready;
+ * @param timeout_mode the mode of @a timeout.
+ *
+ * @retval -EINTR if @a xnselect_ready was interrupted while waiting;
+ * @retval -EIDRM if @a selector was deleted while waiting;
+ * @retval 0 in case of timeout;
+ * @retval the number of entries stored to @a events.
+ *
+ * @coretags{primary-only, might-switch}
+ */
+int xnselect_ready(struct xnselector *selector,
+		   struct xnselect_event *events, int nrevents,
+		   xnticks_t timeout, xntmode_t timeout_mode)
+{
+	struct xnselect_binding *binding;
+	unsigned int count, i;
+	int info, ret = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while (selector->nr_ready == 0) {
+		if (timeout == XN_NONBLOCK)
+			goto out;
+		info = xnsynch_sleep_on(&selector->synchbase,
+					timeout, timeout_mode);
+		if (info & XNRMID) {
+			ret = -EIDRM;
+			goto out;
+		}
+		if (selector->nr_ready)
+			break;
+		if (info & XNBREAK) {
+			ret = -EINTR;
+			goto out;
+		}
+		if (info & XNTIMEO)
+			goto out;
+	}
+
+	count = min_t(unsigned int, nrevents, selector->nr_ready);
+	for (i = 0; i < count; i++) {
+		binding = list_first_entry(&selector->ready,
+					   struct xnselect_binding, rlink);
+		list_move_tail(&binding->rlink, &selector->ready);
+		if (ret > 0 && events[ret - 1].index == binding->bit_index) {
+			events[ret - 1].types |= 1 << binding->type;
+			continue;
+		}
+		events[ret].index = binding->bit_index;
+		events[ret].types = 1 << binding->type;
+		ret++;
+	}
+out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnselect_ready);
+
 /**
  * Destroy a selector block.
  *
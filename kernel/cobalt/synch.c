@@ -31,6 +31,99 @@
  * @{
  */
 
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+
+/*
+ * The pendq of a priority-sorted object is indexed by a tree of
+ * priority groups, each of them represented by its leading
+ * sleeper, ordered by decreasing priority. Queuing a thread only
+ * requires to look up the group it belongs to, instead of walking
+ * all sleepers of equal or higher priority.
+ */
+static void enqueue_prio_sleeper(struct xnsynch *synch,
+				 struct xnthread *thread)
+{
+	struct rb_node **new = &synch->prioq.rb_node, *parent = NULL;
+	struct xnthread *pos, *lower = NULL;
+	struct rb_node *next;
+
+	thread->pprio = thread->wprio;
+
+	while (*new) {
+		parent = *new;
+		pos = rb_entry(parent, struct xnthread, pnode);
+		if (thread->pprio > pos->pprio) {
+			lower = pos;
+			new = &parent->rb_left;
+		} else if (thread->pprio < pos->pprio)
+			new = &parent->rb_right;
+		else {
+			/* Join the existing group as its last member. */
+			RB_CLEAR_NODE(&thread->pnode);
+			next = rb_next(parent);
+			if (next) {
+				pos = rb_entry(next, struct xnthread, pnode);
+				list_add_tail(&thread->plink, &pos->plink);
+			} else
+				list_add_tail(&thread->plink, &synch->pendq);
+			return;
+		}
+	}
+
+	/* Start a new group, ahead of the next lower one if any. */
+	rb_link_node(&thread->pnode, parent, new);
+	rb_insert_color(&thread->pnode, &synch->prioq);
+
+	if (lower)
+		list_add_tail(&thread->plink, &lower->plink);
+	else
+		list_add_tail(&thread->plink, &synch->pendq);
+}
+
+static void dequeue_sleeper(struct xnsynch *synch, struct xnthread *thread)
+{
+	struct xnthread *next = NULL;
+
+	if (!RB_EMPTY_NODE(&thread->pnode)) {
+		/* Leading a group: hand the index over to the next member. */
+		if (!list_is_last(&thread->plink, &synch->pendq))
+			next = list_next_entry(thread, plink);
+		if (next && next->pprio == thread->pprio)
+			rb_replace_node(&thread->pnode, &next->pnode,
+					&synch->prioq);
+		else
+			rb_erase(&thread->pnode, &synch->prioq);
+		RB_CLEAR_NODE(&thread->pnode);
+	}
+
+	list_del(&thread->plink);
+}
+
+#else /* !CONFIG_XENO_OPT_SYNCH_PRIOINDEX */
+
+static inline void enqueue_prio_sleeper(struct xnsynch *synch,
+					struct xnthread *thread)
+{
+	list_add_priff(thread, &synch->pendq, wprio, plink);
+}
+
+static inline void dequeue_sleeper(struct xnsynch *synch,
+				   struct xnthread *thread)
+{
+	list_del(&thread->plink);
+}
+
+#endif /* !CONFIG_XENO_OPT_SYNCH_PRIOINDEX */
+
+static inline void enqueue_sleeper(struct xnsynch *synch,
+				   struct xnthread *thread)
+{
+	if ((synch->status & XNSYNCH_PRIO) == 0) /* i.e. FIFO */
+		list_add_tail(&thread->plink, &synch->pendq);
+	else /* i.e. priority-sorted */
+		enqueue_prio_sleeper(synch, thread);
+}
+
 /**
  * @fn void xnsynch_init(struct xnsynch *synch, int flags,
  *                       atomic_t *fastlock)
@@ -88,6 +181,9 @@ void xnsynch_init(struct xnsynch *synch, int flags, atomic_t *fastlock)
 	synch->cleanup = NULL;	/* Only works for PIP-enabled objects. */
 	synch->wprio = -1;
 	INIT_LIST_HEAD(&synch->pendq);
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+	synch->prioq = RB_ROOT;
+#endif
 
 	if (flags & XNSYNCH_OWNER) {
 		BUG_ON(fastlock == NULL);
@@ -175,10 +271,7 @@ int xnsynch_sleep_on(struct xnsynch *synch, xnticks_t timeout,
 
 	trace_cobalt_synch_sleepon(synch, thread);
 
-	if ((synch->status & XNSYNCH_PRIO) == 0) /* i.e. FIFO */
-		list_add_tail(&thread->plink, &synch->pendq);
-	else /* i.e. priority-sorted */
-		list_add_priff(thread, &synch->pendq, wprio, plink);
+	enqueue_sleeper(synch, thread);
 
 	xnthread_suspend(thread, XNPEND, timeout, timeout_mode, synch);
 
@@ -224,7 +317,7 @@ struct xnthread *xnsynch_wakeup_one_sleeper(struct xnsynch *synch)
 
 	trace_cobalt_synch_wakeup(synch);
 	thread = list_first_entry(&synch->pendq, struct xnthread, plink);
-	list_del(&thread->plink);
+	dequeue_sleeper(synch, thread);
 	thread->wchan = NULL;
 	xnthread_resume(thread, XNPEND);
 out:
@@ -252,7 +345,7 @@ int xnsynch_wakeup_many_sleepers(struct xnsynch *synch, int nr)
 	list_for_each_entry_safe(thread, tmp, &synch->pendq, plink) {
 		if (nwakeups++ >= nr)
 			break;
-		list_del(&thread->plink);
+		dequeue_sleeper(synch, thread);
 		thread->wchan = NULL;
 		xnthread_resume(thread, XNPEND);
 	}
@@ -293,7 +386,7 @@ void xnsynch_wakeup_this_sleeper(struct xnsynch *synch, struct xnthread *sleeper
 	xnlock_get_irqsave(&nklock, s);
 
 	trace_cobalt_synch_wakeup(synch);
-	list_del(&sleeper->plink);
+	dequeue_sleeper(synch, sleeper);
 	sleeper->wchan = NULL;
 	xnthread_resume(sleeper, XNPEND);
 
@@ -498,7 +591,7 @@ redo:
 			goto grab;
 		}
 
-		list_add_priff(curr, &synch->pendq, wprio, plink);
+		enqueue_prio_sleeper(synch, curr);
 
 		if (synch->status & XNSYNCH_PIP) {
 			if (!xnthread_test_state(owner, XNBOOST)) {
@@ -516,7 +609,7 @@ redo:
 			xnsynch_renice_thread(owner, curr);
 		}
 	} else
-		list_add_priff(curr, &synch->pendq, wprio, plink);
+		enqueue_prio_sleeper(synch, curr);
 block:
 	xnthread_suspend(curr, XNPEND, timeout, timeout_mode, synch);
 	curr->wwake = NULL;
@@ -608,7 +701,7 @@ static struct xnthread *transfer_ownership(struct xnsynch *synch,
 	}
 
 	nextowner = list_first_entry(&synch->pendq, struct xnthread, plink);
-	list_del(&nextowner->plink);
+	dequeue_sleeper(synch, nextowner);
 	nextowner->wchan = NULL;
 	nextowner->wwake = synch;
 	synch->owner = nextowner;
@@ -700,8 +793,8 @@ void xnsynch_requeue_sleeper(struct xnthread *thread)
 
 	XENO_BUG_ON(COBALT, (synch->status & XNSYNCH_OWNER) == 0);
 
-	list_del(&thread->plink);
-	list_add_priff(thread, &synch->pendq, wprio, plink);
+	dequeue_sleeper(synch, thread);
+	enqueue_prio_sleeper(synch, thread);
 	owner = synch->owner;
 
 	if (owner == NULL || thread->wprio <= owner->wprio)
@@ -829,7 +922,7 @@ int xnsynch_flush(struct xnsynch *synch, int reason)
 	} else {
 		ret = XNSYNCH_RESCHED;
 		list_for_each_entry_safe(sleeper, tmp, &synch->pendq, plink) {
-			list_del(&sleeper->plink);
+			dequeue_sleeper(synch, sleeper);
 			xnthread_set_info(sleeper, reason);
 			sleeper->wchan = NULL;
 			xnthread_resume(sleeper, XNPEND);
@@ -857,7 +950,7 @@ void xnsynch_forget_sleeper(struct xnthread *thread)
 
 	xnthread_clear_state(thread, XNPEND);
 	thread->wchan = NULL;
-	list_del(&thread->plink);
+	dequeue_sleeper(synch, thread);
 
 	if ((synch->status & XNSYNCH_CLAIMED) == 0)
 		return;
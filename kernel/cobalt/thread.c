@@ -182,6 +182,9 @@ int __xnthread_init(struct xnthread *thread,
 	memset(&thread->stat, 0, sizeof(thread->stat));
 	thread->selector = NULL;
 	INIT_LIST_HEAD(&thread->claimq);
+#ifdef CONFIG_XENO_OPT_SYNCH_PRIOINDEX
+	RB_CLEAR_NODE(&thread->pnode);
+#endif
 	xnsynch_init(&thread->join_synch, XNSYNCH_FIFO, NULL);
 	/* These will be filled by xnthread_start() */
 	thread->entry = NULL;
@@ -437,6 +440,7 @@ static inline void cleanup_tcb(struct xnthread *thread) /* nklock held, irqs off
 
 	list_del(&thread->glink);
 	cobalt_nrthreads--;
+	xnsched_dec_nrthreads(thread->sched);
 	xnvfile_touch_tag(&nkthreadlist_tag);
 
 	if (xnthread_test_state(thread, XNREADY)) {
@@ -508,6 +512,7 @@ void __xnthread_discard(struct xnthread *thread)
 	xnlock_get_irqsave(&nklock, s);
 	list_del(&thread->glink);
 	cobalt_nrthreads--;
+	xnsched_dec_nrthreads(thread->sched);
 	xnvfile_touch_tag(&nkthreadlist_tag);
 	xnthread_deregister(thread);
 	xnlock_put_irqrestore(&nklock, s);
@@ -609,6 +614,7 @@ int xnthread_init(struct xnthread *thread,
 	xnlock_get_irqsave(&nklock, s);
 	list_add_tail(&thread->glink, &nkthreadq);
 	cobalt_nrthreads++;
+	xnsched_inc_nrthreads(thread->sched);
 	xnvfile_touch_tag(&nkthreadlist_tag);
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -2286,13 +2292,13 @@ void xnthread_pin_initial(struct xnthread *thread)
 
 	/*
 	 * @thread is the Xenomai extension of the current kernel
-	 * task. If the current CPU is part of the affinity mask of
-	 * this thread, pin the latter on this CPU. Otherwise pin it
-	 * to the first CPU of that mask.
+	 * task. By default, if the current CPU is part of the
+	 * affinity mask of this thread, pin the latter on this
+	 * CPU. Otherwise pin it to the first CPU of that mask. The
+	 * balanced placement policy picks the least loaded CPU from
+	 * that mask instead.
 	 */
-	cpu = task_cpu(p);
-	if (!cpu_isset(cpu, thread->affinity))
-		cpu = first_cpu(thread->affinity);
+	cpu = xnsched_pick_cpu(&thread->affinity, task_cpu(p));
 
 	set_cpus_allowed(p, cpumask_of_cpu(cpu));
 	/*
@@ -329,6 +329,21 @@ void xntimer_init(struct xntimer *timer, struct xnclock *clock,
 		  int flags);
 #endif
 
+/*
+ * Timers anticipate their shots according to the clock gravity
+ * applicable to the CPU they are attached to.
+ */
+static inline void set_timer_sched(struct xntimer *timer,
+				   struct xnsched *sched)
+{
+	struct xntimerdata *tmd;
+
+	tmd = xnclock_percpu_timerdata(xntimer_clock(timer),
+				       xnsched_cpu(sched));
+	timer->sched = sched;
+	timer->gravity = &tmd->gravity;
+}
+
 void __xntimer_init(struct xntimer *timer,
 		    struct xnclock *clock,
 		    void (*handler)(struct xntimer *timer),
@@ -354,16 +369,16 @@ void __xntimer_init(struct xntimer *timer,
 	 * current CPU if real-time, otherwise default to the
 	 * scheduler slot of the first real-time CPU.
 	 */
-	if (sched)
-		timer->sched = sched;
-	else {
+	if (sched == NULL) {
 		cpu = ipipe_processor_id();
 		if (!xnsched_supported_cpu(cpu))
 			cpu = first_cpu(xnsched_realtime_cpus);
 
-		timer->sched = xnsched_struct(cpu);
+		sched = xnsched_struct(cpu);
 	}
 
+	set_timer_sched(timer, sched);
+
 #ifdef CONFIG_XENO_OPT_STATS
 #ifdef CONFIG_XENO_OPT_EXTCLOCK
 	timer->tracker = clock;
@@ -464,6 +479,7 @@ void __xntimer_migrate(struct xntimer *timer, struct xnsched *sched)
 {				/* nklocked, IRQs off */
 	struct xnclock *clock;
 	xntimerq_t *q;
+	xnticks_t date;
 
 	if (sched == timer->sched)
 		return;
@@ -472,14 +488,17 @@ void __xntimer_migrate(struct xntimer *timer, struct xnsched *sched)
 
 	if (timer->status & XNTIMER_RUNNING) {
 		xntimer_stop(timer);
-		timer->sched = sched;
+		/* Rebase the shot on the gravity of the new CPU. */
+		date = xntimer_expiry(timer);
+		set_timer_sched(timer, sched);
+		xntimerh_date(&timer->aplink) = date - xntimer_gravity(timer);
 		clock = xntimer_clock(timer);
 		q = xntimer_percpu_queue(timer);
 		xntimer_enqueue(timer, q);
 		if (xntimer_heading_p(timer))
 			xnclock_remote_shot(clock, sched);
 	} else
-		timer->sched = sched;
+		set_timer_sched(timer, sched);
 }
 EXPORT_SYMBOL_GPL(__xntimer_migrate);
 
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#include <linux/bitops.h>
+#include <cobalt/kernel/twheel.h>
+
+/*
+ * Invariants:
+ *
+ * - every timer due before q->horizon is indexed by q->near.
+ *
+ * - timers hashed to level L are due at or after q->horizon, within
+ * the 64 consecutive level-L buckets starting from the one which
+ * contains q->horizon. Therefore, each bucket of a level maps to a
+ * single time range at any point in time.
+ *
+ * - overflow timers are due at or after q->ovfmin, which is only a
+ * lower bound since cancellations do not update it.
+ */
+
+void xntwheel_init(struct xntwheel *q)
+{
+	int level, slot;
+
+	q->near = RB_ROOT;
+	q->leftmost = NULL;
+	q->horizon = 0;
+	q->ovfmin = 0;
+	q->nr_hashed = 0;
+
+	for (level = 0; level < XNTWHEEL_LEVELS; level++) {
+		q->pending[level] = 0;
+		for (slot = 0; slot < XNTWHEEL_LVL_SIZE; slot++)
+			INIT_LIST_HEAD(&q->slots[level][slot]);
+	}
+
+	INIT_LIST_HEAD(&q->overflow);
+}
+
+void __xntwheel_enqueue(struct xntwheel *q, struct xntwholder *holder)
+{
+	xntwheel_key_t key = holder->key;
+	unsigned int slot;
+	int level;
+
+	if (key < q->horizon) {
+		xntwheel_near_insert(q, holder);
+		return;
+	}
+
+	q->nr_hashed++;
+
+	for (level = 0; level < XNTWHEEL_LEVELS; level++) {
+		if ((key >> XNTWHEEL_SHIFT(level)) -
+		    (q->horizon >> XNTWHEEL_SHIFT(level)) < XNTWHEEL_LVL_SIZE) {
+			slot = (key >> XNTWHEEL_SHIFT(level)) & XNTWHEEL_LVL_MASK;
+			list_add_tail(&holder->link, &q->slots[level][slot]);
+			q->pending[level] |= 1ULL << slot;
+			holder->level = level;
+			holder->slot = slot;
+			return;
+		}
+	}
+
+	if (list_empty(&q->overflow) || key < q->ovfmin)
+		q->ovfmin = key;
+
+	list_add_tail(&holder->link, &q->overflow);
+	holder->level = XNTWHEEL_OVERFLOW;
+}
+
+/*
+ * Find the first busy bucket of a level, which always lies within
+ * the 64 buckets following the horizon. Return its start date.
+ */
+static xntwheel_key_t first_bucket(struct xntwheel *q, int level)
+{
+	unsigned long long pending = q->pending[level];
+	unsigned int shift = XNTWHEEL_SHIFT(level), base;
+	xntwheel_key_t index = q->horizon >> shift;
+
+	base = index & XNTWHEEL_LVL_MASK;
+	pending = (pending >> base) | (pending << ((64 - base) & 63));
+
+	return (index + __ffs64(pending)) << shift;
+}
+
+/*
+ * Move the earliest wheel bucket one step closer to the near-term
+ * index, advancing the horizon accordingly. Level 0 buckets move to
+ * the near-term index, upper level buckets and the overflow list are
+ * rehashed from the new horizon, which pushes them at least one level
+ * down.
+ *
+ * Buckets are compared by start date, clamped to the horizon. On a
+ * tie, the coarsest range wins since it may hold timers due before
+ * the end of the finer one.
+ */
+void xntwheel_cascade(struct xntwheel *q)
+{
+	xntwheel_key_t start, date = 0, mask = (1ULL << XNTWHEEL_SHIFT(0)) - 1;
+	struct xntwholder *holder, *tmp;
+	int level, best = -1;
+	struct list_head *bucket;
+	unsigned int slot;
+	LIST_HEAD(rehash);
+
+	if (!list_empty(&q->overflow)) {
+		date = max(q->ovfmin & ~mask, q->horizon);
+		best = XNTWHEEL_OVERFLOW;
+	}
+
+	for (level = XNTWHEEL_LEVELS - 1; level >= 0; level--) {
+		if (q->pending[level] == 0)
+			continue;
+		start = max(first_bucket(q, level), q->horizon);
+		if (best < 0 || start < date) {
+			date = start;
+			best = level;
+		}
+	}
+
+	if (best < 0)
+		return;
+
+	if (best == XNTWHEEL_OVERFLOW) {
+		list_splice_init(&q->overflow, &rehash);
+		q->horizon = date;
+		goto rehash;
+	}
+
+	slot = (date >> XNTWHEEL_SHIFT(best)) & XNTWHEEL_LVL_MASK;
+	bucket = &q->slots[best][slot];
+	list_splice_init(bucket, &rehash);
+	q->pending[best] &= ~(1ULL << slot);
+
+	if (best == 0) {
+		q->horizon = (date | mask) + 1;
+		list_for_each_entry_safe(holder, tmp, &rehash, link) {
+			list_del(&holder->link);
+			q->nr_hashed--;
+			xntwheel_near_insert(q, holder);
+		}
+		return;
+	}
+
+	q->horizon = date;
+rehash:
+	list_for_each_entry_safe(holder, tmp, &rehash, link) {
+		list_del(&holder->link);
+		q->nr_hashed--;
+		__xntwheel_enqueue(q, holder);
+	}
+}
+
+/*
+ * Iterate over all hashed timers, in no particular order. A NULL
+ * holder starts from the first bucket.
+ */
+struct xntwholder *xntwheel_next(struct xntwheel *q,
+				 struct xntwholder *holder)
+{
+	struct list_head *bucket;
+	struct rb_node *next;
+	unsigned int slot = 0;
+	int level = 0;
+
+	if (holder) {
+		if (holder->level == XNTWHEEL_NEAR) {
+			next = rb_next(&holder->rb);
+			if (next)
+				return rb_entry(next, struct xntwholder, rb);
+		} else {
+			bucket = holder->level == XNTWHEEL_OVERFLOW ?
+				&q->overflow : &q->slots[holder->level][holder->slot];
+			if (!list_is_last(&holder->link, bucket))
+				return list_next_entry(holder, link);
+			if (holder->level == XNTWHEEL_OVERFLOW)
+				return NULL;
+			level = holder->level;
+			slot = holder->slot + 1;
+		}
+	}
+
+	for (; level < XNTWHEEL_LEVELS; level++, slot = 0) {
+		for (; slot < XNTWHEEL_LVL_SIZE; slot++) {
+			if (q->pending[level] & (1ULL << slot))
+				return list_first_entry(&q->slots[level][slot],
+							struct xntwholder, link);
+		}
+	}
+
+	if (list_empty(&q->overflow))
+		return NULL;
+
+	return list_first_entry(&q->overflow, struct xntwholder, link);
+}
@@ -61,9 +61,8 @@ struct tuner_state {
 
 struct gravity_tuner {
 	const char *name;
-	unsigned int (*get_gravity)(struct gravity_tuner *tuner);
-	void (*set_gravity)(struct gravity_tuner *tuner, unsigned int gravity);
-	unsigned int (*adjust_gravity)(struct gravity_tuner *tuner, int adjust);
+	/* Offset of the tuned value in struct xnclock_gravity. */
+	size_t gravity_offset;
 	int (*init_tuner)(struct gravity_tuner *tuner);
 	int (*start_tuner)(struct gravity_tuner *tuner, xnticks_t start_time,
 			   xnticks_t interval);
@@ -72,6 +71,8 @@ struct gravity_tuner {
 	rtdm_event_t done;
 	int status;
 	int quiet;
+	/* CPU to tune for, -1 for all CPUs. */
+	int cpu;
 	struct tuning_score scores[AUTOTUNE_STEPS];
 	int nscores;
 };
@@ -111,6 +112,70 @@ static inline void destroy_tuner(struct gravity_tuner *tuner)
 	rtdm_event_destroy(&tuner->done);
 }
 
+static inline unsigned long *
+gravity_field(struct gravity_tuner *tuner, struct xnclock_gravity *gravity)
+{
+	return (unsigned long *)((char *)gravity + tuner->gravity_offset);
+}
+
+static unsigned int get_gravity(struct gravity_tuner *tuner)
+{
+	struct xnclock_gravity gravity;
+
+	if (tuner->cpu < 0)
+		return *gravity_field(tuner, &nkclock.gravity);
+
+	xnclock_get_cpu_gravity(&nkclock, tuner->cpu, &gravity);
+
+	return *gravity_field(tuner, &gravity);
+}
+
+static void set_cpu_gravity(struct gravity_tuner *tuner, int cpu,
+			    unsigned int value)
+{
+	struct xnclock_gravity gravity;
+
+	xnclock_get_cpu_gravity(&nkclock, cpu, &gravity);
+	*gravity_field(tuner, &gravity) = value;
+	xnclock_set_cpu_gravity(&nkclock, cpu, &gravity);
+}
+
+/*
+ * Only the value applicable to the tuned context changes, so that
+ * the results of previous runs for other contexts are kept.
+ */
+static void set_gravity(struct gravity_tuner *tuner, unsigned int value)
+{
+	int cpu;
+
+	if (tuner->cpu >= 0) {
+		set_cpu_gravity(tuner, tuner->cpu, value);
+		return;
+	}
+
+	*gravity_field(tuner, &nkclock.gravity) = value;
+	for_each_realtime_cpu(cpu)
+		set_cpu_gravity(tuner, cpu, value);
+}
+
+static unsigned int adjust_gravity(struct gravity_tuner *tuner, int adjust)
+{
+	unsigned int gravity = get_gravity(tuner) + adjust;
+
+	set_gravity(tuner, gravity);
+
+	return gravity;
+}
+
+static void pin_timer(rtdm_timer_t *timer, int cpu)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	xntimer_set_sched(timer, xnsched_struct(cpu));
+	xnlock_put_irqrestore(&nklock, s);
+}
+
 static inline void done_sampling(struct gravity_tuner *tuner,
 				 int status)
 {
@@ -170,6 +235,9 @@ static int init_irq_tuner(struct gravity_tuner *tuner)
 	if (ret)
 		return ret;
 
+	if (tuner->cpu >= 0)
+		pin_timer(&irq_tuner->timer, tuner->cpu);
+
 	init_tuner(tuner);
 
 	return 0;
@@ -184,21 +252,6 @@ static void destroy_irq_tuner(struct gravity_tuner *tuner)
 	destroy_tuner(tuner);
 }
 
-static unsigned int get_irq_gravity(struct gravity_tuner *tuner)
-{
-	return nkclock.gravity.irq;
-}
-
-static void set_irq_gravity(struct gravity_tuner *tuner, unsigned int gravity)
-{
-	nkclock.gravity.irq = gravity;
-}
-
-static unsigned int adjust_irq_gravity(struct gravity_tuner *tuner, int adjust)
-{
-	return nkclock.gravity.irq += adjust;
-}
-
 static int start_irq_tuner(struct gravity_tuner *tuner,
 			   xnticks_t start_time, xnticks_t interval)
 {
@@ -213,11 +266,9 @@ static int start_irq_tuner(struct gravity_tuner *tuner,
 struct irq_gravity_tuner irq_tuner = {
 	.tuner = {
 		.name = "irqhand",
+		.gravity_offset = offsetof(struct xnclock_gravity, irq),
 		.init_tuner = init_irq_tuner,
 		.destroy_tuner = destroy_irq_tuner,
-		.get_gravity = get_irq_gravity,
-		.set_gravity = set_irq_gravity,
-		.adjust_gravity = adjust_irq_gravity,
 		.start_tuner = start_irq_tuner,
 	},
 };
@@ -235,7 +286,13 @@ void task_handler(void *arg)
 		ret = rtdm_event_wait(&k_tuner->barrier);
 		if (ret)
 			break;
-
+#ifdef CONFIG_SMP
+		if (k_tuner->tuner.cpu >= 0) {
+			ret = xnthread_migrate(k_tuner->tuner.cpu);
+			if (ret)
+				break;
+		}
+#endif
 		ret = xnthread_set_periodic(&k_tuner->task, k_tuner->start_time,
 					    XN_ABSOLUTE, k_tuner->interval);
 		if (ret)
@@ -280,21 +337,6 @@ static void destroy_kthread_tuner(struct gravity_tuner *tuner)
 	rtdm_event_destroy(&k_tuner->barrier);
 }
 
-static unsigned int get_kthread_gravity(struct gravity_tuner *tuner)
-{
-	return nkclock.gravity.kernel;
-}
-
-static void set_kthread_gravity(struct gravity_tuner *tuner, unsigned int gravity)
-{
-	nkclock.gravity.kernel = gravity;
-}
-
-static unsigned int adjust_kthread_gravity(struct gravity_tuner *tuner, int adjust)
-{
-	return nkclock.gravity.kernel += adjust;
-}
-
 static int start_kthread_tuner(struct gravity_tuner *tuner,
 			       xnticks_t start_time, xnticks_t interval)
 {
@@ -312,11 +354,9 @@ static int start_kthread_tuner(struct gravity_tuner *tuner,
 struct kthread_gravity_tuner kthread_tuner = {
 	.tuner = {
 		.name = "kthread",
+		.gravity_offset = offsetof(struct xnclock_gravity, kernel),
 		.init_tuner = init_kthread_tuner,
 		.destroy_tuner = destroy_kthread_tuner,
-		.get_gravity = get_kthread_gravity,
-		.set_gravity = set_kthread_gravity,
-		.adjust_gravity = adjust_kthread_gravity,
 		.start_tuner = start_kthread_tuner,
 	},
 };
@@ -340,6 +380,8 @@ static int init_uthread_tuner(struct gravity_tuner *tuner)
 		return ret;
 
 	xntimer_set_gravity(&u_tuner->timer, XNTIMER_UGRAVITY); /* gasp... */
+	if (tuner->cpu >= 0)
+		pin_timer(&u_tuner->timer, tuner->cpu);
 	rtdm_event_init(&u_tuner->pulse, 0);
 	init_tuner(tuner);
 
@@ -355,21 +397,6 @@ static void destroy_uthread_tuner(struct gravity_tuner *tuner)
 	rtdm_event_destroy(&u_tuner->pulse);
 }
 
-static unsigned int get_uthread_gravity(struct gravity_tuner *tuner)
-{
-	return nkclock.gravity.user;
-}
-
-static void set_uthread_gravity(struct gravity_tuner *tuner, unsigned int gravity)
-{
-	nkclock.gravity.user = gravity;
-}
-
-static unsigned int adjust_uthread_gravity(struct gravity_tuner *tuner, int adjust)
-{
-	return nkclock.gravity.user += adjust;
-}
-
 static int start_uthread_tuner(struct gravity_tuner *tuner,
 			       xnticks_t start_time, xnticks_t interval)
 {
@@ -403,11 +430,9 @@ static int add_uthread_sample(struct gravity_tuner *tuner,
 struct uthread_gravity_tuner uthread_tuner = {
 	.tuner = {
 		.name = "uthread",
+		.gravity_offset = offsetof(struct xnclock_gravity, user),
 		.init_tuner = init_uthread_tuner,
 		.destroy_tuner = destroy_uthread_tuner,
-		.get_gravity = get_uthread_gravity,
-		.set_gravity = set_uthread_gravity,
-		.adjust_gravity = adjust_uthread_gravity,
 		.start_tuner = start_uthread_tuner,
 	},
 };
@@ -428,7 +453,7 @@ static inline void build_score(struct gravity_tuner *tuner, int step)
 		    state->mean * state->mean) / (n - 1);
 	tuner->scores[step].stddev = int_sqrt(variance);
 	tuner->scores[step].minlat = state->min_lat;
-	tuner->scores[step].gravity = tuner->get_gravity(tuner);
+	tuner->scores[step].gravity = get_gravity(tuner);
 	tuner->scores[step].step = step;
 	tuner->nscores++;
 }
@@ -529,8 +554,8 @@ static int tune_gravity(struct gravity_tuner *tuner, int period)
 
 	state->step = xnclock_ns_to_ticks(&nkclock, period);
 	state->max_samples = SAMPLING_TIME / (period ?: 1);
-	orig_gravity = tuner->get_gravity(tuner);
-	tuner->set_gravity(tuner, 0);
+	orig_gravity = get_gravity(tuner);
+	set_gravity(tuner, 0);
 	tuner->nscores = 0;
 	adjust = xnclock_ns_to_ticks(&nkclock, BUCKET_TIMESPAN);
 	gravity_limit = AUTOTUNE_STEPS * adjust;
@@ -567,7 +592,7 @@ static int tune_gravity(struct gravity_tuner *tuner, int period)
 		}
 
 		if (state->min_lat < 0) {
-			if (tuner->get_gravity(tuner) == 0) {
+			if (get_gravity(tuner) == 0) {
 				printk(XENO_WARNING
 				       "autotune(%s) failed with early shot (%Ld ns)\n",
 				       tuner->name,
@@ -589,7 +614,7 @@ static int tune_gravity(struct gravity_tuner *tuner, int period)
 		 * at warmup would make no sense: cap the gravity we
 		 * may try.
 		 */
-		if (tuner->adjust_gravity(tuner, adjust) > gravity_limit)
+		if (adjust_gravity(tuner, adjust) > gravity_limit)
 			break;
 	}
 
@@ -597,11 +622,11 @@ static int tune_gravity(struct gravity_tuner *tuner, int period)
 	filter_score(tuner, filter_minlat);
 	filter_score(tuner, filter_gravity);
 	filter_score(tuner, filter_stddev);
-	tuner->set_gravity(tuner, tuner->scores[0].gravity);
+	set_gravity(tuner, tuner->scores[0].gravity);
 	if (!tuner->quiet)
 		printk(XENO_INFO
-		       "autotune(%s) pmean=%Ld stddev=%Lu minlat=%Lu gravity=%Lu step=%d\n",
-		       tuner->name,
+		       "autotune(%s) cpu=%d pmean=%Ld stddev=%Lu minlat=%Lu gravity=%Lu step=%d\n",
+		       tuner->name, tuner->cpu,
 		       xnclock_ticks_to_ns(&nkclock, tuner->scores[0].pmean),
 		       xnclock_ticks_to_ns(&nkclock, tuner->scores[0].stddev),
 		       xnclock_ticks_to_ns(&nkclock, tuner->scores[0].minlat),
@@ -610,21 +635,78 @@ static int tune_gravity(struct gravity_tuner *tuner, int period)
 
 	return 0;
 fail:
-	tuner->set_gravity(tuner, orig_gravity);
+	set_gravity(tuner, orig_gravity);
 
 	return ret;
 }
 
+/*
+ * A caller pinned to a single CPU tunes the gravity for that CPU
+ * only, otherwise the outcome applies to all CPUs.
+ */
+static int get_tuning_cpu(int *cpu_r)
+{
+#ifdef CONFIG_SMP
+	const struct cpumask *affinity = tsk_cpus_allowed(current);
+	int cpu;
+
+	if (cpumask_weight(affinity) == 1) {
+		cpu = cpumask_first(affinity);
+		if (!xnsched_supported_cpu(cpu))
+			return -EINVAL;
+		*cpu_r = cpu;
+		return 0;
+	}
+#endif
+	*cpu_r = -1;
+
+	return 0;
+}
+
+static int autotune_ioctl_gravity(struct rtdm_fd *fd, unsigned int request,
+				  void *arg)
+{
+	struct xnclock_gravity gravity;
+	struct autotune_gravity ag;
+	int ret;
+
+	ret = rtdm_safe_copy_from_user(fd, &ag, arg, sizeof(ag));
+	if (ret)
+		return ret;
+
+	if (ag.cpu >= nr_cpu_ids || !cpu_online(ag.cpu) ||
+	    !xnsched_supported_cpu(ag.cpu))
+		return -EINVAL;
+
+	if (request == AUTOTUNE_RTIOC_SET_GRAVITY) {
+		gravity.irq = xnclock_ns_to_ticks(&nkclock, ag.irq);
+		gravity.kernel = xnclock_ns_to_ticks(&nkclock, ag.kernel);
+		gravity.user = xnclock_ns_to_ticks(&nkclock, ag.user);
+		return xnclock_set_cpu_gravity(&nkclock, ag.cpu, &gravity);
+	}
+
+	xnclock_get_cpu_gravity(&nkclock, ag.cpu, &gravity);
+	ag.irq = xnclock_ticks_to_ns(&nkclock, gravity.irq);
+	ag.kernel = xnclock_ticks_to_ns(&nkclock, gravity.kernel);
+	ag.user = xnclock_ticks_to_ns(&nkclock, gravity.user);
+
+	return rtdm_safe_copy_to_user(fd, arg, &ag, sizeof(ag));
+}
+
 static int autotune_ioctl_nrt(struct rtdm_fd *fd, unsigned int request, void *arg)
 {
 	struct autotune_context *context;
 	struct autotune_setup setup;
 	struct gravity_tuner *tuner;
-	int period, ret;
+	int period, cpu, ret;
 
-	if (request == AUTOTUNE_RTIOC_RESET) {
+	switch (request) {
+	case AUTOTUNE_RTIOC_RESET:
 		xnclock_reset_gravity(&nkclock);
 		return 0;
+	case AUTOTUNE_RTIOC_GET_GRAVITY:
+	case AUTOTUNE_RTIOC_SET_GRAVITY:
+		return autotune_ioctl_gravity(fd, request, arg);
 	}
 
 	ret = rtdm_copy_from_user(fd, &setup, arg, sizeof(setup));
@@ -658,6 +740,11 @@ static int autotune_ioctl_nrt(struct rtdm_fd *fd, unsigned int request, void *ar
 	if (ret)
 		return ret;
 
+	ret = get_tuning_cpu(&cpu);
+	if (ret)
+		return ret;
+
+	tuner->cpu = cpu;
 	ret = tuner->init_tuner(tuner);
 	if (ret)
 		return ret;
@@ -665,8 +752,13 @@ static int autotune_ioctl_nrt(struct rtdm_fd *fd, unsigned int request, void *ar
 	context->tuner = tuner;
 	context->setup = setup;
 
-	if (setup.quiet <= 1)
-		printk(XENO_INFO "autotune(%s) started\n", tuner->name);
+	if (setup.quiet <= 1) {
+		if (cpu >= 0)
+			printk(XENO_INFO "autotune(%s) started on CPU%d\n",
+			       tuner->name, cpu);
+		else
+			printk(XENO_INFO "autotune(%s) started\n", tuner->name);
+	}
 
 	return ret;
 }
@@ -691,7 +783,7 @@ static int autotune_ioctl_rt(struct rtdm_fd *fd, unsigned int request, void *arg
 		if (ret)
 			break;
 		gravity = xnclock_ticks_to_ns(&nkclock,
-					      tuner->get_gravity(tuner));
+					      get_gravity(tuner));
 		ret = rtdm_safe_copy_to_user(fd, arg, &gravity,
 					     sizeof(gravity));
 		break;
@@ -43,6 +43,10 @@
  * for reception at the same time using Bind */
 #define RTCAN_MAX_RECEIVERS  CONFIG_XENO_DRIVERS_CAN_MAX_RECEIVERS
 
+/* Size of the hash tables indexing the reception list by CAN ID */
+#define RTCAN_RECV_HASH_BITS 7
+#define RTCAN_RECV_HASH_SIZE (1 << RTCAN_RECV_HASH_BITS)
+
 /* Suppress handling of refcount if module support is not enabled
  * or modules cannot be unloaded */
 
@@ -149,6 +153,18 @@ struct rtcan_device {
      * locality all list elements are kept in this array. */
     struct rtcan_recv               receivers[RTCAN_MAX_RECEIVERS];
 
+    /* Index of the reception list, so that a received frame is only
+     * checked against the filters which may accept it:
+     * - recv_eff: filters matching a single extended CAN ID, hashed
+     *   by that ID,
+     * - recv_sff: filters matching all bits of the standard ID range,
+     *   hashed by these bits,
+     * - recv_masked: all other filters, which must be checked one by
+     *   one. */
+    struct rtcan_recv               *recv_eff[RTCAN_RECV_HASH_SIZE];
+    struct rtcan_recv               *recv_sff[RTCAN_RECV_HASH_SIZE];
+    struct rtcan_recv               *recv_masked;
+
     /* Indicates the length of the empty list */
     int                             free_entries;
 
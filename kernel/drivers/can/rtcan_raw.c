@@ -135,6 +135,21 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 }
 
 
+static inline void rtcan_rcv_chain(struct rtcan_recv *recv_listener,
+				   struct rtcan_skb *skb)
+{
+    uint32_t can_id = skb->rb_frame.can_id;
+
+    while (recv_listener != NULL) {
+	if (rtcan_accept_msg(can_id, &recv_listener->can_filter)) {
+	    recv_listener->match_count++;
+	    rtcan_rcv_deliver(recv_listener, skb);
+	}
+	recv_listener = recv_listener->hnext;
+    }
+}
+
+
 void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
@@ -157,13 +172,13 @@ void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 	}
     } else {
 	dev->rx_count++;
-	while (recv_listener != NULL) {
-	    if (rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-		recv_listener->match_count++;
-		rtcan_rcv_deliver(recv_listener, skb);
-	    }
-	    recv_listener = recv_listener->next;
-	}
+	/* Only visit the filters which may accept this ID */
+	if (frame->can_id & CAN_EFF_FLAG)
+	    rtcan_rcv_chain(dev->recv_eff[rtcan_recv_hash(frame->can_id &
+							  CAN_EFF_MASK)], skb);
+	rtcan_rcv_chain(dev->recv_sff[rtcan_recv_hash(frame->can_id &
+						      CAN_SFF_MASK)], skb);
+	rtcan_rcv_chain(dev->recv_masked, skb);
     }
 }
 
@@ -22,6 +22,16 @@
 
 #ifdef __KERNEL__
 
+#include <linux/hash.h>
+
+static inline unsigned int rtcan_recv_hash(u32 can_id)
+{
+    return hash_32(can_id, RTCAN_RECV_HASH_BITS);
+}
+
+struct rtcan_recv **rtcan_raw_filter_index(struct rtcan_device *dev,
+					   can_filter_t *filter);
+
 int rtcan_raw_ioctl_dev(struct rtdm_fd *fd, int request, void *arg);
 
 int rtcan_raw_check_filter(struct rtcan_socket *sock,
@@ -68,6 +68,56 @@ static inline void rtcan_raw_mount_filter(can_filter_t *recv_filter,
 }
 
 
+/*
+ * Return the head of the index chain a mounted filter belongs to.
+ * Filters which require all bits of an extended CAN ID to match are
+ * hashed by that ID, those which require all bits of the standard ID
+ * range to match are hashed by these bits, which covers the usual
+ * exact-match filters in both formats. Any other filter, including
+ * inverted ones, goes to the residual list.
+ */
+struct rtcan_recv **rtcan_raw_filter_index(struct rtcan_device *dev,
+					   can_filter_t *filter)
+{
+    u32 can_id = filter->can_id, can_mask = filter->can_mask;
+
+    if (can_mask & CAN_INV_FILTER)
+	return &dev->recv_masked;
+
+    if ((can_id & CAN_EFF_FLAG) &&
+	(can_mask & (CAN_EFF_FLAG | CAN_EFF_MASK)) ==
+	(CAN_EFF_FLAG | CAN_EFF_MASK))
+	return &dev->recv_eff[rtcan_recv_hash(can_id & CAN_EFF_MASK)];
+
+    if ((can_mask & CAN_SFF_MASK) == CAN_SFF_MASK)
+	return &dev->recv_sff[rtcan_recv_hash(can_id & CAN_SFF_MASK)];
+
+    return &dev->recv_masked;
+}
+
+
+static inline void rtcan_raw_index_filter(struct rtcan_device *dev,
+					  struct rtcan_recv *recv)
+{
+    struct rtcan_recv **head = rtcan_raw_filter_index(dev, &recv->can_filter);
+
+    recv->hnext = *head;
+    *head = recv;
+}
+
+
+static inline void rtcan_raw_unindex_filter(struct rtcan_device *dev,
+					    struct rtcan_recv *recv)
+{
+    struct rtcan_recv **pp = rtcan_raw_filter_index(dev, &recv->can_filter);
+
+    while (*pp != recv)
+	pp = &(*pp)->hnext;
+
+    *pp = recv->hnext;
+}
+
+
 int rtcan_raw_check_filter(struct rtcan_socket *sock, int ifindex,
 			   struct rtcan_filter_list *flist)
 {
@@ -162,6 +212,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 				   &sock->flist->flist[0]);
 	    last->match_count = 0;
 	    last->sock = sock;
+	    rtcan_raw_index_filter(dev, last);
 	    for (j = 1; j < flistlen; j++) {
 		/* Register remaining filters */
 		last = last->next;
@@ -169,6 +220,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 				       &sock->flist->flist[j]);
 		last->sock = sock;
 		last->match_count = 0;
+		rtcan_raw_index_filter(dev, last);
 	    }
 	    /* Decrease free entries counter by length of filter list */
 	    dev->free_entries -= flistlen;
@@ -179,6 +231,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 	    last->can_filter.can_id = last->can_filter.can_mask = 0;
 	    last->sock = sock;
 	    last->match_count = 0;
+	    rtcan_raw_index_filter(dev, last);
 	    /* Decrease free entries counter by 1
 	     * (one filter for all CAN frames) */
 	    dev->free_entries--;
@@ -232,10 +285,14 @@ void rtcan_raw_remove_filter(struct rtcan_socket *sock)
 	    next = first->next;
 	}
 
-	/* Now go to the end of the old filter list */
+	/* Now go to the end of the old filter list, dropping each
+	 * filter from the index on our way */
 	last = next;
-	for (j = 1; j < sock->flistlen; j++)
+	rtcan_raw_unindex_filter(dev, last);
+	for (j = 1; j < sock->flistlen; j++) {
 	    last = last->next;
+	    rtcan_raw_unindex_filter(dev, last);
+	}
 
 	/* Detach found first list entry from reception list */
 	if (first)
@@ -26,6 +26,7 @@
 #include <cobalt/kernel/map.h>
 #include <cobalt/kernel/bufd.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
 #include <rtdm/ipc.h>
 #include "internal.h"
 
@@ -37,7 +38,10 @@ struct bufp_socket {
 	struct sockaddr_ipc peer;
 
 	void *bufmem;
+	void *bufdata;
 	size_t bufsz;
+	struct bufp_ring *ring;
+	struct bufp_ringmem *ringmem;
 	u_long status;
 	xnhandle_t handle;
 	char label[XNOBJECT_NAME_LEN];
@@ -56,6 +60,17 @@ struct bufp_socket {
 	struct rtipc_private *priv;
 };
 
+/*
+ * In ring mode, the buffer memory is shared with the users who
+ * mapped it, so it has to outlive the socket until the last mapping
+ * goes away.
+ */
+struct bufp_ringmem {
+	atomic_t refs;
+	void *mem;
+	size_t size;
+};
+
 struct bufp_wait_context {
 	struct rtipc_wait_context wc;
 	size_t len;
@@ -72,6 +87,8 @@ static struct xnmap *portmap;
 #define _BUFP_BINDING   0
 #define _BUFP_BOUND     1
 #define _BUFP_CONNECTED 2
+#define _BUFP_RING      3
+#define _BUFP_SELECTED  4
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
@@ -103,6 +120,175 @@ static struct xnpnode_link __bufp_pnode = {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
+static void bufp_put_ringmem(struct bufp_ringmem *rm)
+{
+	if (atomic_dec_and_test(&rm->refs)) {
+		free_pages_exact(rm->mem, rm->size);
+		kfree(rm);
+	}
+}
+
+static void bufp_vm_open(struct vm_area_struct *vma)
+{
+	struct bufp_ringmem *rm = vma->vm_private_data;
+
+	atomic_inc(&rm->refs);
+}
+
+static void bufp_vm_close(struct vm_area_struct *vma)
+{
+	bufp_put_ringmem(vma->vm_private_data);
+}
+
+static struct vm_operations_struct bufp_vmops = {
+	.open = bufp_vm_open,
+	.close = bufp_vm_close,
+};
+
+static int bufp_alloc_mem(struct bufp_socket *sk)
+{
+	struct bufp_ringmem *rm;
+	struct bufp_ring *ring;
+	rtdm_lockctx_t s;
+
+	if (!test_bit(_BUFP_RING, &sk->status)) {
+		sk->bufmem = alloc_pages_exact(sk->bufsz, GFP_KERNEL);
+		if (sk->bufmem == NULL)
+			return -ENOMEM;
+		sk->bufdata = sk->bufmem;
+		return 0;
+	}
+
+	/*
+	 * Ring mode: the control page comes first, followed by the
+	 * data area, so that user space may map both at once.
+	 */
+	rm = kmalloc(sizeof(*rm), GFP_KERNEL);
+	if (rm == NULL)
+		return -ENOMEM;
+
+	rm->size = PAGE_SIZE + PAGE_ALIGN(sk->bufsz);
+	rm->mem = alloc_pages_exact(rm->size, GFP_KERNEL | __GFP_ZERO);
+	if (rm->mem == NULL) {
+		kfree(rm);
+		return -ENOMEM;
+	}
+
+	atomic_set(&rm->refs, 1);
+	ring = rm->mem;
+	ring->size = sk->bufsz;
+	ring->offset = PAGE_SIZE;
+	sk->ringmem = rm;
+	/* Serialize with bufp_selbind(). */
+	cobalt_atomic_enter(s);
+	ring->selwait = test_bit(_BUFP_SELECTED, &sk->status);
+	sk->ring = ring;
+	cobalt_atomic_leave(s);
+	sk->bufmem = rm->mem;
+	sk->bufdata = rm->mem + PAGE_SIZE;
+
+	return 0;
+}
+
+static void bufp_free_mem(struct bufp_socket *sk)
+{
+	if (sk->ringmem) {
+		bufp_put_ringmem(sk->ringmem);
+		sk->ringmem = NULL;
+		sk->ring = NULL;
+	} else
+		free_pages_exact(sk->bufmem, sk->bufsz);
+
+	sk->bufmem = NULL;
+}
+
+/*
+ * Buffer state accessors. In ring mode, the fill state lives in the
+ * shared ring header as free-running head and tail indexes, so that
+ * a producer or a consumer may update it directly from user space.
+ */
+static inline size_t bufp_fillsz(struct bufp_socket *sk)
+{
+	struct bufp_ring *ring = sk->ring;
+	size_t fillsz;
+
+	if (ring == NULL)
+		return sk->fillsz;
+
+	fillsz = (u32)(ACCESS_ONCE(ring->head) - ACCESS_ONCE(ring->tail));
+	smp_rmb();
+
+	return fillsz;
+}
+
+static inline off_t bufp_rdoff(struct bufp_socket *sk)
+{
+	if (sk->ring == NULL)
+		return sk->rdoff;
+
+	return ACCESS_ONCE(sk->ring->tail) & (sk->bufsz - 1);
+}
+
+static inline off_t bufp_wroff(struct bufp_socket *sk)
+{
+	if (sk->ring == NULL)
+		return sk->wroff;
+
+	return ACCESS_ONCE(sk->ring->head) & (sk->bufsz - 1);
+}
+
+static inline void bufp_consume(struct bufp_socket *sk,
+				off_t rdoff, size_t len)
+{
+	if (sk->ring) {
+		/* We must be done reading before handing the room back. */
+		smp_mb();
+		ACCESS_ONCE(sk->ring->tail) += len;
+		return;
+	}
+
+	sk->fillsz -= len;
+	sk->rdoff = rdoff;
+}
+
+static inline void bufp_produce(struct bufp_socket *sk,
+				off_t wroff, size_t len)
+{
+	if (sk->ring) {
+		/* Data must be visible before the index moves. */
+		smp_wmb();
+		ACCESS_ONCE(sk->ring->head) += len;
+		return;
+	}
+
+	sk->fillsz += len;
+	sk->wroff = wroff;
+}
+
+/*
+ * Raise the waiter flag which tells user space producers and
+ * consumers to kick us, then check the ring state again, so that
+ * we may not miss any update.
+ */
+static inline int bufp_ring_wait_p(struct bufp_socket *sk,
+				   size_t len, int reader)
+{
+	struct bufp_ring *ring = sk->ring;
+	size_t fillsz;
+
+	if (ring == NULL)
+		return 1;
+
+	if (reader)
+		ACCESS_ONCE(ring->rdwait) = 1;
+	else
+		ACCESS_ONCE(ring->wrwait) = 1;
+	smp_mb();
+	fillsz = bufp_fillsz(sk);
+
+	return reader ? fillsz < len : fillsz + len > sk->bufsz;
+}
+
 static int bufp_socket(struct rtdm_fd *fd)
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -112,7 +298,10 @@ static int bufp_socket(struct rtdm_fd *fd)
 	sk->name = nullsa;	/* Unbound */
 	sk->peer = nullsa;
 	sk->bufmem = NULL;
+	sk->bufdata = NULL;
 	sk->bufsz = 0;
+	sk->ring = NULL;
+	sk->ringmem = NULL;
 	sk->rdoff = 0;
 	sk->wroff = 0;
 	sk->fillsz = 0;
@@ -149,7 +338,7 @@ static void bufp_close(struct rtdm_fd *fd)
 		xnregistry_remove(sk->handle);
 
 	if (sk->bufmem)
-		free_pages_exact(sk->bufmem, sk->bufsz);
+		bufp_free_mem(sk);
 
 	kfree(sk);
 }
@@ -161,9 +350,9 @@ static ssize_t __bufp_readbuf(struct bufp_socket *sk,
 	struct bufp_wait_context wait, *bufwc;
 	struct rtipc_wait_context *wc;
 	struct xnthread *waiter;
+	size_t rbytes, n, fillsz;
 	rtdm_toseq_t toseq;
 	ssize_t len, ret;
-	size_t rbytes, n;
 	rtdm_lockctx_t s;
 	u_long rdtoken;
 	off_t rdoff;
@@ -180,7 +369,7 @@ redo:
 		 * We should be able to read a complete message of the
 		 * requested length, or block.
 		 */
-		if (sk->fillsz < len)
+		if (bufp_fillsz(sk) < len)
 			goto wait;
 
 		/*
@@ -190,7 +379,7 @@ redo:
 		rdtoken = ++sk->rdtoken;
 
 		/* Read from the buffer in a circular way. */
-		rdoff = sk->rdoff;
+		rdoff = bufp_rdoff(sk);
 		rbytes = len;
 
 		do {
@@ -203,7 +392,7 @@ redo:
 			 * to keep latency low.
 			 */
 			cobalt_atomic_leave(s);
-			ret = xnbufd_copy_from_kmem(bufd, sk->bufmem + rdoff, n);
+			ret = xnbufd_copy_from_kmem(bufd, sk->bufdata + rdoff, n);
 			if (ret < 0)
 				return ret;
 
@@ -222,15 +411,15 @@ redo:
 			rbytes -= n;
 		} while (rbytes > 0);
 
-		sk->fillsz -= len;
-		sk->rdoff = rdoff;
+		bufp_consume(sk, rdoff, len);
+		fillsz = bufp_fillsz(sk);
 		ret = len;
 
 		resched = 0;
-		if (sk->fillsz + len == sk->bufsz) /* -> writable */
+		if (fillsz + len == sk->bufsz) /* -> writable */
 			resched |= xnselect_signal(&sk->priv->send_block, POLLOUT);
 
-		if (sk->fillsz == 0) /* -> non-readable */
+		if (fillsz == 0) /* -> non-readable */
 			resched |= xnselect_signal(&sk->priv->recv_block, 0);
 
 		/*
@@ -245,7 +434,7 @@ redo:
 		wc = rtipc_get_wait_context(waiter);
 		XENO_BUG_ON(COBALT, wc == NULL);
 		bufwc = container_of(wc, struct bufp_wait_context, wc);
-		if (bufwc->len + sk->fillsz <= sk->bufsz)
+		if (bufwc->len + fillsz <= sk->bufsz)
 			/* This call rescheds internally. */
 			rtdm_event_pulse(&sk->o_event);
 		else if (resched)
@@ -270,11 +459,15 @@ redo:
 		 * pathological use of the buffer. We must allow for a
 		 * short read to prevent a deadlock.
 		 */
-		if (sk->fillsz > 0 && rtipc_peek_wait_head(&sk->o_event)) {
-			len = sk->fillsz;
+		fillsz = bufp_fillsz(sk);
+		if (fillsz > 0 && rtipc_peek_wait_head(&sk->o_event)) {
+			len = fillsz;
 			goto redo;
 		}
 
+		if (!bufp_ring_wait_p(sk, len, 1))
+			continue;
+
 		wait.len = len;
 		wait.sk = sk;
 		rtipc_prepare_wait(&wait.wc);
@@ -284,6 +477,8 @@ redo:
 		 */
 		ret = rtdm_event_timedwait(&sk->i_event,
 					   sk->rx_timeout, &toseq);
+		if (sk->ring && rtipc_peek_wait_head(&sk->i_event) == NULL)
+			sk->ring->rdwait = 0;
 		if (unlikely(ret))
 			break;
 	}
@@ -414,9 +609,9 @@ static ssize_t __bufp_writebuf(struct bufp_socket *rsk,
 	struct rtipc_wait_context *wc;
 	struct xnthread *waiter;
 	rtdm_toseq_t toseq;
+	size_t wbytes, n, fillsz;
 	rtdm_lockctx_t s;
 	ssize_t len, ret;
-	size_t wbytes, n;
 	u_long wrtoken;
 	off_t wroff;
 	int resched;
@@ -432,7 +627,7 @@ redo:
 		 * We should be able to write the entire message at
 		 * once or block.
 		 */
-		if (rsk->fillsz + len > rsk->bufsz)
+		if (bufp_fillsz(rsk) + len > rsk->bufsz)
 			goto wait;
 
 		/*
@@ -442,7 +637,7 @@ redo:
 		wrtoken = ++rsk->wrtoken;
 
 		/* Write to the buffer in a circular way. */
-		wroff = rsk->wroff;
+		wroff = bufp_wroff(rsk);
 		wbytes = len;
 
 		do {
@@ -455,7 +650,7 @@ redo:
 			 * keep latency low.
 			 */
 			cobalt_atomic_leave(s);
-			ret = xnbufd_copy_to_kmem(rsk->bufmem + wroff, bufd, n);
+			ret = xnbufd_copy_to_kmem(rsk->bufdata + wroff, bufd, n);
 			if (ret < 0)
 				return ret;
 			cobalt_atomic_enter(s);
@@ -473,15 +668,15 @@ redo:
 			wbytes -= n;
 		} while (wbytes > 0);
 
-		rsk->fillsz += len;
-		rsk->wroff = wroff;
+		bufp_produce(rsk, wroff, len);
+		fillsz = bufp_fillsz(rsk);
 		ret = len;
 		resched = 0;
 
-		if (rsk->fillsz == len) /* -> readable */
+		if (fillsz == len) /* -> readable */
 			resched |= xnselect_signal(&rsk->priv->recv_block, POLLIN);
 
-		if (rsk->fillsz == rsk->bufsz) /* non-writable */
+		if (fillsz == rsk->bufsz) /* non-writable */
 			resched |= xnselect_signal(&rsk->priv->send_block, 0);
 		/*
 		 * Wake up all threads pending on the input wait
@@ -495,7 +690,7 @@ redo:
 		wc = rtipc_get_wait_context(waiter);
 		XENO_BUG_ON(COBALT, wc == NULL);
 		bufwc = container_of(wc, struct bufp_wait_context, wc);
-		if (bufwc->len <= rsk->fillsz)
+		if (bufwc->len <= fillsz)
 			rtdm_event_pulse(&rsk->i_event);
 		else if (resched)
 			xnsched_run();
@@ -511,6 +706,9 @@ redo:
 			break;
 		}
 
+		if (!bufp_ring_wait_p(rsk, len, 0))
+			continue;
+
 		wait.len = len;
 		wait.sk = rsk;
 		rtipc_prepare_wait(&wait.wc);
@@ -520,6 +718,8 @@ redo:
 		 */
 		ret = rtdm_event_timedwait(&rsk->o_event,
 					   sk->tx_timeout, &toseq);
+		if (rsk->ring && rtipc_peek_wait_head(&rsk->o_event) == NULL)
+			rsk->ring->wrwait = 0;
 		if (unlikely(ret))
 			break;
 	}
@@ -704,11 +904,9 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 	if (sk->bufsz == 0)
 		return -ENOBUFS;
 
-	sk->bufmem = alloc_pages_exact(sk->bufsz, GFP_KERNEL);
-	if (sk->bufmem == NULL) {
-		ret = -ENOMEM;
+	ret = bufp_alloc_mem(sk);
+	if (ret)
 		goto fail;
-	}
 
 	sk->name = *sa;
 	/* Set default destination if unset at binding time. */
@@ -719,7 +917,7 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__bufp_pnode.node);
 		if (ret) {
-			free_pages_exact(sk->bufmem, sk->bufsz);
+			bufp_free_mem(sk);
 			goto fail;
 		}
 	}
@@ -815,6 +1013,125 @@ set_assoc:
 	return 0;
 }
 
+/*
+ * Re-evaluate the state of a ring after user space moved its
+ * indexes, waking up the leading reader or writer if it may proceed
+ * now. Called with the nucleus lock held.
+ */
+static int __bufp_notify(struct bufp_socket *sk)
+{
+	struct bufp_wait_context *bufwc;
+	struct rtipc_wait_context *wc;
+	struct xnthread *waiter;
+	int resched;
+	size_t fillsz;
+
+	if (sk->ring == NULL)
+		return 0;
+
+	fillsz = bufp_fillsz(sk);
+	resched = xnselect_signal(&sk->priv->recv_block,
+				  fillsz > 0 ? POLLIN : 0);
+	resched |= xnselect_signal(&sk->priv->send_block,
+				   fillsz < sk->bufsz ? POLLOUT : 0);
+
+	waiter = rtipc_peek_wait_head(&sk->i_event);
+	if (waiter) {
+		wc = rtipc_get_wait_context(waiter);
+		XENO_BUG_ON(COBALT, wc == NULL);
+		bufwc = container_of(wc, struct bufp_wait_context, wc);
+		if (bufwc->len <= fillsz) {
+			rtdm_event_pulse(&sk->i_event);
+			resched = 0;
+		}
+	}
+
+	waiter = rtipc_peek_wait_head(&sk->o_event);
+	if (waiter) {
+		wc = rtipc_get_wait_context(waiter);
+		XENO_BUG_ON(COBALT, wc == NULL);
+		bufwc = container_of(wc, struct bufp_wait_context, wc);
+		if (bufwc->len + fillsz <= sk->bufsz) {
+			rtdm_event_pulse(&sk->o_event);
+			resched = 0;
+		}
+	}
+
+	return resched;
+}
+
+static int bufp_notify(struct bufp_socket *sk)
+{
+	struct bufp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int resched;
+
+	cobalt_atomic_enter(s);
+
+	resched = __bufp_notify(sk);
+
+	if (test_bit(_BUFP_CONNECTED, &sk->status)) {
+		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+		if (rfd) {
+			rsk = rtipc_fd_to_state(rfd);
+			if (rsk != sk)
+				resched |= __bufp_notify(rsk);
+		}
+	}
+
+	if (resched)
+		xnsched_run();
+
+	cobalt_atomic_leave(s);
+
+	return 0;
+}
+
+/*
+ * Map the ring of the socket if it is bound in ring mode, otherwise
+ * the ring of its peer. The ring memory is refcounted, so that it
+ * survives the owner until the last mapping is dropped.
+ */
+static int bufp_map_ring(struct bufp_socket *sk,
+			 struct rtdm_fd *fd, void **pptr)
+{
+	struct bufp_ringmem *rm = NULL;
+	struct bufp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int ret;
+
+	cobalt_atomic_enter(s);
+
+	if (test_bit(_BUFP_BOUND, &sk->status) && sk->ringmem)
+		rm = sk->ringmem;
+	else if (test_bit(_BUFP_CONNECTED, &sk->status)) {
+		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+		if (rfd) {
+			rsk = rtipc_fd_to_state(rfd);
+			rm = rsk->ringmem;
+		}
+	}
+
+	if (rm)
+		atomic_inc(&rm->refs);
+
+	cobalt_atomic_leave(s);
+
+	if (rm == NULL)
+		return -ENXIO;
+
+	/* vm_ops->open() is not called for the initial mapping. */
+	ret = rtdm_mmap_to_user(fd, rm->mem, rm->size,
+				PROT_READ|PROT_WRITE, pptr,
+				&bufp_vmops, rm);
+	if (ret)
+		bufp_put_ringmem(rm);
+
+	return ret;
+}
+
 static int __bufp_setsockopt(struct bufp_socket *sk,
 			     struct rtdm_fd *fd,
 			     void *arg)
@@ -823,8 +1140,8 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 	struct rtipc_port_label plabel;
 	struct timeval tv;
 	rtdm_lockctx_t s;
+	int ret, val;
 	size_t len;
-	int ret;
 
 	ret = rtipc_get_sockoptin(fd, &sopt, arg);
 	if (ret)
@@ -873,11 +1190,40 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 		if (test_bit(_BUFP_BOUND, &sk->status) ||
 		    test_bit(_BUFP_BINDING, &sk->status))
 			ret = -EALREADY;
+		else if (test_bit(_BUFP_RING, &sk->status) &&
+			 (len & (len - 1)) != 0)
+			ret = -EINVAL;
 		else
 			sk->bufsz = len;
 		cobalt_atomic_leave(s);
 		break;
 
+	case BUFP_RING:
+		if (sopt.optlen < sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &val, sopt.optval, sizeof(val)))
+			return -EFAULT;
+		cobalt_atomic_enter(s);
+		/*
+		 * Ring indexes wrap on the buffer size, which must be
+		 * a power of two.
+		 */
+		if (test_bit(_BUFP_BOUND, &sk->status) ||
+		    test_bit(_BUFP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else if (val == 0)
+			__clear_bit(_BUFP_RING, &sk->status);
+		else if (sk->bufsz & (sk->bufsz - 1))
+			ret = -EINVAL;
+		else
+			__set_bit(_BUFP_RING, &sk->status);
+		cobalt_atomic_leave(s);
+		break;
+
+	case BUFP_NOTIFY:
+		ret = bufp_notify(sk);
+		break;
+
 	case BUFP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -913,6 +1259,7 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 	struct timeval tv;
 	rtdm_lockctx_t s;
 	socklen_t len;
+	void *ptr;
 	int ret;
 
 	ret = rtipc_get_sockoptout(fd, &sopt, arg);
@@ -961,6 +1308,28 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case BUFP_MAP:
+		if (!rtdm_fd_is_user(fd))
+			return -EPERM;
+		if (len < (rtdm_fd_is_compat(fd) ? sizeof(u32) : sizeof(ptr)))
+			return -EINVAL;
+		if (rtdm_in_rt_context())
+			return -ENOSYS;	/* Try downgrading to NRT */
+		ret = bufp_map_ring(sk, fd, &ptr);
+		if (ret)
+			return ret;
+#ifdef CONFIG_XENO_ARCH_SYS3264
+		if (rtdm_fd_is_compat(fd)) {
+			compat_uptr_t cptr = ptr_to_compat(ptr);
+			if (rtipc_put_arg(fd, sopt.optval, &cptr, sizeof(cptr)))
+				return -EFAULT;
+			break;
+		}
+#endif
+		if (rtipc_put_arg(fd, sopt.optval, &ptr, sizeof(ptr)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -1052,7 +1421,7 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd)
 
 	cobalt_atomic_enter(s);
 
-	if (test_bit(_BUFP_BOUND, &sk->status) && sk->fillsz > 0)
+	if (test_bit(_BUFP_BOUND, &sk->status) && bufp_fillsz(sk) > 0)
 		mask |= POLLIN;
 
 	/*
@@ -1065,7 +1434,7 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd)
 		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
 		if (rfd) {
 			rsk = rtipc_fd_to_state(rfd);
-			if (rsk->fillsz < rsk->bufsz)
+			if (bufp_fillsz(rsk) < rsk->bufsz)
 				mask |= POLLOUT;
 		}
 	} else
@@ -1076,6 +1445,27 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd)
 	return mask;
 }
 
+/*
+ * Once a selector watches the socket, user space must ring the
+ * doorbell after each ring update, so that the select state is kept
+ * in sync. The flag is sticky, bindings may go away silently.
+ */
+static void bufp_selbind(struct rtdm_fd *fd)
+{
+	struct rtipc_private *priv = rtdm_fd_to_private(fd);
+	struct bufp_socket *sk = priv->state;
+	rtdm_lockctx_t s;
+
+	cobalt_atomic_enter(s);
+
+	__set_bit(_BUFP_SELECTED, &sk->status);
+	if (sk->ring)
+		sk->ring->selwait = 1;
+	smp_mb();
+
+	cobalt_atomic_leave(s);
+}
+
 static int bufp_init(void)
 {
 	portmap = xnmap_create(CONFIG_XENO_OPT_BUFP_NRPORT, 0, 0);
@@ -1104,5 +1494,6 @@ struct rtipc_protocol bufp_proto_driver = {
 		.write = bufp_write,
 		.ioctl = bufp_ioctl,
 		.pollstate = bufp_pollstate,
+		.selbind = bufp_selbind,
 	}
 };
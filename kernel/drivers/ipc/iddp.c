@@ -23,6 +23,7 @@
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/bufd.h>
 #include <cobalt/kernel/map.h>
@@ -34,11 +35,40 @@
 struct iddp_message {
 	struct list_head next;
 	int from;
+	int slot;		/* -1 unless pulled from the slot pool. */
 	size_t rdoff;
 	size_t len;
 	char data[];
 };
 
+/*
+ * Shared slot memory. Senders and receivers may map it, so it has to
+ * outlive the socket until the last mapping goes away.
+ */
+struct iddp_slotmem {
+	atomic_t refs;
+	void *mem;
+	size_t size;
+};
+
+#define IDDP_SLOT_FREE    0
+#define IDDP_SLOT_ALLOC   1	/* Owned by a sender (IDDP_GETSLOT). */
+#define IDDP_SLOT_QUEUED  2	/* Pending on the input queue. */
+#define IDDP_SLOT_HELD    3	/* Owned by the receiver. */
+#define IDDP_SLOT_FILLING 4	/* Being filled in by the kernel. */
+
+struct iddp_slotpool {
+	struct iddp_slotmem *mem;
+	void *base;
+	u32 count;
+	u32 size;
+	u32 nrfree;
+	u32 *freelist;
+	u8 *state;
+	struct iddp_socket **owners; /* of IDDP_SLOT_ALLOC slots. */
+	void *mbufs;		/* count message headers, no payload. */
+};
+
 struct iddp_socket {
 	int magic;
 	struct sockaddr_ipc name;
@@ -48,6 +78,8 @@ struct iddp_socket {
 	rtdm_waitqueue_t *poolwaitq;
 	rtdm_waitqueue_t privwaitq;
 	size_t poolsz;
+	struct iddp_slotconf slotconf;
+	struct iddp_slotpool slots;
 	rtdm_sem_t insem;
 	struct list_head inq;
 	u_long status;
@@ -56,6 +88,7 @@ struct iddp_socket {
 	nanosecs_rel_t rx_timeout;
 	nanosecs_rel_t tx_timeout;
 	unsigned long stalls;	/* Buffer stall counter. */
+	atomic_t grabbed;	/* Slots obtained from peers, not posted yet. */
 	struct rtipc_private *priv;
 };
 
@@ -106,9 +139,78 @@ static inline void __iddp_init_mbuf(struct iddp_message *mbuf, size_t len)
 {
 	mbuf->rdoff = 0;
 	mbuf->len = len;
+	mbuf->slot = -1;
 	INIT_LIST_HEAD(&mbuf->next);
 }
 
+static inline struct iddp_message *
+iddp_slot_mbuf(struct iddp_socket *sk, u32 index)
+{
+	return sk->slots.mbufs + index * sizeof(struct iddp_message);
+}
+
+static inline char *iddp_mbuf_data(struct iddp_socket *sk,
+				   struct iddp_message *mbuf)
+{
+	if (mbuf->slot < 0)
+		return mbuf->data;
+
+	return sk->slots.base + mbuf->slot * sk->slots.size;
+}
+
+/* nklock held. */
+static struct iddp_message *__iddp_get_slot(struct iddp_socket *sk)
+{
+	struct iddp_message *mbuf;
+	u32 index;
+
+	if (sk->slots.nrfree == 0)
+		return NULL;
+
+	index = sk->slots.freelist[--sk->slots.nrfree];
+	sk->slots.state[index] = IDDP_SLOT_FILLING;
+	mbuf = iddp_slot_mbuf(sk, index);
+	__iddp_init_mbuf(mbuf, 0);
+	mbuf->slot = index;
+
+	return mbuf;
+}
+
+/* nklock held. */
+static void __iddp_put_slot(struct iddp_socket *sk,
+			    struct iddp_message *mbuf)
+{
+	sk->slots.state[mbuf->slot] = IDDP_SLOT_FREE;
+	sk->slots.freelist[sk->slots.nrfree++] = mbuf->slot;
+}
+
+static struct iddp_message *
+__iddp_get_mbuf(struct iddp_socket *sk, size_t len, int *pret)
+{
+	struct iddp_message *mbuf;
+	rtdm_lockctx_t s;
+
+	if (sk->slots.count == 0) {
+		mbuf = xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
+		if (mbuf)
+			__iddp_init_mbuf(mbuf, len);
+		return mbuf;
+	}
+
+	if (len > sk->slots.size) {
+		*pret = -EMSGSIZE;
+		return NULL;
+	}
+
+	cobalt_atomic_enter(s);
+	mbuf = __iddp_get_slot(sk);
+	cobalt_atomic_leave(s);
+	if (mbuf)
+		mbuf->len = len;
+
+	return mbuf;
+}
+
 static struct iddp_message *
 __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		  nanosecs_rel_t timeout, int flags, int *pret)
@@ -121,11 +223,9 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 	rtdm_toseq_init(&timeout_seq, timeout);
 
 	for (;;) {
-		mbuf = xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
-		if (mbuf) {
-			__iddp_init_mbuf(mbuf, len);
+		mbuf = __iddp_get_mbuf(sk, len, &ret);
+		if (mbuf || ret)
 			break;
-		}
 		if (flags & MSG_DONTWAIT) {
 			ret = -EAGAIN;
 			break;
@@ -139,7 +239,9 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		 */
 		rtdm_waitqueue_lock(sk->poolwaitq, s);
 		++sk->stalls;
-		ret = rtdm_timedwait_locked(sk->poolwaitq, timeout, &timeout_seq);
+		if (sk->slots.count == 0 || sk->slots.nrfree == 0)
+			ret = rtdm_timedwait_locked(sk->poolwaitq,
+						    timeout, &timeout_seq);
 		rtdm_waitqueue_unlock(sk->poolwaitq, s);
 		if (unlikely(ret == -EIDRM))
 			ret = -ECONNRESET;
@@ -155,10 +257,119 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 static void __iddp_free_mbuf(struct iddp_socket *sk,
 			     struct iddp_message *mbuf)
 {
-	xnheap_free(sk->bufpool, mbuf);
+	rtdm_lockctx_t s;
+
+	if (mbuf->slot < 0)
+		xnheap_free(sk->bufpool, mbuf);
+	else {
+		cobalt_atomic_enter(s);
+		__iddp_put_slot(sk, mbuf);
+		cobalt_atomic_leave(s);
+	}
+
 	rtdm_waitqueue_broadcast(sk->poolwaitq);
 }
 
+static void iddp_put_slotmem(struct iddp_slotmem *sm)
+{
+	if (atomic_dec_and_test(&sm->refs)) {
+		free_pages_exact(sm->mem, sm->size);
+		kfree(sm);
+	}
+}
+
+static void iddp_vm_open(struct vm_area_struct *vma)
+{
+	struct iddp_slotmem *sm = vma->vm_private_data;
+
+	atomic_inc(&sm->refs);
+}
+
+static void iddp_vm_close(struct vm_area_struct *vma)
+{
+	iddp_put_slotmem(vma->vm_private_data);
+}
+
+static struct vm_operations_struct iddp_vmops = {
+	.open = iddp_vm_open,
+	.close = iddp_vm_close,
+};
+
+static int iddp_init_slots(struct iddp_socket *sk)
+{
+	struct iddp_slotpool *pool = &sk->slots;
+	u32 count = sk->slotconf.count, n;
+	struct iddp_slotmem *sm;
+	size_t size;
+
+	size = ALIGN(sk->slotconf.size, L1_CACHE_BYTES);
+	if (size > UINT_MAX / count)
+		return -EINVAL;
+
+	sm = kmalloc(sizeof(*sm), GFP_KERNEL);
+	if (sm == NULL)
+		return -ENOMEM;
+
+	sm->size = PAGE_ALIGN(size * count);
+	sm->mem = alloc_pages_exact(sm->size, GFP_KERNEL);
+	if (sm->mem == NULL)
+		goto fail_mem;
+
+	pool->freelist = kmalloc(count * sizeof(u32), GFP_KERNEL);
+	if (pool->freelist == NULL)
+		goto fail_freelist;
+
+	pool->state = kzalloc(count, GFP_KERNEL);
+	if (pool->state == NULL)
+		goto fail_state;
+
+	pool->owners = kcalloc(count, sizeof(struct iddp_socket *), GFP_KERNEL);
+	if (pool->owners == NULL)
+		goto fail_owners;
+
+	pool->mbufs = kcalloc(count, sizeof(struct iddp_message), GFP_KERNEL);
+	if (pool->mbufs == NULL)
+		goto fail_mbufs;
+
+	/* Hand out low indexes first, for better locality. */
+	for (n = 0; n < count; n++)
+		pool->freelist[n] = count - n - 1;
+
+	atomic_set(&sm->refs, 1);
+	pool->mem = sm;
+	pool->base = sm->mem;
+	pool->size = size;
+	pool->nrfree = count;
+	pool->count = count;
+
+	return 0;
+
+fail_mbufs:
+	kfree(pool->owners);
+fail_owners:
+	kfree(pool->state);
+fail_state:
+	kfree(pool->freelist);
+fail_freelist:
+	free_pages_exact(sm->mem, sm->size);
+fail_mem:
+	kfree(sm);
+
+	return -ENOMEM;
+}
+
+static void iddp_cleanup_slots(struct iddp_socket *sk)
+{
+	struct iddp_slotpool *pool = &sk->slots;
+
+	kfree(pool->mbufs);
+	kfree(pool->owners);
+	kfree(pool->state);
+	kfree(pool->freelist);
+	iddp_put_slotmem(pool->mem);
+	pool->count = 0;
+}
+
 static int iddp_socket(struct rtdm_fd *fd)
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -170,11 +381,15 @@ static int iddp_socket(struct rtdm_fd *fd)
 	sk->bufpool = &cobalt_heap;
 	sk->poolwaitq = &poolwaitq;
 	sk->poolsz = 0;
+	sk->slotconf.count = 0;
+	sk->slotconf.size = 0;
+	memset(&sk->slots, 0, sizeof(sk->slots));
 	sk->status = 0;
 	sk->handle = 0;
 	sk->rx_timeout = RTDM_TIMEOUT_INFINITE;
 	sk->tx_timeout = RTDM_TIMEOUT_INFINITE;
 	sk->stalls = 0;
+	atomic_set(&sk->grabbed, 0);
 	*sk->label = 0;
 	INIT_LIST_HEAD(&sk->inq);
 	rtdm_sem_init(&sk->insem, 0);
@@ -184,6 +399,82 @@ static int iddp_socket(struct rtdm_fd *fd)
 	return 0;
 }
 
+/*
+ * Give back the slots the socket grabbed from its peers via
+ * IDDP_GETSLOT, but never posted. A peer which is closing cannot be
+ * locked anymore, but its slot pool remains valid until it leaves the
+ * port map, which it only does once it has dropped all owners (see
+ * iddp_drop_owners()).
+ */
+static void iddp_reclaim_slots(struct iddp_socket *sk)
+{
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int port, nr, locked;
+	u32 n;
+
+	for (port = 0; port < CONFIG_XENO_OPT_IDDP_NRPORT &&
+		     atomic_read(&sk->grabbed) > 0; port++) {
+		cobalt_atomic_enter(s);
+		rfd = xnmap_fetch_nocheck(portmap, port);
+		locked = rfd && rtdm_fd_lock(rfd) >= 0;
+		cobalt_atomic_leave(s);
+		if (rfd == NULL)
+			continue;
+
+		rsk = rtipc_fd_to_state(rfd);
+		for (n = 0, nr = 0;; n++) {
+			cobalt_atomic_enter(s);
+			if ((!locked &&
+			     xnmap_fetch_nocheck(portmap, port) != rfd) ||
+			    n >= rsk->slots.count) {
+				cobalt_atomic_leave(s);
+				break;
+			}
+			if (rsk->slots.state[n] == IDDP_SLOT_ALLOC &&
+			    rsk->slots.owners[n] == sk) {
+				rsk->slots.owners[n] = NULL;
+				__iddp_put_slot(rsk, iddp_slot_mbuf(rsk, n));
+				atomic_dec(&sk->grabbed);
+				nr++;
+			}
+			cobalt_atomic_leave(s);
+		}
+
+		if (!locked)
+			continue;
+
+		if (nr > 0)
+			rtdm_waitqueue_broadcast(rsk->poolwaitq);
+
+		rtdm_fd_unlock(rfd);
+	}
+}
+
+/*
+ * Take back the slots peers grabbed from our pool but never posted,
+ * dropping them from the peers' grabbed count. This must happen
+ * before the socket leaves the port map.
+ */
+static void iddp_drop_owners(struct iddp_socket *sk)
+{
+	struct iddp_socket *owner;
+	rtdm_lockctx_t s;
+	u32 n;
+
+	for (n = 0; n < sk->slots.count; n++) {
+		cobalt_atomic_enter(s);
+		owner = sk->slots.owners[n];
+		if (sk->slots.state[n] == IDDP_SLOT_ALLOC && owner) {
+			sk->slots.owners[n] = NULL;
+			__iddp_put_slot(sk, iddp_slot_mbuf(sk, n));
+			atomic_dec(&owner->grabbed);
+		}
+		cobalt_atomic_leave(s);
+	}
+}
+
 static void iddp_close(struct rtdm_fd *fd)
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -193,6 +484,8 @@ static void iddp_close(struct rtdm_fd *fd)
 	void *poolmem;
 	u32 poolsz;
 
+	iddp_drop_owners(sk);
+
 	if (sk->name.sipc_port > -1) {
 		cobalt_atomic_enter(s);
 		xnmap_remove(portmap, sk->name.sipc_port);
@@ -205,6 +498,15 @@ static void iddp_close(struct rtdm_fd *fd)
 	if (sk->handle)
 		xnregistry_remove(sk->handle);
 
+	iddp_reclaim_slots(sk);
+
+	if (sk->slots.count) {
+		/* Unread datagrams go away with the slot pool. */
+		iddp_cleanup_slots(sk);
+		kfree(sk);
+		return;
+	}
+
 	if (sk->bufpool != &cobalt_heap) {
 		poolmem = xnheap_get_membase(&sk->privpool);
 		poolsz = xnheap_get_size(&sk->privpool);
@@ -225,26 +527,17 @@ static void iddp_close(struct rtdm_fd *fd)
 	return;
 }
 
-static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
-			      struct iovec *iov, int iovlen, int flags,
-			      struct sockaddr_ipc *saddr)
+/*
+ * Wait for the input queue to fill up. On success, return with the
+ * nucleus lock held.
+ */
+static int __iddp_wait_input(struct iddp_socket *sk, int flags,
+			     rtdm_lockctx_t *ctx)
 {
-	struct rtipc_private *priv = rtdm_fd_to_private(fd);
-	struct iddp_socket *sk = priv->state;
-	ssize_t maxlen, len, wrlen, vlen;
 	rtdm_toseq_t timeout_seq, *toseq;
-	int nvec, rdoff, ret, dofree;
-	struct iddp_message *mbuf;
 	nanosecs_rel_t timeout;
-	struct xnbufd bufd;
 	rtdm_lockctx_t s;
-
-	if (!test_bit(_IDDP_BOUND, &sk->status))
-		return -EAGAIN;
-
-	maxlen = rtipc_get_iov_flatlen(iov, iovlen);
-	if (maxlen == 0)
-		return 0;
+	int ret;
 
 	if (flags & MSG_DONTWAIT) {
 		timeout = RTDM_TIMEOUT_NONE;
@@ -254,8 +547,8 @@ static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
 		toseq = &timeout_seq;
 	}
 
-	/* We want to pick one buffer from the queue. */
-	
+	rtdm_toseq_init(&timeout_seq, timeout);
+
 	for (;;) {
 		ret = rtdm_sem_timeddown(&sk->insem, timeout, toseq);
 		if (unlikely(ret)) {
@@ -270,6 +563,36 @@ static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
 		cobalt_atomic_leave(s);
 	}
 
+	*ctx = s;
+
+	return 0;
+}
+
+static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
+			      struct iovec *iov, int iovlen, int flags,
+			      struct sockaddr_ipc *saddr)
+{
+	struct rtipc_private *priv = rtdm_fd_to_private(fd);
+	struct iddp_socket *sk = priv->state;
+	ssize_t maxlen, len, wrlen, vlen;
+	int nvec, rdoff, ret, dofree;
+	struct iddp_message *mbuf;
+	struct xnbufd bufd;
+	rtdm_lockctx_t s;
+	char *data;
+
+	if (!test_bit(_IDDP_BOUND, &sk->status))
+		return -EAGAIN;
+
+	maxlen = rtipc_get_iov_flatlen(iov, iovlen);
+	if (maxlen == 0)
+		return 0;
+
+	/* We want to pick one buffer from the queue. */
+	ret = __iddp_wait_input(sk, flags, &s);
+	if (ret)
+		return ret;
+
 	/* Pull heading message from input queue. */
 	mbuf = list_entry(sk->inq.next, struct iddp_message, next);
 	rdoff = mbuf->rdoff;
@@ -296,6 +619,8 @@ static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
 
 	cobalt_atomic_leave(s);
 
+	data = iddp_mbuf_data(sk, mbuf);
+
 	/* Now, write "len" bytes from mbuf->data to the vector cells */
 	for (nvec = 0, wrlen = len; nvec < iovlen && wrlen > 0; nvec++) {
 		if (iov[nvec].iov_len == 0)
@@ -303,11 +628,11 @@ static ssize_t __iddp_recvmsg(struct rtdm_fd *fd,
 		vlen = wrlen >= iov[nvec].iov_len ? iov[nvec].iov_len : wrlen;
 		if (rtdm_fd_is_user(fd)) {
 			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, data + rdoff, vlen);
 			xnbufd_unmap_uread(&bufd);
 		} else {
 			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, data + rdoff, vlen);
 			xnbufd_unmap_kread(&bufd);
 		}
 		if (ret < 0)
@@ -373,6 +698,61 @@ static ssize_t iddp_read(struct rtdm_fd *fd, void *buf, size_t len)
 	return __iddp_recvmsg(fd, &iov, 1, 0, NULL);
 }
 
+/* nklock held. */
+static void __iddp_post_mbuf(struct iddp_socket *sk,
+			     struct iddp_socket *rsk,
+			     struct iddp_message *mbuf, int flags)
+{
+	/*
+	 * CAUTION: we must remain atomic from the moment we signal
+	 * POLLIN, until sem_up has happened.
+	 */
+	if (list_empty(&rsk->inq)) /* -> readable */
+		xnselect_signal(&rsk->priv->recv_block, POLLIN);
+
+	mbuf->from = sk->name.sipc_port;
+	if (mbuf->slot >= 0)
+		rsk->slots.state[mbuf->slot] = IDDP_SLOT_QUEUED;
+
+	if (flags & MSG_OOB)
+		list_add(&mbuf->next, &rsk->inq);
+	else
+		list_add_tail(&mbuf->next, &rsk->inq);
+
+	rtdm_sem_up(&rsk->insem); /* Will resched. */
+}
+
+/*
+ * Grab the destination socket for sending. On success, the caller
+ * must drop the returned fd with rtdm_fd_unlock() when done.
+ */
+static struct rtdm_fd *iddp_get_peer(const struct sockaddr_ipc *daddr,
+				     int *pret)
+{
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+
+	cobalt_atomic_enter(s);
+	rfd = xnmap_fetch_nocheck(portmap, daddr->sipc_port);
+	if (rfd && rtdm_fd_lock(rfd) < 0)
+		rfd = NULL;
+	cobalt_atomic_leave(s);
+	if (rfd == NULL) {
+		*pret = -ECONNRESET;
+		return NULL;
+	}
+
+	rsk = rtipc_fd_to_state(rfd);
+	if (!test_bit(_IDDP_BOUND, &rsk->status)) {
+		rtdm_fd_unlock(rfd);
+		*pret = -ECONNREFUSED;
+		return NULL;
+	}
+
+	return rfd;
+}
+
 static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 			      struct iovec *iov, int iovlen, int flags,
 			      const struct sockaddr_ipc *daddr)
@@ -385,31 +765,25 @@ static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 	struct rtdm_fd *rfd;
 	struct xnbufd bufd;
 	rtdm_lockctx_t s;
+	char *data;
 
 	len = rtipc_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
 		return 0;
 
-	cobalt_atomic_enter(s);
-	rfd = xnmap_fetch_nocheck(portmap, daddr->sipc_port);
-	if (rfd && rtdm_fd_lock(rfd) < 0)
-		rfd = NULL;
-	cobalt_atomic_leave(s);
+	rfd = iddp_get_peer(daddr, &ret);
 	if (rfd == NULL)
-		return -ECONNRESET;
+		return ret;
 
 	rsk = rtipc_fd_to_state(rfd);
-	if (!test_bit(_IDDP_BOUND, &rsk->status)) {
-		rtdm_fd_unlock(rfd);
-		return -ECONNREFUSED;
-	}
-
 	mbuf = __iddp_alloc_mbuf(rsk, len, sk->tx_timeout, flags, &ret);
 	if (unlikely(ret)) {
 		rtdm_fd_unlock(rfd);
 		return ret;
 	}
 
+	data = iddp_mbuf_data(rsk, mbuf);
+
 	/* Now, move "len" bytes to mbuf->data from the vector cells */
 	for (nvec = 0, rdlen = len, wroff = 0;
 	     nvec < iovlen && rdlen > 0; nvec++) {
@@ -418,11 +792,11 @@ static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
 		if (rtdm_fd_is_user(fd)) {
 			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
+			ret = xnbufd_copy_to_kmem(data + wroff, &bufd, vlen);
 			xnbufd_unmap_uread(&bufd);
 		} else {
 			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
+			ret = xnbufd_copy_to_kmem(data + wroff, &bufd, vlen);
 			xnbufd_unmap_kread(&bufd);
 		}
 		if (ret < 0)
@@ -434,23 +808,7 @@ static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 	}
 
 	cobalt_atomic_enter(s);
-
-	/*
-	 * CAUTION: we must remain atomic from the moment we signal
-	 * POLLIN, until sem_up has happened.
-	 */
-	if (list_empty(&rsk->inq)) /* -> readable */
-		xnselect_signal(&rsk->priv->recv_block, POLLIN);
-
-	mbuf->from = sk->name.sipc_port;
-
-	if (flags & MSG_OOB)
-		list_add(&mbuf->next, &rsk->inq);
-	else
-		list_add_tail(&mbuf->next, &rsk->inq);
-
-	rtdm_sem_up(&rsk->insem); /* Will resched. */
-
+	__iddp_post_mbuf(sk, rsk, mbuf, flags);
 	cobalt_atomic_leave(s);
 
 	rtdm_fd_unlock(rfd);
@@ -564,8 +922,17 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 	 * Allocate a local buffer pool if we were told to do so via
 	 * setsockopt() before we got there.
 	 */
-	poolsz = sk->poolsz;
-	if (poolsz > 0) {
+	/*
+	 * A slot pool supersedes any local pool size, all datagrams
+	 * are conveyed through slots then.
+	 */
+	poolsz = sk->slotconf.count > 0 ? 0 : sk->poolsz;
+	if (sk->slotconf.count > 0) {
+		ret = iddp_init_slots(sk);
+		if (ret)
+			goto fail;
+		sk->poolwaitq = &sk->privwaitq;
+	} else if (poolsz > 0) {
 		poolsz = xnheap_rounded_size(poolsz);
 		poolmem = alloc_pages_exact(poolsz, GFP_KERNEL);
 		if (poolmem == NULL) {
@@ -592,7 +959,9 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__iddp_pnode.node);
 		if (ret) {
-			if (poolsz > 0) {
+			if (sk->slots.count > 0)
+				iddp_cleanup_slots(sk);
+			else if (poolsz > 0) {
 				xnheap_destroy(&sk->privpool);
 				free_pages_exact(poolmem, poolsz);
 			}
@@ -691,14 +1060,237 @@ set_assoc:
 	return 0;
 }
 
+/*
+ * Map the slot pool of the socket if it has one, otherwise the pool
+ * of its peer.
+ */
+static int iddp_map_slots(struct iddp_socket *sk,
+			  struct rtdm_fd *fd, void **pptr)
+{
+	struct iddp_slotmem *sm = NULL;
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int ret;
+
+	cobalt_atomic_enter(s);
+
+	if (sk->slots.count > 0)
+		sm = sk->slots.mem;
+	else if (test_bit(_IDDP_CONNECTED, &sk->status)) {
+		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+		if (rfd) {
+			rsk = rtipc_fd_to_state(rfd);
+			if (rsk->slots.count > 0)
+				sm = rsk->slots.mem;
+		}
+	}
+
+	if (sm)
+		atomic_inc(&sm->refs);
+
+	cobalt_atomic_leave(s);
+
+	if (sm == NULL)
+		return -ENXIO;
+
+	/* vm_ops->open() is not called for the initial mapping. */
+	ret = rtdm_mmap_to_user(fd, sm->mem, sm->size,
+				PROT_READ|PROT_WRITE, pptr,
+				&iddp_vmops, sm);
+	if (ret)
+		iddp_put_slotmem(sm);
+
+	return ret;
+}
+
+/* Grab a free slot from the peer, for filling it in place. */
+static int iddp_get_slot(struct iddp_socket *sk, struct iddp_slot *slot)
+{
+	struct iddp_message *mbuf;
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int ret;
+
+	if (sk->peer.sipc_port < 0)
+		return -EDESTADDRREQ;
+
+	rfd = iddp_get_peer(&sk->peer, &ret);
+	if (rfd == NULL)
+		return ret;
+
+	rsk = rtipc_fd_to_state(rfd);
+	if (rsk->slots.count == 0) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	mbuf = __iddp_alloc_mbuf(rsk, 0, sk->tx_timeout, 0, &ret);
+	if (ret)
+		goto out;
+
+	/* Only the grabbing socket may post it. */
+	cobalt_atomic_enter(s);
+	rsk->slots.state[mbuf->slot] = IDDP_SLOT_ALLOC;
+	rsk->slots.owners[mbuf->slot] = sk;
+	atomic_inc(&sk->grabbed);
+	cobalt_atomic_leave(s);
+
+	slot->index = mbuf->slot;
+	slot->offset = mbuf->slot * rsk->slots.size;
+	slot->len = rsk->slots.size;
+	slot->port = rsk->name.sipc_port;
+out:
+	rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
+/* Give back a slot grabbed by iddp_get_slot(), which was never handed out. */
+static void iddp_unget_slot(struct iddp_socket *sk,
+			    const struct iddp_slot *slot)
+{
+	struct sockaddr_ipc addr;
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int ret, nr = 0;
+
+	addr.sipc_family = AF_RTIPC;
+	addr.sipc_port = slot->port;
+	rfd = iddp_get_peer(&addr, &ret);
+	if (rfd == NULL)
+		return;	/* The closing peer drops it. */
+
+	rsk = rtipc_fd_to_state(rfd);
+
+	cobalt_atomic_enter(s);
+
+	if (slot->index < rsk->slots.count &&
+	    rsk->slots.state[slot->index] == IDDP_SLOT_ALLOC &&
+	    rsk->slots.owners[slot->index] == sk) {
+		rsk->slots.owners[slot->index] = NULL;
+		__iddp_put_slot(rsk, iddp_slot_mbuf(rsk, slot->index));
+		atomic_dec(&sk->grabbed);
+		nr = 1;
+	}
+
+	cobalt_atomic_leave(s);
+
+	if (nr)
+		rtdm_waitqueue_broadcast(rsk->poolwaitq);
+
+	rtdm_fd_unlock(rfd);
+}
+
+/* Post a slot previously obtained from the peer. */
+static int iddp_put_slot(struct iddp_socket *sk,
+			 const struct iddp_slot *slot)
+{
+	struct iddp_message *mbuf;
+	struct iddp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	int ret = 0;
+
+	if (sk->peer.sipc_port < 0)
+		return -EDESTADDRREQ;
+
+	rfd = iddp_get_peer(&sk->peer, &ret);
+	if (rfd == NULL)
+		return ret;
+
+	rsk = rtipc_fd_to_state(rfd);
+
+	cobalt_atomic_enter(s);
+
+	if (slot->index >= rsk->slots.count ||
+	    rsk->slots.state[slot->index] != IDDP_SLOT_ALLOC ||
+	    rsk->slots.owners[slot->index] != sk ||
+	    slot->len > rsk->slots.size)
+		ret = -EINVAL;
+	else {
+		rsk->slots.owners[slot->index] = NULL;
+		atomic_dec(&sk->grabbed);
+		mbuf = iddp_slot_mbuf(rsk, slot->index);
+		mbuf->len = slot->len;
+		__iddp_post_mbuf(sk, rsk, mbuf, 0);
+	}
+
+	cobalt_atomic_leave(s);
+
+	rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
+/* Pull the next datagram from the input queue, without copying. */
+static int iddp_recv_slot(struct iddp_socket *sk, struct iddp_slot *slot)
+{
+	struct iddp_message *mbuf;
+	rtdm_lockctx_t s;
+	int ret;
+
+	if (!test_bit(_IDDP_BOUND, &sk->status))
+		return -EAGAIN;
+
+	if (sk->slots.count == 0)
+		return -EOPNOTSUPP;
+
+	ret = __iddp_wait_input(sk, 0, &s);
+	if (ret)
+		return ret;
+
+	mbuf = list_entry(sk->inq.next, struct iddp_message, next);
+	list_del(&mbuf->next);
+	if (list_empty(&sk->inq)) /* -> non-readable */
+		xnselect_signal(&sk->priv->recv_block, 0);
+
+	sk->slots.state[mbuf->slot] = IDDP_SLOT_HELD;
+	slot->index = mbuf->slot;
+	slot->offset = mbuf->slot * sk->slots.size + mbuf->rdoff;
+	slot->len = mbuf->len - mbuf->rdoff;
+	slot->port = mbuf->from;
+
+	cobalt_atomic_leave(s);
+
+	return 0;
+}
+
+/* Give back a slot obtained by iddp_recv_slot(). */
+static int iddp_release_slot(struct iddp_socket *sk, u32 index)
+{
+	rtdm_lockctx_t s;
+
+	cobalt_atomic_enter(s);
+
+	if (index >= sk->slots.count ||
+	    sk->slots.state[index] != IDDP_SLOT_HELD) {
+		cobalt_atomic_leave(s);
+		return -EINVAL;
+	}
+
+	__iddp_put_slot(sk, iddp_slot_mbuf(sk, index));
+
+	cobalt_atomic_leave(s);
+
+	rtdm_waitqueue_broadcast(sk->poolwaitq);
+
+	return 0;
+}
+
 static int __iddp_setsockopt(struct iddp_socket *sk,
 			     struct rtdm_fd *fd,
 			     void *arg)
 {
 	struct _rtdm_setsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	struct iddp_slotconf conf;
+	struct iddp_slot slot;
 	struct timeval tv;
 	rtdm_lockctx_t s;
+	__u32 index;
 	size_t len;
 	int ret;
 
@@ -735,6 +1327,38 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 
 	switch (sopt.optname) {
 
+	case IDDP_SLOTS:
+		if (sopt.optlen < sizeof(conf))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &conf, sopt.optval, sizeof(conf)))
+			return -EFAULT;
+		if ((conf.count == 0) != (conf.size == 0))
+			return -EINVAL;
+		cobalt_atomic_enter(s);
+		if (test_bit(_IDDP_BOUND, &sk->status) ||
+		    test_bit(_IDDP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else
+			sk->slotconf = conf;
+		cobalt_atomic_leave(s);
+		break;
+
+	case IDDP_PUTSLOT:
+		if (sopt.optlen < sizeof(slot))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &slot, sopt.optval, sizeof(slot)))
+			return -EFAULT;
+		ret = iddp_put_slot(sk, &slot);
+		break;
+
+	case IDDP_RELEASE:
+		if (sopt.optlen < sizeof(index))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &index, sopt.optval, sizeof(index)))
+			return -EFAULT;
+		ret = iddp_release_slot(sk, index);
+		break;
+
 	case IDDP_POOLSZ:
 		ret = rtipc_get_length(fd, &len, sopt.optval, sopt.optlen);
 		if (ret)
@@ -786,9 +1410,11 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 {
 	struct _rtdm_getsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	struct iddp_slot slot;
 	struct timeval tv;
 	rtdm_lockctx_t s;
 	socklen_t len;
+	void *ptr;
 	int ret;
 
 	ret = rtipc_get_sockoptout(fd, &sopt, arg);
@@ -838,6 +1464,48 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case IDDP_MAP:
+		if (!rtdm_fd_is_user(fd))
+			return -EPERM;
+		if (len < (rtdm_fd_is_compat(fd) ? sizeof(u32) : sizeof(ptr)))
+			return -EINVAL;
+		if (rtdm_in_rt_context())
+			return -ENOSYS;	/* Try downgrading to NRT */
+		ret = iddp_map_slots(sk, fd, &ptr);
+		if (ret)
+			return ret;
+#ifdef CONFIG_XENO_ARCH_SYS3264
+		if (rtdm_fd_is_compat(fd)) {
+			compat_uptr_t cptr = ptr_to_compat(ptr);
+			if (rtipc_put_arg(fd, sopt.optval, &cptr, sizeof(cptr)))
+				return -EFAULT;
+			break;
+		}
+#endif
+		if (rtipc_put_arg(fd, sopt.optval, &ptr, sizeof(ptr)))
+			return -EFAULT;
+		break;
+
+	case IDDP_GETSLOT:
+	case IDDP_RECVSLOT:
+		if (len < sizeof(slot))
+			return -EINVAL;
+		if (sopt.optname == IDDP_GETSLOT)
+			ret = iddp_get_slot(sk, &slot);
+		else
+			ret = iddp_recv_slot(sk, &slot);
+		if (ret)
+			return ret;
+		if (rtipc_put_arg(fd, sopt.optval, &slot, sizeof(slot))) {
+			/* Nobody would ever give the slot back. */
+			if (sopt.optname == IDDP_GETSLOT)
+				iddp_unget_slot(sk, &slot);
+			else
+				iddp_release_slot(sk, slot.index);
+			return -EFAULT;
+		}
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -57,6 +57,7 @@ struct rtipc_protocol {
 		int (*ioctl)(struct rtdm_fd *fd,
 			     unsigned int request, void *arg);
 		unsigned int (*pollstate)(struct rtdm_fd *fd);
+		void (*selbind)(struct rtdm_fd *fd);
 	} proto_ops;
 };
 
@@ -480,7 +480,11 @@ static int rtipc_select(struct rtdm_fd *fd, struct xnselector *selector,
 	struct xnselect *block;
 	spl_t s;
 	int ret;
-	
+
+	/* Tell the protocol first, then sample the state. */
+	if (priv->proto->proto_ops.selbind)
+		priv->proto->proto_ops.selbind(fd);
+
 	pollstate = priv->proto->proto_ops.pollstate(fd);
 
 	switch (type) {
@@ -803,6 +803,10 @@ static int e1000_probe(struct pci_dev *pdev,
 
 	netdev->features |= NETIF_F_LLTX;
 
+	/* e1000_tx_csum() handles CHECKSUM_PARTIAL frames */
+	if (adapter->hw.mac_type >= e1000_82543)
+		netdev->rt_features |= RTNETIF_F_UDP_CSUM;
+
 	adapter->en_mng_pt = e1000_enable_mng_pass_thru(&adapter->hw);
 
 	/* initialize eeprom parameters */
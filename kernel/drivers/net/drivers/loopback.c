@@ -33,6 +33,10 @@ MODULE_LICENSE("GPL");
 
 static struct rtnet_device* rt_loopback_dev;
 
+static int csum_offload = 0;
+module_param(csum_offload, int, 0444);
+MODULE_PARM_DESC(csum_offload, "Skip UDP checksums, the data never leaves memory");
+
 /***
  *  rt_loopback_open
  *  @rtdev
@@ -76,6 +80,10 @@ static int rt_loopback_xmit(struct rtskb *rtskb, struct rtnet_device *rtdev)
     /* make sure that critical fields are re-intialised */
     rtskb->chain_end = rtskb;
 
+    /* the checksum left to the "hardware" would be correct by definition */
+    if (rtskb->ip_summed == CHECKSUM_PARTIAL)
+	rtskb->ip_summed = CHECKSUM_UNNECESSARY;
+
     /* parse the Ethernet header as usual */
     rtskb->protocol = rt_eth_type_trans(rtskb, rtdev);
 
@@ -109,6 +117,8 @@ static int __init loopback_init(void)
     rtdev->flags |= IFF_LOOPBACK;
     rtdev->flags &= ~IFF_BROADCAST;
     rtdev->features |= NETIF_F_LLTX;
+    if (csum_offload)
+	rtdev->rt_features |= RTNETIF_F_UDP_CSUM;
 
     if ((err = rt_register_rtnetdev(rtdev)) != 0)
     {
@@ -37,10 +37,20 @@ struct dest_route {
     struct rtnet_device *rtdev;
 };
 
+/* Last output route of a socket, valid as long as the routing tables
+   did not change since. Does not hold any reference on the device. */
+struct dest_cache {
+    struct dest_route   dest;
+    u32                 daddr;
+    u32                 saddr;
+    unsigned int        genid;
+};
+
 
 int rt_ip_route_add_host(u32 addr, unsigned char *dev_addr,
                          struct rtnet_device *rtdev);
 void rt_ip_route_del_all(struct rtnet_device *rtdev);
+void rt_ip_route_sync_readers(void);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
 int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr);
@@ -55,6 +65,13 @@ int rt_ip_route_del_host(u32 addr, struct rtnet_device *rtdev);
 int rt_ip_route_get_host(u32 addr, char* if_name, unsigned char *dev_addr,
                          struct rtnet_device *rtdev);
 int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr);
+int rt_ip_route_output_cached(struct dest_route *rt_buf,
+                              struct dest_cache *cache, u32 daddr, u32 saddr);
+
+static inline void rt_ip_route_cache_init(struct dest_cache *cache)
+{
+    cache->dest.rtdev = NULL;
+}
 
 int __init rt_ip_routing_init(void);
 void rt_ip_routing_release(void);
@@ -46,6 +46,12 @@
 #define NETIF_F_LLTX                    4096
 #endif
 
+/* Offloads the stack may request from the device (rtdev->rt_features).
+ * Unlike NETIF_F_*, these are only set by drivers which actually handle
+ * them in their xmit path. */
+#define RTNETIF_F_UDP_CSUM              0x0001  /* fills in the UDP checksum
+						   of CHECKSUM_PARTIAL frames */
+
 #define RTDEV_TX_OK		0
 #define RTDEV_TX_BUSY	1
 
@@ -96,6 +102,7 @@ struct rtnet_device {
     unsigned int        mtu;        /* eth = 1536, tr = 4...        */
     void                *priv;      /* pointer to private data      */
     netdev_features_t   features;   /* [RT]NETIF_F_*                */
+    unsigned int        rt_features;    /* RTNETIF_F_*              */
 
     /* Interface address info. */
     unsigned char       broadcast[MAX_ADDR_LEN];    /* hw bcast add */
@@ -108,7 +115,8 @@ struct rtnet_device {
     __u32               local_ip;   /* IP address in network order  */
     __u32               broadcast_ip; /* broadcast IP in network order */
 
-    rtdm_event_t        *stack_event;
+    int                 stack_queue;    /* home stack manager queue */
+    unsigned long       stack_pending;  /* stack manager queues to wake */
 
     rtdm_mutex_t        xmit_mutex; /* protects xmit routine        */
     rtdm_lock_t         rtdev_lock; /* management lock              */
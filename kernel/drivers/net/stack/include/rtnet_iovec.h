@@ -44,6 +44,18 @@ static inline size_t rt_iovec_len(const struct iovec *iov, int iovlen)
 extern void rt_memcpy_tokerneliovec(struct iovec *iov, unsigned char *kdata, int len);
 extern void rt_memcpy_fromkerneliovec(unsigned char *kdata, struct iovec *iov, int len);
 
+/* single-pass copy and checksum, returning the updated checksum */
+extern unsigned int rt_memcpy_tokerneliovec_csum(struct iovec *iov,
+						 unsigned char *kdata, int len,
+						 unsigned int csum,
+						 unsigned int pos);
+extern unsigned int rt_memcpy_fromkerneliovec_csum(unsigned char *kdata,
+						   struct iovec *iov, int len,
+						   unsigned int csum,
+						   unsigned int pos);
+extern unsigned int rt_csum_kerneliovec(const struct iovec *iov, int len,
+					unsigned int csum);
+
 
 #endif  /* __KERNEL__ */
 
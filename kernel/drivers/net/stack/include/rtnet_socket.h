@@ -32,12 +32,15 @@
 
 #include <rtdev.h>
 #include <rtnet.h>
+#include <ipv4/route.h>
 #include <rtdm/driver.h>
 #include <stack_mgr.h>
 
 #include <rtdm/driver.h>
 
 
+struct rtpacket_ring;
+
 struct rtsocket {
     unsigned short          protocol;
 
@@ -70,12 +73,15 @@ struct rtsocket {
 	    int             reg_index;  /* index in port registry */
 	    u8              tos;
 	    u8              state;
+	    struct dest_cache dst;      /* last output route */
 	} inet;
 
 	/* packet socket specific */
 	struct {
 	    struct rtpacket_type packet_type;
 	    int                  ifindex;
+	    struct rtpacket_ring *rx_ring;  /* mapped RX frame ring */
+	    struct rtpacket_ring *tx_ring;  /* mapped TX frame ring */
 	} packet;
     } prot;
 };
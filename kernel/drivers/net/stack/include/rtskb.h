@@ -27,6 +27,7 @@
 
 #ifdef __KERNEL__
 
+#include <linux/mutex.h>
 #include <linux/skbuff.h>
 
 #include <rtnet.h>
@@ -242,8 +243,19 @@ struct rtskb_pool_lock_ops {
 struct rtskb_pool {
     struct rtskb_queue queue;
     const struct rtskb_pool_lock_ops *lock_ops;
-    unsigned lock_count;
+    unsigned lock_count;    /* rtskbs handed out */
     void *lock_cookie;
+
+    /* usage telemetry, protected by the queue lock */
+    const char          *name;
+    unsigned int        size;       /* rtskbs owned by the pool */
+    unsigned int        high_water; /* highest lock_count seen */
+    unsigned long       exhausted;  /* dequeues failed on empty pool */
+    unsigned long       refills;    /* background extensions */
+    unsigned int        auto_added; /* rtskbs added in background */
+    int                 extend_pending;
+
+    struct list_head    entry;      /* in rtskb_pool_list */
 };
 
 #define QUEUE_MAX_PRIO          0
@@ -280,6 +292,10 @@ extern unsigned int rtskb_pools_max;    /* maximum number of rtskb pools      */
 extern unsigned int rtskb_amount;       /* current number of allocated rtskbs */
 extern unsigned int rtskb_amount_max;   /* maximum number of allocated rtskbs */
 
+extern struct list_head rtskb_pool_list;   /* all initialised pools */
+extern struct mutex rtskb_pool_nrt_lock;   /* protects rtskb_pool_list */
+extern unsigned int rtskb_pool_auto_rtskbs; /* background extension limit */
+
 #ifdef CONFIG_XENO_DRIVERS_NET_CHECKED
 extern void rtskb_over_panic(struct rtskb *skb, int len, void *here);
 extern void rtskb_under_panic(struct rtskb *skb, int len, void *here);
@@ -291,6 +307,18 @@ extern void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb);
 
 extern struct rtskb *alloc_rtskb(unsigned int size, struct rtskb_pool *pool);
 
+/***
+ *  rtskb_pool_avail - rtskbs currently left in the pool (unlocked
+ *  snapshot, only a hint)
+ */
+static inline unsigned int rtskb_pool_avail(struct rtskb_pool *pool)
+{
+    unsigned int size = ACCESS_ONCE(pool->size);
+    unsigned int used = ACCESS_ONCE(pool->lock_count);
+
+    return size > used ? size - used : 0;
+}
+
 extern void kfree_rtskb(struct rtskb *skb);
 #define dev_kfree_rtskb(a)  kfree_rtskb(a)
 
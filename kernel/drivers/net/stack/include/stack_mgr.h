@@ -40,6 +40,9 @@
 #define RTPACKET_HASH_TBL_SIZE  64
 #define RTPACKET_HASH_KEY_MASK  (RTPACKET_HASH_TBL_SIZE-1)
 
+/* maximum number of stack manager tasks */
+#define RTNET_STACK_MAX_QUEUES  8
+
 struct rtpacket_type {
     struct list_head    list_entry;
 
@@ -79,16 +82,12 @@ int rt_stack_mgr_init(struct rtnet_mgr *mgr);
 void rt_stack_mgr_delete(struct rtnet_mgr *mgr);
 
 void rtnetif_rx(struct rtskb *skb);
+void rt_mark_stack_mgr(struct rtnet_device *rtdev);
 
 static inline void rtnetif_tx(struct rtnet_device *rtdev)
 {
 }
 
-static inline void rt_mark_stack_mgr(struct rtnet_device *rtdev)
-{
-    rtdm_event_signal(rtdev->stack_event);
-}
-
 #endif /* __KERNEL__ */
 
 #endif  /* __STACK_MGR_H_ */
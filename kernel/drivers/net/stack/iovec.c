@@ -25,6 +25,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/string.h>
+#include <net/checksum.h>
 
 #include <rtnet_iovec.h>
 
@@ -73,5 +74,111 @@ void rt_memcpy_fromkerneliovec(unsigned char *kdata, struct iovec *iov,int len)
 }
 
 
+/***
+ *  rt_csum_copy - copy and checksum a block at offset @pos of the
+ *  checksummed data
+ */
+static inline unsigned int rt_csum_copy(const void *from, void *to, int len,
+					unsigned int csum, unsigned int pos)
+{
+    /* odd offsets need the partial sum to be byte-swapped */
+    if (pos & 1)
+	return csum_block_add(csum,
+			      csum_partial_copy_nocheck(from, to, len, 0), pos);
+
+    return csum_partial_copy_nocheck(from, to, len, csum);
+}
+
+
+/***
+ *  rt_memcpy_tokerneliovec_csum - copy to the iovec and checksum the data
+ *  in a single pass
+ *  @csum: checksum of the data preceding @kdata
+ *  @pos: offset of @kdata in the checksummed data
+ */
+unsigned int rt_memcpy_tokerneliovec_csum(struct iovec *iov,
+					  unsigned char *kdata, int len,
+					  unsigned int csum, unsigned int pos)
+{
+    while (len > 0)
+    {
+        if (iov->iov_len)
+        {
+            int copy = min_t(unsigned int, iov->iov_len, len);
+
+            csum = rt_csum_copy(kdata, iov->iov_base, copy, csum, pos);
+            kdata+=copy;
+            len-=copy;
+            pos+=copy;
+            iov->iov_len-=copy;
+            iov->iov_base+=copy;
+        }
+        iov++;
+    }
+
+    return csum;
+}
+
+
+/***
+ *  rt_memcpy_fromkerneliovec_csum - copy from the iovec and checksum the
+ *  data in a single pass
+ *  @csum: checksum of the data preceding the copied block
+ *  @pos: offset of the copied block in the checksummed data
+ */
+unsigned int rt_memcpy_fromkerneliovec_csum(unsigned char *kdata,
+					    struct iovec *iov, int len,
+					    unsigned int csum, unsigned int pos)
+{
+    while (len > 0)
+    {
+        if (iov->iov_len)
+        {
+            int copy=min_t(unsigned int, len, iov->iov_len);
+
+            csum = rt_csum_copy(iov->iov_base, kdata, copy, csum, pos);
+            len-=copy;
+            kdata+=copy;
+            pos+=copy;
+            iov->iov_base+=copy;
+            iov->iov_len-=copy;
+        }
+        iov++;
+    }
+
+    return csum;
+}
+
+
+/***
+ *  rt_csum_kerneliovec - checksum the first @len bytes of the iovec,
+ *  leaving it untouched
+ */
+unsigned int rt_csum_kerneliovec(const struct iovec *iov, int len,
+				 unsigned int csum)
+{
+    unsigned int pos = 0;
+
+    while (len > 0)
+    {
+        if (iov->iov_len)
+        {
+            int copy=min_t(unsigned int, len, iov->iov_len);
+
+            csum = csum_block_add(csum,
+                                  csum_partial(iov->iov_base, copy, 0), pos);
+            len-=copy;
+            pos+=copy;
+        }
+        iov++;
+    }
+
+    return csum;
+}
+
+
 EXPORT_SYMBOL_GPL(rt_memcpy_tokerneliovec);
 EXPORT_SYMBOL_GPL(rt_memcpy_fromkerneliovec);
+EXPORT_SYMBOL_GPL(rt_memcpy_tokerneliovec_csum);
+EXPORT_SYMBOL_GPL(rt_memcpy_fromkerneliovec_csum);
+EXPORT_SYMBOL_GPL(rt_csum_kerneliovec);
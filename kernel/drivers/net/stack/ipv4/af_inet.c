@@ -275,6 +275,9 @@ static void rt_ip_ifup(struct rtnet_device *rtdev,
 static void rt_ip_ifdown(struct rtnet_device *rtdev)
 {
     rt_ip_route_del_all(rtdev);
+
+    /* no lookup may hand out the device beyond this point */
+    rt_ip_route_sync_readers();
 }
 
 
@@ -157,7 +157,7 @@ static int rt_icmp_glue_reply_bits(const void *p, unsigned char *to,
 
 
     /* TODO: add support for fragmented ICMP packets */
-    if (offset != 0)
+    if ((offset != 0) || (to == NULL))
 	return -EMSGSIZE;
 
     csum = csum_partial_copy_nocheck((void *)&icmp_param->head, to,
@@ -287,6 +287,9 @@ static int rt_icmp_glue_request_bits(const void *p, unsigned char *to,
 			     __FUNCTION__);
 		 return -1;);
 
+    if (to == NULL)
+	return -EMSGSIZE;
+
     csum = csum_partial_copy_nocheck((void *)&icmp_param->head, to,
 				     icmp_param->head_len, icmp_param->csum);
 
@@ -22,6 +22,7 @@
  */
 
 #include <linux/ip.h>
+#include <linux/udp.h>
 #include <net/checksum.h>
 #include <net/ip.h>
 
@@ -37,19 +38,28 @@ static u16          rt_ip_id_count = 0;
 
 /***
  *  Slow path for fragmented packets
+ *
+ *  When the socket pool can hold the whole datagram, all fragments are
+ *  built before the first one is sent, so that getfrag may complete the
+ *  transport header once it has seen the whole payload. Otherwise,
+ *  getfrag is first called with a NULL buffer to complete that header
+ *  in a separate pass, then each fragment is sent as soon as it is built.
  */
 int rt_ip_build_xmit_slow(struct rtsocket *sk,
 	int getfrag(const void *, char *, unsigned int, unsigned int),
 	const void *frag, unsigned length, struct dest_route *rt,
 	int msg_flags, unsigned int mtu, unsigned int prio)
 {
-    int             err, next_err;
+    int             err;
     struct rtskb    *skb;
-    struct rtskb    *next_skb;
+    struct rtskb    *first_skb = NULL;
+    struct rtskb    *last_skb = NULL;
     struct          iphdr *iph;
     struct          rtnet_device *rtdev = rt->rtdev;
     unsigned int    fragdatalen;
+    unsigned int    nfrags;
     unsigned int    offset = 0;
+    int             stream = 0;
     u16             msg_rt_ip_id;
     rtdm_lockctx_t  context;
     unsigned int    rtskb_size;
@@ -67,13 +77,13 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 
     rtskb_size = mtu + hh_len + 15;
 
-    /* TODO: delay previous skb until ALL errors are catched which may occure
-	     during next skb setup */
-
-    /* Preallocate first rtskb */
-    skb = alloc_rtskb(rtskb_size, &sk->skb_pool);
-    if (skb == NULL)
-	return -ENOBUFS;
+    nfrags = (length + fragdatalen - 1) / fragdatalen;
+    if (nfrags > rtskb_pool_avail(&sk->skb_pool)) {
+	err = getfrag(frag, NULL, 0, length);
+	if (err)
+	    return err;
+	stream = 1;
+    }
 
     for (offset = 0; offset < length; offset += fragdatalen)
     {
@@ -82,23 +92,28 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 	__u16 frag_off = offset >> 3 ;
 
 
-	next_err = 0;
+	skb = alloc_rtskb(rtskb_size, &sk->skb_pool);
+	if (skb == NULL) {
+	    err = -ENOBUFS;
+	    goto error;
+	}
+
+	skb->next = NULL;
+	if (last_skb != NULL)
+	    last_skb->next = skb;
+	else
+	    first_skb = skb;
+	last_skb = skb;
+
 	if (offset >= length - fragdatalen)
 	{
 	    /* last fragment */
 	    fraglen  = FRAGHEADERLEN + length - offset ;
-	    next_skb = NULL;
 	}
 	else
 	{
 	    fraglen = FRAGHEADERLEN + fragdatalen;
 	    frag_off |= IP_MF;
-
-	    next_skb = alloc_rtskb(rtskb_size, &sk->skb_pool);
-	    if (next_skb == NULL) {
-		frag_off &= ~IP_MF; /* cut the chain */
-		next_err = -ENOBUFS;
-	    }
 	}
 
 	rtskb_reserve(skb, hh_len);
@@ -131,26 +146,32 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 		goto error;
 	}
 
-	err = rtdev_xmit(skb);
+	if (stream) {
+	    first_skb = last_skb = NULL;
 
-	skb = next_skb;
+	    if (rtdev_xmit(skb) != 0)
+		return -EAGAIN;
+	}
+    }
 
-	if (err != 0) {
+    while (first_skb != NULL) {
+	skb = first_skb;
+	first_skb = skb->next;
+	skb->next = NULL;
+
+	if (rtdev_xmit(skb) != 0) {
 	    err = -EAGAIN;
 	    goto error;
 	}
-
-	if (next_err != 0)
-	    return next_err;
     }
+
     return 0;
 
   error:
-    if (skb != NULL) {
+    while (first_skb != NULL) {
+	skb = first_skb;
+	first_skb = skb->next;
 	kfree_rtskb(skb);
-
-	if (next_skb != NULL)
-	    kfree_rtskb(next_skb);
     }
     return err;
 }
@@ -223,6 +244,15 @@ int rt_ip_build_xmit(struct rtsocket *sk,
     iph->check    = 0; /* required! */
     iph->check    = ip_fast_csum((unsigned char *)iph, 5 /*iph->ihl*/);
 
+    /* Leave the UDP checksum to the device if it can compute it, the
+       getfrag handler then only seeds the pseudo-header sum. */
+    if ((sk->protocol == IPPROTO_UDP) &&
+	(rtdev->rt_features & RTNETIF_F_UDP_CSUM)) {
+	skb->ip_summed = CHECKSUM_PARTIAL;
+	skb->h.raw     = (unsigned char *)iph + 5 /*iph->ihl*/ * 4;
+	skb->csum      = offsetof(struct udphdr, check);
+    }
+
     if ( (err=getfrag(frag, ((char *)iph) + 5 /*iph->ihl*/ * 4, 0,
 		      length - 5 /*iph->ihl*/ * 4)) )
 	goto error;
@@ -23,6 +23,10 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 #include <net/ip.h>
 
 #include <rtnet_internal.h>
@@ -40,8 +44,10 @@
 
 /* First-level routing: explicite host routes */
 struct host_route {
-    struct host_route       *next;
+    struct host_route       *next[2];   /* chain, see host_hash.link */
+    struct host_route       *free_next;
     struct dest_route       dest_host;
+    u32                     local_ip;   /* of dest_host.rtdev when added */
 };
 
 /* Second-level routing: routes to other networks */
@@ -52,22 +58,58 @@ struct net_route {
     u32                     gw_ip;
 };
 
-#if (CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES & (CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES - 1))
-# error CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES must be power of 2
-#endif
-#if CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES < 256
-# define HOST_HASH_TBL_SIZE 64
-#else
-# define HOST_HASH_TBL_SIZE ((CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES / 256) * 64)
-#endif
-#define HOST_HASH_KEY_MASK  (HOST_HASH_TBL_SIZE-1)
+/***
+ *  Lookups
+ *
+ *  rt_ip_route_output() does not take any lock. Updates to the tables are
+ *  serialized by the table locks and bracketed by odd sequence counts, so
+ *  that lookups racing with them retry. Since a lookup may still walk
+ *  entries or a hash table which went away meanwhile, it also registers
+ *  in a per-CPU reader count, which rt_ip_route_sync_readers() waits for
+ *  before a retired hash table is freed, and before a device goes down.
+ *  Route entries themselves are never freed before the module goes away.
+ *
+ *  Each route has two chain links, so that a larger host hash table can be
+ *  filled in a few buckets at a time while lookups keep walking the
+ *  current one. Only publishing the new table needs a write section.
+ */
+struct host_hash {
+    unsigned int            size;       /* power of 2 */
+    unsigned int            link;       /* index of host_route.next[] */
+    struct host_route       *chain[0];
+};
+
+struct route_readers {
+    atomic_t                count[2];
+};
+
+#define HOST_HASH_INIT_SIZE 64
+#define HOST_HASH_GROW_BATCH 16     /* buckets moved per lock section */
 
-static struct host_route    host_routes[CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES];
+static unsigned int         nr_host_routes = CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES;
+static struct host_route    *host_routes;
 static struct host_route    *free_host_route;
 static int                  allocated_host_routes;
-static struct host_route    *host_hash_tbl[HOST_HASH_TBL_SIZE];
+static struct host_hash     *host_hash;
+static struct host_hash     *host_hash_next;        /* being filled */
+static unsigned int         host_hash_migrated;     /* buckets already in it */
+static unsigned int         host_table_seq;
+static int                  host_hash_grow_pending;
 static DEFINE_RTDM_LOCK(host_table_lock);
 
+module_param_named(host_routes, nr_host_routes, uint, 0444);
+MODULE_PARM_DESC(host_routes, "maximum number of host routes");
+
+static void rt_ip_route_grow_hash(struct work_struct *work);
+static DECLARE_WORK(host_hash_work, rt_ip_route_grow_hash);
+
+/* bumped on every change of a route, see struct dest_cache */
+static atomic_t             route_genid = ATOMIC_INIT(0);
+
+static DEFINE_PER_CPU(struct route_readers, route_readers);
+static unsigned int         route_readers_epoch;
+static DEFINE_MUTEX(route_sync_lock);
+
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
 #if (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES & (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES - 1))
 # error CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES must be power of 2
@@ -85,6 +127,7 @@ static struct net_route     *free_net_route;
 static int                  allocated_net_routes;
 static struct net_route     *net_hash_tbl[NET_HASH_TBL_SIZE + 1];
 static unsigned int         net_hash_key_shift = NET_HASH_KEY_SHIFT;
+static unsigned int         net_table_seq;
 static DEFINE_RTDM_LOCK(net_table_lock);
 
 module_param(net_hash_key_shift, uint, 0444);
@@ -94,21 +137,125 @@ MODULE_PARM_DESC(net_hash_key_shift, "destination right shift for "
 
 
 
+/***
+ *  rt_route_write_begin/end - bracket updates of a routing table
+ *
+ *  Note: must be called with the table lock held
+ */
+static inline void rt_route_write_begin(unsigned int *seq)
+{
+    (*seq)++;
+    smp_wmb();
+}
+
+static inline void rt_route_write_end(unsigned int *seq)
+{
+    smp_wmb();
+    (*seq)++;
+}
+
+static inline unsigned int rt_route_read_begin(unsigned int *seq)
+{
+    unsigned int ret;
+
+    while ((ret = ACCESS_ONCE(*seq)) & 1)
+	cpu_relax();
+    smp_rmb();
+
+    return ret;
+}
+
+static inline int rt_route_read_retry(unsigned int *seq, unsigned int start)
+{
+    smp_rmb();
+    return ACCESS_ONCE(*seq) != start;
+}
+
+
+
+/***
+ *  rt_route_read_lock/unlock - bracket a lookup
+ *
+ *  Note: the count is only shared with lookups running on the same CPU
+ */
+static inline atomic_t *rt_route_read_lock(void)
+{
+    unsigned int idx = ACCESS_ONCE(route_readers_epoch) & 1;
+    atomic_t *count;
+
+    count = &raw_cpu_ptr(&route_readers)->count[idx];
+    atomic_inc(count);
+    smp_mb__after_atomic();
+
+    return count;
+}
+
+static inline void rt_route_read_unlock(atomic_t *count)
+{
+    smp_mb__before_atomic();
+    atomic_dec(count);
+}
+
+
+
+/***
+ *  rt_ip_route_sync_readers - wait for lookups which may still see the
+ *  previous state of the tables
+ *
+ *  Both counts are drained in turn, new lookups moving to the other one
+ *  each time, so that lookups which picked a count late are caught too.
+ *
+ *  Note: must be called from non-real-time context
+ */
+void rt_ip_route_sync_readers(void)
+{
+    unsigned int    idx, round;
+    int             cpu, pending;
+
+
+    mutex_lock(&route_sync_lock);
+
+    for (round = 0; round < 2; round++) {
+	idx = route_readers_epoch & 1;
+	ACCESS_ONCE(route_readers_epoch) = route_readers_epoch + 1;
+	smp_mb();
+
+	for (;;) {
+	    pending = 0;
+	    for_each_possible_cpu(cpu)
+		pending += atomic_read(&per_cpu(route_readers, cpu).count[idx]);
+	    if (pending == 0)
+		break;
+	    msleep(1);
+	}
+    }
+
+    smp_mb();
+
+    mutex_unlock(&route_sync_lock);
+}
+
+
+
 /***
  *  proc filesystem section
  */
 #ifdef CONFIG_XENO_OPT_VFILE
 static int rtnet_ipv4_route_show(struct xnvfile_regular_iterator *it, void *d)
 {
+    rtdm_lockctx_t context;
+    unsigned int hash_size;
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
     u32 mask;
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
-    xnvfile_printf(it, "Host routes allocated/total:\t%d/%d\n"
-	    "Host hash table size:\t\t%d\n",
-	    allocated_host_routes,
-	    CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES,
-	    HOST_HASH_TBL_SIZE);
+    rtdm_lock_get_irqsave(&host_table_lock, context);
+    hash_size = host_hash->size;
+    rtdm_lock_put_irqrestore(&host_table_lock, context);
+
+    xnvfile_printf(it, "Host routes allocated/total:\t%d/%u\n"
+	    "Host hash table size:\t\t%u\n",
+	    allocated_host_routes, nr_host_routes, hash_size);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
     mask = NET_HASH_KEY_MASK << net_hash_key_shift;
@@ -201,8 +348,8 @@ static int rtnet_ipv4_host_route_rewind(struct xnvfile_snapshot_iterator *it)
     if (err < 0)
 	return err;
 
-    for (key = 0; key < HOST_HASH_TBL_SIZE; key++)
-	if ((entry_ptr = host_hash_tbl[key]))
+    for (key = 0; key < host_hash->size; key++)
+	if ((entry_ptr = host_hash->chain[key]))
 	    break;
 
     priv->key = key;
@@ -224,10 +371,10 @@ static int rtnet_ipv4_host_route_next(struct xnvfile_snapshot_iterator *it,
     struct rtnet_device *rtdev;
 
     if (priv->entry_ptr == NULL) {
-	if (++priv->key >= HOST_HASH_TBL_SIZE)
+	if (++priv->key >= host_hash->size)
 	    return 0;
 
-	priv->entry_ptr = host_hash_tbl[priv->key];
+	priv->entry_ptr = host_hash->chain[priv->key];
 	if (priv->entry_ptr == NULL)
 	    return VFILE_SEQ_SKIP;
     }
@@ -245,7 +392,7 @@ static int rtnet_ipv4_host_route_next(struct xnvfile_snapshot_iterator *it,
 
     memcpy(&p->dest_host, &priv->entry_ptr->dest_host, sizeof(p->dest_host));
 
-    priv->entry_ptr = priv->entry_ptr->next;
+    priv->entry_ptr = priv->entry_ptr->next[host_hash->link];
 
     return 1;
 }
@@ -491,7 +638,7 @@ static inline struct host_route *rt_alloc_host_route(void)
     rtdm_lock_get_irqsave(&host_table_lock, context);
 
     if ((rt = free_host_route) != NULL) {
-	free_host_route = rt->next;
+	free_host_route = rt->free_next;
 	allocated_host_routes++;
     }
 
@@ -509,13 +656,170 @@ static inline struct host_route *rt_alloc_host_route(void)
  */
 static inline void rt_free_host_route(struct host_route *rt)
 {
-    rt->next        = free_host_route;
+    rt->free_next   = free_host_route;
     free_host_route = rt;
     allocated_host_routes--;
 }
 
 
 
+/***
+ *  rt_alloc_host_hash - allocates empty host hash table
+ */
+static struct host_hash *rt_alloc_host_hash(unsigned int size,
+					    unsigned int link)
+{
+    struct host_hash    *tbl;
+
+
+    tbl = kzalloc(sizeof(*tbl) + size * sizeof(struct host_route *),
+		  GFP_KERNEL);
+    if (tbl) {
+	tbl->size = size;
+	tbl->link = link;
+    }
+
+    return tbl;
+}
+
+
+
+/***
+ *  rt_host_hash_link/unlink - adds/removes route to/from a hash chain
+ *
+ *  Note: must be called with host_table_lock held, within a write section
+ *        for the published table
+ */
+static inline void rt_host_hash_link(struct host_hash *tbl,
+				     struct host_route *rt)
+{
+    struct host_route   **bucket;
+
+
+    bucket = &tbl->chain[ntohl(rt->dest_host.ip) & (tbl->size-1)];
+    rt->next[tbl->link] = *bucket;
+    *bucket = rt;
+}
+
+static inline void rt_host_hash_unlink(struct host_hash *tbl,
+				       struct host_route *rt)
+{
+    struct host_route   **last_ptr;
+
+
+    last_ptr = &tbl->chain[ntohl(rt->dest_host.ip) & (tbl->size-1)];
+    while (*last_ptr != rt)
+	last_ptr = &(*last_ptr)->next[tbl->link];
+    *last_ptr = rt->next[tbl->link];
+}
+
+
+
+/***
+ *  rt_host_hash_mirror - returns the table being filled if it already
+ *  holds the bucket of addr, NULL otherwise
+ *
+ *  Note: must be called with host_table_lock held
+ */
+static inline struct host_hash *rt_host_hash_mirror(u32 addr)
+{
+    if ((host_hash_next != NULL) &&
+	((ntohl(addr) & (host_hash->size-1)) < host_hash_migrated))
+	return host_hash_next;
+
+    return NULL;
+}
+
+
+
+/***
+ *  rt_remove_host_route - unlinks and releases host route
+ *
+ *  Note: must be called with host_table_lock held
+ */
+static void rt_remove_host_route(struct host_route *rt)
+{
+    struct host_hash    *mirror = rt_host_hash_mirror(rt->dest_host.ip);
+
+
+    rt_route_write_begin(&host_table_seq);
+    rt_host_hash_unlink(host_hash, rt);
+    if (mirror)
+	rt_host_hash_unlink(mirror, rt);
+    rt_free_host_route(rt);
+    atomic_inc(&route_genid);
+    rt_route_write_end(&host_table_seq);
+
+    xnvfile_touch_tag(&host_route_tag);
+}
+
+
+
+/***
+ *  rt_ip_route_grow_hash - doubles the host hash table
+ *
+ *  Scheduled by rt_ip_route_add_host() as soon as chains get longer than 2
+ *  entries on average. Routes are linked into the new table a few buckets
+ *  at a time, updates meanwhile go to both tables.
+ */
+static void rt_ip_route_grow_hash(struct work_struct *work)
+{
+    rtdm_lockctx_t      context;
+    struct host_hash    *old = NULL;
+    struct host_hash    *tbl;
+    struct host_route   *rt;
+    unsigned int        key;
+    unsigned int        n;
+
+
+    /* only this work replaces the table */
+    tbl = rt_alloc_host_hash(host_hash->size * 2, !host_hash->link);
+
+    /* if we cannot grow, longer chains are no big deal */
+    for (key = 0; tbl != NULL; ) {
+	rtdm_lock_get_irqsave(&host_table_lock, context);
+
+	host_hash_next = tbl;
+
+	for (n = 0; (n < HOST_HASH_GROW_BATCH) && (key < host_hash->size);
+	     n++, key++) {
+	    for (rt = host_hash->chain[key]; rt != NULL;
+		 rt = rt->next[host_hash->link])
+		rt_host_hash_link(tbl, rt);
+	    host_hash_migrated = key + 1;
+	}
+
+	if (key >= host_hash->size) {
+	    old = host_hash;
+
+	    rt_route_write_begin(&host_table_seq);
+	    host_hash = tbl;
+	    rt_route_write_end(&host_table_seq);
+
+	    host_hash_next     = NULL;
+	    host_hash_migrated = 0;
+
+	    xnvfile_touch_tag(&host_route_tag);
+
+	    tbl = NULL;
+	}
+
+	rtdm_lock_put_irqrestore(&host_table_lock, context);
+    }
+
+    /* lookups may still walk the old links, keep them until done */
+    if (old) {
+	rt_ip_route_sync_readers();
+	kfree(old);
+    }
+
+    rtdm_lock_get_irqsave(&host_table_lock, context);
+    host_hash_grow_pending = 0;
+    rtdm_lock_put_irqrestore(&host_table_lock, context);
+}
+
+
+
 /***
  *  rt_ip_route_add_host: add or update host route
  */
@@ -525,7 +829,8 @@ int rt_ip_route_add_host(u32 addr, unsigned char *dev_addr,
     rtdm_lockctx_t      context;
     struct host_route   *new_route;
     struct host_route   *rt;
-    unsigned int        key;
+    struct host_hash    *mirror;
+    int                 grow = 0;
     int                 ret = 0;
 
 
@@ -542,21 +847,27 @@ int rt_ip_route_add_host(u32 addr, unsigned char *dev_addr,
     if ((new_route = rt_alloc_host_route()) != NULL) {
 	new_route->dest_host.ip    = addr;
 	new_route->dest_host.rtdev = rtdev;
+	new_route->local_ip        = rtdev->local_ip;
 	memcpy(new_route->dest_host.dev_addr, dev_addr, rtdev->addr_len);
     }
 
-    key = ntohl(addr) & HOST_HASH_KEY_MASK;
-
     rtdm_lock_get_irqsave(&host_table_lock, context);
 
-    xnvfile_touch_tag(&host_route_tag);
-
-    rt = host_hash_tbl[key];
+    rt = host_hash->chain[ntohl(addr) & (host_hash->size-1)];
     while (rt != NULL) {
 	if ((rt->dest_host.ip == addr) &&
-	    (rt->dest_host.rtdev->local_ip == rtdev->local_ip)) {
-	    rt->dest_host.rtdev = rtdev;
-	    memcpy(rt->dest_host.dev_addr, dev_addr, rtdev->addr_len);
+	    (rt->local_ip == rtdev->local_ip)) {
+	    /* ARP refreshes usually confirm what we know already */
+	    if ((rt->dest_host.rtdev != rtdev) ||
+		memcmp(rt->dest_host.dev_addr, dev_addr, rtdev->addr_len)) {
+		rt_route_write_begin(&host_table_seq);
+		rt->dest_host.rtdev = rtdev;
+		memcpy(rt->dest_host.dev_addr, dev_addr, rtdev->addr_len);
+		atomic_inc(&route_genid);
+		rt_route_write_end(&host_table_seq);
+
+		xnvfile_touch_tag(&host_route_tag);
+	    }
 
 	    if (new_route)
 		rt_free_host_route(new_route);
@@ -566,14 +877,29 @@ int rt_ip_route_add_host(u32 addr, unsigned char *dev_addr,
 	    goto out;
 	}
 
-	rt = rt->next;
+	rt = rt->next[host_hash->link];
     }
 
     if (new_route) {
-	new_route->next    = host_hash_tbl[key];
-	host_hash_tbl[key] = new_route;
+	mirror = rt_host_hash_mirror(addr);
+
+	rt_route_write_begin(&host_table_seq);
+	rt_host_hash_link(host_hash, new_route);
+	if (mirror)
+	    rt_host_hash_link(mirror, new_route);
+	atomic_inc(&route_genid);
+	rt_route_write_end(&host_table_seq);
+
+	xnvfile_touch_tag(&host_route_tag);
+
+	if ((allocated_host_routes > 2 * host_hash->size) &&
+	    !host_hash_grow_pending)
+	    grow = host_hash_grow_pending = 1;
 
 	rtdm_lock_put_irqrestore(&host_table_lock, context);
+
+	if (grow)
+	    rtdm_schedule_nrt_work(&host_hash_work);
     } else {
 	rtdm_lock_put_irqrestore(&host_table_lock, context);
 
@@ -596,32 +922,22 @@ int rt_ip_route_del_host(u32 addr, struct rtnet_device *rtdev)
 {
     rtdm_lockctx_t      context;
     struct host_route   *rt;
-    struct host_route   **last_ptr;
-    unsigned int        key;
-
 
-    key = ntohl(addr) & HOST_HASH_KEY_MASK;
-    last_ptr = &host_hash_tbl[key];
 
     rtdm_lock_get_irqsave(&host_table_lock, context);
 
-    rt = host_hash_tbl[key];
+    rt = host_hash->chain[ntohl(addr) & (host_hash->size-1)];
     while (rt != NULL) {
 	if ((rt->dest_host.ip == addr) &&
-	    (!rtdev || (rt->dest_host.rtdev->local_ip == rtdev->local_ip))) {
-	    *last_ptr = rt->next;
-
-	    rt_free_host_route(rt);
-
-	    xnvfile_touch_tag(&host_route_tag);
+	    (!rtdev || (rt->local_ip == rtdev->local_ip))) {
+	    rt_remove_host_route(rt);
 
 	    rtdm_lock_put_irqrestore(&host_table_lock, context);
 
 	    return 0;
 	}
 
-	last_ptr = &rt->next;
-	rt = rt->next;
+	rt = rt->next[host_hash->link];
     }
 
     rtdm_lock_put_irqrestore(&host_table_lock, context);
@@ -633,38 +949,47 @@ int rt_ip_route_del_host(u32 addr, struct rtnet_device *rtdev)
 
 /***
  *  rt_ip_route_del_all - deletes all routes associated with a specified device
+ *
+ *  Note: may be called from real-time context, the caller releasing the
+ *        device has to call rt_ip_route_sync_readers() afterwards
  */
 void rt_ip_route_del_all(struct rtnet_device *rtdev)
 {
     rtdm_lockctx_t      context;
+    struct host_hash    *tbl = NULL;
     struct host_route   *host_rt;
-    struct host_route   **last_host_ptr;
-    unsigned int        key;
+    unsigned int        key = 0;
     u32                 ip;
 
 
-    for (key = 0; key < HOST_HASH_TBL_SIZE; key++) {
-      host_start_over:
-	last_host_ptr = &host_hash_tbl[key];
-
+    for (;;) {
 	rtdm_lock_get_irqsave(&host_table_lock, context);
 
-	host_rt = host_hash_tbl[key];
-	while (host_rt != NULL) {
-	    if (host_rt->dest_host.rtdev == rtdev) {
-		*last_host_ptr = host_rt->next;
-
-		rt_free_host_route(host_rt);
+	/* start over if the hash table grew meanwhile */
+	if (tbl != host_hash) {
+	    tbl = host_hash;
+	    key = 0;
+	}
 
-		rtdm_lock_put_irqrestore(&host_table_lock, context);
+	if (key >= tbl->size) {
+	    rtdm_lock_put_irqrestore(&host_table_lock, context);
+	    break;
+	}
 
-		goto host_start_over;
+	host_rt = tbl->chain[key];
+	while (host_rt != NULL) {
+	    if (host_rt->dest_host.rtdev == rtdev) {
+		rt_remove_host_route(host_rt);
+		break;
 	    }
 
-	    last_host_ptr = &host_rt->next;
-	    host_rt = host_rt->next;
+	    host_rt = host_rt->next[tbl->link];
 	}
 
+	/* one route at a time, stay on this bucket until it is clean */
+	if (host_rt == NULL)
+	    key++;
+
 	rtdm_lock_put_irqrestore(&host_table_lock, context);
     }
 
@@ -673,6 +998,7 @@ void rt_ip_route_del_all(struct rtnet_device *rtdev)
 }
 
 
+
 /***
  *  rt_ip_route_get_host - check if specified host route is resolved
  */
@@ -681,17 +1007,14 @@ int rt_ip_route_get_host(u32 addr, char *if_name, unsigned char *dev_addr,
 {
     rtdm_lockctx_t      context;
     struct host_route   *rt;
-    unsigned int        key;
 
 
-    key = ntohl(addr) & HOST_HASH_KEY_MASK;
-
     rtdm_lock_get_irqsave(&host_table_lock, context);
 
-    rt = host_hash_tbl[key];
+    rt = host_hash->chain[ntohl(addr) & (host_hash->size-1)];
     while (rt != NULL) {
 	if ((rt->dest_host.ip == addr) &&
-	    (!rtdev || rt->dest_host.rtdev->local_ip == rtdev->local_ip)) {
+	    (!rtdev || rt->local_ip == rtdev->local_ip)) {
 	    memcpy(dev_addr, rt->dest_host.dev_addr,
 		   rt->dest_host.rtdev->addr_len);
 	    strncpy(if_name, rt->dest_host.rtdev->name, IFNAMSIZ);
@@ -700,7 +1023,7 @@ int rt_ip_route_get_host(u32 addr, char *if_name, unsigned char *dev_addr,
 	    return 0;
 	}
 
-	rt = rt->next;
+	rt = rt->next[host_hash->link];
     }
 
     rtdm_lock_put_irqrestore(&host_table_lock, context);
@@ -742,7 +1065,7 @@ static inline void rt_free_net_route(struct net_route *rt)
 {
     rt->next       = free_net_route;
     free_net_route = rt;
-    allocated_host_routes--;
+    allocated_net_routes--;
 }
 
 
@@ -782,7 +1105,10 @@ int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
     rt = net_hash_tbl[key];
     while (rt != NULL) {
 	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
+	    rt_route_write_begin(&net_table_seq);
 	    rt->gw_ip = gw_addr;
+	    atomic_inc(&route_genid);
+	    rt_route_write_end(&net_table_seq);
 
 	    if (new_route)
 		rt_free_net_route(new_route);
@@ -797,8 +1123,11 @@ int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
     }
 
     if (new_route) {
+	rt_route_write_begin(&net_table_seq);
 	new_route->next = *last_ptr;
 	*last_ptr       = new_route;
+	atomic_inc(&route_genid);
+	rt_route_write_end(&net_table_seq);
 
 	rtdm_lock_put_irqrestore(&net_table_lock, context);
 
@@ -839,9 +1168,11 @@ int rt_ip_route_del_net(u32 addr, u32 mask)
     rt = net_hash_tbl[key];
     while (rt != NULL) {
 	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
+	    rt_route_write_begin(&net_table_seq);
 	    *last_ptr = rt->next;
-
 	    rt_free_net_route(rt);
+	    atomic_inc(&route_genid);
+	    rt_route_write_end(&net_table_seq);
 
 	    xnvfile_touch_tag(&net_route_tag);
 
@@ -862,16 +1193,49 @@ int rt_ip_route_del_net(u32 addr, u32 mask)
 
 
 
+#ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
 /***
- *  rt_ip_route_output - looks up output route
+ *  rt_ip_route_find_net - looks up network route in a hash chain
  *
- *  Note: increments refcount on returned rtdev in rt_buf
+ *  Note: must be called within a net_table_seq read section
  */
-int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
+static inline struct net_route *rt_ip_route_find_net(struct net_route *net_rt,
+						     u32 daddr)
 {
-    rtdm_lockctx_t      context;
+    unsigned int        n;
+
+
+    /* chains may be rearranged under our feet, bound the walk */
+    for (n = 0; (net_rt != NULL) &&
+	     (n < CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES); n++) {
+	if (net_rt->dest_net_ip == (daddr & net_rt->dest_net_mask))
+	    return net_rt;
+
+	net_rt = ACCESS_ONCE(net_rt->next);
+    }
+
+    return NULL;
+}
+#endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
+
+
+
+/***
+ *  __rt_ip_route_output - looks up output route
+ *
+ *  Note: must be called within rt_route_read_lock/unlock,
+ *        increments refcount on returned rtdev in rt_buf
+ */
+static int __rt_ip_route_output(struct dest_route *rt_buf, u32 daddr,
+				u32 saddr)
+{
+    struct host_hash    *tbl;
     struct host_route   *host_rt;
-    unsigned int        key;
+    struct rtnet_device *rtdev;
+    unsigned int        seq;
+    unsigned int        n;
+    unsigned int        match;
+    unsigned int        skip;
 
 #ifndef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
     #define DADDR       daddr
@@ -879,96 +1243,146 @@ int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
     #define DADDR       real_daddr
 
     struct net_route    *net_rt;
+    unsigned int        key;
     int                 lookup_gw  = 1;
     u32                 real_daddr = daddr;
+    u32                 gw_ip      = 0;
 
 
   restart:
 #endif /* !CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
-    key = ntohl(daddr) & HOST_HASH_KEY_MASK;
-
-    rtdm_lock_get_irqsave(&host_table_lock, context);
-
-    host_rt = host_hash_tbl[key];
-    if (likely(saddr == INADDR_ANY))
-	while (host_rt != NULL) {
-	    if (host_rt->dest_host.ip == daddr) {
-	      host_route_found:
-		if (!rtdev_reference(host_rt->dest_host.rtdev)) {
-		    rtdm_lock_put_irqrestore(&host_table_lock, context);
-		    goto next;
+    /* skip routes over devices going down, there may be other ones */
+    for (skip = 0;; skip++) {
+	do {
+	    seq = rt_route_read_begin(&host_table_seq);
+
+	    tbl     = ACCESS_ONCE(host_hash);
+	    host_rt = ACCESS_ONCE(tbl->chain[ntohl(daddr) & (tbl->size-1)]);
+	    rtdev   = NULL;
+	    match   = 0;
+
+	    /* chains may be rearranged under our feet, bound the walk */
+	    for (n = 0; (host_rt != NULL) && (n < nr_host_routes); n++) {
+		if ((host_rt->dest_host.ip == daddr) &&
+		    ((saddr == INADDR_ANY) || (host_rt->local_ip == saddr)) &&
+		    (match++ == skip)) {
+		    rtdev = host_rt->dest_host.rtdev;
+		    memcpy(rt_buf->dev_addr, &host_rt->dest_host.dev_addr,
+			   sizeof(rt_buf->dev_addr));
+		    break;
 		}
 
-		memcpy(rt_buf->dev_addr, &host_rt->dest_host.dev_addr,
-		       sizeof(rt_buf->dev_addr));
-		rt_buf->rtdev = host_rt->dest_host.rtdev;
+		host_rt = ACCESS_ONCE(host_rt->next[tbl->link]);
+	    }
+	} while (rt_route_read_retry(&host_table_seq, seq));
 
-		rtdm_lock_put_irqrestore(&host_table_lock, context);
+	if (rtdev == NULL)
+	    break;
 
-		rt_buf->ip = DADDR;
+	if (rtdev_reference(rtdev)) {
+	    rt_buf->rtdev = rtdev;
+	    rt_buf->ip    = DADDR;
 
-		return 0;
-	    }
-	  next:
-	    host_rt = host_rt->next;
-	}
-    else
-	while (host_rt != NULL) {
-	    if ((host_rt->dest_host.ip == daddr) &&
-		(host_rt->dest_host.rtdev->local_ip == saddr))
-		goto host_route_found;
-	    host_rt = host_rt->next;
+	    return 0;
 	}
-
-    rtdm_lock_put_irqrestore(&host_table_lock, context);
+    }
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
     if (lookup_gw) {
 	lookup_gw = 0;
 	key = (ntohl(daddr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
 
-	rtdm_lock_get_irqsave(&net_table_lock, context);
+	do {
+	    seq = rt_route_read_begin(&net_table_seq);
 
-	net_rt = net_hash_tbl[key];
-	while (net_rt != NULL) {
-	    if (net_rt->dest_net_ip == (daddr & net_rt->dest_net_mask)) {
-		daddr = net_rt->gw_ip;
+	    net_rt = rt_ip_route_find_net(ACCESS_ONCE(net_hash_tbl[key]),
+					  daddr);
 
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
+	    /* last try: no hash key */
+	    if (net_rt == NULL)
+		net_rt = rt_ip_route_find_net(
+		    ACCESS_ONCE(net_hash_tbl[NET_HASH_TBL_SIZE]), daddr);
 
-		/* start over, now using the gateway ip as destination */
-		goto restart;
-	    }
+	    if (net_rt != NULL)
+		gw_ip = net_rt->gw_ip;
+	} while (rt_route_read_retry(&net_table_seq, seq));
 
-	    net_rt = net_rt->next;
+	if (net_rt != NULL) {
+	    /* start over, now using the gateway ip as destination */
+	    daddr = gw_ip;
+	    goto restart;
 	}
+    }
+#endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+    /*ERRMSG*/rtdm_printk("RTnet: host %u.%u.%u.%u unreachable\n", NIPQUAD(daddr));
+    return -EHOSTUNREACH;
+}
 
-	/* last try: no hash key */
-	rtdm_lock_get_irqsave(&net_table_lock, context);
 
-	net_rt = net_hash_tbl[NET_HASH_TBL_SIZE];
-	while (net_rt != NULL) {
-	    if (net_rt->dest_net_ip == (daddr & net_rt->dest_net_mask)) {
-		daddr = net_rt->gw_ip;
 
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
+/***
+ *  rt_ip_route_output - looks up output route
+ *
+ *  Note: increments refcount on returned rtdev in rt_buf
+ */
+int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
+{
+    atomic_t            *readers;
+    int                 ret;
 
-		/* start over, now using the gateway ip as destination */
-		goto restart;
-	    }
 
-	    net_rt = net_rt->next;
-	}
+    readers = rt_route_read_lock();
+    ret = __rt_ip_route_output(rt_buf, daddr, saddr);
+    rt_route_read_unlock(readers);
 
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+    return ret;
+}
+
+
+
+/***
+ *  rt_ip_route_output_cached - looks up output route, unless the cached
+ *  one is still valid
+ *
+ *  Note: increments refcount on returned rtdev in rt_buf, the caller
+ *        serializes accesses to the cache
+ */
+int rt_ip_route_output_cached(struct dest_route *rt_buf,
+			      struct dest_cache *cache, u32 daddr, u32 saddr)
+{
+    atomic_t            *readers;
+    unsigned int        genid;
+    int                 ret;
+
+
+    readers = rt_route_read_lock();
+
+    /* the device of a valid cache entry cannot leave before we unlock */
+    genid = atomic_read(&route_genid);
+    smp_rmb();
+
+    if ((cache->dest.rtdev != NULL) && (cache->genid == genid) &&
+	(cache->daddr == daddr) && (cache->saddr == saddr) &&
+	rtdev_reference(cache->dest.rtdev)) {
+	*rt_buf = cache->dest;
+	rt_route_read_unlock(readers);
+
+	return 0;
     }
-#endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
-    /*ERRMSG*/rtdm_printk("RTnet: host %u.%u.%u.%u unreachable\n", NIPQUAD(daddr));
-    return -EHOSTUNREACH;
+    ret = __rt_ip_route_output(rt_buf, daddr, saddr);
+    if (ret == 0) {
+	cache->dest  = *rt_buf;
+	cache->daddr = daddr;
+	cache->saddr = saddr;
+	cache->genid = genid;
+    }
+
+    rt_route_read_unlock(readers);
+
+    return ret;
 }
 
 
@@ -1020,11 +1434,23 @@ int rt_ip_route_forward(struct rtskb *rtskb, u32 daddr)
  */
 int __init rt_ip_routing_init(void)
 {
-    int i;
+    int             i;
+    int             ret;
 
 
-    for (i = 0; i < CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES-2; i++)
-	host_routes[i].next = &host_routes[i+1];
+    if (nr_host_routes == 0)
+	return -EINVAL;
+
+    host_routes = kcalloc(nr_host_routes, sizeof(struct host_route),
+			  GFP_KERNEL);
+    host_hash = rt_alloc_host_hash(HOST_HASH_INIT_SIZE, 0);
+    if (!host_routes || !host_hash) {
+	ret = -ENOMEM;
+	goto err_out;
+    }
+
+    for (i = 0; i < (int)nr_host_routes-1; i++)
+	host_routes[i].free_next = &host_routes[i+1];
     free_host_route = &host_routes[0];
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
@@ -1034,10 +1460,17 @@ int __init rt_ip_routing_init(void)
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 #ifdef CONFIG_XENO_OPT_VFILE
-    return rt_route_proc_register();
-#else /* !CONFIG_XENO_OPT_VFILE */
-    return 0;
+    ret = rt_route_proc_register();
+    if (ret < 0)
+	goto err_out;
 #endif /* CONFIG_XENO_OPT_VFILE */
+
+    return 0;
+
+  err_out:
+    kfree(host_hash);
+    kfree(host_routes);
+    return ret;
 }
 
 
@@ -1050,10 +1483,17 @@ void rt_ip_routing_release(void)
 #ifdef CONFIG_XENO_OPT_VFILE
     rt_route_proc_unregister();
 #endif /* CONFIG_XENO_OPT_VFILE */
+
+    flush_work(&host_hash_work);
+
+    kfree(host_hash);
+    kfree(host_routes);
 }
 
 
 EXPORT_SYMBOL_GPL(rt_ip_route_add_host);
 EXPORT_SYMBOL_GPL(rt_ip_route_del_host);
 EXPORT_SYMBOL_GPL(rt_ip_route_del_all);
+EXPORT_SYMBOL_GPL(rt_ip_route_sync_readers);
 EXPORT_SYMBOL_GPL(rt_ip_route_output);
+EXPORT_SYMBOL_GPL(rt_ip_route_output_cached);
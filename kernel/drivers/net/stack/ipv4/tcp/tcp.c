@@ -833,7 +833,8 @@ static struct rtsocket *rt_tcp_dest_socket(struct rtskb *skb)
 	  rtdm_printk("Not found addr:0x%08x, port: 0x%04x\n", daddr, dport);
 	*/
 	if (!th->rst) {
-	    /* No listening socket found, send RST|ACK */
+	    /* No listening socket found, send RST|ACK. rst_socket is
+	       shared, TCP is only delivered by a single stack manager. */
 	    rst_socket.saddr = daddr;
 	    rst_socket.daddr = saddr;
 	    rst_socket.sport = dport;
@@ -1065,7 +1066,8 @@ static void rt_tcp_rcv(struct rtskb *skb)
 	    /* The socket shall be in TCP_LISTEN state */
 
 	    /* safe to update ts->saddr here due to a single task for
-	       rt_tcp_rcv() and rt_tcp_dest_socket() callers */
+	       rt_tcp_rcv() and rt_tcp_dest_socket() callers, all TCP
+	       packets go to the same stack manager (see rt_stack_steer()) */
 	    ts->saddr = skb->nh.iph->daddr;
 
 	    ts->daddr = skb->nh.iph->saddr;
@@ -56,6 +56,10 @@ struct udp_socket {
     struct hlist_node link;
 };
 
+/* Longest iovec for which the checksum is verified while copying, longer
+   ones are checked in a separate pass. */
+#define RT_UDP_CSUM_IOVLEN      8
+
 /***
  *  Automatic port number assignment
 
@@ -274,6 +278,7 @@ int rt_udp_socket(struct rtdm_fd *fd)
     sock->prot.inet.saddr = INADDR_ANY;
     sock->prot.inet.state = TCP_CLOSE;
     sock->prot.inet.tos   = 0;
+    rt_ip_route_cache_init(&sock->prot.inet.dst);
 
     rtdm_lock_get_irqsave(&udp_socket_base_lock, context);
 
@@ -369,6 +374,29 @@ int rt_udp_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 
 
 
+/***
+ *  rt_udp_csum_ok - verify the checksum of a datagram without copying it
+ */
+static int rt_udp_csum_ok(struct rtskb *skb, size_t data_len,
+                          unsigned int csum)
+{
+    unsigned int    pos = 0;
+    size_t          block_size;
+
+
+    do {
+        block_size = min_t(size_t, skb->len, data_len - pos);
+        csum = csum_block_add(csum, csum_partial(skb->data, block_size, 0),
+                              pos);
+        pos += block_size;
+        skb = skb->next;
+    } while ((skb != NULL) && (pos < data_len));
+
+    return csum_fold(csum) == 0;
+}
+
+
+
 /***
  *  rt_udp_recvmsg
  */
@@ -378,12 +406,15 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
     size_t              len   = rt_iovec_len(msg->msg_iov, msg->msg_iovlen);
     struct rtskb        *skb;
     struct rtskb        *first_skb;
-    size_t              copied = 0;
+    size_t              copied;
     size_t              block_size;
     size_t              data_len;
     struct udphdr       *uh;
     struct sockaddr_in  *sin;
     nanosecs_rel_t      timeout = sock->timeout;
+    struct iovec        iov[RT_UDP_CSUM_IOVLEN];
+    unsigned int        csum = 0;
+    int                 csum_copy;
     int                 ret;
 
 
@@ -391,6 +422,7 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
     if (msg_flags & MSG_DONTWAIT)
         timeout = -1;
 
+  again:
     ret = rtdm_sem_timeddown(&sock->pending_sem, timeout, NULL);
     if (unlikely(ret < 0))
         switch (ret) {
@@ -408,6 +440,26 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
 
     uh = skb->h.uh;
     data_len = ntohs(uh->len) - sizeof(struct udphdr);
+
+    /* remove the UDP header */
+    __rtskb_pull(skb, sizeof(struct udphdr));
+
+    /* Verify the checksum while copying the data, unless the datagram is
+       truncated or the iovec is too long to be rewound on error. */
+    csum_copy = 0;
+    if (skb->ip_summed != CHECKSUM_UNNECESSARY) {
+        csum = csum_partial((unsigned char *)uh, sizeof(struct udphdr),
+                            skb->csum);
+
+        if ((data_len > len) || (msg->msg_iovlen > RT_UDP_CSUM_IOVLEN)) {
+            if (!rt_udp_csum_ok(skb, data_len, csum))
+                goto csum_error;
+        } else {
+            memcpy(iov, msg->msg_iov, msg->msg_iovlen * sizeof(*iov));
+            csum_copy = 1;
+        }
+    }
+
     sin = msg->msg_name;
 
     /* copy the address */
@@ -418,22 +470,19 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
         sin->sin_addr.s_addr = skb->nh.iph->saddr;
     }
 
-    /* remove the UDP header */
-    __rtskb_pull(skb, sizeof(struct udphdr));
-
     first_skb = skb;
+    copied = 0;
 
     /* iterate over all IP fragments */
     do {
         rtskb_trim(skb, data_len);
 
         block_size = skb->len;
-        copied += block_size;
         data_len -= block_size;
 
         /* The data must not be longer than the available buffer size */
-        if (copied > len) {
-            block_size -= copied - len;
+        if (copied + block_size > len) {
+            block_size = len - copied;
             copied = len;
             msg->msg_flags |= MSG_TRUNC;
 
@@ -444,12 +493,26 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
         }
 
         /* copy the data */
-        rt_memcpy_tokerneliovec(msg->msg_iov, skb->data, block_size);
+        if (csum_copy)
+            csum = rt_memcpy_tokerneliovec_csum(msg->msg_iov, skb->data,
+                                                block_size, csum, copied);
+        else
+            rt_memcpy_tokerneliovec(msg->msg_iov, skb->data, block_size);
+        copied += block_size;
 
         /* next fragment */
         skb = skb->next;
     } while (skb != NULL);
 
+    if (csum_copy) {
+        if (csum_fold(csum) != 0) {
+            /* rewind the iovec, the user buffer is garbage */
+            memcpy(msg->msg_iov, iov, msg->msg_iovlen * sizeof(*iov));
+            skb = first_skb;
+            goto csum_error;
+        }
+    }
+
     /* did we copied all bytes? */
     if (data_len > 0)
         msg->msg_flags |= MSG_TRUNC;
@@ -457,12 +520,18 @@ ssize_t rt_udp_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
     if ((msg_flags & MSG_PEEK) == 0)
         kfree_rtskb(first_skb);
     else {
+        /* checked once, no need to do it again */
+        first_skb->ip_summed = CHECKSUM_UNNECESSARY;
         __rtskb_push(first_skb, sizeof(struct udphdr));
         rtskb_queue_head(&sock->incoming, first_skb);
         rtdm_sem_up(&sock->pending_sem);
     }
 
     return copied;
+
+  csum_error:
+    kfree_rtskb(skb);
+    goto again;
 }
 
 
@@ -478,46 +547,93 @@ struct udpfakehdr
     struct iovec *iov;
     int iovlen;
     u32 wcheck;
+    struct udphdr *uhp;     /* header location in the first fragment */
+    int offload;            /* device may compute the checksum */
+    int presummed;          /* checksum computed ahead of the copy */
 };
 
 
 
 /***
+ *  rt_udp_set_check - fill in the checksum once the payload sum is known
+ */
+static void rt_udp_set_check(struct udpfakehdr *ufh, unsigned int ulen)
+{
+    /* Checksum of the udp header: */
+    ufh->wcheck = csum_partial((unsigned char *)ufh,
+                               sizeof(struct udphdr), ufh->wcheck);
+
+    ufh->uh.check = csum_tcpudp_magic(ufh->saddr, ufh->daddr, ulen,
+                                      IPPROTO_UDP, ufh->wcheck);
+
+    if (ufh->uh.check == 0)
+        ufh->uh.check = -1;
+}
+
+
+
+/***
+ *  rt_udp_getfrag - copy a fragment of the payload
  *
+ *  The payload is checksummed while being copied. The IP layer normally
+ *  builds all fragments before sending any of them, so the header of the
+ *  first fragment is only filled in once the last one has been copied.
+ *  If the socket pool is too small for that, the IP layer passes a NULL
+ *  buffer first, and the checksum is computed ahead of the copy.
  */
 static int rt_udp_getfrag(const void *p, unsigned char *to,
                           unsigned int offset, unsigned int fraglen)
 {
     struct udpfakehdr *ufh = (struct udpfakehdr *)p;
-    int i;
-
+    unsigned int ulen = ntohs(ufh->uh.len);
+    unsigned int end = offset + fraglen;
+    unsigned int pos;
 
-    // We should optimize this function a bit (copy+csum...)!
-    if (offset==0) {
-        /* Checksum of the complete data part of the UDP message: */
-        for (i = 0; i < ufh->iovlen; i++) {
-            ufh->wcheck = csum_partial(ufh->iov[i].iov_base, ufh->iov[i].iov_len,
-                                       ufh->wcheck);
-        }
 
-        rt_memcpy_fromkerneliovec(to + sizeof(struct udphdr), ufh->iov,
-                                  fraglen - sizeof(struct udphdr));
+    if (to == NULL) {
+        ufh->offload = 0;
+        ufh->wcheck = rt_csum_kerneliovec(ufh->iov,
+                                          ulen - sizeof(struct udphdr), 0);
+        rt_udp_set_check(ufh, ulen);
+        ufh->presummed = 1;
+        return 0;
+    }
 
-        /* Checksum of the udp header: */
-        ufh->wcheck = csum_partial((unsigned char *)ufh,
-                                   sizeof(struct udphdr), ufh->wcheck);
+    if (offset == 0) {
+        ufh->uhp = (struct udphdr *)to;
+        to += sizeof(struct udphdr);
+        fraglen -= sizeof(struct udphdr);
+        pos = 0;
 
-        ufh->uh.check = csum_tcpudp_magic(ufh->saddr, ufh->daddr, ntohs(ufh->uh.len),
-                                          IPPROTO_UDP, ufh->wcheck);
+        /* the device can only checksum unfragmented datagrams */
+        if (end != ulen)
+            ufh->offload = 0;
+    } else
+        pos = offset - sizeof(struct udphdr);
 
-        if (ufh->uh.check == 0)
-            ufh->uh.check = -1;
+    if (ufh->offload || ufh->presummed)
+        rt_memcpy_fromkerneliovec(to, ufh->iov, fraglen);
+    else
+        ufh->wcheck = rt_memcpy_fromkerneliovec_csum(to, ufh->iov, fraglen,
+                                                     ufh->wcheck, pos);
 
-        memcpy(to, ufh, sizeof(struct udphdr));
+    if (ufh->presummed) {
+        if (offset == 0)
+            memcpy(ufh->uhp, ufh, sizeof(struct udphdr));
         return 0;
     }
 
-    rt_memcpy_fromkerneliovec(to, ufh->iov, fraglen);
+    if (end < ulen)
+        return 0;
+
+    if (ufh->offload)
+        /* seed the pseudo-header sum, the device adds the rest */
+        ufh->uh.check = ~csum_tcpudp_magic(ufh->saddr, ufh->daddr, ulen,
+                                           IPPROTO_UDP, 0);
+    else
+        rt_udp_set_check(ufh, ulen);
+
+    memcpy(ufh->uhp, ufh, sizeof(struct udphdr));
 
     return 0;
 }
@@ -578,8 +694,10 @@ ssize_t rt_udp_sendmsg(struct rtdm_fd *fd, const struct msghdr *msg, int msg_fla
     if ((daddr | dport) == 0)
         return -EINVAL;
 
-    /* get output route */
-    err = rt_ip_route_output(&rt, daddr, saddr);
+    /* get output route, most likely the one used last time */
+    rtdm_lock_get_irqsave(&sock->param_lock, context);
+    err = rt_ip_route_output_cached(&rt, &sock->prot.inet.dst, daddr, saddr);
+    rtdm_lock_put_irqrestore(&sock->param_lock, context);
     if (err)
         return err;
 
@@ -592,6 +710,8 @@ ssize_t rt_udp_sendmsg(struct rtdm_fd *fd, const struct msghdr *msg, int msg_fla
     ufh.iov       = msg->msg_iov;
     ufh.iovlen    = msg->msg_iovlen;
     ufh.wcheck    = 0;
+    ufh.offload   = (rt.rtdev->rt_features & RTNETIF_F_UDP_CSUM) != 0;
+    ufh.presummed = 0;
 
     err = rt_ip_build_xmit(sock, rt_udp_getfrag, &ufh, ulen, &rt, msg_flags);
 
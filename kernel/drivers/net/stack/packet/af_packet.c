@@ -24,6 +24,10 @@
 
 #include <linux/module.h>
 #include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/if_packet.h>
 
 #include <rtnet_iovec.h>
 #include <rtnet_socket.h>
@@ -32,6 +36,153 @@
 MODULE_LICENSE("GPL");
 
 
+/***
+ *  Frame ring shared with user space, following the PACKET_MMAP layout
+ *  (TPACKET_V1). Each frame starts with a struct tpacket_hdr whose
+ *  status word tells who owns the frame, the kernel or the user.
+ *  Rings are set up once per socket and direction, and released when
+ *  both the socket and the last mapping are gone.
+ */
+struct rtpacket_ring {
+    atomic_t            refs;       /* socket and user mappings */
+    rtdm_lock_t         lock;
+    void                *mem;
+    size_t              size;
+    unsigned int        block_size;
+    unsigned int        frame_size;
+    unsigned int        frame_nr;
+    unsigned int        frames_per_block;
+    unsigned int        head;       /* next frame to fill or to send */
+    int                 losing;     /* RX frames were dropped */
+};
+
+/* TX frame data follows the aligned header, as with Linux. */
+#define RTPACKET_TX_DATA_OFFSET \
+    (TPACKET_HDRLEN - sizeof(struct sockaddr_ll))
+
+/* RX frame data follows the aligned header and link-level address. */
+#define RTPACKET_RX_DATA_OFFSET TPACKET_ALIGN(TPACKET_HDRLEN)
+
+
+static inline struct tpacket_hdr *
+rt_packet_frame(struct rtpacket_ring *ring, unsigned int n)
+{
+    return ring->mem + (n / ring->frames_per_block) * ring->block_size +
+	(n % ring->frames_per_block) * ring->frame_size;
+}
+
+static void rt_packet_put_ring(struct rtpacket_ring *ring)
+{
+    if (atomic_dec_and_test(&ring->refs)) {
+	vfree(ring->mem);
+	kfree(ring);
+    }
+}
+
+static inline int rt_packet_socket_type(struct rtsocket *sock)
+{
+    return rtdm_fd_to_context(rt_socket_fd(sock))->device->driver->socket_type;
+}
+
+
+/***
+ *  rt_packet_ring_rcv - copy a packet to the next RX ring frame
+ *
+ *  Returns non-zero if the ring was found empty, i.e. the user may
+ *  wait for the socket to become readable.
+ */
+static int rt_packet_ring_rcv(struct rtsocket *sock,
+			      struct rtpacket_ring *ring, struct rtskb *skb)
+{
+    struct rtnet_device *rtdev = skb->rtdev;
+    struct tpacket_hdr  *hdr, *prev;
+    struct sockaddr_ll  *sll;
+    unsigned char       *start = skb->data;
+    unsigned int        len, snaplen;
+    unsigned long       status;
+    rtdm_lockctx_t      context;
+    u32                 nsec;
+    int                 was_empty;
+
+
+    /* Include the header in raw delivery */
+    if (rt_packet_socket_type(sock) != SOCK_DGRAM)
+	start = skb->mac.raw;
+
+    len = skb->len + (skb->data - start);
+    snaplen = min(len, ring->frame_size - RTPACKET_RX_DATA_OFFSET);
+
+    rtdm_lock_get_irqsave(&ring->lock, context);
+
+    hdr = rt_packet_frame(ring, ring->head);
+    if (hdr->tp_status != TP_STATUS_KERNEL) {
+	ring->losing = 1;
+	rtdm_lock_put_irqrestore(&ring->lock, context);
+	return 0;
+    }
+
+    /* The user consumes the frames in order. */
+    prev = rt_packet_frame(ring, (ring->head ?: ring->frame_nr) - 1);
+    was_empty = (prev->tp_status & TP_STATUS_USER) == 0;
+
+    memcpy((void *)hdr + RTPACKET_RX_DATA_OFFSET, start, snaplen);
+
+    hdr->tp_len     = len;
+    hdr->tp_snaplen = snaplen;
+    hdr->tp_mac     = RTPACKET_RX_DATA_OFFSET;
+    hdr->tp_net     = RTPACKET_RX_DATA_OFFSET + (skb->data - start);
+    hdr->tp_sec     = div_u64_rem(skb->time_stamp, NSEC_PER_SEC, &nsec);
+    hdr->tp_usec    = nsec / NSEC_PER_USEC;
+
+    sll = (void *)hdr + TPACKET_ALIGN(sizeof(*hdr));
+    sll->sll_family   = AF_PACKET;
+    sll->sll_hatype   = rtdev->type;
+    sll->sll_protocol = skb->protocol;
+    sll->sll_pkttype  = skb->pkt_type;
+    sll->sll_ifindex  = rtdev->ifindex;
+
+    /* Ethernet specific - we rather need some parse handler here */
+    memcpy(sll->sll_addr, skb->mac.ethernet->h_source, ETH_ALEN);
+    sll->sll_halen = ETH_ALEN;
+
+    status = TP_STATUS_USER;
+    if (ring->losing) {
+	status |= TP_STATUS_LOSING;
+	ring->losing = 0;
+    }
+
+    /* frame contents must have been written before handing it over */
+    smp_wmb();
+    hdr->tp_status = status;
+
+    if (++ring->head == ring->frame_nr)
+	ring->head = 0;
+
+    rtdm_lock_put_irqrestore(&ring->lock, context);
+
+    return was_empty;
+}
+
+
+/***
+ *  rt_packet_ring_pending - check for RX ring frames owned by the user
+ */
+static int rt_packet_ring_pending(struct rtpacket_ring *ring)
+{
+    struct tpacket_hdr  *last;
+    rtdm_lockctx_t      context;
+    int                 ret;
+
+
+    rtdm_lock_get_irqsave(&ring->lock, context);
+    last = rt_packet_frame(ring, (ring->head ?: ring->frame_nr) - 1);
+    ret = (last->tp_status & TP_STATUS_USER) != 0;
+    rtdm_lock_put_irqrestore(&ring->lock, context);
+
+    return ret;
+}
+
+
 /***
  *  rt_packet_rcv
  */
@@ -40,9 +191,11 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
     struct rtsocket *sock   = container_of(pt, struct rtsocket,
 					   prot.packet.packet_type);
     int             ifindex = sock->prot.packet.ifindex;
+    struct rtpacket_ring *ring = sock->prot.packet.rx_ring;
     void            (*callback_func)(struct rtdm_fd *, void *);
     void            *callback_arg;
     rtdm_lockctx_t  context;
+    int             was_empty;
 
 
     if (unlikely((ifindex != 0) && (ifindex != skb->rtdev->ifindex)))
@@ -51,6 +204,18 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
     if (rt_socket_reference(sock) < 0)
 	return -EUNATCH;
 
+    if (ring != NULL) {
+	was_empty = rt_packet_ring_rcv(sock, ring, skb);
+#ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
+	/* ETH_P_ALL listeners must leave the packet to others. */
+	if (pt->type != htons(ETH_P_ALL))
+#endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
+	    kfree_rtskb(skb);
+	if (!was_empty)
+	    goto out;
+	goto notify;
+    }
+
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
     if (pt->type == htons(ETH_P_ALL)) {
 	struct rtskb *clone_skb = rtskb_clone(skb, &sock->skb_pool);
@@ -65,6 +230,7 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
 	}
 
     rtskb_queue_tail(&sock->incoming, skb);
+  notify:
     rtdm_sem_up(&sock->pending_sem);
 
     rtdm_lock_get_irqsave(&sock->param_lock, context);
@@ -149,6 +315,167 @@ static int rt_packet_bind(struct rtsocket *sock, const struct sockaddr *addr,
 
 
 
+/***
+ *  rt_packet_setup_ring - set up the RX or TX frame ring of a socket
+ */
+static int rt_packet_setup_ring(struct rtsocket *sock,
+				struct rtpacket_ring **ringp,
+				const struct tpacket_req *req)
+{
+    struct rtpacket_ring    *ring;
+    unsigned int            frames_per_block;
+    rtdm_lockctx_t          context;
+    int                     ret = 0;
+
+
+    if (rtdm_in_rt_context())
+	return -ENOSYS;
+
+    if ((req->tp_block_size == 0) ||
+	(req->tp_block_size & (PAGE_SIZE - 1)) ||
+	(req->tp_block_nr == 0) ||
+	(req->tp_block_nr > UINT_MAX / req->tp_block_size))
+	return -EINVAL;
+
+    if ((req->tp_frame_size < TPACKET_HDRLEN) ||
+	(req->tp_frame_size & (TPACKET_ALIGNMENT - 1)) ||
+	(req->tp_frame_size > req->tp_block_size))
+	return -EINVAL;
+
+    frames_per_block = req->tp_block_size / req->tp_frame_size;
+    if (frames_per_block * req->tp_block_nr != req->tp_frame_nr)
+	return -EINVAL;
+
+    ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+    if (ring == NULL)
+	return -ENOMEM;
+
+    ring->size = (size_t)req->tp_block_size * req->tp_block_nr;
+    /* All frames start with TP_STATUS_KERNEL / TP_STATUS_AVAILABLE. */
+    ring->mem = vzalloc(ring->size);
+    if (ring->mem == NULL) {
+	kfree(ring);
+	return -ENOMEM;
+    }
+
+    atomic_set(&ring->refs, 1);
+    rtdm_lock_init(&ring->lock);
+    ring->block_size        = req->tp_block_size;
+    ring->frame_size        = req->tp_frame_size;
+    ring->frame_nr          = req->tp_frame_nr;
+    ring->frames_per_block  = frames_per_block;
+
+    rtdm_lock_get_irqsave(&sock->param_lock, context);
+
+    if (*ringp != NULL)
+	ret = -EBUSY;
+    else
+	*ringp = ring;
+
+    rtdm_lock_put_irqrestore(&sock->param_lock, context);
+
+    if (ret)
+	rt_packet_put_ring(ring);
+
+    return ret;
+}
+
+
+
+/***
+ *  rt_packet_setsockopt
+ */
+static int rt_packet_setsockopt(struct rtsocket *sock, int level, int optname,
+				const void *optval, socklen_t optlen)
+{
+    struct rtpacket_ring **ringp;
+    struct tpacket_req   req;
+
+
+    if (level != SOL_PACKET)
+	return -ENOPROTOOPT;
+
+    switch (optname) {
+	case PACKET_RX_RING:
+	    ringp = &sock->prot.packet.rx_ring;
+	    break;
+
+	case PACKET_TX_RING:
+	    ringp = &sock->prot.packet.tx_ring;
+	    break;
+
+	default:
+	    return -ENOPROTOOPT;
+    }
+
+    if (optlen < sizeof(struct tpacket_req))
+	return -EINVAL;
+
+    if (rtdm_copy_from_user(rt_socket_fd(sock), &req, optval, sizeof(req)))
+	return -EFAULT;
+
+    return rt_packet_setup_ring(sock, ringp, &req);
+}
+
+
+
+static void rt_packet_vmopen(struct vm_area_struct *vma)
+{
+    struct rtpacket_ring *ring = vma->vm_private_data;
+
+    atomic_inc(&ring->refs);
+}
+
+static void rt_packet_vmclose(struct vm_area_struct *vma)
+{
+    rt_packet_put_ring(vma->vm_private_data);
+}
+
+static struct vm_operations_struct rt_packet_vmops = {
+    .open   = rt_packet_vmopen,
+    .close  = rt_packet_vmclose,
+};
+
+/***
+ *  rt_packet_mmap - map a frame ring
+ *
+ *  The RX ring is found at offset 0, the TX ring right after it, or at
+ *  offset 0 if there is no RX ring. A mapping covers a single ring.
+ */
+static int rt_packet_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+    struct rtsocket         *sock = rtdm_fd_to_private(fd);
+    struct rtpacket_ring    *rx_ring = sock->prot.packet.rx_ring;
+    struct rtpacket_ring    *tx_ring = sock->prot.packet.tx_ring;
+    struct rtpacket_ring    *ring;
+    size_t                  offset = vma->vm_pgoff << PAGE_SHIFT;
+    int                     ret;
+
+
+    if (rx_ring != NULL && offset == 0)
+	ring = rx_ring;
+    else if (tx_ring != NULL && offset == (rx_ring ? rx_ring->size : 0))
+	ring = tx_ring;
+    else
+	return -EINVAL;
+
+    if (vma->vm_end - vma->vm_start != ring->size)
+	return -EINVAL;
+
+    ret = rtdm_mmap_vmem(vma, ring->mem);
+    if (ret)
+	return ret;
+
+    /* vm_ops->open() is not called for the initial mapping. */
+    atomic_inc(&ring->refs);
+    vma->vm_ops = &rt_packet_vmops;
+    vma->vm_private_data = ring;
+
+    return 0;
+}
+
+
+
 /***
  *  rt_packet_getsockname
  */
@@ -207,6 +534,8 @@ static int rt_packet_socket(struct rtdm_fd *fd, int protocol)
     sock->prot.packet.ifindex			= 0;
     sock->prot.packet.packet_type.trylock	= rt_packet_trylock;
     sock->prot.packet.packet_type.unlock        = rt_packet_unlock;
+    sock->prot.packet.rx_ring			= NULL;
+    sock->prot.packet.tx_ring			= NULL;
 
     /* if protocol is non-zero, register the packet type */
     if (protocol != 0) {
@@ -249,6 +578,12 @@ static void rt_packet_close(struct rtdm_fd *fd)
 	kfree_rtskb(del);
     }
 
+    /* rings may live on in user mappings */
+    if (sock->prot.packet.rx_ring != NULL)
+	rt_packet_put_ring(sock->prot.packet.rx_ring);
+    if (sock->prot.packet.tx_ring != NULL)
+	rt_packet_put_ring(sock->prot.packet.tx_ring);
+
     rt_socket_cleanup(fd);
 }
 
@@ -262,6 +597,7 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
     struct rtsocket *sock = rtdm_fd_to_private(fd);
     struct _rtdm_setsockaddr_args *setaddr = arg;
     struct _rtdm_getsockaddr_args *getaddr = arg;
+    struct _rtdm_setsockopt_args  *setopt  = arg;
 
 
     /* fast path for common socket IOCTLs */
@@ -276,6 +612,10 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 	    return rt_packet_getsockname(sock, getaddr->addr,
 					 getaddr->addrlen);
 
+	case _RTIOC_SETSOCKOPT:
+	    return rt_packet_setsockopt(sock, setopt->level, setopt->optname,
+					setopt->optval, setopt->optlen);
+
 	default:
 	    return rt_socket_if_ioctl(fd, request, arg);
     }
@@ -283,6 +623,42 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 
 
 
+/***
+ *  rt_packet_ring_wait - wait for the RX ring to hold user frames
+ *
+ *  Received packets are not copied by recvmsg() when an RX ring is
+ *  set up, it returns 0 as soon as the ring has frames to consume.
+ */
+static ssize_t rt_packet_ring_wait(struct rtsocket *sock,
+				   struct rtpacket_ring *ring,
+				   nanosecs_rel_t timeout)
+{
+    rtdm_toseq_t    timeout_seq;
+    int             ret;
+
+
+    rtdm_toseq_init(&timeout_seq, timeout);
+
+    /* the semaphore may count frames the user consumed already */
+    while (!rt_packet_ring_pending(ring)) {
+	ret = rtdm_sem_timeddown(&sock->pending_sem, timeout, &timeout_seq);
+	if (unlikely(ret < 0))
+	    switch (ret) {
+		case -EWOULDBLOCK:
+		case -ETIMEDOUT:
+		case -EINTR:
+		    return ret;
+
+		default:
+		    return -EBADF;   /* socket has been closed */
+	    }
+    }
+
+    return 0;
+}
+
+
+
 /***
  *  rt_packet_recvmsg
  */
@@ -303,6 +679,9 @@ rt_packet_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
     if (msg_flags & MSG_DONTWAIT)
 	timeout = -1;
 
+    if (sock->prot.packet.rx_ring != NULL)
+	return rt_packet_ring_wait(sock, sock->prot.packet.rx_ring, timeout);
+
     ret = rtdm_sem_timeddown(&sock->pending_sem, timeout, NULL);
     if (unlikely(ret < 0))
 	switch (ret) {
@@ -362,6 +741,143 @@ rt_packet_recvmsg(struct rtdm_fd *fd, struct msghdr *msg, int msg_flags)
 
 
 
+/***
+ *  rt_packet_alloc_frame - allocate and prepare an outgoing frame of
+ *  @len bytes, which the caller appends
+ */
+static struct rtskb *
+rt_packet_alloc_frame(struct rtdm_fd *fd, struct rtnet_device *rtdev,
+		      const struct sockaddr_ll *sll, unsigned short proto,
+		      unsigned char *addr, size_t len, int *err)
+{
+    struct rtsocket     *sock = rtdm_fd_to_private(fd);
+    int                 socket_type = rt_packet_socket_type(sock);
+    struct rtskb        *rtskb;
+
+
+    rtskb = alloc_rtskb(rtdev->hard_header_len + len, &sock->skb_pool);
+    if (rtskb == NULL) {
+	*err = -ENOBUFS;
+	return NULL;
+    }
+
+    /* If an RTmac discipline is active, this becomes a pure sanity check to
+       avoid writing beyond rtskb boundaries. The hard check is then performed
+       upon rtdev_xmit() by the discipline's xmit handler. */
+    if (len > rtdev->mtu +
+	((socket_type == SOCK_RAW) ? rtdev->hard_header_len : 0)) {
+	*err = -EMSGSIZE;
+	goto err;
+    }
+
+    if ((sll != NULL) && (sll->sll_halen != rtdev->addr_len)) {
+	*err = -EINVAL;
+	goto err;
+    }
+
+    rtskb_reserve(rtskb, rtdev->hard_header_len);
+
+    rtskb->rtdev    = rtdev;
+    rtskb->priority = sock->priority;
+
+    if (rtdev->hard_header) {
+	int hdr_len;
+
+	hdr_len = rtdev->hard_header(rtskb, rtdev, ntohs(proto),
+				     addr, NULL, len);
+	if (socket_type != SOCK_DGRAM) {
+	    rtskb->tail = rtskb->data;
+	    rtskb->len = 0;
+	} else if (hdr_len < 0) {
+	    *err = -EINVAL;
+	    goto err;
+	}
+    }
+
+    return rtskb;
+
+ err:
+    kfree_rtskb(rtskb);
+    return NULL;
+}
+
+
+
+/***
+ *  rt_packet_ring_send - send all frames the user handed over in the
+ *  TX ring, stopping at the first one still owned by the user
+ */
+static ssize_t rt_packet_ring_send(struct rtdm_fd *fd,
+				   struct rtpacket_ring *ring,
+				   struct rtnet_device *rtdev,
+				   const struct sockaddr_ll *sll,
+				   unsigned short proto, unsigned char *addr)
+{
+    struct tpacket_hdr  *hdr;
+    struct rtskb        *rtskb;
+    rtdm_lockctx_t      context;
+    ssize_t             sent = 0;
+    size_t              len;
+    int                 ret = 0;
+
+
+    if ((rtdev->flags & IFF_UP) == 0)
+	return -ENETDOWN;
+
+    for (;;) {
+	/* concurrent senders may share the ring */
+	rtdm_lock_get_irqsave(&ring->lock, context);
+
+	hdr = rt_packet_frame(ring, ring->head);
+	if (hdr->tp_status != TP_STATUS_SEND_REQUEST) {
+	    rtdm_lock_put_irqrestore(&ring->lock, context);
+	    break;
+	}
+
+	/* status must have been read before the frame contents */
+	smp_rmb();
+
+	len = ACCESS_ONCE(hdr->tp_len);
+	if (len > ring->frame_size - RTPACKET_TX_DATA_OFFSET) {
+	    ret = -EINVAL;
+	    rtskb = NULL;
+	} else
+	    rtskb = rt_packet_alloc_frame(fd, rtdev, sll, proto, addr,
+					  len, &ret);
+
+	if (rtskb == NULL) {
+	    /* retry later when running out of buffers */
+	    if (ret != -ENOBUFS) {
+		hdr->tp_status = TP_STATUS_WRONG_FORMAT;
+		if (++ring->head == ring->frame_nr)
+		    ring->head = 0;
+	    }
+	    rtdm_lock_put_irqrestore(&ring->lock, context);
+	    break;
+	}
+
+	memcpy(rtskb_put(rtskb, len),
+	       (void *)hdr + RTPACKET_TX_DATA_OFFSET, len);
+
+	/* the frame contents went to the rtskb, give it back */
+	smp_mb();
+	hdr->tp_status = TP_STATUS_AVAILABLE;
+	if (++ring->head == ring->frame_nr)
+	    ring->head = 0;
+
+	rtdm_lock_put_irqrestore(&ring->lock, context);
+
+	if ((ret = rtdev_xmit(rtskb)) != 0)
+	    break;
+
+	sent += len;
+    }
+
+    return sent ? sent : ret;
+}
+
+
+
 /***
  *  rt_packet_sendmsg
  */
@@ -371,6 +887,7 @@ rt_packet_sendmsg(struct rtdm_fd *fd, const struct msghdr *msg, int msg_flags)
     struct rtsocket     *sock = rtdm_fd_to_private(fd);
     size_t              len   = rt_iovec_len(msg->msg_iov, msg->msg_iovlen);
     struct sockaddr_ll  *sll  = (struct sockaddr_ll*)msg->msg_name;
+    struct rtpacket_ring *ring = sock->prot.packet.tx_ring;
     struct rtnet_device *rtdev;
     struct rtskb        *rtskb;
     unsigned short      proto;
@@ -406,44 +923,15 @@ rt_packet_sendmsg(struct rtdm_fd *fd, const struct msghdr *msg, int msg_flags)
     if ((rtdev = rtdev_get_by_index(ifindex)) == NULL)
 	return -ENODEV;
 
-    rtskb = alloc_rtskb(rtdev->hard_header_len + len, &sock->skb_pool);
-    if (rtskb == NULL) {
-	ret = -ENOBUFS;
+    /* an empty message flushes the TX ring */
+    if ((ring != NULL) && (len == 0)) {
+	ret = rt_packet_ring_send(fd, ring, rtdev, sll, proto, addr);
 	goto out;
     }
 
-    /* If an RTmac discipline is active, this becomes a pure sanity check to
-       avoid writing beyond rtskb boundaries. The hard check is then performed
-       upon rtdev_xmit() by the discipline's xmit handler. */
-    if (len > rtdev->mtu +
-	((rtdm_fd_to_context(fd)->device->driver->socket_type == SOCK_RAW) ?
-	    rtdev->hard_header_len : 0)) {
-	ret = -EMSGSIZE;
-	goto err;
-    }
-
-    if ((sll != NULL) && (sll->sll_halen != rtdev->addr_len)) {
-	ret = -EINVAL;
-	goto err;
-    }
-
-    rtskb_reserve(rtskb, rtdev->hard_header_len);
-
-    rtskb->rtdev    = rtdev;
-    rtskb->priority = sock->priority;
-
-    if (rtdev->hard_header) {
-	int hdr_len;
-
-	ret = -EINVAL;
-	hdr_len = rtdev->hard_header(rtskb, rtdev, ntohs(proto),
-				     addr, NULL, len);
-	if (rtdm_fd_to_context(fd)->device->driver->socket_type != SOCK_DGRAM) {
-	    rtskb->tail = rtskb->data;
-	    rtskb->len = 0;
-	} else if (hdr_len < 0)
-	    goto err;
-    }
+    rtskb = rt_packet_alloc_frame(fd, rtdev, sll, proto, addr, len, &ret);
+    if (rtskb == NULL)
+	goto out;
 
     rt_memcpy_fromkerneliovec(rtskb_put(rtskb, len), msg->msg_iov, len);
 
@@ -487,6 +975,7 @@ static struct rtdm_driver packet_proto_drv = {
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
 	.select =       rt_socket_select_bind,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -516,6 +1005,7 @@ static struct rtdm_driver raw_packet_proto_drv = {
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
 	.select =       rt_socket_select_bind,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -275,6 +275,7 @@ struct rtnet_device *rtdev_alloc(unsigned sizeof_priv, unsigned rx_pool_size)
     memset(rtdev, 0, alloc_size);
 
     ret = rtskb_pool_init(&rtdev->rx_pool, rx_pool_size, &rtdev_ops, rtdev);
+    rtdev->rx_pool.name = rtdev->name;
     if (ret < rx_pool_size) {
 	printk(KERN_ERR "RTnet: cannot allocate rtnet device RX pool\n");
 	rtskb_pool_release(&rtdev->rx_pool);
@@ -307,7 +308,6 @@ void rtdev_free (struct rtnet_device *rtdev)
     if (rtdev != NULL) {
 	rtskb_pool_release(&rtdev->rx_pool);
 	rtskb_pool_shrink(&global_pool, rtdev->add_rtskbs);
-	rtdev->stack_event = NULL;
 	rtdm_mutex_destroy(&rtdev->xmit_mutex);
 	kfree(rtdev);
     }
@@ -147,6 +147,71 @@ static struct xnvfile_regular rtnet_rtskb_vfile = {
 	.ops = &rtnet_rtskb_vfile_ops,
 };
 
+static int rtnet_rtskb_pools_lock_get(struct xnvfile *vfile)
+{
+	return mutex_lock_interruptible(&rtskb_pool_nrt_lock);
+}
+
+static void rtnet_rtskb_pools_lock_put(struct xnvfile *vfile)
+{
+	mutex_unlock(&rtskb_pool_nrt_lock);
+}
+
+static struct xnvfile_lock_ops rtnet_rtskb_pools_lock_ops = {
+	.get = rtnet_rtskb_pools_lock_get,
+	.put = rtnet_rtskb_pools_lock_put,
+};
+
+static void *rtnet_rtskb_pools_begin(struct xnvfile_regular_iterator *it)
+{
+	struct rtskb_pool *pool;
+	loff_t pos = 0;
+
+	if (it->pos == 0)
+		return VFILE_SEQ_START;
+
+	list_for_each_entry(pool, &rtskb_pool_list, entry)
+		if (++pos == it->pos)
+			return pool;
+
+	return NULL;
+}
+
+static void *rtnet_rtskb_pools_next(struct xnvfile_regular_iterator *it)
+{
+	/* pools come and go, so look up the record by position */
+	return rtnet_rtskb_pools_begin(it);
+}
+
+static int rtnet_rtskb_pools_show(struct xnvfile_regular_iterator *it,
+				  void *data)
+{
+	struct rtskb_pool *pool = data;
+
+	if (data == VFILE_SEQ_START) {
+		xnvfile_printf(it, "Name\t\tSize\tUsed\tHigh\tExhausted\t"
+			       "Refills\tAdded\n");
+		return 0;
+	}
+
+	xnvfile_printf(it, "%-15s %u\t%u\t%u\t%-10lu\t%lu\t%u\n",
+		       pool->name ?: "-", pool->size, pool->lock_count,
+		       pool->high_water, pool->exhausted, pool->refills,
+		       pool->auto_added);
+	return 0;
+}
+
+static struct xnvfile_regular_ops rtnet_rtskb_pools_vfile_ops = {
+	.begin = rtnet_rtskb_pools_begin,
+	.next = rtnet_rtskb_pools_next,
+	.show = rtnet_rtskb_pools_show,
+};
+
+static struct xnvfile_regular rtnet_rtskb_pools_vfile = {
+	.entry = { .lockops = &rtnet_rtskb_pools_lock_ops, },
+	.ops = &rtnet_rtskb_pools_vfile_ops,
+};
+
 static int rtnet_version_show(struct xnvfile_regular_iterator *it, void *data)
 {
     const char verstr[] =
@@ -277,8 +342,16 @@ static int rtnet_proc_register(void)
 	if (err < 0)
 		goto error5;
 
+	err = xnvfile_init_regular("rtskb_pools", &rtnet_rtskb_pools_vfile,
+				   &rtnet_proc_root);
+	if (err < 0)
+		goto error6;
+
     return 0;
 
+  error6:
+	xnvfile_destroy_regular(&rtnet_stats_vfile);
+
   error5:
 	xnvfile_destroy_regular(&rtnet_version_vfile);
 
@@ -300,6 +373,7 @@ static int rtnet_proc_register(void)
 
 static void rtnet_proc_unregister(void)
 {
+	xnvfile_destroy_regular(&rtnet_rtskb_pools_vfile);
 	xnvfile_destroy_regular(&rtnet_stats_vfile);
 	xnvfile_destroy_regular(&rtnet_version_vfile);
 	xnvfile_destroy_regular(&rtnet_rtskb_vfile);
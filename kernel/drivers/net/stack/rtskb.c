@@ -23,6 +23,7 @@
 
 #include <linux/moduleparam.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 #include <net/checksum.h>
 
 #include <rtdev.h>
@@ -48,6 +49,21 @@ unsigned int rtskb_pools_max=0;
 unsigned int rtskb_amount=0;
 unsigned int rtskb_amount_max=0;
 
+LIST_HEAD(rtskb_pool_list);
+EXPORT_SYMBOL_GPL(rtskb_pool_list);
+DEFINE_MUTEX(rtskb_pool_nrt_lock);
+EXPORT_SYMBOL_GPL(rtskb_pool_nrt_lock);
+
+unsigned int rtskb_pool_auto_rtskbs = 0;
+module_param_named(pool_auto_rtskbs, rtskb_pool_auto_rtskbs, uint, 0644);
+MODULE_PARM_DESC(pool_auto_rtskbs, "Maximum number of rtskbs added to a pool "
+		 "running low, in background (0: disabled)");
+EXPORT_SYMBOL_GPL(rtskb_pool_auto_rtskbs);
+
+static void rtskb_pool_extend_work(struct work_struct *work);
+
+static DECLARE_WORK(rtskb_extend_work, rtskb_pool_extend_work);
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
 /* RTcap interface */
 rtdm_lock_t rtcap_lock;
@@ -151,6 +167,25 @@ void rtskb_under_panic(struct rtskb *skb, int sz, void *here)
 EXPORT_SYMBOL_GPL(rtskb_under_panic);
 #endif /* CONFIG_XENO_DRIVERS_NET_CHECKED */
 
+/***
+ *  rtskb_pool_check_low - have the pool extended in background when
+ *  less than a quarter of its rtskbs is left
+ */
+static inline void rtskb_pool_check_low(struct rtskb_pool *pool)
+{
+    unsigned int limit = rtskb_pool_auto_rtskbs;
+
+    if (likely(limit == 0 || pool->extend_pending))
+	return;
+
+    if ((pool->size - pool->lock_count) * 4 > pool->size ||
+	pool->auto_added >= limit)
+	return;
+
+    pool->extend_pending = 1;
+    rtdm_schedule_nrt_work(&rtskb_extend_work);
+}
+
 static struct rtskb *__rtskb_pool_dequeue(struct rtskb_pool *pool)
 {
     struct rtskb_queue *queue = &pool->queue;
@@ -162,8 +197,13 @@ static struct rtskb *__rtskb_pool_dequeue(struct rtskb_pool *pool)
     if (skb == NULL) {
 	if (pool->lock_count == 0) /* This can only happen if pool has 0 packets */
 	    pool->lock_ops->unlock(pool->lock_cookie);
-    } else
-	++pool->lock_count;
+	pool->exhausted++;
+    } else {
+	if (++pool->lock_count > pool->high_water)
+	    pool->high_water = pool->lock_count;
+    }
+
+    rtskb_pool_check_low(pool);
 
     return skb;
 }
@@ -227,6 +267,7 @@ struct rtskb *alloc_rtskb(unsigned int size, struct rtskb_pool *pool)
     skb->len = 0;
     skb->pkt_type = PACKET_HOST;
     skb->xmit_stamp = NULL;
+    skb->ip_summed = CHECKSUM_NONE;
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
     skb->cap_flags = 0;
@@ -310,6 +351,14 @@ unsigned int rtskb_pool_init(struct rtskb_pool *pool,
 
     rtskb_queue_init(&pool->queue);
 
+    pool->name = NULL;
+    pool->size = 0;
+    pool->high_water = 0;
+    pool->exhausted = 0;
+    pool->refills = 0;
+    pool->auto_added = 0;
+    pool->extend_pending = 0;
+
     i = rtskb_pool_extend(pool, initial_size);
 
     rtskb_pools++;
@@ -320,6 +369,10 @@ unsigned int rtskb_pool_init(struct rtskb_pool *pool,
     pool->lock_count = 0;
     pool->lock_cookie = lock_cookie;
 
+    mutex_lock(&rtskb_pool_nrt_lock);
+    list_add_tail(&pool->entry, &rtskb_pool_list);
+    mutex_unlock(&rtskb_pool_nrt_lock);
+
     return i;
 }
 
@@ -348,7 +401,12 @@ unsigned int __rtskb_module_pool_init(struct rtskb_pool *pool,
 				    unsigned int initial_size,
 				    struct module *module)
 {
-    return rtskb_pool_init(pool, initial_size, &rtskb_module_lock_ops, module);
+    unsigned int ret;
+
+    ret = rtskb_pool_init(pool, initial_size, &rtskb_module_lock_ops, module);
+    pool->name = module ? module->name : "rtnet";
+
+    return ret;
 }
 EXPORT_SYMBOL_GPL(__rtskb_module_pool_init);
 
@@ -361,6 +419,15 @@ int rtskb_pool_release(struct rtskb_pool *pool)
 {
     struct rtskb *skb;
 
+    /*
+     * Wait for the background extender to let go of the pool. Unlink
+     * it even if it is still busy: most callers free the pool anyway,
+     * which must not leave a dangling entry on the pool list.
+     */
+    mutex_lock(&rtskb_pool_nrt_lock);
+    list_del_init(&pool->entry);
+    mutex_unlock(&rtskb_pool_nrt_lock);
+
     if (pool->lock_count)
 	return -EBUSY;
 
@@ -370,6 +437,7 @@ int rtskb_pool_release(struct rtskb_pool *pool)
 	rtskb_amount--;
     }
 
+    pool->size = 0;
     rtskb_pools--;
     return 0;
 }
@@ -382,6 +450,7 @@ unsigned int rtskb_pool_extend(struct rtskb_pool *pool,
 {
     unsigned int i;
     struct rtskb *skb;
+    rtdm_lockctx_t context;
 
 
     RTNET_ASSERT(pool != NULL, return -EINVAL;);
@@ -413,6 +482,10 @@ unsigned int rtskb_pool_extend(struct rtskb_pool *pool,
 	    rtskb_amount_max = rtskb_amount;
     }
 
+    rtdm_lock_get_irqsave(&pool->queue.lock, context);
+    pool->size += i;
+    rtdm_lock_put_irqrestore(&pool->queue.lock, context);
+
     return i;
 }
 
@@ -422,6 +495,7 @@ unsigned int rtskb_pool_shrink(struct rtskb_pool *pool,
 {
     unsigned int    i;
     struct rtskb    *skb;
+    rtdm_lockctx_t  context;
 
 
     for (i = 0; i < rem_rtskbs; i++) {
@@ -433,10 +507,53 @@ unsigned int rtskb_pool_shrink(struct rtskb_pool *pool,
 	rtskb_amount--;
     }
 
+    rtdm_lock_get_irqsave(&pool->queue.lock, context);
+    pool->size -= i;
+    rtdm_lock_put_irqrestore(&pool->queue.lock, context);
+
     return i;
 }
 
 
+/***
+ *  rtskb_pool_extend_work - grow the pools running low
+ *
+ *  Each pool grows by half its size at a time, until the extender has
+ *  added rtskb_pool_auto_rtskbs to it.
+ */
+static void rtskb_pool_extend_work(struct work_struct *work)
+{
+    struct rtskb_pool   *pool;
+    unsigned int        limit, add;
+    rtdm_lockctx_t      context;
+
+
+    mutex_lock(&rtskb_pool_nrt_lock);
+
+    list_for_each_entry(pool, &rtskb_pool_list, entry) {
+	if (!pool->extend_pending)
+	    continue;
+
+	limit = rtskb_pool_auto_rtskbs;
+	add = max(pool->size / 2, 1U);
+	if (pool->auto_added + add > limit)
+	    add = limit > pool->auto_added ? limit - pool->auto_added : 0;
+
+	if (add > 0)
+	    add = rtskb_pool_extend(pool, add);
+
+	rtdm_lock_get_irqsave(&pool->queue.lock, context);
+	pool->auto_added += add;
+	if (add > 0)
+	    pool->refills++;
+	pool->extend_pending = 0;
+	rtdm_lock_put_irqrestore(&pool->queue.lock, context);
+    }
+
+    mutex_unlock(&rtskb_pool_nrt_lock);
+}
+
+
 /* Note: acquires only the first skb of a chain! */
 int rtskb_acquire(struct rtskb *rtskb, struct rtskb_pool *comp_pool)
 {
@@ -534,6 +651,7 @@ int rtskb_pools_init(void)
     /* create the global rtskb pool */
     if (rtskb_module_pool_init(&global_pool, global_rtskbs) < global_rtskbs)
 	goto err_out;
+    global_pool.name = "global";
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
     rtdm_lock_init(&rtcap_lock);
@@ -552,5 +670,6 @@ err_out:
 void rtskb_pools_release(void)
 {
     rtskb_pool_release(&global_pool);
+    flush_work(&rtskb_extend_work);
     kmem_cache_destroy(rtskb_slab_pool);
 }
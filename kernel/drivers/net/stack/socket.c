@@ -69,11 +69,16 @@ int rt_bare_socket_init(struct rtdm_fd *fd,
 			unsigned int priority, unsigned int pool_size)
 {
     struct rtsocket *sock = rtdm_fd_to_private(fd);
+    unsigned int ret;
+
     sock->protocol = protocol;
     sock->priority = priority;
 
-    return rtskb_pool_init(&sock->skb_pool,
+    ret = rtskb_pool_init(&sock->skb_pool,
 			pool_size, &rtskb_socket_pool_ops, fd);
+    sock->skb_pool.name = rtdm_fd_to_context(fd)->device->label;
+
+    return ret;
 }
 EXPORT_SYMBOL_GPL(rt_bare_socket_init);
 
@@ -102,10 +107,6 @@ int rt_socket_init(struct rtdm_fd *fd, unsigned short protocol)
     mutex_init(&sock->pool_nrt_lock);
 
     if (pool_size < socket_rtskbs) {
-	/* fix statistics */
-	if (pool_size == 0)
-	    rtskb_pools--;
-
 	rt_socket_cleanup(fd);
 	return -ENOMEM;
     }
@@ -129,8 +130,8 @@ void rt_socket_cleanup(struct rtdm_fd *fd)
 
     set_bit(SKB_POOL_CLOSED, &sock->flags);
 
-    if (sock->pool_size > 0)
-	rtskb_pool_release(&sock->skb_pool);
+    /* even if empty, the pool is registered */
+    rtskb_pool_release(&sock->skb_pool);
 
     mutex_unlock(&sock->pool_nrt_lock);
 }
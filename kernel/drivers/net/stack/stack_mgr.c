@@ -23,22 +23,66 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/jhash.h>
+#include <linux/ip.h>
+#include <asm/unaligned.h>
 
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/thread.h>
 #include <rtdev.h>
 #include <rtnet_internal.h>
 #include <rtskb_fifo.h>
 #include <stack_mgr.h>
 
 
-static unsigned int stack_mgr_prio = RTNET_DEF_STACK_PRIORITY;
-module_param(stack_mgr_prio, uint, 0444);
-MODULE_PARM_DESC(stack_mgr_prio, "Priority of the stack manager task");
+static unsigned int stack_mgr_queues = 1;
+module_param(stack_mgr_queues, uint, 0444);
+MODULE_PARM_DESC(stack_mgr_queues, "Number of stack manager tasks "
+		 "(TCP is always delivered by the first one)");
+
+static unsigned int stack_mgr_prio[RTNET_STACK_MAX_QUEUES] = {
+    [0 ... RTNET_STACK_MAX_QUEUES - 1] = RTNET_DEF_STACK_PRIORITY
+};
+static int nr_stack_mgr_prio;
+module_param_array(stack_mgr_prio, uint, &nr_stack_mgr_prio, 0444);
+MODULE_PARM_DESC(stack_mgr_prio, "Priority of the stack manager tasks "
+		 "(a single value applies to all)");
+
+static int stack_mgr_cpu[RTNET_STACK_MAX_QUEUES] = {
+    [0 ... RTNET_STACK_MAX_QUEUES - 1] = -1
+};
+module_param_array(stack_mgr_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(stack_mgr_cpu, "CPU of the stack manager tasks "
+		 "(-1: spread over the real-time CPUs)");
+
+static bool stack_mgr_by_dev;
+module_param(stack_mgr_by_dev, bool, 0444);
+MODULE_PARM_DESC(stack_mgr_by_dev, "Dispatch packets by receiving device "
+		 "instead of by flow");
 
 
 #if (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE & (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE-1)) != 0
 #error CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE must be power of 2!
 #endif
-static DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+
+/***
+ *  Each stack manager task delivers the packets received into its own
+ *  queue. A flow always maps to the same queue, so that packets of a
+ *  flow are delivered in order.
+ */
+struct rt_stack_queue {
+    DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+    struct rtnet_mgr        *mgr;
+    int                     cpu;
+    unsigned int            prio;
+    unsigned long           received;   /* updated under rx write_lock */
+    unsigned long           dropped;    /* updated under rx write_lock */
+    unsigned long           delivered;  /* updated by the manager only */
+};
+
+static struct rt_stack_queue stack_queues[RTNET_STACK_MAX_QUEUES];
+static struct rtnet_mgr stack_mgrs[RTNET_STACK_MAX_QUEUES - 1];
+static unsigned int nr_stack_queues;
 
 struct list_head    rt_packets[RTPACKET_HASH_TBL_SIZE];
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
@@ -110,26 +154,110 @@ int rtdev_remove_pack(struct rtpacket_type *pt)
 EXPORT_SYMBOL_GPL(rtdev_remove_pack);
 
 
+/***
+ *  rt_stack_steer: pick the stack manager queue of a received packet
+ *
+ *  IPv4 packets are hashed by addresses, protocol and ports. The ports
+ *  are left out for fragments, so that all fragments of a datagram go
+ *  to the same queue. Anything else is queued to the home queue of the
+ *  receiving device.
+ *
+ *  TCP is the exception: its receive path shares state between all
+ *  connections (e.g. the socket sending resets for unmatched segments),
+ *  and relies on a single task delivering segments. All TCP packets,
+ *  fragments included, therefore go to the first queue.
+ */
+static inline unsigned int rt_stack_steer(struct rtskb *skb)
+{
+    struct iphdr    *iph;
+    unsigned int    ihl;
+    u32             ports = 0;
+
+
+    if (nr_stack_queues == 1)
+	return 0;
+
+    if (skb->protocol != htons(ETH_P_IP) || skb->len < sizeof(struct iphdr))
+	return skb->rtdev->stack_queue;
+
+    iph = (struct iphdr *)skb->data;
+    if (iph->protocol == IPPROTO_TCP)
+	return 0;
+
+    if (stack_mgr_by_dev)
+	return skb->rtdev->stack_queue;
+
+    ihl = iph->ihl * 4;
+
+    if ((iph->frag_off & htons(IP_MF | IP_OFFSET)) == 0 &&
+	iph->protocol == IPPROTO_UDP &&
+	skb->len >= ihl + sizeof(ports))
+	ports = get_unaligned((u32 *)(skb->data + ihl));
+
+    return jhash_3words(iph->saddr, iph->daddr ^ iph->protocol, ports, 0) %
+	nr_stack_queues;
+}
+
+
 /***
  *  rtnetif_rx: will be called from the driver interrupt handler
- *  (IRQs disabled!) and send a message to rtdev-owned stack-manager
+ *  (IRQs disabled!) and queue the packet to a stack manager, which
+ *  rt_mark_stack_mgr() wakes up
  *
  *  @skb - the packet
  */
 void rtnetif_rx(struct rtskb *skb)
 {
+    struct rt_stack_queue   *queue;
+    unsigned int            q;
+    int                     err;
+
+
     RTNET_ASSERT(skb != NULL, return;);
     RTNET_ASSERT(skb->rtdev != NULL, return;);
 
-    if (unlikely(rtskb_fifo_insert_inirq(&rx.fifo, skb) < 0)) {
+    q = rt_stack_steer(skb);
+    queue = &stack_queues[q];
+
+    rtdm_lock_get(&queue->rx.fifo.write_lock);
+    err = __rtskb_fifo_insert(&queue->rx.fifo, skb);
+    if (likely(err == 0))
+	queue->received++;
+    else
+	queue->dropped++;
+    rtdm_lock_put(&queue->rx.fifo.write_lock);
+
+    if (unlikely(err < 0)) {
 	rtdm_printk("RTnet: dropping packet in %s()\n", __FUNCTION__);
 	kfree_rtskb(skb);
+	return;
     }
+
+    set_bit(q, &skb->rtdev->stack_pending);
 }
 
 EXPORT_SYMBOL_GPL(rtnetif_rx);
 
 
+/***
+ *  rt_mark_stack_mgr: wake up the stack managers which packets
+ *  received from @rtdev were queued to
+ */
+void rt_mark_stack_mgr(struct rtnet_device *rtdev)
+{
+    unsigned long   pending;
+    unsigned int    q;
+
+
+    pending = xchg(&rtdev->stack_pending, 0);
+
+    for_each_set_bit(q, &pending, RTNET_STACK_MAX_QUEUES)
+	rtdm_event_signal(&stack_queues[q].mgr->event);
+}
+
+EXPORT_SYMBOL_GPL(rt_mark_stack_mgr);
+
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_DRV_LOOPBACK)
 #define __DELIVER_PREFIX
 #else /* !CONFIG_XENO_DRIVERS_NET_DRV_LOOPBACK */
@@ -204,14 +332,22 @@ EXPORT_SYMBOL_GPL(rt_stack_deliver);
 
 static void rt_stack_mgr_task(void *arg)
 {
-    rtdm_event_t            *mgr_event = &((struct rtnet_mgr *)arg)->event;
+    struct rt_stack_queue   *queue = arg;
     struct rtskb            *rtskb;
 
 
-    while (rtdm_event_wait(mgr_event) == 0) {
+#ifdef CONFIG_SMP
+    if (queue->cpu >= 0 && xnthread_migrate(queue->cpu) < 0)
+	rtdm_printk("RTnet: cannot move stack manager to CPU%d\n",
+		    queue->cpu);
+#endif
+
+    while (rtdm_event_wait(&queue->mgr->event) == 0) {
 	/* we are the only reader => no locking required */
-	while ((rtskb = __rtskb_fifo_remove(&rx.fifo)))
+	while ((rtskb = __rtskb_fifo_remove(&queue->rx.fifo))) {
+	    queue->delivered++;
 	    rt_stack_deliver(rtskb);
+	}
     }
 }
 
@@ -221,7 +357,10 @@ static void rt_stack_mgr_task(void *arg)
  */
 void rt_stack_connect (struct rtnet_device *rtdev, struct rtnet_mgr *mgr)
 {
-    rtdev->stack_event = &mgr->event;
+    /* Spread the devices over the queues when dispatching by device. */
+    rtdev->stack_queue = rtdev->ifindex > 0 ?
+	(rtdev->ifindex - 1) % nr_stack_queues : 0;
+    rtdev->stack_pending = 0;
 }
 
 EXPORT_SYMBOL_GPL(rt_stack_connect);
@@ -232,21 +371,108 @@ EXPORT_SYMBOL_GPL(rt_stack_connect);
  */
 void rt_stack_disconnect (struct rtnet_device *rtdev)
 {
-    rtdev->stack_event = NULL;
+    rtdev->stack_queue = 0;
 }
 
 EXPORT_SYMBOL_GPL(rt_stack_disconnect);
 
 
+#ifdef CONFIG_XENO_OPT_VFILE
+static void *rtnet_stack_mgr_begin(struct xnvfile_regular_iterator *it)
+{
+    if (it->pos == 0)
+	return VFILE_SEQ_START;
+
+    return (void *)2UL;
+}
+
+static void *rtnet_stack_mgr_next(struct xnvfile_regular_iterator *it)
+{
+    if (it->pos > nr_stack_queues)
+	return NULL;
+
+    return (void *)2UL;
+}
+
+static int rtnet_stack_mgr_show(struct xnvfile_regular_iterator *it,
+				void *data)
+{
+    struct rt_stack_queue   *queue;
+    struct rtskb_fifo       *fifo;
+
+
+    if (data == NULL) {
+	xnvfile_printf(it, "Queue\tCPU\tPrio\tReceived\tDropped\t"
+		       "Delivered\tPending\n");
+	return 0;
+    }
+
+    queue = &stack_queues[it->pos - 1];
+    fifo = &queue->rx.fifo;
+
+    xnvfile_printf(it, "%d\t%d\t%u\t%-10lu\t%-7lu\t%-10lu\t%lu\n",
+		   (int)it->pos - 1, queue->cpu, queue->prio,
+		   queue->received, queue->dropped, queue->delivered,
+		   (fifo->write_pos - fifo->read_pos) & fifo->size_mask);
+
+    return 0;
+}
+
+static struct xnvfile_regular_ops rtnet_stack_mgr_vfile_ops = {
+    .begin  = rtnet_stack_mgr_begin,
+    .next   = rtnet_stack_mgr_next,
+    .show   = rtnet_stack_mgr_show,
+};
+
+static struct xnvfile_regular rtnet_stack_mgr_vfile = {
+    .ops = &rtnet_stack_mgr_vfile_ops,
+};
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+
+/***
+ *  rt_stack_queue_cpu: CPU of a stack manager task, -1 for any
+ */
+static int rt_stack_queue_cpu(unsigned int q)
+{
+    unsigned int    n = 0, nr_cpus = 0;
+    int             cpu;
+
+
+    if (stack_mgr_cpu[q] >= 0 || nr_stack_queues == 1)
+	return stack_mgr_cpu[q];
+
+    /* Spread the queues over the real-time CPUs. */
+    for_each_realtime_cpu(cpu)
+	nr_cpus++;
+
+    for_each_realtime_cpu(cpu)
+	if (n++ == q % nr_cpus)
+	    return cpu;
+
+    return -1;
+}
+
+
+static void rt_stack_queue_delete(struct rt_stack_queue *queue)
+{
+    rtdm_event_destroy(&queue->mgr->event);
+    rtdm_task_join_nrt(&queue->mgr->task, 100);
+}
+
+
 /***
  *  rt_stack_mgr_init
  */
 int rt_stack_mgr_init (struct rtnet_mgr *mgr)
 {
-    int i;
+    struct rt_stack_queue   *queue;
+    unsigned int            q;
+    int                     i, ret;
 
 
-    rtskb_fifo_init(&rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+    nr_stack_queues = clamp_t(unsigned int, stack_mgr_queues, 1,
+			      RTNET_STACK_MAX_QUEUES);
 
     for (i = 0; i < RTPACKET_HASH_TBL_SIZE; i++)
 	INIT_LIST_HEAD(&rt_packets[i]);
@@ -254,10 +480,40 @@ int rt_stack_mgr_init (struct rtnet_mgr *mgr)
     INIT_LIST_HEAD(&rt_packets_all);
 #endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
 
-    rtdm_event_init(&mgr->event, 0);
+    for (q = 0; q < nr_stack_queues; q++) {
+	queue = &stack_queues[q];
+	rtskb_fifo_init(&queue->rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+	queue->mgr = q == 0 ? mgr : &stack_mgrs[q - 1];
+	queue->cpu = rt_stack_queue_cpu(q);
+	queue->prio = stack_mgr_prio[nr_stack_mgr_prio > 1 ? q : 0];
+	queue->received = 0;
+	queue->dropped = 0;
+	queue->delivered = 0;
+
+	rtdm_event_init(&queue->mgr->event, 0);
+
+	ret = rtdm_task_init(&queue->mgr->task, "rtnet-stack",
+			     rt_stack_mgr_task, queue, queue->prio, 0);
+	if (ret) {
+	    rtdm_event_destroy(&queue->mgr->event);
+	    goto fail;
+	}
+    }
+
+#ifdef CONFIG_XENO_OPT_VFILE
+    ret = xnvfile_init_regular("stack_mgr", &rtnet_stack_mgr_vfile,
+			       &rtnet_proc_root);
+    if (ret < 0)
+	goto fail;
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+    return 0;
 
-    return rtdm_task_init(&mgr->task, "rtnet-stack", rt_stack_mgr_task, mgr,
-			  stack_mgr_prio, 0);
+  fail:
+    while (q-- > 0)
+	rt_stack_queue_delete(&stack_queues[q]);
+
+    return ret;
 }
 
 
@@ -266,6 +522,13 @@ int rt_stack_mgr_init (struct rtnet_mgr *mgr)
  */
 void rt_stack_mgr_delete (struct rtnet_mgr *mgr)
 {
-    rtdm_event_destroy(&mgr->event);
-    rtdm_task_join_nrt(&mgr->task, 100);
+    unsigned int q;
+
+
+#ifdef CONFIG_XENO_OPT_VFILE
+    xnvfile_destroy_regular(&rtnet_stack_mgr_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+    for (q = 0; q < nr_stack_queues; q++)
+	rt_stack_queue_delete(&stack_queues[q]);
 }
@@ -154,7 +154,7 @@ static void buffer_finalize(struct syncobj *sobj)
 	bcb = container_of(sobj, struct alchemy_buffer, sobj);
 	registry_destroy_file(&bcb->fsobj);
 	xnfree(bcb->buf);
-	xnfree(bcb);
+	xnslab_free(bcb, sizeof(*bcb));
 }
 fnref_register(libalchemy, buffer_finalize);
 
@@ -226,7 +226,7 @@ int rt_buffer_create(RT_BUFFER *bf, const char *name,
 
 	CANCEL_DEFER(svc);
 
-	bcb = xnmalloc(sizeof(*bcb));
+	bcb = xnslab_alloc(sizeof(*bcb));
 	if (bcb == NULL) {
 		ret = __bt(-ENOMEM);
 		goto fail;
@@ -278,7 +278,7 @@ fail_register:
 fail_syncinit:
 	xnfree(bcb->buf);
 fail_bufalloc:
-	xnfree(bcb);
+	xnslab_free(bcb, sizeof(*bcb));
 fail:
 	CANCEL_RESTORE(svc);
 
@@ -91,7 +91,8 @@ static int queue_registry_open(struct fsobj *fsobj, void *priv)
 		return -EIO;
 
 	usable_mem = heapobj_size(&qcb->hobj);
-	used_mem = heapobj_inquire(&qcb->hobj);
+	used_mem = heapobj_inquire(&qcb->hobj) -
+		heapobj_slab_cached(&qcb->mslab);
 	limit = qcb->limit;
 	mcount = qcb->mcount;
 	mode = qcb->mode;
@@ -135,10 +136,46 @@ static void queue_finalize(struct syncobj *sobj)
 	qcb = container_of(sobj, struct alchemy_queue, sobj);
 	registry_destroy_file(&qcb->fsobj);
 	heapobj_destroy(&qcb->hobj);
-	xnfree(qcb);
+	xnslab_free(qcb, sizeof(*qcb));
 }
 fnref_register(libalchemy, queue_finalize);
 
+/*
+ * Messages fitting the nominal size of a queue with a fixed message
+ * count are recycled through a slab pool drawn from the queue heap.
+ */
+static struct alchemy_queue_msg *alloc_msg(struct alchemy_queue *qcb,
+					   size_t size)
+{
+	struct alchemy_queue_msg *msg;
+	int slab = 0;
+
+	size += sizeof(struct alchemy_queue_msg);
+	if (size <= qcb->mslab.objsize) {
+		msg = heapobj_slab_alloc(&qcb->mslab);
+		slab = 1;
+	} else
+		msg = heapobj_alloc(&qcb->hobj, size);
+
+	if (msg)
+		msg->slab = slab;
+
+	return msg;
+}
+
+/*
+ * rt_queue_send() may shrink msg->size below the allocation size, so
+ * the origin of the block is recorded at allocation time.
+ */
+static void free_msg(struct alchemy_queue *qcb,
+		     struct alchemy_queue_msg *msg)
+{
+	if (msg->slab)
+		heapobj_slab_free(&qcb->mslab, msg);
+	else
+		heapobj_free(&qcb->hobj, msg);
+}
+
 /**
  * @fn int rt_queue_create(RT_QUEUE *q, const char *name, size_t poolsize, size_t qlimit, int mode)
  * @brief Create a message queue.
@@ -217,7 +254,7 @@ int rt_queue_create(RT_QUEUE *queue, const char *name,
 	CANCEL_DEFER(svc);
 
 	ret = -ENOMEM;
-	qcb = xnmalloc(sizeof(*qcb));
+	qcb = xnslab_alloc(sizeof(*qcb));
 	if (qcb == NULL)
 		goto fail_cballoc;
 
@@ -230,14 +267,18 @@ int rt_queue_create(RT_QUEUE *queue, const char *name,
 	 * allocating the buffer pool. When the queue limit is not
 	 * known, assume 5% overhead.
 	 */
-	if (qlimit == Q_UNLIMITED)
+	if (qlimit == Q_UNLIMITED) {
 		ret = heapobj_init(&qcb->hobj, qcb->name,
 				   poolsize + (poolsize / 5));
-	else
+		memset(&qcb->mslab, 0, sizeof(qcb->mslab));
+	} else {
 		ret = heapobj_init_array(&qcb->hobj, qcb->name,
 					 (poolsize / qlimit) *
 					 sizeof(struct alchemy_queue_msg),
 					 qlimit);
+		heapobj_slab_init(&qcb->mslab, &qcb->hobj, poolsize / qlimit +
+				  sizeof(struct alchemy_queue_msg));
+	}
 	if (ret)
 		goto fail_bufalloc;
 
@@ -280,7 +321,7 @@ fail_register:
 fail_syncinit:
 	heapobj_destroy(&qcb->hobj);
 fail_bufalloc:
-	xnfree(qcb);
+	xnslab_free(qcb, sizeof(*qcb));
 fail_cballoc:
 	CANCEL_RESTORE(svc);
 
@@ -365,7 +406,7 @@ void *rt_queue_alloc(RT_QUEUE *queue, size_t size)
 	if (qcb == NULL)
 		goto out;
 
-	msg = heapobj_alloc(&qcb->hobj, size + sizeof(*msg));
+	msg = alloc_msg(qcb, size);
 	if (msg == NULL)
 		goto done;
 
@@ -440,7 +481,7 @@ int rt_queue_free(RT_QUEUE *queue, void *buf)
 	}
 
 	if (--msg->refcount == 0)
-		heapobj_free(&qcb->hobj, msg);
+		free_msg(qcb, msg);
 done:
 	put_alchemy_queue(qcb, &syns);
 out:
@@ -670,7 +711,7 @@ enqueue:
 	if (qcb->limit && qcb->mcount >= qcb->limit)
 		goto done;
 
-	msg = heapobj_alloc(&qcb->hobj, size + sizeof(*msg));
+	msg = alloc_msg(qcb, size);
 	if (msg == NULL)
 		goto done;
 
@@ -997,7 +1038,7 @@ wait:
 		ret = (ssize_t)(msg->size > size ? size : msg->size);
 		if (ret > 0) 
 			memcpy(buf, msg + 1, ret);
-		heapobj_free(&qcb->hobj, msg);
+		free_msg(qcb, msg);
 	} else	/* A direct copy took place. */
 		ret = (ssize_t)wait->usersz;
 
@@ -1051,7 +1092,7 @@ int rt_queue_flush(RT_QUEUE *queue)
 	if (!list_empty(&qcb->mq)) {
 		list_for_each_entry_safe(msg, tmp, &qcb->mq, next) {
 			list_remove(&msg->next);
-			heapobj_free(&qcb->hobj, msg);
+			free_msg(qcb, msg);
 		}
 	}
 
@@ -1099,7 +1140,8 @@ int rt_queue_inquire(RT_QUEUE *queue, RT_QUEUE_INFO *info)
 	info->mode = qcb->mode;
 	info->qlimit = qcb->limit;
 	info->poolsize = heapobj_size(&qcb->hobj);
-	info->usedmem = heapobj_inquire(&qcb->hobj);
+	info->usedmem = heapobj_inquire(&qcb->hobj) -
+		heapobj_slab_cached(&qcb->mslab);
 	strcpy(info->name, qcb->name);
 
 	put_alchemy_queue(qcb, &syns);
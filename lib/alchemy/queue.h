@@ -32,6 +32,7 @@ struct alchemy_queue {
 	int mode;
 	size_t limit;
 	struct heapobj hobj;
+	struct heapobj_slab mslab;
 	struct syncobj sobj;
 	struct clusterobj cobj;
 	struct list mq;
@@ -44,6 +45,7 @@ struct alchemy_queue {
 struct alchemy_queue_msg {
 	size_t size;
 	unsigned int refcount;
+	unsigned int slab;	/* Drawn from the slab pool. */
 	struct holder next;
 	/* Payload data follows. */
 };
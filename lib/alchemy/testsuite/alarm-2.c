@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <copperplate/traceobj.h>
+#include <alchemy/task.h>
+#include <alchemy/alarm.h>
+#include <alchemy/sem.h>
+#include <alchemy/timer.h>
+
+/*
+ * Run a bunch of periodic alarms with staggered phases, then report
+ * how late their handlers ran. Compare the figures obtained with
+ * --timer-servers=1 and --timer-servers=0 on SMP.
+ */
+
+#define NALARMS		64
+#define PERIOD_NS	1000000ULL
+#define NSHOTS		1000
+
+static struct traceobj trobj;
+
+static RT_TASK t_main;
+
+static RT_SEM done;
+
+static struct alarm_data {
+	RT_ALARM alrm;
+	RTIME expected;
+	RTIME max_lat;
+	RTIME sum_lat;
+	int hits;
+} alarms[NALARMS];
+
+static void alarm_handler(void *arg)
+{
+	struct alarm_data *ad = arg;
+	RTIME now = rt_timer_read(), lat;
+
+	lat = now > ad->expected ? now - ad->expected : 0;
+	ad->expected += PERIOD_NS;
+
+	if (ad->hits >= NSHOTS)
+		return;
+
+	if (lat > ad->max_lat)
+		ad->max_lat = lat;
+	ad->sum_lat += lat;
+
+	if (++ad->hits == NSHOTS)
+		rt_sem_v(&done);
+}
+
+static void main_task(void *arg)
+{
+	RTIME sum = 0, max = 0, delay;
+	struct alarm_data *ad;
+	int ret, n;
+
+	traceobj_enter(&trobj);
+
+	for (n = 0; n < NALARMS; n++) {
+		ad = alarms + n;
+		delay = PERIOD_NS + n * (PERIOD_NS / NALARMS);
+		ad->expected = rt_timer_read() + delay;
+		ret = rt_alarm_start(&ad->alrm, delay, PERIOD_NS);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	for (n = 0; n < NALARMS; n++) {
+		ret = rt_sem_p(&done, TM_INFINITE);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	for (n = 0; n < NALARMS; n++) {
+		ad = alarms + n;
+		ret = rt_alarm_delete(&ad->alrm);
+		traceobj_assert(&trobj, ret == 0);
+		sum += ad->sum_lat;
+		if (ad->max_lat > max)
+			max = ad->max_lat;
+	}
+
+	printf("%d alarms, %d shots: average lateness %llu ns, max %llu ns\n",
+	       NALARMS, NSHOTS,
+	       (unsigned long long)(sum / (NALARMS * NSHOTS)),
+	       (unsigned long long)max);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	int ret, n;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	for (n = 0; n < NALARMS; n++) {
+		ret = rt_alarm_create(&alarms[n].alrm, NULL,
+				      alarm_handler, alarms + n);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	ret = rt_sem_create(&done, "DONE", 0, S_FIFO);
+	traceobj_assert(&trobj, ret == 0);
+
+	ret = rt_task_create(&t_main, "main_task", 0, 50, 0);
+	traceobj_assert(&trobj, ret == 0);
+
+	ret = rt_task_start(&t_main, main_task, NULL);
+	traceobj_assert(&trobj, ret == 0);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
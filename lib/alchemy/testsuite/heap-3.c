@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <copperplate/traceobj.h>
+#include <alchemy/task.h>
+#include <alchemy/heap.h>
+#include <alchemy/timer.h>
+
+/*
+ * Touch a large heap block page by page in scattered order, then
+ * report the cost of the first pass, which may take page faults,
+ * and of the following ones, which are bound by TLB misses. Compare
+ * the figures obtained with and without --mem-pool-huge or
+ * --mem-pool-prefault in a shared session, passing the heap size
+ * in kbytes as an argument along with a large enough
+ * --mem-pool-size.
+ */
+
+#define DEFAULT_HEAPSIZE	(512 * 1024)
+#define PAGESZ			4096
+#define STRIDE			4099	/* Prime, in pages. */
+#define NPASSES			16
+
+static struct traceobj trobj;
+
+static RT_TASK t_main;
+
+static RT_HEAP heap;
+
+static size_t heapsize = DEFAULT_HEAPSIZE;
+
+static RTIME run_pass(volatile char *mem, size_t npages, int write)
+{
+	RTIME start = rt_timer_read();
+	size_t n, page = 0;
+
+	for (n = 0; n < npages; n++) {
+		if (write)
+			mem[page * PAGESZ] = (char)n;
+		else
+			(void)mem[page * PAGESZ];
+		page = (page + STRIDE) % npages;
+	}
+
+	return rt_timer_read() - start;
+}
+
+static void main_task(void *arg)
+{
+	RTIME first, sum = 0;
+	size_t npages;
+	void *mem;
+	int ret, n;
+
+	traceobj_enter(&trobj);
+
+	ret = rt_heap_alloc(&heap, heapsize, TM_NONBLOCK, &mem);
+	traceobj_assert(&trobj, ret == 0);
+
+	npages = heapsize / PAGESZ;
+	first = run_pass(mem, npages, 1);
+	for (n = 0; n < NPASSES; n++)
+		sum += run_pass(mem, npages, 0);
+
+	printf("%zu pages: first touch %llu ns/page, traversal %llu ns/page\n",
+	       npages, (unsigned long long)(first / npages),
+	       (unsigned long long)(sum / (npages * NPASSES)));
+
+	ret = rt_heap_free(&heap, mem);
+	traceobj_assert(&trobj, ret == 0);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	if (argc > 1)
+		heapsize = (size_t)atoi(argv[1]) * 1024;
+	traceobj_assert(&trobj, heapsize >= PAGESZ);
+
+	ret = rt_heap_create(&heap, "HEAP", heapsize, H_SINGLE);
+	traceobj_assert(&trobj, ret == 0);
+
+	ret = rt_task_create(&t_main, "main_task", 0, 50, 0);
+	traceobj_assert(&trobj, ret == 0);
+
+	ret = rt_task_start(&t_main, main_task, NULL);
+	traceobj_assert(&trobj, ret == 0);
+
+	traceobj_join(&trobj);
+
+	ret = rt_heap_delete(&heap);
+	traceobj_assert(&trobj, ret == 0);
+
+	exit(0);
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <copperplate/traceobj.h>
+#include <alchemy/task.h>
+#include <alchemy/queue.h>
+#include <alchemy/buffer.h>
+#include <alchemy/timer.h>
+
+#define NLOOPS		100000
+#define NOBJECTS	1000
+#define MSGSIZE		64
+#define NMSGS		16
+
+static struct traceobj trobj;
+
+static RT_TASK t_main;
+
+static void report(const char *what, RTIME start, int count)
+{
+	RTIME delta = rt_timer_read() - start;
+
+	printf("%-24s %8llu ns/op\n", what,
+	       (unsigned long long)(delta / count));
+}
+
+static void bench_queue_alloc(const char *what, size_t qlimit)
+{
+	void *bufs[NMSGS], *buf;
+	RTIME start;
+	RT_QUEUE q;
+	int ret, n, m;
+
+	ret = rt_queue_create(&q, "QUEUE", MSGSIZE * NMSGS, qlimit, Q_FIFO);
+	traceobj_assert(&trobj, ret == 0);
+
+	/*
+	 * A message released to a fixed-count queue is recycled
+	 * first.
+	 */
+	buf = rt_queue_alloc(&q, MSGSIZE);
+	traceobj_assert(&trobj, buf != NULL);
+	ret = rt_queue_free(&q, buf);
+	traceobj_assert(&trobj, ret == 0);
+	if (qlimit != Q_UNLIMITED)
+		traceobj_assert(&trobj, rt_queue_alloc(&q, MSGSIZE) == buf);
+	else
+		buf = rt_queue_alloc(&q, MSGSIZE);
+	ret = rt_queue_free(&q, buf);
+	traceobj_assert(&trobj, ret == 0);
+
+	start = rt_timer_read();
+
+	for (n = 0; n < NLOOPS / NMSGS; n++) {
+		for (m = 0; m < NMSGS; m++) {
+			bufs[m] = rt_queue_alloc(&q, MSGSIZE);
+			traceobj_assert(&trobj, bufs[m] != NULL);
+		}
+		for (m = 0; m < NMSGS; m++) {
+			ret = rt_queue_free(&q, bufs[m]);
+			traceobj_assert(&trobj, ret == 0);
+		}
+	}
+
+	report(what, start, (NLOOPS / NMSGS) * NMSGS);
+
+	ret = rt_queue_delete(&q);
+	traceobj_assert(&trobj, ret == 0);
+}
+
+static void bench_queue_create(void)
+{
+	RTIME start;
+	RT_QUEUE q;
+	int ret, n;
+
+	start = rt_timer_read();
+
+	for (n = 0; n < NOBJECTS; n++) {
+		ret = rt_queue_create(&q, NULL, MSGSIZE * NMSGS, NMSGS, Q_FIFO);
+		traceobj_assert(&trobj, ret == 0);
+		ret = rt_queue_delete(&q);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	report("queue create/delete", start, NOBJECTS);
+}
+
+static void bench_buffer_create(void)
+{
+	RTIME start;
+	RT_BUFFER bf;
+	int ret, n;
+
+	start = rt_timer_read();
+
+	for (n = 0; n < NOBJECTS; n++) {
+		ret = rt_buffer_create(&bf, NULL, MSGSIZE, B_FIFO);
+		traceobj_assert(&trobj, ret == 0);
+		ret = rt_buffer_delete(&bf);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	report("buffer create/delete", start, NOBJECTS);
+}
+
+static void bench_task_create(void)
+{
+	RTIME start;
+	RT_TASK t;
+	int ret, n;
+
+	start = rt_timer_read();
+
+	for (n = 0; n < NOBJECTS; n++) {
+		ret = rt_task_create(&t, NULL, 0, 1, 0);
+		traceobj_assert(&trobj, ret == 0);
+		ret = rt_task_delete(&t);
+		traceobj_assert(&trobj, ret == 0);
+	}
+
+	report("task create/delete", start, NOBJECTS);
+}
+
+static void main_task(void *arg)
+{
+	traceobj_enter(&trobj);
+
+	bench_queue_alloc("queue alloc (slab)", NMSGS);
+	bench_queue_alloc("queue alloc (heap)", Q_UNLIMITED);
+	bench_queue_create();
+	bench_buffer_create();
+	bench_task_create();
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = rt_task_create(&t_main, "main_task", 0, 50, 0);
+	traceobj_assert(&trobj, ret == 0);
+
+	ret = rt_task_start(&t_main, main_task, NULL);
+	traceobj_assert(&trobj, ret == 0);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
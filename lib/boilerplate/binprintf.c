@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "boilerplate/binprintf.h"
+
+/*
+ * Arguments are packed back to back with no padding, each one in
+ * its native representation, strings being copied inline with their
+ * terminating null byte.
+ */
+enum bin_type {
+	BIN_LITERAL,
+	BIN_INT,
+	BIN_LONG,
+	BIN_LLONG,
+	BIN_INTMAX,
+	BIN_SIZE,
+	BIN_PTRDIFF,
+	BIN_DOUBLE,
+	BIN_LDOUBLE,
+	BIN_PTR,
+	BIN_STR,
+	BIN_ERRNO,
+};
+
+#define BIN_SPEC_MAX  32
+
+struct bin_spec {
+	enum bin_type type;
+	int stars;
+	int prec;	/* -1 if unspecified, -2 if given as an argument */
+	size_t len;
+};
+
+/*
+ * Parse the conversion specification starting at @p, which points
+ * at a '%' sign. Returns -EINVAL for conversions we cannot defer,
+ * i.e. %n and wide strings.
+ */
+static int parse_spec(const char *p, struct bin_spec *spec)
+{
+	const char *start = p++;
+	int lmod = 0, digits;
+
+	spec->stars = 0;
+	spec->prec = -1;
+
+	while (*p && strchr("-+ #0'I", *p))
+		p++;
+
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	} else
+		while (*p >= '0' && *p <= '9')
+			p++;
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			spec->prec = -2;
+			p++;
+		} else {
+			for (digits = 0; *p >= '0' && *p <= '9'; p++)
+				digits = digits * 10 + *p - '0';
+			spec->prec = digits;
+		}
+	}
+
+	switch (*p) {
+	case 'h':
+		lmod = 'h';
+		if (*++p == 'h')
+			p++;
+		break;
+	case 'l':
+		lmod = 'l';
+		if (*++p == 'l') {
+			lmod = 'q';
+			p++;
+		}
+		break;
+	case 'q':
+	case 'L':
+	case 'j':
+	case 'z':
+	case 'Z':
+	case 't':
+		lmod = *p++;
+		break;
+	}
+
+	switch (*p) {
+	case '%':
+		spec->type = BIN_LITERAL;
+		break;
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		switch (lmod) {
+		case 'l':
+			spec->type = BIN_LONG;
+			break;
+		case 'q':
+		case 'L':
+			spec->type = BIN_LLONG;
+			break;
+		case 'j':
+			spec->type = BIN_INTMAX;
+			break;
+		case 'z':
+		case 'Z':
+			spec->type = BIN_SIZE;
+			break;
+		case 't':
+			spec->type = BIN_PTRDIFF;
+			break;
+		default:
+			spec->type = BIN_INT;
+		}
+		break;
+	case 'c':
+		spec->type = BIN_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		spec->type = lmod == 'L' ? BIN_LDOUBLE : BIN_DOUBLE;
+		break;
+	case 'p':
+		spec->type = BIN_PTR;
+		break;
+	case 's':
+		if (lmod == 'l')
+			return -EINVAL;
+		spec->type = BIN_STR;
+		break;
+	case 'm':
+		spec->type = BIN_ERRNO;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	spec->len = p + 1 - start;
+	if (spec->len >= BIN_SPEC_MAX)
+		return -EINVAL;
+
+	return 0;
+}
+
+#define pack_value(__type, __val)				\
+	do {							\
+		__type __v = (__val);				\
+		if (pos + sizeof(__v) > size)			\
+			return -ENOSPC;				\
+		memcpy(buf + pos, &__v, sizeof(__v));		\
+		pos += sizeof(__v);				\
+	} while (0)
+
+/**
+ * Pack the arguments of a printf-like call into @buf, returning the
+ * number of bytes used, -ENOSPC if @buf is too short, or -EINVAL if
+ * @format contains a conversion which cannot be deferred.
+ */
+ssize_t binprintf_pack(char *buf, size_t size,
+		       const char *format, va_list args)
+{
+	struct bin_spec spec;
+	const char *p, *s;
+	size_t pos = 0, len;
+	int n, ret, star = -1;
+
+	for (p = format; *p; p++) {
+		if (*p != '%')
+			continue;
+
+		ret = parse_spec(p, &spec);
+		if (ret)
+			return ret;
+
+		p += spec.len - 1;
+
+		for (n = 0; n < spec.stars; n++) {
+			star = va_arg(args, int);
+			pack_value(int, star);
+		}
+
+		switch (spec.type) {
+		case BIN_LITERAL:
+			break;
+		case BIN_INT:
+			pack_value(int, va_arg(args, int));
+			break;
+		case BIN_LONG:
+			pack_value(long, va_arg(args, long));
+			break;
+		case BIN_LLONG:
+			pack_value(long long, va_arg(args, long long));
+			break;
+		case BIN_INTMAX:
+			pack_value(intmax_t, va_arg(args, intmax_t));
+			break;
+		case BIN_SIZE:
+			pack_value(size_t, va_arg(args, size_t));
+			break;
+		case BIN_PTRDIFF:
+			pack_value(ptrdiff_t, va_arg(args, ptrdiff_t));
+			break;
+		case BIN_DOUBLE:
+			pack_value(double, va_arg(args, double));
+			break;
+		case BIN_LDOUBLE:
+			pack_value(long double, va_arg(args, long double));
+			break;
+		case BIN_PTR:
+			pack_value(void *, va_arg(args, void *));
+			break;
+		case BIN_STR:
+			s = va_arg(args, const char *);
+			if (s == NULL)
+				s = "(null)";
+			/* The string may be bounded by the precision. */
+			if (spec.prec == -2 && star >= 0)
+				len = strnlen(s, star);
+			else if (spec.prec >= 0)
+				len = strnlen(s, spec.prec);
+			else
+				len = strlen(s);
+			if (pos + len + 1 > size)
+				return -ENOSPC;
+			memcpy(buf + pos, s, len);
+			buf[pos + len] = '\0';
+			pos += len + 1;
+			break;
+		case BIN_ERRNO:
+			pack_value(int, errno);
+			break;
+		}
+	}
+
+	return pos;
+}
+
+#define unpack_value(__type, __var)				\
+	do {							\
+		if (pos + sizeof(__type) > argsz)		\
+			goto bad;				\
+		memcpy(&(__var), args + pos, sizeof(__type));	\
+		pos += sizeof(__type);				\
+	} while (0)
+
+#define format_value(__val)						\
+	do {								\
+		switch (spec.stars) {					\
+		case 0:							\
+			ret = snprintf(out, room, fmt, __val);		\
+			break;						\
+		case 1:							\
+			ret = snprintf(out, room, fmt, stars[0], __val); \
+			break;						\
+		default:						\
+			ret = snprintf(out, room, fmt, stars[0],	\
+				       stars[1], __val);		\
+		}							\
+	} while (0)
+
+/**
+ * Format a record packed by binprintf_pack() into @buf, with
+ * snprintf() semantics. Returns -EINVAL if @args does not match
+ * @format.
+ */
+int binprintf_format(char *buf, size_t size, const char *format,
+		     const char *args, size_t argsz)
+{
+	char fmt[BIN_SPEC_MAX], *out;
+	int n, ret, stars[2], errnum;
+	size_t pos = 0, total = 0, room;
+	struct bin_spec spec;
+	long double ld;
+	const char *p;
+	long long ll;
+	ptrdiff_t pd;
+	intmax_t im;
+	double d;
+	size_t sz;
+	void *ptr;
+	long l;
+	int i;
+
+	for (p = format; *p; p += spec.len) {
+		out = total < size ? buf + total : NULL;
+		room = total < size ? size - total : 0;
+
+		if (*p != '%') {
+			spec.len = strcspn(p, "%");
+			if (room > 0) {
+				n = spec.len < room ? spec.len : room - 1;
+				memcpy(out, p, n);
+				out[n] = '\0';
+			}
+			total += spec.len;
+			continue;
+		}
+
+		if (parse_spec(p, &spec))
+			goto bad;
+
+		memcpy(fmt, p, spec.len);
+		fmt[spec.len] = '\0';
+
+		for (n = 0; n < spec.stars; n++)
+			unpack_value(int, stars[n]);
+
+		switch (spec.type) {
+		case BIN_LITERAL:
+			ret = snprintf(out, room, "%%");
+			break;
+		case BIN_INT:
+			unpack_value(int, i);
+			format_value(i);
+			break;
+		case BIN_LONG:
+			unpack_value(long, l);
+			format_value(l);
+			break;
+		case BIN_LLONG:
+			unpack_value(long long, ll);
+			format_value(ll);
+			break;
+		case BIN_INTMAX:
+			unpack_value(intmax_t, im);
+			format_value(im);
+			break;
+		case BIN_SIZE:
+			unpack_value(size_t, sz);
+			format_value(sz);
+			break;
+		case BIN_PTRDIFF:
+			unpack_value(ptrdiff_t, pd);
+			format_value(pd);
+			break;
+		case BIN_DOUBLE:
+			unpack_value(double, d);
+			format_value(d);
+			break;
+		case BIN_LDOUBLE:
+			unpack_value(long double, ld);
+			format_value(ld);
+			break;
+		case BIN_PTR:
+			unpack_value(void *, ptr);
+			format_value(ptr);
+			break;
+		case BIN_STR:
+			n = strnlen(args + pos, argsz - pos);
+			if (pos + n >= argsz)
+				goto bad;
+			format_value(args + pos);
+			pos += n + 1;
+			break;
+		case BIN_ERRNO:
+			unpack_value(int, errnum);
+			ret = snprintf(out, room, "%s", strerror(errnum));
+			break;
+		default:
+			goto bad;
+		}
+
+		if (ret < 0)
+			return ret;
+
+		total += ret;
+	}
+
+	if (total > INT_MAX)
+		return -EOVERFLOW;
+
+	return total;
+bad:
+	return -EINVAL;
+}
@@ -656,6 +656,47 @@ void tlsf_free(void *ptr)
 
 }
 
+/******************************************************************/
+int tlsf_malloc_batch(size_t size, void **blocks, int nr)
+{
+/******************************************************************/
+    int n = 0;
+
+#if USE_MMAP || USE_SBRK
+    if (!mp) {
+	if (nr <= 0 || (blocks[0] = tlsf_malloc(size)) == NULL)
+	    return 0;
+	n = 1;
+    }
+#endif
+
+    TLSF_ACQUIRE_LOCK(&((tlsf_t *)mp)->lock);
+
+    for (; n < nr; n++) {
+	blocks[n] = malloc_ex(size, mp);
+	if (!blocks[n])
+	    break;
+    }
+
+    TLSF_RELEASE_LOCK(&((tlsf_t *)mp)->lock);
+
+    return n;
+}
+
+/******************************************************************/
+void tlsf_free_batch(void **blocks, int nr)
+{
+/******************************************************************/
+    int n;
+
+    TLSF_ACQUIRE_LOCK(&((tlsf_t *)mp)->lock);
+
+    for (n = 0; n < nr; n++)
+	free_ex(blocks[n], mp);
+
+    TLSF_RELEASE_LOCK(&((tlsf_t *)mp)->lock);
+}
+
 /******************************************************************/
 void *tlsf_realloc(void *ptr, size_t size)
 {
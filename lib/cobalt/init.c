@@ -123,6 +123,7 @@ static void cobalt_fork_handler(void)
 	cobalt_unmap_umm();
 	cobalt_clear_tsd();
 	cobalt_print_init_atfork();
+	cobalt_mq_init_atfork();
 #ifdef HAVE_PTHREAD_ATFORK
 	/*
 	 * Upon fork, in case the parent required init deferral, this
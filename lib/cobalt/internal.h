@@ -52,6 +52,10 @@ void cobalt_print_init_atfork(void);
 
 void cobalt_print_exit(void);
 
+void cobalt_mq_init_atfork(void);
+
+void cobalt_mq_detach(int fd);
+
 void cobalt_ticks_init(unsigned long long freq);
 
 void cobalt_default_mutexattr_init(void);
@@ -18,11 +18,14 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <mqueue.h>
 #include <asm/xenomai/syscall.h>
+#include <boilerplate/atomic.h>
+#include <cobalt/uapi/mqueue.h>
 #include "internal.h"
 
 /**
@@ -36,9 +39,146 @@
  * maximum number of messages are fixed when it is created with
  * mq_open().
  *
+ * Queues holding a few small messages live in the shared memory
+ * heap, where mq_send(), mq_receive() and their timed variants
+ * transfer messages without issuing any syscall, unless the caller
+ * has to wait or some thread has to be woken up.
+ *
  *@{
  */
 
+/*
+ * Shared state of the queues which support direct transfers,
+ * indexed by descriptor. Descriptors beyond this range always go
+ * through the kernel.
+ */
+#define MQ_SHARED_FDMAX  1024
+
+static struct mq_shared {
+	struct cobalt_mq_state *state;
+	int oflags;
+} mq_shared[MQ_SHARED_FDMAX];
+
+static void mq_attach_shared(int fd, int oflags)
+{
+	struct mq_shared *p;
+	int off;
+
+	if (fd >= MQ_SHARED_FDMAX)
+		return;
+
+	p = mq_shared + fd;
+	off = XENOMAI_SYSCALL1(sc_cobalt_mq_state, fd);
+	if (off < 0) {
+		p->state = NULL;
+		return;
+	}
+
+	p->oflags = oflags;
+	smp_wmb();
+	p->state = cobalt_umm_shared + off;
+}
+
+/*
+ * Called on mq_close() and close() alike, since the descriptor may
+ * be reused for any other object afterwards.
+ */
+void cobalt_mq_detach(int fd)
+{
+	if ((unsigned int)fd < MQ_SHARED_FDMAX)
+		mq_shared[fd].state = NULL;
+}
+
+static inline struct cobalt_mq_state *mq_get_state(mqd_t q, int access)
+{
+	struct cobalt_mq_state *state;
+	struct mq_shared *p;
+	int mode;
+
+	if ((unsigned int)q >= MQ_SHARED_FDMAX)
+		return NULL;
+
+	p = mq_shared + q;
+	state = p->state;
+	if (state == NULL)
+		return NULL;
+
+	smp_rmb();
+	mode = p->oflags & O_ACCMODE;
+	if (mode != O_RDWR && mode != access)
+		return NULL;
+
+	return state;
+}
+
+/*
+ * Try sending through the shared area. Returns -EAGAIN if the kernel
+ * has to handle the request, including for reporting errors.
+ */
+static int mq_send_shared(mqd_t q, const char *buffer,
+			  size_t len, unsigned int prio)
+{
+	struct cobalt_mq_state *state;
+	struct cobalt_mq_slot *slot;
+	int events = 0;
+
+	state = mq_get_state(q, O_WRONLY);
+	if (state == NULL || len > state->msgsize || prio >= COBALT_MQ_PRIOMAX)
+		return -EAGAIN;
+
+	if (!cobalt_mq_reserve(&state->nfree))
+		return -EAGAIN;
+
+	slot = cobalt_mq_claim_free(state, state->maxmsg, state->slotsize,
+				    0, cobalt_get_current_fast());
+	memcpy(slot->data, buffer, len);
+	if (cobalt_mq_publish(state, slot, prio, len) == 0)
+		events = COBALT_MQ_FILLED;
+
+	if (ACCESS_ONCE(state->flags) & (COBALT_MQ_RCVWAIT|COBALT_MQ_SYNC))
+		XENOMAI_SYSCALL2(sc_cobalt_mq_sync, q, events);
+
+	return 0;
+}
+
+static ssize_t mq_receive_shared(mqd_t q, char *buffer,
+				 size_t len, unsigned int *prio)
+{
+	struct cobalt_mq_state *state;
+	struct cobalt_mq_slot *slot;
+	ssize_t rlen;
+
+	state = mq_get_state(q, O_RDONLY);
+	if (state == NULL || len < state->msgsize)
+		return -EAGAIN;
+
+	if (!cobalt_mq_reserve(&state->nready))
+		return -EAGAIN;
+
+	slot = cobalt_mq_claim_ready(state, state->maxmsg, state->slotsize,
+				     0, cobalt_get_current_fast());
+	rlen = slot->len;
+	/* Drop messages no sender could have queued legitimately. */
+	if (rlen > len || rlen > state->msgsize)
+		rlen = -EAGAIN;
+	else {
+		memcpy(buffer, slot->data, rlen);
+		if (prio)
+			*prio = slot->prio;
+	}
+	cobalt_mq_release(state, slot);
+
+	if (ACCESS_ONCE(state->flags) & (COBALT_MQ_SNDWAIT|COBALT_MQ_SYNC))
+		XENOMAI_SYSCALL2(sc_cobalt_mq_sync, q, 0);
+
+	return rlen;
+}
+
+void cobalt_mq_init_atfork(void)
+{
+	memset(mq_shared, 0, sizeof(mq_shared));
+}
+
 /**
  * @brief Open a message queue
  *
@@ -119,6 +259,8 @@ COBALT_IMPL(mqd_t, mq_open, (const char *name, int oflags, ...))
 		return (mqd_t)-1;
 	}
 
+	mq_attach_shared(fd, oflags);
+
 	return (mqd_t)fd;
 }
 
@@ -145,6 +287,8 @@ COBALT_IMPL(int, mq_close, (mqd_t mqd))
 {
 	int err;
 
+	cobalt_mq_detach(mqd);
+
 	err = XENOMAI_SYSCALL1(sc_cobalt_mq_close, mqd);
 	if (err) {
 		errno = -err;
@@ -312,6 +456,7 @@ COBALT_IMPL(int, mq_setattr, (mqd_t mqd,
  * - EAGAIN, the flag O_NONBLOCK is set for the descriptor @a fd and the message
  *   queue is full;
  * - EPERM, the caller context is invalid;
+ * - EIO, the shared state of the queue was found corrupted;
  * - EINTR, the service was interrupted by a signal.
  *
  * @see
@@ -323,6 +468,9 @@ COBALT_IMPL(int, mq_send, (mqd_t q, const char *buffer, size_t len, unsigned pri
 {
 	int err, oldtype;
 
+	if (mq_send_shared(q, buffer, len, prio) == 0)
+		return 0;
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedsend,
@@ -364,6 +512,7 @@ COBALT_IMPL(int, mq_send, (mqd_t q, const char *buffer, size_t len, unsigned pri
  * - EAGAIN, the flag O_NONBLOCK is set for the descriptor @a fd and the message
  *   queue is full;
  * - EPERM, the caller context is invalid;
+ * - EIO, the shared state of the queue was found corrupted;
  * - ETIMEDOUT, the specified timeout expired;
  * - EINTR, the service was interrupted by a signal.
  *
@@ -382,6 +531,9 @@ COBALT_IMPL(int, mq_timedsend, (mqd_t q,
 	if (timeout == NULL)
 		return -EFAULT;
 
+	if (mq_send_shared(q, buffer, len, prio) == 0)
+		return 0;
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedsend,
@@ -428,6 +580,7 @@ COBALT_IMPL(int, mq_timedsend, (mqd_t q,
  * - EAGAIN, the queue is empty, and the flag @a O_NONBLOCK is set for the
  *   descriptor @a fd;
  * - EPERM, the caller context is invalid;
+ * - EIO, the shared state of the queue was found corrupted;
  * - EINTR, the service was interrupted by a signal.
  *
  * @see
@@ -437,9 +590,14 @@ COBALT_IMPL(int, mq_timedsend, (mqd_t q,
  */
 COBALT_IMPL(ssize_t, mq_receive, (mqd_t q, char *buffer, size_t len, unsigned *prio))
 {
-	ssize_t rlen = (ssize_t) len;
+	ssize_t rlen;
 	int err, oldtype;
 
+	rlen = mq_receive_shared(q, buffer, len, prio);
+	if (rlen >= 0)
+		return rlen;
+
+	rlen = (ssize_t) len;
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedreceive,
@@ -484,6 +642,7 @@ COBALT_IMPL(ssize_t, mq_receive, (mqd_t q, char *buffer, size_t len, unsigned *p
  * - EAGAIN, the queue is empty, and the flag @a O_NONBLOCK is set for the
  *   descriptor @a fd;
  * - EPERM, the caller context is invalid;
+ * - EIO, the shared state of the queue was found corrupted;
  * - EINTR, the service was interrupted by a signal;
  * - ETIMEDOUT, the specified timeout expired.
  *
@@ -498,12 +657,17 @@ COBALT_IMPL(ssize_t, mq_timedreceive, (mqd_t q,
 				       unsigned *__restrict__ prio,
 				       const struct timespec * __restrict__ timeout))
 {
-	ssize_t rlen = (ssize_t) len;
+	ssize_t rlen;
 	int err, oldtype;
 
 	if (timeout == NULL)
 		return -EFAULT;
 
+	rlen = mq_receive_shared(q, buffer, len, prio);
+	if (rlen >= 0)
+		return rlen;
+
+	rlen = (ssize_t) len;
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedreceive,
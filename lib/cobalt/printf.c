@@ -26,8 +26,14 @@
 #include <string.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #include <boilerplate/atomic.h>
 #include <boilerplate/compiler.h>
+#include <boilerplate/binprintf.h>
+#include <cobalt/ticks.h>
+#include <asm/xenomai/tsc.h>
 #include "current.h"
 #include "internal.h"
 
@@ -40,21 +46,47 @@
 #define RT_PRINT_BUFFERS_COUNT_ENV      "RT_PRINT_BUFFERS_COUNT"
 #define RT_PRINT_DEFAULT_BUFFERS_COUNT  4
 
+#define RT_PRINT_BINARY_DUMP_ENV	"RT_PRINT_BINARY_DUMP"
+
 #define RT_PRINT_LINE_BREAK		256
 
+/* Max. number of entries written out by a single writev() call. */
+#define RT_PRINT_IOV_MAX		64
+
+/* Room for formatting the binary entries of an output batch. */
+#define RT_PRINT_BATCH_TEXT		8192
+
+/*
+ * Shortest polling period as a power of two fraction of the default
+ * one, for serving writers which cannot ring the doorbell.
+ */
+#define RT_PRINT_MAX_SPEEDUP		6
+
 #define RT_PRINT_SYSLOG_STREAM		NULL
 
 #define RT_PRINT_MODE_FORMAT		0
 #define RT_PRINT_MODE_FWRITE		1
+#define RT_PRINT_MODE_BINARY		2
 
 struct entry_head {
 	FILE *dest;
 	uint32_t seq_no;
 	int priority;
+	int mode;
 	size_t len;
 	char data[0];
 } __attribute__((packed));
 
+/*
+ * Binary entries carry the unformatted arguments, packed after this
+ * header.
+ */
+struct binary_head {
+	const char *format;
+	unsigned long long tsc;
+	char args[0];
+} __attribute__((packed));
+
 struct print_buffer {
 	off_t write_pos;
 
@@ -65,11 +97,21 @@ struct print_buffer {
 
 	char name[32];
 
+	/* Count of messages lost or truncated for lack of space. */
+	unsigned long dropped;
+
 	/*
 	 * Keep read_pos separated from write_pos to optimise write
 	 * caching on SMP.
 	 */
 	off_t read_pos;
+
+	/*
+	 * Printer-private state: print_pos runs ahead of read_pos
+	 * over the entries pending in the current output batch.
+	 */
+	off_t print_pos;
+	unsigned long reported;
 };
 
 __weak int __cobalt_print_bufsz = RT_PRINT_DEFAULT_BUFFER;
@@ -83,13 +125,36 @@ static pthread_mutex_t buffer_lock;
 static pthread_cond_t printer_wakeup;
 static pthread_key_t buffer_key;
 static pthread_t printer_thread;
+static atomic_t printer_doorbell;
+static struct print_buffer **merge_heap;
+static int merge_heap_len;
+static FILE *binary_dump;
 static atomic_long_t *pool_bitmap;
 static unsigned pool_bitmap_len;
 static unsigned pool_buf_size;
 static unsigned long pool_start, pool_len;
 
 static void cleanup_buffer(struct print_buffer *buffer);
-static void print_buffers(void);
+static int print_buffers(void);
+
+/*
+ * Wake up the printer when a ring starts filling up. Threads running
+ * in primary mode must not issue regular syscalls, the printer polls
+ * their buffers at a rate adapted to the backlog instead.
+ */
+static void ring_doorbell(void)
+{
+	if (cobalt_get_current() != XN_NO_HANDLE &&
+	    !(cobalt_get_current_mode() & XNRELAX))
+		return;
+
+	if (atomic_read(&printer_doorbell) ||
+	    atomic_cmpxchg(&printer_doorbell, 0, 1) != 0)
+		return;
+
+	syscall(__NR_futex, &printer_doorbell.v, FUTEX_WAKE_PRIVATE, 1,
+		NULL, NULL, 0);
+}
 
 /* *** rt_print API *** */
 
@@ -100,7 +165,7 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 	struct print_buffer *buffer = pthread_getspecific(buffer_key);
 	off_t write_pos, read_pos;
 	struct entry_head *head;
-	int len, str_len;
+	int len, str_len, was_empty;
 	int res = 0;
 
 	if (!buffer) {
@@ -121,6 +186,7 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 	write_pos = buffer->write_pos;
 	read_pos = buffer->read_pos;
 	smp_mb();
+	was_empty = write_pos == read_pos;
 
 	/* Is our write limit the end of the ring buffer? */
 	if (write_pos >= read_pos) {
@@ -175,6 +241,8 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 				len = res;
 			} else {
 				/* Text was truncated */
+				if (res > 0)
+					buffer->dropped++;
 				res = len;
 			}
 		} else {
@@ -195,20 +263,48 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 				len = res + 1;
 			} else {
 				/* Text was truncated */
+				if (res > 0)
+					buffer->dropped++;
 				res = len;
 			}
 		}
+	} else if (mode == RT_PRINT_MODE_BINARY) {
+		struct binary_head *bin = (struct binary_head *)head->data;
+		ssize_t ret = -ENOSPC;
+
+		if (len > (int)sizeof(*bin))
+			ret = binprintf_pack(bin->args, len - sizeof(*bin),
+					     format, args);
+		if (ret == -EINVAL) {
+			errno = EINVAL;
+			return -1;
+		}
+		if (ret < 0) {
+			buffer->dropped++;
+			len = 0;
+		} else {
+			bin->format = format;
+			bin->tsc = cobalt_read_tsc();
+			len = sizeof(*bin) + ret;
+		}
 	} else if (len >= 1) {
 		str_len = sz;
-		len = (str_len < len) ? str_len : len;
+		if (str_len > len)
+			buffer->dropped++;
+		else
+			len = str_len;
 		memcpy(head->data, format, len);
-	} else
+	} else {
+		if (sz > 0)
+			buffer->dropped++;
 		len = 0;
+	}
 
 	/* If we were able to write some text, finalise the entry */
 	if (len > 0) {
 		head->seq_no = ++seq_no;
 		head->priority = priority;
+		head->mode = mode;
 		head->dest = stream;
 		head->len = len;
 
@@ -233,6 +329,15 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 
 	buffer->write_pos = write_pos;
 
+	/*
+	 * Ring the doorbell when the buffer was empty, or is half
+	 * full.
+	 */
+	if (len > 0 &&
+	    (was_empty || (write_pos - read_pos + buffer->size) % buffer->size
+	     >= buffer->size / 2))
+		ring_doorbell();
+
 	return res;
 }
 
@@ -333,6 +438,48 @@ size_t rt_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
 	return nmemb;
 }
 
+/*
+ * Binary variants: only the format pointer, a timestamp and the raw
+ * arguments are logged, formatting is left to the printer thread, or
+ * to rtprintdump when RT_PRINT_BINARY_DUMP names a dump file. The
+ * format string must remain valid for the lifetime of the process.
+ * %n and wide strings are not supported.
+ */
+int rt_vfbprintf(FILE *stream, const char *format, va_list args)
+{
+	if (stream == RT_PRINT_SYSLOG_STREAM) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return vprint_to_buffer(stream, 0, 0,
+				RT_PRINT_MODE_BINARY, 0, format, args);
+}
+
+int rt_fbprintf(FILE *stream, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = rt_vfbprintf(stream, format, args);
+	va_end(args);
+
+	return n;
+}
+
+int rt_bprintf(const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = rt_vfbprintf(stdout, format, args);
+	va_end(args);
+
+	return n;
+}
+
 
 void rt_syslog(int priority, const char *format, ...)
 {
@@ -380,6 +527,9 @@ static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
 
 	buffer->read_pos  = 0;
 	buffer->write_pos = 0;
+	buffer->print_pos = 0;
+	buffer->dropped = 0;
+	buffer->reported = 0;
 
 	buffer->prev = NULL;
 
@@ -575,87 +725,309 @@ static void cleanup_buffer(struct print_buffer *buffer)
 	free(buffer);
 }
 
+/*
+ * Move the print cursor past any wrap-around marker, returning
+ * non-zero if an entry is pending at the resulting position.
+ */
+static int get_next_entry(struct print_buffer *buffer)
+{
+	struct entry_head *head;
+
+	for (;;) {
+		if (buffer->print_pos == buffer->write_pos)
+			return 0;
+
+		/* Make sure we read the entry after write_pos. */
+		smp_rmb();
+		head = buffer->ring + buffer->print_pos;
+		if (head->len)
+			return 1;
+
+		/* Empty entries mark the wrap-around */
+		buffer->print_pos = 0;
+	}
+}
+
 static inline uint32_t get_next_seq_no(struct print_buffer *buffer)
 {
-	struct entry_head *head = buffer->ring + buffer->read_pos;
+	struct entry_head *head = buffer->ring + buffer->print_pos;
 	return head->seq_no;
 }
 
-static struct print_buffer *get_next_buffer(void)
+static inline int seq_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static void sift_down(struct print_buffer **heap, int nr, int pos)
 {
-	struct print_buffer *pos = first_buffer;
-	struct print_buffer *buffer = NULL;
-	uint32_t next_seq_no = 0; /* silence gcc... */
+	struct print_buffer *buffer = heap[pos];
+	uint32_t seq = get_next_seq_no(buffer);
+	int child;
+
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= nr)
+			break;
+		if (child + 1 < nr &&
+		    seq_before(get_next_seq_no(heap[child + 1]),
+			       get_next_seq_no(heap[child])))
+			child++;
+		if (!seq_before(get_next_seq_no(heap[child]), seq))
+			break;
+		heap[pos] = heap[child];
+		pos = child;
+	}
+
+	heap[pos] = buffer;
+}
 
-	while (pos) {
-		if (pos->read_pos != pos->write_pos &&
-		    (!buffer || get_next_seq_no(pos) < next_seq_no)) {
-			buffer = pos;
-			next_seq_no = get_next_seq_no(pos);
+/*
+ * Output batch: consecutive entries bound to the same stream are
+ * written out at once, the ring space they occupy is released
+ * afterwards. Binary entries are formatted to the text area.
+ */
+static struct print_batch {
+	FILE *dest;
+	struct iovec iov[RT_PRINT_IOV_MAX];
+	int nr;
+	char text[RT_PRINT_BATCH_TEXT];
+	size_t text_len;
+} output_batch;
+
+static void write_batch(struct print_batch *batch)
+{
+	struct iovec *iov = batch->iov;
+	int fd, nr = batch->nr, n;
+	ssize_t ret;
+
+	fflush(batch->dest);
+	fd = fileno(batch->dest);
+	if (fd < 0) {
+		for (n = 0; n < nr; n++)
+			fwrite(iov[n].iov_base, iov[n].iov_len, 1, batch->dest);
+		return;
+	}
+
+	while (nr > 0) {
+		ret = writev(fd, iov, nr);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		while (nr > 0 && (size_t)ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			iov++;
+			nr--;
 		}
-		pos = pos->next;
+		if (nr > 0) {
+			iov->iov_base = (char *)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+}
+
+static void flush_batch(struct print_batch *batch)
+{
+	struct print_buffer *pos;
+
+	if (batch->nr > 0) {
+		write_batch(batch);
+		batch->nr = 0;
+		batch->text_len = 0;
 	}
 
-	return buffer;
+	/* Make sure we are done with the entries before releasing them */
+	smp_mb();
+
+	for (pos = first_buffer; pos; pos = pos->next)
+		pos->read_pos = pos->print_pos;
+
+	/* Enforce the read_pos update before proceeding */
+	smp_wmb();
+}
+
+static void format_binary(struct print_batch *batch, struct entry_head *head)
+{
+	struct binary_head *bin = (struct binary_head *)head->data;
+	size_t room = RT_PRINT_BATCH_TEXT - batch->text_len;
+	char *text = batch->text + batch->text_len;
+	int ret;
+
+	ret = binprintf_format(text, room, bin->format, bin->args,
+			       head->len - sizeof(*bin));
+	if (ret >= (int)room && batch->text_len > 0) {
+		flush_batch(batch);
+		format_binary(batch, head);
+		return;
+	}
+
+	if (ret <= 0)
+		return;
+
+	if (ret >= (int)room)
+		ret = room - 1;	/* Truncated. */
+
+	batch->iov[batch->nr].iov_base = text;
+	batch->iov[batch->nr].iov_len = ret;
+	batch->nr++;
+	batch->text_len += ret;
 }
 
-static void print_buffers(void)
+static void dump_binary(struct entry_head *head)
 {
-	struct print_buffer *buffer;
+	struct binary_head *bin = (struct binary_head *)head->data;
+	struct binprintf_record rec;
+
+	rec.timestamp = cobalt_ticks_to_ns(bin->tsc);
+	rec.seq_no = head->seq_no;
+	rec.fmtlen = strlen(bin->format);
+	rec.argsz = head->len - sizeof(*bin);
+	rec.pad = 0;
+	fwrite(&rec, sizeof(rec), 1, binary_dump);
+	fwrite(bin->format, rec.fmtlen, 1, binary_dump);
+	fwrite(bin->args, rec.argsz, 1, binary_dump);
+}
+
+static void report_drops(void)
+{
+	struct print_buffer *pos;
+	unsigned long dropped;
+
+	for (pos = first_buffer; pos; pos = pos->next) {
+		dropped = pos->dropped;
+		if (dropped == pos->reported)
+			continue;
+		fprintf(stderr, "rt_print: %lu message(s) lost from buffer %s\n",
+			dropped - pos->reported, pos->name);
+		pos->reported = dropped;
+	}
+}
+
+/*
+ * Merge the pending entries from all buffers in sequence order,
+ * keeping the buffers in a min-heap indexed on the sequence number
+ * of their oldest entry. Returns non-zero if any buffer was found
+ * more than a quarter full, i.e. at risk of overflowing.
+ */
+static int print_buffers(void)
+{
+	struct print_batch *batch = &output_batch;
+	struct print_buffer *buffer, **heap;
 	struct entry_head *head;
-	off_t read_pos;
-	int len, ret;
+	int nr, n, backlog = 0;
+	size_t used;
 
-	while (1) {
-		buffer = get_next_buffer();
-		if (!buffer)
+	if (merge_heap_len < buffers) {
+		heap = realloc(merge_heap, buffers * sizeof(*heap));
+		if (heap == NULL)
+			return 0;
+		merge_heap = heap;
+		merge_heap_len = buffers;
+	}
+
+	heap = merge_heap;
+
+	for (;;) {
+		nr = 0;
+		for (buffer = first_buffer; buffer; buffer = buffer->next) {
+			if (!get_next_entry(buffer))
+				continue;
+			used = (buffer->write_pos - buffer->print_pos +
+				buffer->size) % buffer->size;
+			if (used > buffer->size / 4)
+				backlog = 1;
+			heap[nr++] = buffer;
+		}
+
+		if (nr == 0)
 			break;
 
-		read_pos = buffer->read_pos;
-		head = buffer->ring + read_pos;
-		len = head->len;
+		for (n = nr / 2 - 1; n >= 0; n--)
+			sift_down(heap, nr, n);
 
-		if (len) {
-			/* Print out non-empty entry and proceed */
-			/* Check if output goes to syslog */
-			if (head->dest == RT_PRINT_SYSLOG_STREAM) {
-				syslog(head->priority,
-				       "%s", head->data);
+		while (nr > 0) {
+			buffer = heap[0];
+			head = buffer->ring + buffer->print_pos;
+
+			if (head->mode == RT_PRINT_MODE_BINARY && binary_dump)
+				dump_binary(head);
+			else if (head->dest == RT_PRINT_SYSLOG_STREAM) {
+				flush_batch(batch);
+				syslog(head->priority, "%s", head->data);
 			} else {
-				ret = fwrite(head->data,
-					     head->len, 1, head->dest);
-				(void)ret;
+				if (batch->nr == RT_PRINT_IOV_MAX ||
+				    (batch->nr > 0 && head->dest != batch->dest))
+					flush_batch(batch);
+				batch->dest = head->dest;
+				if (head->mode == RT_PRINT_MODE_BINARY)
+					format_binary(batch, head);
+				else {
+					batch->iov[batch->nr].iov_base = head->data;
+					batch->iov[batch->nr].iov_len = head->len;
+					batch->nr++;
+				}
 			}
 
-			read_pos += sizeof(*head) + len;
-		} else {
-			/* Emptry entries mark the wrap-around */
-			read_pos = 0;
+			buffer->print_pos += sizeof(*head) + head->len;
+
+			if (!get_next_entry(buffer))
+				heap[0] = heap[--nr];
+			if (nr > 0)
+				sift_down(heap, nr, 0);
 		}
+	}
 
-		/* Make sure we have read the entry competely before
-		   forwarding read_pos */
-		smp_rmb();
-		buffer->read_pos = read_pos;
+	flush_batch(batch);
+	if (binary_dump)
+		fflush(binary_dump);
+	report_drops();
 
-		/* Enforce the read_pos update before proceeding */
-		smp_wmb();
-	}
+	return backlog;
+}
+
+static void wait_doorbell(int speedup)
+{
+	unsigned long long ns;
+	struct timespec ts;
+
+	ns = (print_period.tv_sec * 1000000000ULL + print_period.tv_nsec)
+		>> speedup;
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+
+	if (atomic_cmpxchg(&printer_doorbell, 1, 0) == 1)
+		return;
+
+	syscall(__NR_futex, &printer_doorbell.v, FUTEX_WAIT_PRIVATE, 0,
+		&ts, NULL, 0);
+	atomic_set(&printer_doorbell, 0);
 }
 
 static void *printer_loop(void *arg)
 {
+	int speedup = 0;
+
 	while (1) {
 		pthread_mutex_lock(&buffer_lock);
 
 		while (buffers == 0)
 			pthread_cond_wait(&printer_wakeup, &buffer_lock);
 
-		print_buffers();
+		/*
+		 * Poll faster as long as some buffer fills up,
+		 * getting back to normal progressively.
+		 */
+		if (print_buffers()) {
+			if (speedup < RT_PRINT_MAX_SPEEDUP)
+				speedup++;
+		} else if (speedup > 0)
+			speedup--;
 
 		pthread_mutex_unlock(&buffer_lock);
 
-		nanosleep(&print_period, NULL);
+		wait_doorbell(speedup);
 	}
 
 	return NULL;
@@ -681,10 +1053,12 @@ void cobalt_print_init_atfork(void)
 
 		my_buffer->read_pos  = 0;
 		my_buffer->write_pos = 0;
+		my_buffer->print_pos = 0;
 	}
 
 	/* re-init to avoid finding it locked by some parent thread */
 	pthread_mutex_init(&buffer_lock, NULL);
+	atomic_set(&printer_doorbell, 0);
 
 	while (*pbuffer) {
 		if (*pbuffer == my_buffer)
@@ -731,6 +1105,16 @@ void cobalt_print_init(void)
 	print_period.tv_sec  = period / 1000;
 	print_period.tv_nsec = (period % 1000) * 1000000;
 
+	value_str = getenv(RT_PRINT_BINARY_DUMP_ENV);
+	if (value_str) {
+		binary_dump = fopen(value_str, "w");
+		if (binary_dump == NULL) {
+			report_error("cannot open %s", value_str);
+			exit(1);
+		}
+		fwrite(BINPRINTF_MAGIC, strlen(BINPRINTF_MAGIC), 1, binary_dump);
+	}
+
 	/* Fill the buffer pool */
 	{
 		unsigned buffers_count, i;
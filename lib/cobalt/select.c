@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <asm/xenomai/syscall.h>
 #include "internal.h"
 
@@ -46,3 +47,52 @@ COBALT_IMPL(int, select, (int __nfds, fd_set *__restrict __readfds,
 	errno = -err;
 	return -1;
 }
+
+/*
+ * Persistent interest sets. Descriptors are registered once with
+ * cobalt_poll_ctl(), then cobalt_poll_wait() only reports the ready
+ * ones, filling in the fd and revents fields of up to @nrfds
+ * pollfd entries. Level-triggered, like select().
+ */
+int cobalt_poll_create(int flags)
+{
+	int fd;
+
+	fd = XENOMAI_SYSCALL1(sc_cobalt_poll_create, flags);
+	if (fd < 0) {
+		errno = -fd;
+		return -1;
+	}
+
+	return fd;
+}
+
+int cobalt_poll_ctl(int pfd, int op, int fd, unsigned int events)
+{
+	int ret;
+
+	ret = -XENOMAI_SYSCALL4(sc_cobalt_poll_ctl, pfd, op, fd, events);
+	if (ret == 0)
+		return 0;
+
+	errno = ret;
+	return -1;
+}
+
+int cobalt_poll_wait(int pfd, struct pollfd *fds, int nrfds,
+		     const struct timespec *timeout)
+{
+	int ret, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SYSCALL4(sc_cobalt_poll_wait, pfd, fds, nrfds, timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (ret >= 0)
+		return ret;
+
+	errno = -ret;
+	return -1;
+}
@@ -226,6 +226,30 @@ ssize_t __real_sendmsg(int fd, const struct msghdr * msg, int flags)
 	return sendmsg(fd, msg, flags);
 }
 
+__weak
+int __real_recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+		    unsigned int flags, struct timespec *timeout)
+{
+#ifdef HAVE_RECVMMSG
+	return recvmmsg(fd, msgvec, vlen, flags, timeout);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+__weak
+int __real_sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+		    unsigned int flags)
+{
+#ifdef HAVE_SENDMMSG
+	return sendmmsg(fd, msgvec, vlen, flags);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 __weak
 ssize_t __real_recvfrom(int fd, void *buf, size_t len, int flags,
 			struct sockaddr * from, socklen_t * fromlen)
@@ -25,7 +25,10 @@
 #include <sys/mman.h>
 #include <sys/file.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 #include <assert.h>
+#include <mntent.h>
+#include <limits.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
@@ -80,6 +83,7 @@ struct session_heap {
 	memoff_t maplen;
 	struct hash_table catalog;
 	struct sysgroup sysgroup;
+	struct heapobj_slab slabs[HOBJ_SLAB_POOLS];
 };
 
 /*
@@ -100,6 +104,9 @@ struct sysgroup *__main_sysgroup;
 
 static struct heapobj main_pool;
 
+/* Whether the main heap is backed by a hugetlbfs file. */
+static int main_huge;
+
 #define __moff(h, p)		((caddr_t)(p) - (caddr_t)(h))
 #define __moff_check(h, p)	((p) ? __moff(h, p) : 0)
 #define __mref(h, o)		((void *)((caddr_t)(h) + (o)))
@@ -217,6 +224,7 @@ static int init_main_heap(struct session_heap *m_heap, void *mem, size_t size)
 	__list_init(m_heap, &m_heap->sysgroup.thread_list);
 	m_heap->sysgroup.heap_count = 0;
 	__list_init(m_heap, &m_heap->sysgroup.heap_list);
+	memset(m_heap->slabs, 0, sizeof(m_heap->slabs));
 
 	return 0;
 }
@@ -583,12 +591,141 @@ out:
 	return ret;
 }
 
+static const char *get_hugetlbfs_root(void)
+{
+	static char root[PATH_MAX];
+	struct mntent *ent;
+	FILE *fp;
+
+	if (__node_info.hugetlbfs_root)
+		return __node_info.hugetlbfs_root;
+
+	if (*root)
+		return root;
+
+	fp = setmntent("/proc/mounts", "r");
+	if (fp == NULL)
+		return NULL;
+
+	while ((ent = getmntent(fp)) != NULL) {
+		if (strcmp(ent->mnt_type, "hugetlbfs") == 0) {
+			snprintf(root, sizeof(root), "%s", ent->mnt_dir);
+			break;
+		}
+	}
+
+	endmntent(fp);
+
+	return *root ? root : NULL;
+}
+
+/*
+ * The main heap is backed by a tmpfs file by default, or by a file
+ * from a hugetlbfs mount if --mem-pool-huge was given, so that large
+ * sessions are covered by fewer TLB entries.
+ */
+static int open_main_heap(struct heapobj *hobj, const char *session,
+			  int huge, int oflags, mode_t mode)
+{
+	const char *root;
+
+	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
+
+	if (!huge) {
+		snprintf(hobj->fsname, sizeof(hobj->fsname),
+			 "/xeno:%s", hobj->name);
+		return shm_open(hobj->fsname, oflags, mode);
+	}
+
+	root = get_hugetlbfs_root();
+	if (root == NULL) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	snprintf(hobj->fsname, sizeof(hobj->fsname),
+		 "%s/xeno:%s", root, hobj->name);
+
+	return __STD(open(hobj->fsname, oflags, mode));
+}
+
+static int unlink_main_heap(struct heapobj *hobj, int huge)
+{
+	return huge ? unlink(hobj->fsname) : shm_unlink(hobj->fsname);
+}
+
+/*
+ * Optionally fault in and lock the whole heap upfront, so that no
+ * page fault is taken later on when touching it for the first time.
+ */
+static void *map_main_heap(int fd, size_t len)
+{
+	int prefault = __node_info.mem_pool_prefault || main_huge;
+	void *mem;
+
+	mem = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE,
+			 MAP_SHARED | (prefault ? MAP_POPULATE : 0), fd, 0));
+	if (mem == MAP_FAILED || !prefault || __node_info.no_mlock)
+		return mem;
+
+	if (mlock(mem, len))
+		warning("cannot lock main heap in memory (%s)",
+			symerror(-errno));
+
+	return mem;
+}
+
+/*
+ * Tell whether a live session heap exists on the given backing, so
+ * that a process joining the session binds to it instead of creating
+ * a separate heap on the other file system.
+ */
+static int main_heap_alive(const char *session, int huge)
+{
+	struct session_heap *m_heap;
+	struct heapobj probe;
+	struct statfs sfs;
+	struct stat sbuf;
+	int fd, alive = 0;
+	size_t len;
+
+	fd = open_main_heap(&probe, session, huge, O_RDONLY, 0);
+	if (fd < 0)
+		return 0;
+
+	/* Wait for the creator to be done with initializing the heap. */
+	if (flock(fd, LOCK_SH))
+		goto out;
+
+	if (fstat(fd, &sbuf) || sbuf.st_size < sizeof(*m_heap))
+		goto out;
+
+	len = sizeof(*m_heap);
+	if (huge) {
+		if (fstatfs(fd, &sfs))
+			goto out;
+		len = __align_to(len, sfs.f_bsize);
+	}
+
+	m_heap = __STD(mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0));
+	if (m_heap == MAP_FAILED)
+		goto out;
+
+	alive = m_heap->cpid && kill(m_heap->cpid, 0) == 0;
+	munmap(m_heap, len);
+out:
+	__STD(close(fd));
+
+	return alive;
+}
+
 static int create_main_heap(pid_t *cnode_r)
 {
 	const char *session = __node_info.session_label;
 	size_t size = __node_info.mem_pool;
 	struct heapobj *hobj = &main_pool;
 	struct session_heap *m_heap;
+	struct statfs sfs;
 	struct stat sbuf;
 	memoff_t len;
 	int ret, fd;
@@ -623,12 +760,35 @@ static int create_main_heap(pid_t *cnode_r)
 	 * Otherwise, create the heap for the new emerging session and
 	 * bind to it.
 	 */
-	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
-	snprintf(hobj->fsname, sizeof(hobj->fsname), "/xeno:%s", hobj->name);
+	main_huge = __node_info.mem_pool_huge;
+	if (main_heap_alive(session, !main_huge)) {
+		notice("session %s already lives on %s, %s --mem-pool-huge",
+		       session, main_huge ? "tmpfs" : "hugetlbfs",
+		       main_huge ? "ignoring" : "assuming");
+		main_huge = !main_huge;
+	}
 
-	fd = shm_open(hobj->fsname, O_RDWR|O_CREAT, 0600);
-	if (fd < 0)
+	fd = open_main_heap(hobj, session, main_huge, O_RDWR|O_CREAT, 0600);
+	if (fd < 0) {
+		if (main_huge && errno == ENODEV)
+			warning("no hugetlbfs mount found for --mem-pool-huge");
 		return __bt(-errno);
+	}
+
+	/*
+	 * Files from hugetlbfs have to be sized and mapped in
+	 * multiples of the huge page size. The rounding slack is
+	 * given to the heap.
+	 */
+	if (main_huge) {
+		ret = fstatfs(fd, &sfs);
+		if (ret)
+			goto errno_fail;
+		len = __align_to(len, sfs.f_bsize);
+		size = (len - sizeof(*m_heap)) & HOBJ_PAGE_MASK;
+		if (size > HOBJ_MAXEXTSZ)
+			size = HOBJ_MAXEXTSZ;
+	}
 
 	ret = flock(fd, LOCK_EX);
 	if (ret)
@@ -641,7 +801,7 @@ static int create_main_heap(pid_t *cnode_r)
 	if (sbuf.st_size == 0)
 		goto init;
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+	m_heap = map_main_heap(fd, len);
 	if (m_heap == MAP_FAILED)
 		goto errno_fail;
 
@@ -668,9 +828,12 @@ init:
 	if (ret)
 		goto unlink_fail;
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
-	if (m_heap == MAP_FAILED)
+	m_heap = map_main_heap(fd, len);
+	if (m_heap == MAP_FAILED) {
+		if (main_huge && errno == ENOMEM)
+			warning("not enough huge pages for the main heap");
 		goto unlink_fail;
+	}
 
 	m_heap->maplen = len;
 	hobj->pool = &m_heap->base; /* Must be set prior to calling init_main_heap() */
@@ -689,13 +852,14 @@ done:
 	__STD(close(fd));
 	hobj->size = size;
 	__main_catalog = &m_heap->catalog;
+	__main_slabs = m_heap->slabs;
 
 	return 0;
 unmap_fail:
 	munmap(m_heap, len);
 unlink_fail:
 	ret = __bt(-errno);
-	shm_unlink(hobj->fsname);
+	unlink_main_heap(hobj, main_huge);
 	goto close_fail;
 errno_fail:
 	ret = __bt(-errno);
@@ -715,10 +879,18 @@ static int bind_main_heap(const char *session)
 
 	/* No error tracking, this is for internal users. */
 
-	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
-	snprintf(hobj->fsname, sizeof(hobj->fsname), "/xeno:%s", hobj->name);
-
-	fd = shm_open(hobj->fsname, O_RDWR, 0400);
+	/*
+	 * We may not know how the session was set up, look for a
+	 * hugetlbfs-backed heap if there is no tmpfs one.
+	 */
+	main_huge = 0;
+	fd = open_main_heap(hobj, session, 0, O_RDWR, 0400);
+	if (fd < 0 && errno == ENOENT) {
+		main_huge = 1;
+		fd = open_main_heap(hobj, session, 1, O_RDWR, 0400);
+		if (fd < 0 && errno == ENODEV)
+			errno = ENOENT;
+	}
 	if (fd < 0)
 		return -errno;
 
@@ -736,7 +908,7 @@ static int bind_main_heap(const char *session)
 		goto fail;
 	}
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+	m_heap = map_main_heap(fd, len);
 	if (m_heap == MAP_FAILED)
 		goto errno_fail;
 
@@ -753,6 +925,7 @@ static int bind_main_heap(const char *session)
 	__main_heap = m_heap;
 	__main_catalog = &m_heap->catalog;
 	__main_sysgroup = &m_heap->sysgroup;
+	__main_slabs = m_heap->slabs;
 
 	return 0;
 
@@ -873,7 +1046,7 @@ void heapobj_destroy(struct heapobj *hobj)
 	__RT(pthread_mutex_destroy(&heap->lock));
 	__RT(pthread_mutex_destroy(&main_heap.sysgroup.lock));
 	munmap(&main_heap, main_heap.maplen);
-	shm_unlink(hobj->fsname);
+	unlink_main_heap(hobj, main_huge);
 }
 
 int heapobj_extend(struct heapobj *hobj, size_t size, void *unused)
@@ -973,6 +1146,7 @@ void heapobj_unbind_session(void)
 
 int heapobj_unlink_session(const char *session)
 {
+	const char *root;
 	char *path;
 	int ret;
 
@@ -982,5 +1156,18 @@ int heapobj_unlink_session(const char *session)
 	ret = shm_unlink(path) ? -errno : 0;
 	free(path);
 
+	if (ret != -ENOENT)
+		return ret;
+
+	root = get_hugetlbfs_root();
+	if (root == NULL)
+		return ret;
+
+	ret = asprintf(&path, "%s/xeno:%s.heap", root, session);
+	if (ret < 0)
+		return -ENOMEM;
+	ret = unlink(path) ? -errno : 0;
+	free(path);
+
 	return ret;
 }
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include "boilerplate/atomic.h"
+#include "copperplate/heapobj.h"
+#include "internal.h"
+
+/*
+ * The free list head packs an object reference with a generation
+ * tag, which is bumped on every update to defeat ABA races between
+ * concurrent pops. References are offsets into the main heap in
+ * pshared mode, plain addresses otherwise; both are 8-byte aligned,
+ * and must fit in 48 bits.
+ */
+#define SLAB_REF_SHIFT	3
+#define SLAB_REF_BITS	45
+#define SLAB_REF_MASK	((1ULL << SLAB_REF_BITS) - 1)
+#define SLAB_TAG_ONE	(1ULL << SLAB_REF_BITS)
+#define SLAB_TAG_MASK	(~SLAB_REF_MASK)
+
+/* Alignment of objects carved from the main heap. */
+#define SLAB_ALIGN	64
+/* Amount of main heap memory drawn per refill. */
+#define SLAB_CHUNK	4096
+#define SLAB_MINBATCH	4
+
+struct slab_link {
+	uint64_t next;
+};
+
+#ifdef CONFIG_XENO_PSHARED
+struct heapobj_slab *__main_slabs;
+#else
+static struct heapobj_slab main_slabs[HOBJ_SLAB_POOLS];
+struct heapobj_slab *__main_slabs = main_slabs;
+#endif
+
+static inline uint64_t slab_ref(void *p)
+{
+	uintptr_t off = (uintptr_t)__memoff(__main_heap, p);
+
+	assert((off & ((1UL << SLAB_REF_SHIFT) - 1)) == 0);
+	assert((uint64_t)off >> SLAB_REF_SHIFT <= SLAB_REF_MASK);
+
+	return (uint64_t)off >> SLAB_REF_SHIFT;
+}
+
+static inline void *slab_ptr(uint64_t ref)
+{
+	uintptr_t off = (uintptr_t)(ref << SLAB_REF_SHIFT);
+
+	return (void *)__memptr(__main_heap, off);
+}
+
+static inline uint64_t slab_cmpxchg(struct heapobj_slab *slab,
+				    uint64_t old, uint64_t new)
+{
+	return __sync_val_compare_and_swap(&slab->freelist, old, new);
+}
+
+/*
+ * Attach the chain of objects from @first to @last to the free
+ * list, @count objects total.
+ */
+static void push_chain(struct heapobj_slab *slab,
+		       void *first, void *last, int count)
+{
+	struct slab_link *link = last;
+	uint64_t old, new, prev;
+
+	old = ACCESS_ONCE(slab->freelist);
+	for (;;) {
+		link->next = old & SLAB_REF_MASK;
+		new = slab_ref(first) | ((old + SLAB_TAG_ONE) & SLAB_TAG_MASK);
+		prev = slab_cmpxchg(slab, old, new);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+
+	__sync_add_and_fetch(&slab->nr_free, count);
+}
+
+static void *refill(struct heapobj_slab *slab)
+{
+	struct slab_link *link;
+	int n, batch;
+	caddr_t p;
+
+	if (slab->heap)
+		return heapobj_alloc(mainheap_deref(slab->heap, struct heapobj),
+				     slab->objsize);
+
+	batch = SLAB_CHUNK / slab->objsize;
+	if (batch < SLAB_MINBATCH)
+		batch = SLAB_MINBATCH;
+
+	p = xnmalloc(slab->objsize * batch + SLAB_ALIGN - 1);
+	if (p == NULL)
+		return NULL;
+
+	p = (caddr_t)(((uintptr_t)p + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1));
+	if (batch > 1) {
+		for (n = 1; n < batch - 1; n++) {
+			link = (struct slab_link *)(p + n * slab->objsize);
+			link->next = slab_ref(p + (n + 1) * slab->objsize);
+		}
+		push_chain(slab, p + slab->objsize,
+			   p + (batch - 1) * slab->objsize, batch - 1);
+	}
+
+	return p;
+}
+
+void heapobj_slab_init(struct heapobj_slab *slab,
+		       struct heapobj *hobj, size_t size)
+{
+	size_t align = hobj ? 1U << SLAB_REF_SHIFT : SLAB_ALIGN;
+
+	if (size < sizeof(struct slab_link))
+		size = sizeof(struct slab_link);
+
+	slab->freelist = 0;
+	slab->heap = hobj ? mainheap_ref(hobj, uintptr_t) : 0;
+	slab->objsize = (size + align - 1) & ~(align - 1);
+	slab->nr_free = 0;
+}
+
+void *heapobj_slab_alloc(struct heapobj_slab *slab)
+{
+	uint64_t old, new, prev, ref;
+	struct slab_link *link;
+
+	old = ACCESS_ONCE(slab->freelist);
+	for (;;) {
+		ref = old & SLAB_REF_MASK;
+		if (ref == 0)
+			return refill(slab);
+		/*
+		 * The object may be popped and reused under our feet,
+		 * in which case we read a stale link, but the tag
+		 * update makes the CAS fail. Pool memory is never
+		 * released, so the read itself is always safe.
+		 */
+		link = slab_ptr(ref);
+		new = ACCESS_ONCE(link->next) |
+			((old + SLAB_TAG_ONE) & SLAB_TAG_MASK);
+		prev = slab_cmpxchg(slab, old, new);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+
+	__sync_sub_and_fetch(&slab->nr_free, 1);
+
+	return link;
+}
+
+void heapobj_slab_free(struct heapobj_slab *slab, void *ptr)
+{
+	push_chain(slab, ptr, ptr, 1);
+}
+
+/*
+ * Find the session-wide pool for objects of @size, claiming a free
+ * slot for it if none exists yet. Slots are never released, so the
+ * outcome for a given size never changes once a pool exists or the
+ * table is full.
+ */
+static struct heapobj_slab *find_main_slab(size_t size)
+{
+	struct heapobj_slab *slab;
+	unsigned int objsize;
+	int n;
+
+	if (__main_slabs == NULL)
+		return NULL;
+
+	objsize = (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+
+	for (n = 0; n < HOBJ_SLAB_POOLS; n++) {
+		slab = __main_slabs + n;
+		if (slab->objsize == objsize)
+			return slab;
+		if (slab->objsize)
+			continue;
+		if (__sync_bool_compare_and_swap(&slab->objsize, 0, objsize) ||
+		    slab->objsize == objsize)
+			return slab;
+	}
+
+	return NULL;
+}
+
+void *xnslab_alloc(size_t size)
+{
+	struct heapobj_slab *slab = find_main_slab(size);
+
+	if (slab == NULL)
+		return xnmalloc(size);
+
+	return heapobj_slab_alloc(slab);
+}
+
+void xnslab_free(void *ptr, size_t size)
+{
+	struct heapobj_slab *slab = find_main_slab(size);
+
+	if (slab == NULL)
+		xnfree(ptr);
+	else
+		heapobj_slab_free(slab, ptr);
+}
@@ -19,6 +19,8 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <pthread.h>
 #include "boilerplate/tlsf/tlsf.h"
 #include "copperplate/heapobj.h"
 #include "copperplate/debug.h"
@@ -34,6 +36,144 @@
 
 static int tlsf_pool_overhead;
 
+/*
+ * Small blocks from the main pool are recycled through per-thread
+ * magazines, one per power-of-two size class, so that threads
+ * seldom contend on the pool lock. An empty magazine is refilled
+ * with PV_MAGBATCH blocks under a single lock grab, and a full one
+ * drains its coldest half the same way, including blocks other
+ * threads allocated. A request never runs more than PV_MAGBATCH
+ * TLSF operations, so the allocation time remains bounded.
+ */
+#define PV_MINLOG2	4
+#define PV_MAXLOG2	10
+#define PV_MAGCLASSES	(PV_MAXLOG2 - PV_MINLOG2 + 1)
+#define PV_MAGSZ	16
+#define PV_MAGBATCH	(PV_MAGSZ / 2)
+
+struct pv_magazine {
+	int nrounds;
+	void *rounds[PV_MAGSZ];
+};
+
+struct pv_cache {
+	struct pv_magazine mags[PV_MAGCLASSES];
+};
+
+static pthread_key_t pv_cache_key;
+
+static int pv_cache_enabled;
+
+/* Size class serving a request, rounding up. */
+static inline int alloc_class(size_t size)
+{
+	if (size > (1UL << PV_MAXLOG2))
+		return -1;
+
+	if (size <= (1UL << PV_MINLOG2))
+		return 0;
+
+	return sizeof(long) * 8 - __builtin_clzl(size - 1) - PV_MINLOG2;
+}
+
+/* Size class a block may serve, rounding down. */
+static inline int free_class(size_t size)
+{
+	int class;
+
+	if (size < (1UL << PV_MINLOG2))
+		return -1;
+
+	class = sizeof(long) * 8 - 1 - __builtin_clzl(size) - PV_MINLOG2;
+
+	return class < PV_MAGCLASSES ? class : -1;
+}
+
+static void flush_cache(void *arg)
+{
+	struct pv_cache *cache = arg;
+	struct pv_magazine *mag;
+	int n;
+
+	for (n = 0; n < PV_MAGCLASSES; n++) {
+		mag = cache->mags + n;
+		tlsf_free_batch(mag->rounds, mag->nrounds);
+	}
+
+	tlsf_free(cache);
+}
+
+static struct pv_cache *get_cache(void)
+{
+	struct pv_cache *cache;
+
+	if (!pv_cache_enabled)
+		return NULL;
+
+	cache = pthread_getspecific(pv_cache_key);
+	if (cache)
+		return cache;
+
+	cache = tlsf_malloc(sizeof(*cache));
+	if (cache == NULL)
+		return NULL;
+
+	memset(cache, 0, sizeof(*cache));
+	if (pthread_setspecific(pv_cache_key, cache)) {
+		tlsf_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void *pvmalloc(size_t size)
+{
+	struct pv_magazine *mag;
+	struct pv_cache *cache;
+	int class;
+
+	class = alloc_class(size);
+	if (class < 0 || (cache = get_cache()) == NULL)
+		return tlsf_malloc(size);
+
+	mag = cache->mags + class;
+	if (mag->nrounds == 0) {
+		mag->nrounds = tlsf_malloc_batch(1UL << (class + PV_MINLOG2),
+						 mag->rounds, PV_MAGBATCH);
+		if (mag->nrounds == 0)
+			return NULL;
+	}
+
+	return mag->rounds[--mag->nrounds];
+}
+
+void pvfree(void *ptr)
+{
+	struct pv_magazine *mag;
+	struct pv_cache *cache;
+	int class;
+
+	if (ptr == NULL)
+		return;
+
+	class = free_class(malloc_usable_size_ex(ptr, NULL));
+	if (class < 0 || (cache = get_cache()) == NULL) {
+		tlsf_free(ptr);
+		return;
+	}
+
+	mag = cache->mags + class;
+	if (mag->nrounds == PV_MAGSZ) {
+		tlsf_free_batch(mag->rounds, PV_MAGBATCH);
+		memmove(mag->rounds, mag->rounds + PV_MAGBATCH,
+			(PV_MAGSZ - PV_MAGBATCH) * sizeof(void *));
+		mag->nrounds -= PV_MAGBATCH;
+	}
+
+	mag->rounds[mag->nrounds++] = ptr;
+}
+
 int __heapobj_init_private(struct heapobj *hobj, const char *name,
 			   size_t size, void *mem)
 {
@@ -99,5 +239,11 @@ int heapobj_pkg_init_private(void)
 	tlsf_pool_overhead = (tlsf_pool_overhead + 1024) & ~15;
 	tlsf_free(mem);
 
+	if (!pv_cache_enabled) {
+		if (pthread_key_create(&pv_cache_key, flush_cache))
+			panic("cannot create TLSF cache key");
+		pv_cache_enabled = 1;
+	}
+
 	return 0;
 }
@@ -41,6 +41,9 @@
 
 struct coppernode __node_info = {
 	.mem_pool = 1024 * 1024, /* Default, 1Mb. */
+	.hugetlbfs_root = NULL,
+	.mem_pool_huge = 0,
+	.mem_pool_prefault = 0,
 	.no_mlock = 0,
 	.no_registry = 0,
 	.no_sanity = !CONFIG_XENO_SANITY,
@@ -48,6 +51,7 @@ struct coppernode __node_info = {
 	.registry_root = DEFAULT_REGISTRY_ROOT,
 	.session_label = NULL,
 	.session_root = NULL,
+	.timer_servers = 1,
 };
 
 pid_t __node_id;
@@ -143,6 +147,27 @@ static const struct option base_options[] = {
 		.flag = &__node_info.no_sanity,
 		.val = 0
 	},
+	{
+#define timer_servers_opt	12
+		.name = "timer-servers",
+		.has_arg = 1,
+		.flag = NULL,
+		.val = 0
+	},
+	{
+#define mempool_huge_opt	13
+		.name = "mem-pool-huge",
+		.has_arg = 2,
+		.flag = NULL,
+		.val = 0
+	},
+	{
+#define mempool_prefault_opt	14
+		.name = "mem-pool-prefault",
+		.has_arg = 0,
+		.flag = &__node_info.mem_pool_prefault,
+		.val = 1
+	},
 	{
 		.name = NULL,
 		.has_arg = 0,
@@ -172,11 +197,14 @@ static void usage(void)
 	print_version();
         fprintf(stderr, "usage: program <options>, where options may be:\n");
 	fprintf(stderr, "--mem-pool-size=<sizeK>          size of the main heap (kbytes)\n");
+	fprintf(stderr, "--mem-pool-huge[=<path>]         back shared main heap with huge pages\n");
+	fprintf(stderr, "--mem-pool-prefault              fault in and lock shared main heap at init\n");
         fprintf(stderr, "--no-mlock                       do not lock memory at init (Mercury only)\n");
         fprintf(stderr, "--registry-root=<path>           root path of registry\n");
         fprintf(stderr, "--no-registry                    suppress object registration\n");
         fprintf(stderr, "--session=<label>                label of shared multi-processing session\n");
         fprintf(stderr, "--cpu-affinity=<cpu[,cpu]...>    set CPU affinity of threads\n");
+        fprintf(stderr, "--timer-servers=<n>              number of timer server threads (0=one per CPU)\n");
         fprintf(stderr, "--[no-]sanity                    disable/enable sanity checks\n");
         fprintf(stderr, "--silent                         tame down verbosity\n");
         fprintf(stderr, "--version                        get version information\n");
@@ -374,6 +402,11 @@ static int parse_base_options(int *argcp, char *const **argvp,
 		case mempool_opt:
 			__node_info.mem_pool = atoi(optarg) * 1024;
 			break;
+		case mempool_huge_opt:
+			__node_info.mem_pool_huge = 1;
+			if (optarg)
+				__node_info.hugetlbfs_root = strdup(optarg);
+			break;
 		case session_opt:
 			__node_info.session_label = strdup(optarg);
 			break;
@@ -385,7 +418,15 @@ static int parse_base_options(int *argcp, char *const **argvp,
 			if (ret)
 				return ret;
 			break;
+		case timer_servers_opt:
+			__node_info.timer_servers = atoi(optarg);
+			if (__node_info.timer_servers < 0) {
+				warning("invalid timer server count '%s'", optarg);
+				return __bt(-EINVAL);
+			}
+			break;
 		case no_mlock_opt:
+		case mempool_prefault_opt:
 		case no_sanity_opt:
 		case no_registry_opt:
 		case sanity_opt:
@@ -38,10 +38,14 @@
 
 struct coppernode {
 	unsigned int mem_pool;
+	const char *hugetlbfs_root;
+	int mem_pool_huge;
+	int mem_pool_prefault;
 	const char *registry_root;
 	const char *session_label;
 	const char *session_root;
 	cpu_set_t cpu_affinity;
+	int timer_servers;
 	int no_mlock;
 	int no_registry;
 	int no_sanity;
@@ -73,6 +77,11 @@ struct shared_heap {
 	} buckets[HOBJ_NBUCKETS];
 };
 
+/* Number of session-wide slab pools. */
+#define HOBJ_SLAB_POOLS	16
+
+extern struct heapobj_slab *__main_slabs;
+
 struct corethread_attributes {
 	size_t stacksize;
 	int detachstate;
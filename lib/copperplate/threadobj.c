@@ -1058,7 +1058,7 @@ void *__threadobj_alloc(size_t tcb_struct_size,
 		wait_union_size = sizeof(union copperplate_wait_union);
 
 	tcb_struct_size = (tcb_struct_size+sizeof(double)-1) & ~(sizeof(double)-1);
-	p = xnmalloc(tcb_struct_size + wait_union_size);
+	p = xnslab_alloc(tcb_struct_size + wait_union_size);
 	if (p == NULL)
 		return NULL;
 
@@ -1711,7 +1711,7 @@ static inline int main_overlay(void)
 	idata.param_ex.sched_priority = 0;
 	ret = threadobj_init(tcb, &idata);
 	if (ret) {
-		__threadobj_free(tcb);
+		threadobj_free(tcb);
 		return __bt(ret);
 	}
 
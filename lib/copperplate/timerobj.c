@@ -18,12 +18,14 @@
  * Timer object abstraction.
  */
 
+#include <stdio.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <memory.h>
 #include <limits.h>
+#include <sched.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include "boilerplate/list.h"
@@ -32,16 +34,39 @@
 #include "copperplate/threadobj.h"
 #include "copperplate/timerobj.h"
 #include "copperplate/clockobj.h"
+#include "copperplate/heapobj.h"
 #include "copperplate/debug.h"
 #include "internal.h"
 
+/*
+ * Timers are spread over one or more server threads, each of them
+ * waiting for SIGALRM then running the handlers of the timers which
+ * elapsed. Every server indexes its timers in a pairing heap ordered
+ * by expiry date, which inserts in constant time and removes in
+ * logarithmic amortized time. Servers do not share any state, so a
+ * slow handler only delays the timers attached to the same server.
+ *
+ * The default setup runs a single unpinned server, i.e. handlers
+ * are serialized process-wide. --timer-servers=<n> starts <n>
+ * servers pinned to the CPUs from the affinity set in turn, one per
+ * CPU if zero. A new timer is attached to a server running on the
+ * current CPU if any, round-robin otherwise.
+ */
+struct timerobj_server {
+	pthread_mutex_t lock;
+	pthread_t thread;
+	pid_t pid;
+	int cpu;
+	struct timerobj *root;
+};
+
 static pthread_mutex_t svlock;
 
-static pthread_t svthread;
+static struct timerobj_server *servers;
 
-static pid_t svpid;
+static int nr_servers;
 
-static DEFINE_PRIVATE_LIST(svtimers);
+static int next_server;
 
 #ifdef CONFIG_XENO_COBALT
 
@@ -61,35 +86,117 @@ static inline void timersv_init_corespec(void)
 #endif /* CONFIG_XENO_MERCURY */
 
 /*
- * XXX: at some point, we may consider using a timer wheel instead of
- * a simple linked list to index timers. The latter method is
- * efficient for up to ten outstanding timers or so, which should be
- * enough for most applications. However, there exist poorly designed
- * apps involving dozens of active timers, particularly in the legacy
- * embedded world.
+ * Link two detached heap roots, returning the earliest one. Equal
+ * dates favour @a, which should be the oldest entry.
  */
+static struct timerobj *heap_meld(struct timerobj *a, struct timerobj *b)
+{
+	struct timerobj *t;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	if (timespec_before(&b->itspec.it_value, &a->itspec.it_value)) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->sibling = a->child;
+	if (a->child)
+		a->child->prev = b;
+	a->child = b;
+
+	return a;
+}
+
+/* Two-pass merge of a list of siblings into a single heap. */
+static struct timerobj *heap_merge_pairs(struct timerobj *first)
+{
+	struct timerobj *a, *b, *next, *stack = NULL, *root = NULL;
+
+	while (first) {
+		a = first;
+		b = a->sibling;
+		next = b ? b->sibling : NULL;
+		a->prev = a->sibling = NULL;
+		if (b) {
+			b->prev = b->sibling = NULL;
+			a = heap_meld(a, b);
+		}
+		a->sibling = stack;
+		stack = a;
+		first = next;
+	}
+
+	while (stack) {
+		next = stack->sibling;
+		stack->sibling = NULL;
+		root = heap_meld(root, stack);
+		stack = next;
+	}
+
+	return root;
+}
+
 static void timerobj_enqueue(struct timerobj *tmobj)
 {
-	struct timerobj *__tmobj;
+	struct timerobj_server *sv = tmobj->server;
+
+	tmobj->child = tmobj->sibling = tmobj->prev = NULL;
+	sv->root = heap_meld(sv->root, tmobj);
+	tmobj->queued = 1;
+}
+
+static void timerobj_dequeue(struct timerobj *tmobj)
+{
+	struct timerobj_server *sv = tmobj->server;
+	struct timerobj *sub;
 
-	if (pvlist_empty(&svtimers)) {
-		pvlist_append(&tmobj->next, &svtimers);
+	if (!tmobj->queued)
 		return;
-	}
 
-	pvlist_for_each_entry_reverse(__tmobj, &svtimers, next) {
-		if (timespec_before_or_same(&__tmobj->itspec.it_value,
-					    &tmobj->itspec.it_value))
-			break;
+	if (tmobj == sv->root)
+		sv->root = heap_merge_pairs(tmobj->child);
+	else {
+		if (tmobj->prev->child == tmobj)
+			tmobj->prev->child = tmobj->sibling;
+		else
+			tmobj->prev->sibling = tmobj->sibling;
+		if (tmobj->sibling)
+			tmobj->sibling->prev = tmobj->prev;
+		sub = heap_merge_pairs(tmobj->child);
+		sv->root = heap_meld(sv->root, sub);
 	}
 
-	atpvh(&__tmobj->next, &tmobj->next);
+	tmobj->child = tmobj->sibling = tmobj->prev = NULL;
+	tmobj->queued = 0;
 }
 
 static int server_prologue(void *arg)
 {
-	svpid = get_thread_pid();
-	copperplate_set_current_name("timer-internal");
+	struct timerobj_server *sv = arg;
+	char name[32];
+	cpu_set_t set;
+
+	sv->pid = get_thread_pid();
+	if (nr_servers > 1) {
+		snprintf(name, sizeof(name), "timer-internal/%d",
+			 (int)(sv - servers));
+		copperplate_set_current_name(name);
+	} else
+		copperplate_set_current_name("timer-internal");
+
+	if (sv->cpu >= 0) {
+		CPU_ZERO(&set);
+		CPU_SET(sv->cpu, &set);
+		if (sched_setaffinity(0, sizeof(set), &set))
+			warning("cannot pin timer server to CPU%d", sv->cpu);
+	}
+
 	timersv_init_corespec();
 	threadobj_set_current(THREADOBJ_IRQCONTEXT);
 
@@ -98,8 +205,9 @@ static int server_prologue(void *arg)
 
 static void *timerobj_server(void *arg)
 {
+	struct timerobj_server *sv = arg;
 	struct timespec now, value, interval;
-	struct timerobj *tmobj, *tmp;
+	struct timerobj *tmobj;
 	sigset_t set;
 	int sig, ret;
 
@@ -111,54 +219,82 @@ static void *timerobj_server(void *arg)
 		if (ret && ret != -EINTR)
 			break;
 		/*
-		 * We have a single server thread for now, so handlers
-		 * are fully serialized.
+		 * Handlers attached to this server are serialized,
+		 * other servers run theirs concurrently.
 		 */
-		write_lock_nocancel(&svlock);
+		write_lock_nocancel(&sv->lock);
 
 		__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
 
-		pvlist_for_each_entry_safe(tmobj, tmp, &svtimers, next) {
+		while ((tmobj = sv->root) != NULL) {
 			value = tmobj->itspec.it_value;
 			if (timespec_after(&value, &now))
 				break;
-			pvlist_remove_init(&tmobj->next);
+			timerobj_dequeue(tmobj);
 			interval = tmobj->itspec.it_interval;
 			if (interval.tv_sec > 0 || interval.tv_nsec > 0) {
 				timespec_add(&tmobj->itspec.it_value,
 					     &value, &interval);
 				timerobj_enqueue(tmobj);
 			}
-			write_unlock(&svlock);
+			write_unlock(&sv->lock);
 			tmobj->handler(tmobj);
-			write_lock_nocancel(&svlock);
+			write_lock_nocancel(&sv->lock);
 		}
 
-		write_unlock(&svlock);
+		write_unlock(&sv->lock);
 	}
 
 	return NULL;
 }
 
-static int timerobj_spawn_server(void)
+static struct timerobj_server *pick_server(void)
+{
+	int cpu, n, count = 0;
+
+	if (nr_servers == 1)
+		return servers;
+
+	cpu = sched_getcpu();
+	for (n = 0; n < nr_servers; n++) {
+		if (servers[n].cpu == cpu)
+			count++;
+	}
+
+	if (count == 0)
+		return servers + (next_server++ % nr_servers);
+
+	count = next_server++ % count;
+	for (n = 0; n < nr_servers; n++) {
+		if (servers[n].cpu == cpu && count-- == 0)
+			break;
+	}
+
+	return servers + n;
+}
+
+static int timerobj_spawn_server(struct timerobj *tmobj)
 {
 	struct corethread_attributes cta;
+	struct timerobj_server *sv;
 	int ret = 0;
 
 	push_cleanup_lock(&svlock);
 	write_lock(&svlock);
 
-	if (svthread)
+	sv = pick_server();
+	tmobj->server = sv;
+	if (sv->thread)
 		goto out;
 
 	cta.policy = SCHED_CORE;
 	cta.param_ex.sched_priority = threadobj_irq_prio;
 	cta.prologue = server_prologue;
 	cta.run = timerobj_server;
-	cta.arg = NULL;
+	cta.arg = sv;
 	cta.stacksize = PTHREAD_STACK_MIN * 16;
 	cta.detachstate = PTHREAD_CREATE_DETACHED;
-	ret = __bt(copperplate_create_thread(&cta, &svthread));
+	ret = __bt(copperplate_create_thread(&cta, &sv->thread));
 out:
 	write_unlock(&svlock);
 	pop_cleanup_lock(&svlock);
@@ -183,17 +319,18 @@ int timerobj_init(struct timerobj *tmobj)
 	 * very least), and spawning a short-lived thread at each
 	 * timeout expiration to run the handler is just overkill.
 	 */
-	ret = timerobj_spawn_server();
+	ret = timerobj_spawn_server(tmobj);
 	if (ret)
 		return __bt(ret);
 
 	tmobj->handler = NULL;
-	pvholder_init(&tmobj->next); /* so we may use pvholder_linked() */
+	tmobj->child = tmobj->sibling = tmobj->prev = NULL;
+	tmobj->queued = 0;
 
 	memset(&sev, 0, sizeof(sev));
 	sev.sigev_notify = SIGEV_THREAD_ID;
 	sev.sigev_signo = SIGALRM;
-	sev.sigev_notify_thread_id = svpid;
+	sev.sigev_notify_thread_id = tmobj->server->pid;
 
 	ret = __RT(timer_create(CLOCK_COPPERPLATE, &sev, &tmobj->timer));
 	if (ret)
@@ -212,12 +349,11 @@ int timerobj_init(struct timerobj *tmobj)
 
 void timerobj_destroy(struct timerobj *tmobj) /* lock held, dropped */
 {
-	write_lock_nocancel(&svlock);
-
-	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
+	struct timerobj_server *sv = tmobj->server;
 
-	write_unlock(&svlock);
+	write_lock_nocancel(&sv->lock);
+	timerobj_dequeue(tmobj);
+	write_unlock(&sv->lock);
 
 	__RT(timer_delete(tmobj->timer));
 	__RT(pthread_mutex_unlock(&tmobj->lock));
@@ -228,8 +364,9 @@ int timerobj_start(struct timerobj *tmobj,
 		   void (*handler)(struct timerobj *tmobj),
 		   struct itimerspec *it) /* lock held, dropped */
 {
+	struct timerobj_server *sv = tmobj->server;
+
 	tmobj->handler = handler;
-	tmobj->itspec = *it;
 
 	/*
 	 * We hold the queue lock long enough to prevent the timer
@@ -239,14 +376,23 @@ int timerobj_start(struct timerobj *tmobj,
 	 * would in turn lead to a double-deletion if the caller
 	 * happens to check the return code then drop the timer
 	 * (again).
+	 *
+	 * A timer which is still armed is restarted: pull it out
+	 * of the heap before its date changes, and before it is
+	 * queued again.
 	 */
-	write_lock_nocancel(&svlock);
+	write_lock_nocancel(&sv->lock);
 
-	if (__RT(timer_settime(tmobj->timer, TIMER_ABSTIME, it, NULL)))
+	timerobj_dequeue(tmobj);
+	tmobj->itspec = *it;
+
+	if (__RT(timer_settime(tmobj->timer, TIMER_ABSTIME, it, NULL))) {
+		write_unlock(&sv->lock);
 		return __bt(-errno);
+	}
 
 	timerobj_enqueue(tmobj);
-	write_unlock(&svlock);
+	write_unlock(&sv->lock);
 	timerobj_unlock(tmobj);
 
 	return 0;
@@ -255,13 +401,11 @@ int timerobj_start(struct timerobj *tmobj,
 int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 {
 	static const struct itimerspec itimer_stop;
+	struct timerobj_server *sv = tmobj->server;
 
-	write_lock_nocancel(&svlock);
-
-	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
-
-	write_unlock(&svlock);
+	write_lock_nocancel(&sv->lock);
+	timerobj_dequeue(tmobj);
+	write_unlock(&sv->lock);
 
 	__RT(timer_settime(tmobj->timer, 0, &itimer_stop, NULL));
 	tmobj->handler = NULL;
@@ -273,14 +417,47 @@ int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 int timerobj_pkg_init(void)
 {
 	pthread_mutexattr_t mattr;
-	int ret;
+	int ret, n, cpu = -1;
+	cpu_set_t cpus;
+
+	/* Pin servers to the CPUs our threads may run on. */
+	if (CPU_COUNT(&__node_info.cpu_affinity) > 0)
+		cpus = __node_info.cpu_affinity;
+	else if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return __bt(-errno);
+
+	nr_servers = __node_info.timer_servers;
+	if (nr_servers == 0)
+		nr_servers = CPU_COUNT(&cpus);
+
+	servers = pvmalloc(nr_servers * sizeof(*servers));
+	if (servers == NULL)
+		return __bt(-ENOMEM);
+
+	memset(servers, 0, nr_servers * sizeof(*servers));
 
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
 	pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_PRIVATE);
+
 	ret = __bt(-__RT(pthread_mutex_init(&svlock, &mattr)));
+	for (n = 0; ret == 0 && n < nr_servers; n++) {
+		if (nr_servers > 1) {
+			do
+				cpu = (cpu + 1) % CPU_SETSIZE;
+			while (!CPU_ISSET(cpu, &cpus));
+		}
+		servers[n].cpu = cpu;
+		ret = __bt(-__RT(pthread_mutex_init(&servers[n].lock, &mattr)));
+	}
+
 	pthread_mutexattr_destroy(&mattr);
 
+	if (ret) {
+		pvfree(servers);
+		servers = NULL;
+	}
+
 	return ret;
 }
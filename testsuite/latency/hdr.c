@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "hdr.h"
+
+/*
+ * Dump format, CSV with comment lines for metadata, only listing
+ * the buckets which were hit:
+ *
+ * # xenomai-hdr <version>
+ * # host=<name> cpu=<cpu> period=<ns> precision=<bits>
+ * # total=<samples> min=<ns> max=<ns>
+ * <index>,<lowest ns>,<highest ns>,<count>
+ * ...
+ */
+
+void hdr_init(struct hdr_histogram *h, int cpu, long long period_ns)
+{
+	memset(h->counts, 0, sizeof(h->counts));
+	h->total = 0;
+	h->min = INT64_MAX;
+	h->max = INT64_MIN;
+	h->cpu = cpu;
+	h->period_ns = period_ns;
+}
+
+int64_t hdr_lowest(int index)
+{
+	int msb;
+
+	if (index < HDR_SUBBUCKETS)
+		return index;
+
+	msb = index / HDR_SUBBUCKETS + HDR_PRECISION - 1;
+
+	return (int64_t)(index % HDR_SUBBUCKETS + HDR_SUBBUCKETS)
+		<< (msb - HDR_PRECISION);
+}
+
+int64_t hdr_highest(int index)
+{
+	int msb;
+
+	if (index < HDR_SUBBUCKETS)
+		return index;
+
+	msb = index / HDR_SUBBUCKETS + HDR_PRECISION - 1;
+
+	return hdr_lowest(index) + (1LL << (msb - HDR_PRECISION)) - 1;
+}
+
+/*
+ * Return the highest value equivalent to the given percentile,
+ * i.e. the actual percentile is no larger than this, within the
+ * histogram precision. The exact maximum caps the result.
+ */
+int64_t hdr_percentile(const struct hdr_histogram *h, double pct)
+{
+	uint64_t rank, seen = 0;
+	int64_t value;
+	int n;
+
+	if (h->total == 0)
+		return 0;
+
+	rank = (uint64_t)(pct / 100.0 * h->total + 0.5);
+	if (rank == 0)
+		rank = 1;
+	if (rank > h->total)
+		rank = h->total;
+
+	for (n = 0; n < HDR_BUCKETS; n++) {
+		seen += h->counts[n];
+		if (seen >= rank)
+			break;
+	}
+
+	value = hdr_highest(n < HDR_BUCKETS ? n : HDR_BUCKETS - 1);
+
+	return value > h->max ? h->max : value;
+}
+
+int hdr_merge(struct hdr_histogram *dst, const struct hdr_histogram *src)
+{
+	int n;
+
+	for (n = 0; n < HDR_BUCKETS; n++)
+		dst->counts[n] += src->counts[n];
+
+	dst->total += src->total;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	if (dst->cpu != src->cpu)
+		dst->cpu = -1;
+	if (dst->period_ns != src->period_ns)
+		dst->period_ns = 0;
+
+	return 0;
+}
+
+/*
+ * Write to a temporary file first, so that a snapshot in progress
+ * never clobbers the previous one. The sampler may still be recording
+ * into @h, so the dump is taken from a copy of the counts, and the
+ * total is summed from that copy for the file to stay consistent.
+ */
+int hdr_save(const struct hdr_histogram *h, const char *path,
+	     const char *host)
+{
+	struct hdr_histogram *snap;
+	char tmp[4096];
+	int n, ret = 0;
+	FILE *fp;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+		return -ENAMETOOLONG;
+
+	snap = malloc(sizeof(*snap));
+	if (snap == NULL)
+		return -ENOMEM;
+
+	*snap = *h;
+	snap->total = 0;
+	for (n = 0; n < HDR_BUCKETS; n++)
+		snap->total += snap->counts[n];
+
+	fp = fopen(tmp, "w");
+	if (fp == NULL) {
+		ret = -errno;
+		goto out;
+	}
+
+	fprintf(fp, "%s %d\n", HDR_MAGIC, HDR_VERSION);
+	fprintf(fp, "# host=%s cpu=%d period=%lld precision=%d\n",
+		host, snap->cpu, snap->period_ns, HDR_PRECISION);
+	fprintf(fp, "# total=%llu min=%lld max=%lld\n",
+		(unsigned long long)snap->total,
+		(long long)(snap->total ? snap->min : 0),
+		(long long)(snap->total ? snap->max : 0));
+
+	for (n = 0; n < HDR_BUCKETS; n++) {
+		if (snap->counts[n] == 0)
+			continue;
+		fprintf(fp, "%d,%lld,%lld,%llu\n", n,
+			(long long)hdr_lowest(n), (long long)hdr_highest(n),
+			(unsigned long long)snap->counts[n]);
+	}
+
+	if (fclose(fp) || rename(tmp, path))
+		ret = -errno;
+out:
+	free(snap);
+
+	return ret;
+}
+
+int hdr_load(struct hdr_histogram *h, FILE *fp)
+{
+	long long min, max, period, low, high;
+	unsigned long long total, count;
+	int version, precision, cpu, n;
+	char line[512], *p;
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+	    strncmp(line, HDR_MAGIC " ", strlen(HDR_MAGIC) + 1))
+		return -EINVAL;
+
+	version = atoi(line + strlen(HDR_MAGIC) + 1);
+	if (version != HDR_VERSION)
+		return -EINVAL;
+
+	if (fgets(line, sizeof(line), fp) == NULL)
+		return -EINVAL;
+
+	p = strstr(line, " cpu=");
+	if (p == NULL || sscanf(p, " cpu=%d period=%lld precision=%d",
+				&cpu, &period, &precision) != 3)
+		return -EINVAL;
+
+	if (precision != HDR_PRECISION)
+		return -EINVAL;
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+	    sscanf(line, "# total=%llu min=%lld max=%lld",
+		   &total, &min, &max) != 3)
+		return -EINVAL;
+
+	hdr_init(h, cpu, period);
+	if (total > 0) {
+		h->min = min;
+		h->max = max;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%d,%lld,%lld,%llu",
+			   &n, &low, &high, &count) != 4)
+			return -EINVAL;
+		if (n < 0 || n >= HDR_BUCKETS || low != hdr_lowest(n))
+			return -EINVAL;
+		h->counts[n] += count;
+		h->total += count;
+	}
+
+	return h->total == total ? 0 : -EINVAL;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _TESTSUITE_LATENCY_HDR_H
+#define _TESTSUITE_LATENCY_HDR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Log-linear histogram of nanosecond values. Values below
+ * 2^HDR_PRECISION get a bucket each, every power of two above is
+ * split into 2^HDR_PRECISION buckets, which bounds the relative
+ * error to 2^-HDR_PRECISION (0.8%) up to HDR_MAXVAL. Negative values
+ * count as zero, larger ones saturate the last bucket; the exact
+ * extrema are kept aside.
+ */
+#define HDR_PRECISION	7
+#define HDR_SUBBUCKETS	(1 << HDR_PRECISION)
+#define HDR_MAXLOG2	32
+#define HDR_MAXVAL	((1LL << HDR_MAXLOG2) - 1)
+#define HDR_BUCKETS	(HDR_SUBBUCKETS * (HDR_MAXLOG2 - HDR_PRECISION + 1))
+
+#define HDR_MAGIC	"# xenomai-hdr"
+#define HDR_VERSION	1
+
+struct hdr_histogram {
+	uint64_t counts[HDR_BUCKETS];
+	uint64_t total;
+	int64_t min;
+	int64_t max;
+	int cpu;
+	long long period_ns;
+};
+
+static inline int hdr_index(int64_t value)
+{
+	int msb;
+
+	if (value < HDR_SUBBUCKETS)
+		return value < 0 ? 0 : (int)value;
+
+	if (value > HDR_MAXVAL)
+		value = HDR_MAXVAL;
+
+	msb = 63 - __builtin_clzll(value);
+
+	return HDR_SUBBUCKETS * (msb - HDR_PRECISION + 1) +
+		(int)(value >> (msb - HDR_PRECISION)) - HDR_SUBBUCKETS;
+}
+
+static inline void hdr_record(struct hdr_histogram *h, int64_t value)
+{
+	h->counts[hdr_index(value)]++;
+	h->total++;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+}
+
+void hdr_init(struct hdr_histogram *h, int cpu, long long period_ns);
+
+int64_t hdr_lowest(int index);
+
+int64_t hdr_highest(int index);
+
+int64_t hdr_percentile(const struct hdr_histogram *h, double pct);
+
+int hdr_merge(struct hdr_histogram *dst, const struct hdr_histogram *src);
+
+int hdr_save(const struct hdr_histogram *h, const char *path,
+	     const char *host);
+
+int hdr_load(struct hdr_histogram *h, FILE *fp);
+
+#endif /* !_TESTSUITE_LATENCY_HDR_H */
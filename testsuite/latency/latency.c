@@ -15,6 +15,7 @@
 #include <xeno_config.h>
 #include <rtdm/testing.h>
 #include <boilerplate/trace.h>
+#include "hdr.h"
 
 pthread_t latency_task, display_task;
 
@@ -68,6 +69,15 @@ int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
 #define need_histo() (do_histogram || do_stats || do_gnuplot)
 
+/* Log-linear histogram of all samples, user task mode only. */
+struct hdr_histogram *hdr_hist = NULL;
+char *hdr_output = NULL;	/* -o <file> */
+int hdr_interval = 0;		/* -i <sec>, 0 dumps at exit only */
+
+static const double hdr_percentiles[] = {
+	50.0, 99.0, 99.9, 99.99, 99.999,
+};
+
 static inline void add_histogram(int32_t *histogram, int32_t addval)
 {
 	/* bucketsize steps */
@@ -188,8 +198,11 @@ static void *latency(void *cookie)
 				gmaxjitter = dt;
 			}
 
-			if (!(finished || warmup) && need_histo())
-				add_histogram(histogram_avg, dt);
+			if (!(finished || warmup)) {
+				if (need_histo())
+					add_histogram(histogram_avg, dt);
+				hdr_record(hdr_hist, dt);
+			}
 		}
 
 		if (!warmup) {
@@ -221,8 +234,38 @@ static void *latency(void *cookie)
 	return NULL;
 }
 
+static void save_hdr_histogram(void)
+{
+	char host[64];
+	int ret;
+
+	if (gethostname(host, sizeof(host)))
+		strcpy(host, "unknown");
+	host[sizeof(host) - 1] = '\0';
+
+	ret = hdr_save(hdr_hist, hdr_output, host);
+	if (ret)
+		fprintf(stderr, "latency: cannot write %s: %s\n",
+			hdr_output, strerror(-ret));
+}
+
+static void dump_hdr_percentiles(void)
+{
+	unsigned int n;
+
+	printf("RPH");
+	for (n = 0; n < sizeof(hdr_percentiles) / sizeof(double); n++)
+		printf("|%10gp", hdr_percentiles[n]);
+	printf("\nRPS");
+	for (n = 0; n < sizeof(hdr_percentiles) / sizeof(double); n++)
+		printf("|%11.3f",
+		       (double)hdr_percentile(hdr_hist, hdr_percentiles[n]) / 1000);
+	printf("\n");
+}
+
 static void *display(void *cookie)
 {
+	unsigned int snapshot = 0;
 	char task_name[16];
 	int err, n = 0;
 	time_t start;
@@ -302,6 +345,14 @@ static void *display(void *cookie)
 			maxj = maxjitter;
 			gmaxj = gmaxjitter;
 
+			/*
+			 * Snapshots are taken on the fly, so they may
+			 * lag the sampling task by a few samples.
+			 */
+			if (hdr_output && hdr_interval &&
+			    ++snapshot % hdr_interval == 0)
+				save_hdr_histogram();
+
 		} else {
 			struct rttst_interm_bench_res result;
 
@@ -502,6 +553,11 @@ static void cleanup(void)
 	     goverrun, max_relaxed, actual_duration / 3600, (actual_duration / 60) % 60,
 	     actual_duration % 60, test_duration / 3600,
 	     (test_duration / 60) % 60, test_duration % 60);
+	if (test_mode == USER_TASK && hdr_hist && hdr_hist->total > 0) {
+		dump_hdr_percentiles();
+		if (hdr_output)
+			save_hdr_histogram();
+	}
 	if (max_relaxed > 0)
 		printf(
 "Warning! some latency peaks may have been due to involuntary mode switches.\n"
@@ -513,6 +569,8 @@ static void cleanup(void)
 		free(histogram_max);
 	if (histogram_min)
 		free(histogram_min);
+	if (hdr_hist)
+		free(hdr_hist);
 
 	exit(0);
 }
@@ -580,7 +638,7 @@ int main(int argc, char *const *argv)
 	cpu_set_t cpus;
 	sigset_t mask;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:bo:i:")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
@@ -657,6 +715,14 @@ int main(int argc, char *const *argv)
 			stop_upon_switch = 1;
 			break;
 
+		case 'o':
+			hdr_output = strdup(optarg);
+			break;
+
+		case 'i':
+			hdr_interval = atoi(optarg);
+			break;
+
 		default:
 
 			fprintf(stderr,
@@ -676,6 +742,8 @@ int main(int argc, char *const *argv)
 "  [-c <cpu>]                   # pin measuring task down to given CPU\n"
 "  [-P <priority>]              # task priority (test mode 0 and 1 only)\n"
 "  [-b]                         # break upon mode switch\n"
+"  [-o <file>]                  # dump percentile histogram to <file>\n"
+"  [-i <seconds>]               # also dump it every <seconds>, default=0\n"
 );
 			exit(2);
 		}
@@ -697,9 +765,13 @@ int main(int argc, char *const *argv)
 	histogram_max = calloc(histogram_size, sizeof(int32_t));
 	histogram_min = calloc(histogram_size, sizeof(int32_t));
 
-	if (!(histogram_avg && histogram_max && histogram_min))
+	hdr_hist = malloc(sizeof(*hdr_hist));
+
+	if (!(histogram_avg && histogram_max && histogram_min && hdr_hist))
 		cleanup();
 
+	hdr_init(hdr_hist, cpu, period_ns ?: CONFIG_XENO_DEFAULT_PERIOD);
+
 	if (period_ns == 0)
 		period_ns = CONFIG_XENO_DEFAULT_PERIOD;	/* ns */
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Merge latency histogram dumps (latency -o) collected from several
+ * CPUs or hosts, then print the resulting percentiles.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hdr.h"
+
+static const double percentiles[] = {
+	50.0, 90.0, 99.0, 99.9, 99.99, 99.999, 99.9999,
+};
+
+#define NR_PERCENTILES	(sizeof(percentiles) / sizeof(percentiles[0]))
+
+static struct hdr_histogram merged, h;
+
+static void print_header(void)
+{
+	unsigned int n;
+
+	printf("%-24s|%12s|%9s|%9s", "source", "samples", "min", "max");
+	for (n = 0; n < NR_PERCENTILES; n++)
+		printf("|%8gp", percentiles[n]);
+	printf("\n");
+}
+
+static void print_summary(const char *name, const struct hdr_histogram *p)
+{
+	unsigned int n;
+
+	printf("%-24s|%12llu|%9.3f|%9.3f", name,
+	       (unsigned long long)p->total,
+	       (double)p->min / 1000, (double)p->max / 1000);
+	for (n = 0; n < NR_PERCENTILES; n++)
+		printf("|%9.3f", (double)hdr_percentile(p, percentiles[n]) / 1000);
+	printf("\n");
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+"usage: latmerge [options] <dump-file>...\n"
+"  [-o <file>]                  # write merged histogram to <file>\n"
+"  [-q]                         # only print the merged results\n"
+"All results in microseconds.\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	const char *output = NULL;
+	int c, ret, quiet = 0;
+	FILE *fp;
+
+	while ((c = getopt(argc, argv, "o:q")) != EOF) {
+		switch (c) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage();
+			return 2;
+		}
+	}
+
+	if (optind >= argc) {
+		usage();
+		return 2;
+	}
+
+	hdr_init(&merged, 0, 0);
+	merged.cpu = -2;	/* No source yet. */
+
+	print_header();
+
+	for (; optind < argc; optind++) {
+		fp = fopen(argv[optind], "r");
+		if (fp == NULL) {
+			fprintf(stderr, "latmerge: cannot open %s: %m\n",
+				argv[optind]);
+			return 1;
+		}
+		ret = hdr_load(&h, fp);
+		fclose(fp);
+		if (ret) {
+			fprintf(stderr, "latmerge: %s: invalid dump file\n",
+				argv[optind]);
+			return 1;
+		}
+		if (!quiet)
+			print_summary(argv[optind], &h);
+		if (merged.cpu == -2) {
+			merged.cpu = h.cpu;
+			merged.period_ns = h.period_ns;
+		}
+		hdr_merge(&merged, &h);
+	}
+
+	print_summary("merged", &merged);
+
+	if (output) {
+		ret = hdr_save(&merged, output, "merged");
+		if (ret) {
+			fprintf(stderr, "latmerge: cannot write %s: %s\n",
+				output, strerror(-ret));
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -13,6 +13,7 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/mman.h>
 #include <smokey/smokey.h>
 #include <rtdm/ipc.h>
 
@@ -132,6 +133,109 @@ static void *client(void *arg)
 	return NULL;
 }
 
+static void *ring_selector(void *arg)
+{
+	struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+	int s = *(int *)arg;
+	fd_set set;
+
+	FD_ZERO(&set);
+	FD_SET(s, &set);
+
+	return (void *)(long)select(s + 1, &set, NULL, NULL, &tv);
+}
+
+/*
+ * Exchange data over a ring mapped on both ends, without involving
+ * the kernel except for binding and mapping.
+ */
+static int check_ring(void)
+{
+	struct bufp_ring *svring, *clring;
+	struct sockaddr_ipc saddr;
+	int ret, sv, cl, on = 1;
+	pthread_t seltid;
+	long data, n;
+	void *status;
+	size_t bufsz;
+	void *ptr;
+	socklen_t len;
+
+	sv = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (sv < 0)
+		fail("socket");
+
+	bufsz = 4096;
+	if (setsockopt(sv, SOL_BUFP, BUFP_BUFSZ, &bufsz, sizeof(bufsz)))
+		fail("setsockopt");
+
+	if (setsockopt(sv, SOL_BUFP, BUFP_RING, &on, sizeof(on)))
+		fail("setsockopt");
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_SVPORT + 1;
+	if (bind(sv, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("bind");
+
+	len = sizeof(ptr);
+	if (getsockopt(sv, SOL_BUFP, BUFP_MAP, &ptr, &len))
+		fail("getsockopt");
+	svring = ptr;
+	if (svring->size != bufsz)
+		return -EINVAL;
+
+	cl = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (cl < 0)
+		fail("socket");
+
+	if (connect(cl, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("connect");
+
+	len = sizeof(ptr);
+	if (getsockopt(cl, SOL_BUFP, BUFP_MAP, &ptr, &len))
+		fail("getsockopt");
+	clring = ptr;
+
+	/* Go through the ring several times to cover wrapping. */
+	for (n = 0; n < 3 * (long)bufsz / (long)sizeof(data); n++) {
+		ret = bufp_ring_write(cl, clring, &n, sizeof(n));
+		if (ret != sizeof(n))
+			fail("bufp_ring_write");
+		ret = bufp_ring_read(sv, svring, &data, sizeof(data));
+		if (ret != sizeof(data))
+			fail("bufp_ring_read");
+		if (data != n)
+			return -EINVAL;
+	}
+
+	/* The regular receive path sees ring data too. */
+	n = 0xdeadbeef;
+	bufp_ring_write(cl, clring, &n, sizeof(n));
+	ret = recv(sv, &data, sizeof(data), MSG_DONTWAIT);
+	if (ret != sizeof(data) || data != n)
+		return -EINVAL;
+
+	/* A ring update must wake up a reader blocked in select(). */
+	errno = pthread_create(&seltid, NULL, ring_selector, &sv);
+	if (errno)
+		fail("pthread_create");
+	usleep(100000);
+	bufp_ring_write(cl, clring, &n, sizeof(n));
+	pthread_join(seltid, &status);
+	if ((long)status != 1) {
+		smokey_note("bufp: select() missed the ring update");
+		return -EINVAL;
+	}
+
+	close(cl);
+	close(sv);
+	munmap(clring, clring->offset + bufsz);
+	munmap(svring, svring->offset + bufsz);
+
+	return 0;
+}
+
 static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param svparam = {.sched_priority = 71 };
@@ -170,5 +274,5 @@ static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
-	return 0;
+	return check_ring();
 }
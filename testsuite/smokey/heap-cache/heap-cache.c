@@ -0,0 +1,260 @@
+/*
+ * Private heap cache test.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <copperplate/heapobj.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(heap_cache,
+		   SMOKEY_NOARGS,
+		   "Check and benchmark the per-thread caches of the private heap."
+);
+
+#define NR_LOOPS	2000
+#define BATCH		32
+#define MAX_WORKERS	64
+
+struct allocator {
+	const char *name;
+	void *(*alloc)(size_t size);
+	void (*free)(void *ptr);
+};
+
+static const struct allocator cached = {
+	.name = "cached",
+	.alloc = pvmalloc,
+	.free = pvfree,
+};
+
+static const struct allocator locked = {
+	.name = "locked",
+	.alloc = tlsf_malloc,
+	.free = tlsf_free,
+};
+
+/*
+ * Each worker hands the blocks it allocated over to the next one
+ * through its mailbox, which the latter releases.
+ */
+struct worker {
+	pthread_t tid;
+	int cpu;
+	const struct allocator *a;
+	int cross;
+	void *box[BATCH];
+	int full;
+	struct worker *next;
+	long long cost;
+	int ret;
+};
+
+static struct worker workers[MAX_WORKERS];
+
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t gate = PTHREAD_COND_INITIALIZER;
+
+/* Negative if the run was aborted. */
+static int gate_open;
+
+/* Set when a worker bails out, so that peers stop waiting for it. */
+static int failed;
+
+static long long elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+		now.tv_nsec - start->tv_nsec;
+}
+
+static inline size_t block_size(int n)
+{
+	return 16 << (n % 7);	/* 16 to 1024 bytes. */
+}
+
+/* Each block holds its own address, aliasing would break this. */
+static int release(const struct allocator *a, void **blocks)
+{
+	int n;
+
+	for (n = 0; n < BATCH; n++) {
+		if (*(void **)blocks[n] != blocks[n])
+			return -EINVAL;
+		a->free(blocks[n]);
+	}
+
+	return 0;
+}
+
+static int wait_box(struct worker *w, int full)
+{
+	while (__sync_fetch_and_add(&w->full, 0) != full) {
+		if (__sync_fetch_and_add(&failed, 0))
+			return -ECANCELED;
+		sched_yield();
+	}
+
+	return 0;
+}
+
+static void *worker_body(void *arg)
+{
+	struct worker *w = arg;
+	const struct allocator *a = w->a;
+	struct timespec start;
+	void *blocks[BATCH];
+	cpu_set_t cpus;
+	int loop, n;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(w->cpu, &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+
+	pthread_mutex_lock(&gate_lock);
+	while (!gate_open)
+		pthread_cond_wait(&gate, &gate_lock);
+	pthread_mutex_unlock(&gate_lock);
+
+	if (gate_open < 0)
+		return NULL;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (loop = 0; loop < NR_LOOPS; loop++) {
+		for (n = 0; n < BATCH; n++) {
+			blocks[n] = a->alloc(block_size(n + loop));
+			if (blocks[n] == NULL) {
+				w->ret = -ENOMEM;
+				goto out;
+			}
+			*(void **)blocks[n] = blocks[n];
+		}
+
+		if (!w->cross) {
+			if (release(a, blocks))
+				goto fail;
+			continue;
+		}
+
+		if (wait_box(w->next, 0))
+			return NULL;
+		memcpy(w->next->box, blocks, sizeof(blocks));
+		__sync_lock_test_and_set(&w->next->full, 1);
+
+		if (wait_box(w, 1))
+			return NULL;
+		if (release(a, w->box))
+			goto fail;
+		__sync_lock_test_and_set(&w->full, 0);
+	}
+
+	w->cost = elapsed(&start) / (NR_LOOPS * BATCH);
+
+	return NULL;
+fail:
+	w->ret = -EINVAL;
+	smokey_note("corrupted block in %s heap", a->name);
+out:
+	__sync_lock_test_and_set(&failed, 1);
+
+	return NULL;
+}
+
+/*
+ * Have one thread per CPU allocate and release blocks concurrently,
+ * returning the average cost of an allocation and release pair.
+ */
+static int run_workers(int nr_cpus, const struct allocator *a,
+		       int cross, long long *cost)
+{
+	int n, ret = 0;
+
+	gate_open = 0;
+	failed = 0;
+
+	for (n = 0; n < nr_cpus; n++) {
+		workers[n].cpu = n;
+		workers[n].a = a;
+		workers[n].cross = cross;
+		workers[n].full = 0;
+		workers[n].next = &workers[(n + 1) % nr_cpus];
+		workers[n].cost = 0;
+		workers[n].ret = 0;
+	}
+
+	for (n = 0; n < nr_cpus; n++) {
+		ret = -pthread_create(&workers[n].tid, NULL,
+				      worker_body, &workers[n]);
+		if (ret)
+			break;
+	}
+
+	/*
+	 * Workers exchanging blocks wait for each other, so don't
+	 * start any of them unless all exist.
+	 */
+	pthread_mutex_lock(&gate_lock);
+	gate_open = ret ? -1 : 1;
+	pthread_cond_broadcast(&gate);
+	pthread_mutex_unlock(&gate_lock);
+
+	nr_cpus = n;
+	*cost = 0;
+
+	for (n = 0; n < nr_cpus; n++) {
+		pthread_join(workers[n].tid, NULL);
+		if (workers[n].ret && ret == 0)
+			ret = workers[n].ret;
+		*cost += workers[n].cost;
+	}
+
+	if (nr_cpus > 0)
+		*cost /= nr_cpus;
+
+	return ret;
+}
+
+static int run_heap_cache(struct smokey_test *t, int argc, char *const argv[])
+{
+	static const struct allocator *allocators[] = { &cached, &locked };
+	long long local[2], cross[2];
+	int n, k, ret, nr_cpus;
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_cpus > MAX_WORKERS)
+		nr_cpus = MAX_WORKERS;
+
+	for (n = 1;; n = n * 2 < nr_cpus ? n * 2 : nr_cpus) {
+		for (k = 0; k < 2; k++) {
+			ret = run_workers(n, allocators[k], 0, &local[k]);
+			if (ret == 0)
+				ret = run_workers(n, allocators[k], 1, &cross[k]);
+			if (ret) {
+				smokey_note("%s heap on %d CPU(s) failed: %s",
+					    allocators[k]->name, n, strerror(-ret));
+				return ret;
+			}
+		}
+		smokey_note("%d CPU(s): alloc+free %lld ns cached, %lld ns locked; "
+			    "cross-thread %lld ns cached, %lld ns locked",
+			    n, local[0], local[1], cross[0], cross[1]);
+		if (n >= nr_cpus)
+			break;
+	}
+
+	return 0;
+}
@@ -13,6 +13,8 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <smokey/smokey.h>
 #include <rtdm/ipc.h>
 
@@ -23,6 +25,10 @@ smokey_test_plugin(iddp,
 
 #define IDDP_SVPORT 12
 #define IDDP_CLPORT 13
+#define IDDP_BMPORT 14
+
+#define BENCH_MSGS  100000
+#define BENCH_MSGSZ 64
 
 static pthread_t svtid, cltid;
 
@@ -136,6 +142,196 @@ static void *client(void *arg)
 	return NULL;
 }
 
+static int bench_socket(int zerocopy)
+{
+	struct iddp_slotconf conf;
+	struct sockaddr_ipc saddr;
+	size_t poolsz;
+	int s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0)
+		fail("socket");
+
+	if (zerocopy) {
+		conf.count = 64;
+		conf.size = BENCH_MSGSZ;
+		if (setsockopt(s, SOL_IDDP, IDDP_SLOTS, &conf, sizeof(conf)))
+			fail("setsockopt");
+	} else {
+		poolsz = 64 * 1024;
+		if (setsockopt(s, SOL_IDDP, IDDP_POOLSZ,
+			       &poolsz, sizeof(poolsz)))
+			fail("setsockopt");
+	}
+
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = IDDP_BMPORT;
+	if (bind(s, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("bind");
+
+	return s;
+}
+
+static double elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) +
+		(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int bench_copy(double *rate)
+{
+	char buf[BENCH_MSGSZ];
+	struct sockaddr_ipc saddr;
+	struct timespec start;
+	int ret, sv, cl;
+	long n;
+
+	sv = bench_socket(0);
+	cl = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (cl < 0)
+		fail("socket");
+
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = IDDP_BMPORT;
+	if (connect(cl, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("connect");
+
+	memset(buf, 0, sizeof(buf));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < BENCH_MSGS; n++) {
+		memcpy(buf, &n, sizeof(n));
+		ret = send(cl, buf, sizeof(buf), 0);
+		if (ret != sizeof(buf))
+			fail("send");
+		ret = recv(sv, buf, sizeof(buf), 0);
+		if (ret != sizeof(buf))
+			fail("recv");
+		if (memcmp(buf, &n, sizeof(n)))
+			return -EINVAL;
+	}
+
+	*rate = BENCH_MSGS / elapsed(&start);
+
+	close(cl);
+	close(sv);
+
+	return 0;
+}
+
+static int bench_zerocopy(double *rate)
+{
+	struct sockaddr_ipc saddr;
+	struct timespec start;
+	struct iddp_slot slot;
+	char *svpool, *clpool;
+	int ret, sv, cl, other;
+	socklen_t len;
+	void *ptr;
+	long n;
+
+	sv = bench_socket(1);
+	cl = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (cl < 0)
+		fail("socket");
+
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = IDDP_BMPORT;
+	if (connect(cl, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("connect");
+
+	len = sizeof(ptr);
+	if (getsockopt(sv, SOL_IDDP, IDDP_MAP, &ptr, &len))
+		fail("getsockopt(IDDP_MAP)");
+	svpool = ptr;
+
+	len = sizeof(ptr);
+	if (getsockopt(cl, SOL_IDDP, IDDP_MAP, &ptr, &len))
+		fail("getsockopt(IDDP_MAP)");
+	clpool = ptr;
+
+	/* Only the socket which grabbed a slot may post it. */
+	other = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (other < 0)
+		fail("socket");
+	if (connect(other, (struct sockaddr *)&saddr, sizeof(saddr)))
+		fail("connect");
+	len = sizeof(slot);
+	if (getsockopt(cl, SOL_IDDP, IDDP_GETSLOT, &slot, &len))
+		fail("getsockopt(IDDP_GETSLOT)");
+	slot.len = BENCH_MSGSZ;
+	ret = setsockopt(other, SOL_IDDP, IDDP_PUTSLOT, &slot, sizeof(slot));
+	if (ret == 0 || errno != EINVAL)
+		return -EPERM;
+	close(other);
+	if (setsockopt(cl, SOL_IDDP, IDDP_PUTSLOT, &slot, sizeof(slot)))
+		fail("setsockopt(IDDP_PUTSLOT)");
+	len = sizeof(slot);
+	if (getsockopt(sv, SOL_IDDP, IDDP_RECVSLOT, &slot, &len))
+		fail("getsockopt(IDDP_RECVSLOT)");
+	if (setsockopt(sv, SOL_IDDP, IDDP_RELEASE,
+		       &slot.index, sizeof(slot.index)))
+		fail("setsockopt(IDDP_RELEASE)");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < BENCH_MSGS; n++) {
+		len = sizeof(slot);
+		ret = getsockopt(cl, SOL_IDDP, IDDP_GETSLOT, &slot, &len);
+		if (ret)
+			fail("getsockopt(IDDP_GETSLOT)");
+		memcpy(clpool + slot.offset, &n, sizeof(n));
+		slot.len = BENCH_MSGSZ;
+		ret = setsockopt(cl, SOL_IDDP, IDDP_PUTSLOT, &slot, sizeof(slot));
+		if (ret)
+			fail("setsockopt(IDDP_PUTSLOT)");
+		len = sizeof(slot);
+		ret = getsockopt(sv, SOL_IDDP, IDDP_RECVSLOT, &slot, &len);
+		if (ret)
+			fail("getsockopt(IDDP_RECVSLOT)");
+		if (slot.len != BENCH_MSGSZ ||
+		    memcmp(svpool + slot.offset, &n, sizeof(n)))
+			return -EINVAL;
+		ret = setsockopt(sv, SOL_IDDP, IDDP_RELEASE,
+				 &slot.index, sizeof(slot.index));
+		if (ret)
+			fail("setsockopt(IDDP_RELEASE)");
+	}
+
+	*rate = BENCH_MSGS / elapsed(&start);
+
+	close(cl);
+	close(sv);
+	munmap(clpool, 64 * BENCH_MSGSZ);
+	munmap(svpool, 64 * BENCH_MSGSZ);
+
+	return 0;
+}
+
+static int run_bench(void)
+{
+	double copy_rate, zc_rate;
+	int ret;
+
+	ret = bench_copy(&copy_rate);
+	if (ret)
+		return ret;
+
+	ret = bench_zerocopy(&zc_rate);
+	if (ret)
+		return ret;
+
+	smokey_note("iddp: %.0f msgs/s (copy), %.0f msgs/s (zero-copy), "
+		    "%d bytes per message\n", copy_rate, zc_rate, BENCH_MSGSZ);
+
+	return 0;
+}
+
 static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param svparam = {.sched_priority = 71 };
@@ -174,5 +370,5 @@ static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
-	return 0;
+	return run_bench();
 }
@@ -0,0 +1,229 @@
+/*
+ * Batched sendmmsg/recvmmsg test over RTIPC/IDDP.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <smokey/smokey.h>
+#include <rtdm/ipc.h>
+
+smokey_test_plugin(mmsg,
+		   SMOKEY_NOARGS,
+		   "Check and benchmark batched message I/O on RTDM sockets."
+);
+
+#define MMSG_PORT   20
+
+#define BENCH_MSGS  100000
+#define BENCH_MSGSZ 64
+#define BENCH_BATCH 16
+
+static char bufs[BENCH_BATCH][BENCH_MSGSZ];
+static struct iovec iovs[BENCH_BATCH];
+static struct mmsghdr msgvec[BENCH_BATCH];
+
+static int open_sockets(int *sv, int *cl)
+{
+	struct sockaddr_ipc saddr;
+	size_t poolsz;
+	int ret;
+
+	*sv = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (*sv < 0)
+		return -errno;
+
+	poolsz = BENCH_BATCH * (BENCH_MSGSZ + 64) * 2;
+	ret = setsockopt(*sv, SOL_IDDP, IDDP_POOLSZ, &poolsz, sizeof(poolsz));
+	if (ret)
+		goto fail_sv;
+
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = MMSG_PORT;
+	ret = bind(*sv, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail_sv;
+
+	*cl = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (*cl < 0)
+		goto fail_sv;
+
+	ret = connect(*cl, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail_cl;
+
+	return 0;
+fail_cl:
+	ret = -errno;
+	close(*cl);
+	close(*sv);
+	return ret;
+fail_sv:
+	ret = -errno;
+	close(*sv);
+	return ret;
+}
+
+static void close_sockets(int sv, int cl)
+{
+	close(cl);
+	close(sv);
+}
+
+static void init_msgvec(void)
+{
+	int n;
+
+	for (n = 0; n < BENCH_BATCH; n++) {
+		iovs[n].iov_base = bufs[n];
+		iovs[n].iov_len = BENCH_MSGSZ;
+		memset(&msgvec[n], 0, sizeof(msgvec[n]));
+		msgvec[n].msg_hdr.msg_iov = &iovs[n];
+		msgvec[n].msg_hdr.msg_iovlen = 1;
+	}
+}
+
+static double elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) +
+		(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int check_batch(int sv, int cl)
+{
+	long seq;
+	int n, ret;
+
+	init_msgvec();
+	for (n = 0; n < BENCH_BATCH; n++) {
+		seq = n;
+		memcpy(bufs[n], &seq, sizeof(seq));
+	}
+
+	ret = sendmmsg(cl, msgvec, BENCH_BATCH, 0);
+	if (ret != BENCH_BATCH) {
+		smokey_note("sendmmsg() sent %d/%d frames", ret, BENCH_BATCH);
+		return ret < 0 ? -errno : -EIO;
+	}
+
+	memset(bufs, 0xff, sizeof(bufs));
+	init_msgvec();
+
+	/*
+	 * MSG_WAITFORONE must return what is pending once the first
+	 * datagram is in, never block for the rest of the vector.
+	 */
+	ret = recvmmsg(sv, msgvec, BENCH_BATCH, MSG_WAITFORONE, NULL);
+	if (ret != BENCH_BATCH) {
+		smokey_note("recvmmsg() got %d/%d frames", ret, BENCH_BATCH);
+		return ret < 0 ? -errno : -EIO;
+	}
+
+	for (n = 0; n < BENCH_BATCH; n++) {
+		memcpy(&seq, bufs[n], sizeof(seq));
+		if (msgvec[n].msg_len != BENCH_MSGSZ || seq != n) {
+			smokey_note("frame #%d does not match", n);
+			return -EINVAL;
+		}
+	}
+
+	/* Nothing left: a non-blocking receive must fail. */
+	ret = recvmmsg(sv, msgvec, BENCH_BATCH, MSG_DONTWAIT, NULL);
+	if (ret >= 0 || errno != EWOULDBLOCK) {
+		smokey_note("recvmmsg() on empty socket returned %d", ret);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int bench_single(int sv, int cl, double *rate)
+{
+	struct timespec start;
+	char buf[BENCH_MSGSZ];
+	int ret;
+	long n;
+
+	memset(buf, 0, sizeof(buf));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < BENCH_MSGS; n++) {
+		memcpy(buf, &n, sizeof(n));
+		ret = send(cl, buf, sizeof(buf), 0);
+		if (ret != sizeof(buf))
+			return -errno;
+		ret = recv(sv, buf, sizeof(buf), 0);
+		if (ret != sizeof(buf))
+			return -errno;
+	}
+
+	*rate = BENCH_MSGS / elapsed(&start);
+
+	return 0;
+}
+
+static int bench_batched(int sv, int cl, double *rate)
+{
+	struct timespec start;
+	long n;
+	int ret;
+
+	init_msgvec();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < BENCH_MSGS; n += BENCH_BATCH) {
+		ret = sendmmsg(cl, msgvec, BENCH_BATCH, 0);
+		if (ret != BENCH_BATCH)
+			return ret < 0 ? -errno : -EIO;
+		ret = recvmmsg(sv, msgvec, BENCH_BATCH, 0, NULL);
+		if (ret != BENCH_BATCH)
+			return ret < 0 ? -errno : -EIO;
+	}
+
+	*rate = n / elapsed(&start);
+
+	return 0;
+}
+
+static int run_mmsg(struct smokey_test *t, int argc, char *const argv[])
+{
+	double single_rate = 0, batch_rate = 0;
+	int ret, sv, cl = -1;
+
+	ret = open_sockets(&sv, &cl);
+	if (ret == -EAFNOSUPPORT)
+		return -ENOSYS;
+	if (ret)
+		return ret;
+
+	ret = check_batch(sv, cl);
+	if (ret)
+		goto out;
+
+	ret = bench_single(sv, cl, &single_rate);
+	if (ret)
+		goto out;
+
+	ret = bench_batched(sv, cl, &batch_rate);
+	if (ret)
+		goto out;
+
+	smokey_note("mmsg: %.0f frames/s (single), %.0f frames/s (batch of %d), "
+		    "%d bytes per frame\n", single_rate, batch_rate,
+		    BENCH_BATCH, BENCH_MSGSZ);
+out:
+	close_sockets(sv, cl);
+
+	return ret;
+}
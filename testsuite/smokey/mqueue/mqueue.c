@@ -0,0 +1,326 @@
+/*
+ * POSIX message queue test.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(mqueue,
+		   SMOKEY_NOARGS,
+		   "Check the POSIX message queue services."
+);
+
+#define MQ_NAME		"/smokey-mq"
+#define SMALL_MAXMSG	8
+#define LARGE_MAXMSG	64
+#define MSGSIZE		64
+#define NLOOPS		10000
+
+static int check(const char *what, long ret, long expected)
+{
+	if (ret == expected)
+		return 0;
+
+	smokey_note("%s returned %ld, expected %ld (%s)",
+		    what, ret, expected, ret < 0 ? strerror(errno) : "-");
+	return -EINVAL;
+}
+
+static mqd_t open_queue(long maxmsg, int oflags)
+{
+	struct mq_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.mq_maxmsg = maxmsg;
+	attr.mq_msgsize = MSGSIZE;
+
+	mq_unlink(MQ_NAME);
+
+	return mq_open(MQ_NAME, O_RDWR | O_CREAT | O_EXCL | oflags,
+		       0600, &attr);
+}
+
+static void close_queue(mqd_t mq)
+{
+	mq_close(mq);
+	mq_unlink(MQ_NAME);
+}
+
+static int check_ordering(mqd_t mq)
+{
+	static const struct {
+		const char *msg;
+		unsigned int prio;
+	} in[] = {
+		{ "low", 1 }, { "high-1", 5 }, { "mid", 3 }, { "high-2", 5 },
+	}, out[] = {
+		{ "high-1", 5 }, { "high-2", 5 }, { "mid", 3 }, { "low", 1 },
+	};
+	char buf[MSGSIZE];
+	struct mq_attr attr;
+	unsigned int prio;
+	ssize_t len;
+	int n;
+
+	for (n = 0; n < 4; n++) {
+		if (mq_send(mq, in[n].msg, strlen(in[n].msg) + 1, in[n].prio))
+			return -errno;
+	}
+
+	if (mq_getattr(mq, &attr))
+		return -errno;
+
+	if (check("queued message count", attr.mq_curmsgs, 4))
+		return -EINVAL;
+
+	for (n = 0; n < 4; n++) {
+		len = mq_receive(mq, buf, sizeof(buf), &prio);
+		if (check("receive length", len, strlen(out[n].msg) + 1) ||
+		    check("receive priority", prio, out[n].prio))
+			return -EINVAL;
+		if (strcmp(buf, out[n].msg)) {
+			smokey_note("received '%s', expected '%s'",
+				    buf, out[n].msg);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int check_limits(mqd_t mq, long maxmsg)
+{
+	char buf[MSGSIZE + 1];
+	ssize_t len;
+	int n, ret;
+
+	memset(buf, 0, sizeof(buf));
+
+	ret = mq_send(mq, buf, MSGSIZE + 1, 0);
+	if (check("oversized send", ret < 0 ? -errno : ret, -EMSGSIZE))
+		return -EINVAL;
+
+	len = mq_receive(mq, buf, MSGSIZE - 1, NULL);
+	if (check("short receive", len < 0 ? -errno : len, -EMSGSIZE))
+		return -EINVAL;
+
+	for (n = 0; n < maxmsg; n++) {
+		if (mq_send(mq, buf, MSGSIZE, 0))
+			return -errno;
+	}
+
+	ret = mq_send(mq, buf, MSGSIZE, 0);
+	if (check("send to full queue", ret < 0 ? -errno : ret, -EAGAIN))
+		return -EINVAL;
+
+	for (n = 0; n < maxmsg; n++) {
+		len = mq_receive(mq, buf, sizeof(buf), NULL);
+		if (check("receive", len, MSGSIZE))
+			return -EINVAL;
+	}
+
+	len = mq_receive(mq, buf, sizeof(buf), NULL);
+	if (check("receive from empty queue", len < 0 ? -errno : len, -EAGAIN))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void *receiver(void *arg)
+{
+	mqd_t mq = (mqd_t)(long)arg;
+	char buf[MSGSIZE];
+	unsigned int prio;
+	ssize_t len;
+	int n;
+
+	for (n = 0; n < NLOOPS; n++) {
+		len = mq_receive(mq, buf, sizeof(buf), &prio);
+		if (len != sizeof(n) || memcmp(buf, &n, sizeof(n)))
+			return (void *)(long)-EPROTO;
+	}
+
+	return NULL;
+}
+
+/*
+ * Stream messages to a receiver which has to sleep whenever the
+ * queue runs empty, making the sender wait as well when it fills
+ * up: no message may be lost or reordered.
+ */
+static int check_streaming(mqd_t mq)
+{
+	char buf[MSGSIZE];
+	struct timespec ts;
+	pthread_t tid;
+	void *status;
+	ssize_t len;
+	int n, ret;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_nsec -= 1000000000;
+		ts.tv_sec++;
+	}
+
+	len = mq_timedreceive(mq, buf, sizeof(buf), NULL, &ts);
+	if (check("timed receive", len < 0 ? -errno : len, -ETIMEDOUT))
+		return -EINVAL;
+
+	ret = pthread_create(&tid, NULL, receiver, (void *)(long)mq);
+	if (ret)
+		return -ret;
+
+	for (n = 0; n < NLOOPS; n++) {
+		if (mq_send(mq, (const char *)&n, sizeof(n), 0)) {
+			ret = -errno;
+			pthread_cancel(tid);
+			pthread_join(tid, NULL);
+			return ret;
+		}
+	}
+
+	pthread_join(tid, &status);
+	if (status) {
+		smokey_note("receiver got out-of-sequence message");
+		return (int)(long)status;
+	}
+
+	return 0;
+}
+
+static long long measure(mqd_t mq)
+{
+	struct timespec start, end;
+	char buf[MSGSIZE];
+	int n;
+
+	memset(buf, 0, sizeof(buf));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < NLOOPS; n++) {
+		if (mq_send(mq, buf, MSGSIZE, 0) ||
+		    mq_receive(mq, buf, sizeof(buf), NULL) != MSGSIZE)
+			return -errno;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1000000000LL +
+		end.tv_nsec - start.tv_nsec) / NLOOPS;
+}
+
+static int run_queue(long maxmsg, long long *cost)
+{
+	mqd_t mq;
+	int ret;
+
+	mq = open_queue(maxmsg, O_NONBLOCK);
+	if (mq == (mqd_t)-1)
+		return -errno;
+
+	ret = check_ordering(mq);
+	if (ret)
+		goto out;
+
+	ret = check_limits(mq, maxmsg);
+	if (ret)
+		goto out;
+
+	*cost = measure(mq);
+	if (*cost < 0) {
+		ret = (int)*cost;
+		goto out;
+	}
+
+	close_queue(mq);
+
+	mq = open_queue(maxmsg, 0);
+	if (mq == (mqd_t)-1)
+		return -errno;
+
+	ret = check_streaming(mq);
+out:
+	close_queue(mq);
+
+	return ret;
+}
+
+/*
+ * A descriptor closed with close() instead of mq_close() may be
+ * reused by a larger queue, which must not be served from the state
+ * of the former one.
+ */
+static int check_fd_reuse(void)
+{
+	struct mq_attr attr;
+	mqd_t mq, reused;
+	int n, ret = 0;
+
+	mq = open_queue(SMALL_MAXMSG, O_NONBLOCK);
+	if (mq == (mqd_t)-1)
+		return -errno;
+
+	close(mq);
+
+	reused = open_queue(LARGE_MAXMSG, O_NONBLOCK);
+	if (reused == (mqd_t)-1)
+		return -errno;
+
+	if (reused != mq) {
+		smokey_note("mqueue: descriptor not reused, skipping check");
+		goto out;
+	}
+
+	for (n = 0; n < LARGE_MAXMSG; n++) {
+		if (mq_send(reused, "x", 1, 0)) {
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	if (mq_getattr(reused, &attr))
+		ret = -errno;
+	else if (check("queued message count", attr.mq_curmsgs, LARGE_MAXMSG))
+		ret = -EINVAL;
+out:
+	close_queue(reused);
+
+	return ret;
+}
+
+static int run_mqueue(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long shared, kernel;
+	int ret;
+
+	/* Small queues are served from the shared memory heap. */
+	ret = run_queue(SMALL_MAXMSG, &shared);
+	if (ret)
+		return ret;
+
+	ret = run_queue(LARGE_MAXMSG, &kernel);
+	if (ret)
+		return ret;
+
+	ret = check_fd_reuse();
+	if (ret)
+		return ret;
+
+	smokey_note("send+receive: %lld ns (%d slots), %lld ns (%d slots)",
+		    shared, SMALL_MAXMSG, kernel, LARGE_MAXMSG);
+
+	return 0;
+}
@@ -0,0 +1,282 @@
+/*
+ * RTnet packet socket frame ring benchmark over the loopback device.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <smokey/smokey.h>
+#include <rtnet.h>
+
+smokey_test_plugin(packet_ring,
+		   SMOKEY_NOARGS,
+		   "Check and benchmark packet socket frame rings (needs rtlo up)."
+);
+
+#define IFNAME		"rtlo"
+#define ETH_P_BENCH	0x88b5	/* Local experimental. */
+
+#define NR_CYCLES	1000
+#define NR_FRAMES	256	/* per cycle */
+#define PAYLOAD_LEN	64
+
+#define FRAME_SIZE	256
+#define BLOCK_SIZE	4096
+
+struct bench_frame {
+	struct ether_header eth;
+	unsigned int seq;
+	char pad[PAYLOAD_LEN - sizeof(unsigned int)];
+} __attribute__((packed));
+
+struct ring {
+	void *mem;
+	size_t size;
+	unsigned int head;
+};
+
+static struct tpacket_req ring_req = {
+	.tp_block_size = BLOCK_SIZE,
+	.tp_block_nr = NR_FRAMES / (BLOCK_SIZE / FRAME_SIZE),
+	.tp_frame_size = FRAME_SIZE,
+	.tp_frame_nr = NR_FRAMES,
+};
+
+static long long elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+		now.tv_nsec - start->tv_nsec;
+}
+
+static int open_socket(int *ifindex_r)
+{
+	struct sockaddr_ll sll;
+	struct ifreq ifr;
+	int s;
+
+	s = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_BENCH));
+	if (s < 0)
+		return errno == EAFNOSUPPORT || errno == EPERM ? -ENOSYS : -errno;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, IFNAME, IFNAMSIZ - 1);
+	if (ioctl(s, SIOCGIFINDEX, &ifr))
+		goto nodev;
+
+	*ifindex_r = ifr.ifr_ifindex;
+	if (ioctl(s, SIOCGIFFLAGS, &ifr) || (ifr.ifr_flags & IFF_UP) == 0)
+		goto nodev;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_BENCH);
+	sll.sll_ifindex = *ifindex_r;
+	if (bind(s, (struct sockaddr *)&sll, sizeof(sll))) {
+		close(s);
+		return -errno;
+	}
+
+	return s;
+nodev:
+	close(s);
+
+	return -ENOSYS;
+}
+
+static void init_frame(struct bench_frame *f, unsigned int seq)
+{
+	memset(f, 0, sizeof(*f));
+	f->eth.ether_type = htons(ETH_P_BENCH);
+	f->seq = seq;
+}
+
+/*
+ * Each frame loops back to the sending socket, the loopback device
+ * delivers it synchronously.
+ */
+static int run_copy(int s, long long *cost)
+{
+	struct bench_frame f, r;
+	struct timespec start;
+	unsigned int pool = NR_FRAMES;
+	int cycle, n, seq = 0;
+	ssize_t ret;
+
+	/* Received frames are held in the socket pool until read. */
+	if (ioctl(s, RTNET_RTIOC_EXTPOOL, &pool) < 0)
+		return -errno;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (cycle = 0; cycle < NR_CYCLES; cycle++) {
+		for (n = 0; n < NR_FRAMES; n++) {
+			init_frame(&f, seq + n);
+			ret = send(s, &f, sizeof(f), 0);
+			if (ret != sizeof(f))
+				return ret < 0 ? -errno : -EPROTO;
+		}
+		for (n = 0; n < NR_FRAMES; n++, seq++) {
+			ret = recv(s, &r, sizeof(r), 0);
+			if (ret < 0)
+				return -errno;
+			if (ret != sizeof(r) || r.seq != seq) {
+				smokey_note("packet_ring: copy frame #%d mismatch", seq);
+				return -EPROTO;
+			}
+		}
+	}
+
+	*cost = elapsed(&start) / (NR_CYCLES * NR_FRAMES);
+
+	return 0;
+}
+
+static inline struct tpacket_hdr *ring_frame(struct ring *ring, unsigned int n)
+{
+	return ring->mem + n * FRAME_SIZE;	/* No gap between blocks. */
+}
+
+static int map_ring(int s, int optname, struct ring *ring, off_t offset)
+{
+	if (setsockopt(s, SOL_PACKET, optname, &ring_req, sizeof(ring_req)))
+		return -errno;
+
+	ring->size = ring_req.tp_block_size * ring_req.tp_block_nr;
+	ring->mem = mmap(NULL, ring->size, PROT_READ|PROT_WRITE,
+			 MAP_SHARED, s, offset);
+	if (ring->mem == MAP_FAILED)
+		return -errno;
+
+	ring->head = 0;
+
+	return 0;
+}
+
+static int run_ring(int s, long long *cost)
+{
+	struct ring rx, tx;
+	struct tpacket_hdr *hdr;
+	struct bench_frame *f;
+	struct timespec start;
+	int cycle, n, seq = 0, ret;
+	ssize_t len;
+
+	ret = map_ring(s, PACKET_RX_RING, &rx, 0);
+	if (ret)
+		return ret;
+
+	ret = map_ring(s, PACKET_TX_RING, &tx, rx.size);
+	if (ret)
+		goto unmap_rx;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (cycle = 0; cycle < NR_CYCLES; cycle++) {
+		for (n = 0; n < NR_FRAMES; n++) {
+			hdr = ring_frame(&tx, tx.head);
+			if (hdr->tp_status != TP_STATUS_AVAILABLE) {
+				smokey_note("packet_ring: TX frame #%d busy", seq + n);
+				ret = -EPROTO;
+				goto unmap_tx;
+			}
+			f = (void *)hdr + TPACKET_HDRLEN - sizeof(struct sockaddr_ll);
+			init_frame(f, seq + n);
+			hdr->tp_len = sizeof(*f);
+			__sync_synchronize();
+			hdr->tp_status = TP_STATUS_SEND_REQUEST;
+			tx.head = (tx.head + 1) % NR_FRAMES;
+		}
+
+		/* An empty message flushes the TX ring. */
+		len = send(s, NULL, 0, 0);
+		if (len != NR_FRAMES * sizeof(*f)) {
+			ret = len < 0 ? -errno : -EPROTO;
+			goto unmap_tx;
+		}
+
+		/* Returns at once since the RX ring is not empty. */
+		if (recv(s, NULL, 0, MSG_DONTWAIT)) {
+			ret = -errno;
+			goto unmap_tx;
+		}
+
+		for (n = 0; n < NR_FRAMES; n++, seq++) {
+			hdr = ring_frame(&rx, rx.head);
+			if ((hdr->tp_status & TP_STATUS_USER) == 0) {
+				smokey_note("packet_ring: RX frame #%d missing", seq);
+				ret = -EPROTO;
+				goto unmap_tx;
+			}
+			__sync_synchronize();
+			f = (void *)hdr + hdr->tp_mac;
+			if (hdr->tp_len != sizeof(*f) || f->seq != seq) {
+				smokey_note("packet_ring: ring frame #%d mismatch", seq);
+				ret = -EPROTO;
+				goto unmap_tx;
+			}
+			hdr->tp_status = TP_STATUS_KERNEL;
+			rx.head = (rx.head + 1) % NR_FRAMES;
+		}
+
+		if (recv(s, NULL, 0, MSG_DONTWAIT) != -1 || errno != EWOULDBLOCK) {
+			smokey_note("packet_ring: RX ring not empty");
+			ret = -EPROTO;
+			goto unmap_tx;
+		}
+	}
+
+	*cost = elapsed(&start) / (NR_CYCLES * NR_FRAMES);
+	ret = 0;
+unmap_tx:
+	munmap(tx.mem, tx.size);
+unmap_rx:
+	munmap(rx.mem, rx.size);
+
+	return ret;
+}
+
+static int run_packet_ring(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long copy_cost = 0, ring_cost = 0;
+	int s, ifindex, ret;
+
+	s = open_socket(&ifindex);
+	if (s < 0)
+		return s;
+
+	ret = run_copy(s, &copy_cost);
+	close(s);
+	if (ret)
+		return ret;
+
+	s = open_socket(&ifindex);
+	if (s < 0)
+		return s;
+
+	ret = run_ring(s, &ring_cost);
+	close(s);
+	if (ret)
+		return ret;
+
+	smokey_note("packet_ring: %d frames/cycle, %lld ns/frame (copy), "
+		    "%lld ns/frame (ring)", NR_FRAMES, copy_cost, ring_cost);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Cobalt poll set test.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/timerfd.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(pollset,
+		   SMOKEY_NOARGS,
+		   "Check the Cobalt poll set interface."
+);
+
+#define NR_TIMERS 16
+
+static int check(const char *what, int ret, int expected)
+{
+	if (ret == expected)
+		return 0;
+
+	smokey_note("%s returned %d, expected %d (%s)",
+		    what, ret, expected, ret < 0 ? strerror(errno) : "-");
+	return -EINVAL;
+}
+
+static int fire(int tfd, long ns)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_nsec = ns;
+
+	return timerfd_settime(tfd, 0, &its, NULL);
+}
+
+static int run_pollset(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct timespec timeout = { .tv_sec = 1 }, zero = { 0 };
+	struct pollfd fds[NR_TIMERS];
+	int tfds[NR_TIMERS], pfd, n, ret;
+	uint64_t ticks;
+
+	pfd = cobalt_poll_create(0);
+	if (pfd < 0)
+		return -errno;
+
+	for (n = 0; n < NR_TIMERS; n++) {
+		tfds[n] = timerfd_create(CLOCK_MONOTONIC, 0);
+		if (tfds[n] < 0)
+			return -errno;
+		ret = cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD, tfds[n], POLLIN);
+		if (ret)
+			return -errno;
+	}
+
+	ret = cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD, tfds[0], POLLIN);
+	if (check("duplicate add", ret < 0 ? -errno : ret, -EEXIST))
+		return -EINVAL;
+
+	/* Nothing is ready yet. */
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &zero);
+	if (check("poll on idle set", ret, 0))
+		return -EINVAL;
+
+	/* Only the timer which fired may be reported. */
+	if (fire(tfds[5], 1000000))
+		return -errno;
+
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &timeout);
+	if (check("poll on one ready timer", ret, 1))
+		return -EINVAL;
+
+	if (check("ready fd", fds[0].fd, tfds[5]) ||
+	    check("ready events", fds[0].revents, POLLIN))
+		return -EINVAL;
+
+	/* Level-triggered: ready until consumed. */
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &zero);
+	if (check("poll on unconsumed timer", ret, 1))
+		return -EINVAL;
+
+	if (read(tfds[5], &ticks, sizeof(ticks)) != sizeof(ticks))
+		return -errno;
+
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &zero);
+	if (check("poll after consumption", ret, 0))
+		return -EINVAL;
+
+	/* A removed descriptor is not reported anymore. */
+	ret = cobalt_poll_ctl(pfd, COBALT_POLL_CTL_DEL, tfds[7], 0);
+	if (check("del", ret, 0))
+		return -EINVAL;
+
+	if (fire(tfds[7], 1000000) || fire(tfds[9], 2000000))
+		return -errno;
+
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &timeout);
+	if (check("poll after del", ret, 1) ||
+	    check("ready fd after del", fds[0].fd, tfds[9]))
+		return -EINVAL;
+
+	for (n = 0; n < NR_TIMERS; n++)
+		close(tfds[n]);
+
+	/* Closed descriptors silently leave the set. */
+	ret = cobalt_poll_wait(pfd, fds, NR_TIMERS, &zero);
+	if (check("poll on closed fds", ret, 0))
+		return -EINVAL;
+
+	close(pfd);
+
+	return 0;
+}
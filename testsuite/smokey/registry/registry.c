@@ -0,0 +1,248 @@
+/*
+ * Registry lookup test.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(registry,
+		   SMOKEY_NOARGS,
+		   "Check and benchmark registry lookups and updates over all CPUs."
+);
+
+/*
+ * Stay well below the default count of registry slots
+ * (CONFIG_XENO_OPT_REGISTRY_NRSLOTS), since other objects may be
+ * registered concurrently.
+ */
+#define NR_OBJECTS	256
+
+static sem_t *sems[NR_OBJECTS];
+
+#define NR_CHURN_LOOPS	1000
+#define MAX_CHURNERS	64
+
+struct churner {
+	pthread_t tid;
+	int cpu;
+	long long cost;
+	int ret;
+};
+
+static struct churner churners[MAX_CHURNERS];
+
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t gate = PTHREAD_COND_INITIALIZER;
+
+static int gate_open;
+
+static inline void get_name(char *buf, size_t len, int n)
+{
+	snprintf(buf, len, "/smokey-reg-%d", n);
+}
+
+static long long elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+		now.tv_nsec - start->tv_nsec;
+}
+
+static void *churner_body(void *arg)
+{
+	struct churner *c = arg;
+	struct timespec start;
+	char name[32];
+	cpu_set_t cpus;
+	sem_t *sem;
+	int n;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(c->cpu, &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+
+	pthread_mutex_lock(&gate_lock);
+	while (!gate_open)
+		pthread_cond_wait(&gate, &gate_lock);
+	pthread_mutex_unlock(&gate_lock);
+
+	snprintf(name, sizeof(name), "/smokey-churn-%d", c->cpu);
+	sem_unlink(name);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < NR_CHURN_LOOPS; n++) {
+		sem = sem_open(name, O_CREAT | O_EXCL, 0600, 0);
+		if (sem == SEM_FAILED) {
+			c->ret = -errno;
+			return NULL;
+		}
+		sem_unlink(name);
+		sem_close(sem);
+	}
+
+	c->cost = elapsed(&start) / NR_CHURN_LOOPS;
+
+	return NULL;
+}
+
+/*
+ * Have one thread per CPU create and destroy named objects
+ * concurrently, returning the average cost of a cycle. Its growth
+ * with the number of CPUs involved reflects the contention on the
+ * core locks.
+ */
+static int run_churners(int nr_cpus, long long *cost)
+{
+	int n, ret = 0;
+
+	gate_open = 0;
+
+	for (n = 0; n < nr_cpus; n++) {
+		churners[n].cpu = n;
+		churners[n].cost = 0;
+		churners[n].ret = 0;
+		ret = -pthread_create(&churners[n].tid, NULL,
+				      churner_body, &churners[n]);
+		if (ret)
+			break;
+	}
+
+	pthread_mutex_lock(&gate_lock);
+	gate_open = 1;
+	pthread_cond_broadcast(&gate);
+	pthread_mutex_unlock(&gate_lock);
+
+	nr_cpus = n;
+	*cost = 0;
+
+	for (n = 0; n < nr_cpus; n++) {
+		pthread_join(churners[n].tid, NULL);
+		if (churners[n].ret && ret == 0)
+			ret = churners[n].ret;
+		*cost += churners[n].cost;
+	}
+
+	if (nr_cpus > 0)
+		*cost /= nr_cpus;
+
+	return ret;
+}
+
+static void cleanup(int count)
+{
+	char name[32];
+	int n;
+
+	for (n = 0; n < count; n++) {
+		sem_close(sems[n]);
+		get_name(name, sizeof(name), n);
+		sem_unlink(name);
+	}
+}
+
+static int run_registry(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long create, lookup, destroy, churn;
+	int n, ret, value, nr_cpus;
+	struct timespec start;
+	char name[32];
+	sem_t *sem;
+
+	for (n = 0; n < NR_OBJECTS; n++) {
+		get_name(name, sizeof(name), n);
+		sem_unlink(name);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < NR_OBJECTS; n++) {
+		get_name(name, sizeof(name), n);
+		sems[n] = sem_open(name, O_CREAT | O_EXCL, 0600, n);
+		if (sems[n] == SEM_FAILED) {
+			ret = -errno;
+			smokey_note("cannot create %s: %s", name, strerror(-ret));
+			cleanup(n);
+			return ret;
+		}
+	}
+
+	create = elapsed(&start);
+
+	/*
+	 * Look names up backwards, checking that each one leads to
+	 * the object registered under it.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = NR_OBJECTS - 1; n >= 0; n--) {
+		get_name(name, sizeof(name), n);
+		sem = sem_open(name, 0);
+		if (sem == SEM_FAILED) {
+			ret = -errno;
+			smokey_note("cannot look up %s: %s", name, strerror(-ret));
+			cleanup(NR_OBJECTS);
+			return ret;
+		}
+		sem_close(sem);
+	}
+
+	lookup = elapsed(&start);
+
+	for (n = 0; n < NR_OBJECTS; n++) {
+		if (sem_getvalue(sems[n], &value) || value != n) {
+			smokey_note("semaphore #%d has wrong value", n);
+			cleanup(NR_OBJECTS);
+			return -EINVAL;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	cleanup(NR_OBJECTS);
+	destroy = elapsed(&start);
+
+	get_name(name, sizeof(name), 0);
+	sem = sem_open(name, 0);
+	if (sem != SEM_FAILED || errno != ENOENT) {
+		smokey_note("stale name %s still registered", name);
+		return -EINVAL;
+	}
+
+	smokey_note("%d objects: create %lld ns, lookup %lld ns, destroy %lld ns",
+		    NR_OBJECTS, create / NR_OBJECTS, lookup / NR_OBJECTS,
+		    destroy / NR_OBJECTS);
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_cpus > MAX_CHURNERS)
+		nr_cpus = MAX_CHURNERS;
+
+	for (n = 1;; n = n * 2 < nr_cpus ? n * 2 : nr_cpus) {
+		ret = run_churners(n, &churn);
+		if (ret) {
+			smokey_note("churn on %d CPU(s) failed: %s",
+				    n, strerror(-ret));
+			return ret;
+		}
+		smokey_note("%d CPU(s): create+unlink %lld ns", n, churn);
+		if (n >= nr_cpus)
+			break;
+	}
+
+	return 0;
+}
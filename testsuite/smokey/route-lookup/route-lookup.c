@@ -0,0 +1,183 @@
+/*
+ * RTnet IPv4 route lookup benchmark over the loopback device.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <smokey/smokey.h>
+#include <rtnet.h>
+#include <ipv4_chrdev.h>
+
+smokey_test_plugin(route_lookup,
+		   SMOKEY_NOARGS,
+		   "Benchmark IPv4 route lookups (needs rtlo up)."
+);
+
+#define IFNAME		"rtlo"
+#define NR_HOSTS	512	/* see the host_routes module parameter */
+#define HOST_BASE	0x7f020001	/* 127.2.0.1 */
+#define DISCARD_PORT	9	/* Nobody listens, datagrams are dropped. */
+#define NR_LOOPS	100000
+#define POOL_EXTENSION	16
+
+#define ROUTE_PROC	"/proc/xenomai/rtnet/ipv4/route"
+
+static char payload[32];
+
+static long long elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+		now.tv_nsec - start->tv_nsec;
+}
+
+static int add_routes(int f)
+{
+	struct ipv4_cmd cmd;
+	int n;
+
+	for (n = 0; n < NR_HOSTS; n++) {
+		memset(&cmd, 0, sizeof(cmd));
+		strncpy(cmd.head.if_name, IFNAME, IFNAMSIZ - 1);
+		cmd.args.addhost.ip_addr = htonl(HOST_BASE + n);
+		cmd.args.addhost.dev_addr[0] = 0x02;	/* Locally administered. */
+		cmd.args.addhost.dev_addr[4] = n >> 8;
+		cmd.args.addhost.dev_addr[5] = n;
+		if (ioctl(f, IOC_RT_HOST_ROUTE_ADD, &cmd) < 0)
+			return n > 0 && errno == ENOBUFS ? n : -errno;
+	}
+
+	return n;
+}
+
+static void del_routes(int f, int nr)
+{
+	struct ipv4_cmd cmd;
+	int n;
+
+	for (n = 0; n < nr; n++) {
+		memset(&cmd, 0, sizeof(cmd));
+		cmd.args.delhost.ip_addr = htonl(HOST_BASE + n);
+		ioctl(f, IOC_RT_HOST_ROUTE_DELETE, &cmd);
+	}
+}
+
+static void get_hash_size(char *buf, size_t len)
+{
+	char line[128];
+	FILE *fp;
+
+	strcpy(buf, "?");
+
+	fp = fopen(ROUTE_PROC, "r");
+	if (fp == NULL)
+		return;
+
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "Host hash table size: %15s", buf) == 1)
+			break;
+
+	fclose(fp);
+}
+
+/*
+ * Sending to the same host over and over hits the route cached by the
+ * socket, spreading datagrams over all hosts defeats it, so that each
+ * of them goes through a table lookup.
+ */
+static int run_sends(int s, int nr_hosts, long long *cost)
+{
+	struct sockaddr_in sin;
+	struct timespec start;
+	ssize_t ret;
+	int n;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(DISCARD_PORT);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < NR_LOOPS; n++) {
+		sin.sin_addr.s_addr = htonl(HOST_BASE + n % nr_hosts);
+		ret = sendto(s, payload, sizeof(payload), 0,
+			     (struct sockaddr *)&sin, sizeof(sin));
+		if (ret != sizeof(payload))
+			return ret < 0 ? -errno : -EPROTO;
+	}
+
+	*cost = elapsed(&start) / NR_LOOPS;
+
+	return 0;
+}
+
+static int run_route_lookup(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long cached_cost = 0, lookup_cost = 0;
+	unsigned int pool = POOL_EXTENSION;
+	char hash_size[16];
+	int f, s, nr, ret;
+
+	f = open("/dev/rtnet", O_RDWR);
+	if (f < 0)
+		return -ENOSYS;
+
+	nr = add_routes(f);
+	if (nr < 0) {
+		/* -EBUSY if rtlo is down, -ENODEV if missing. */
+		close(f);
+		return nr == -EBUSY || nr == -ENODEV ? -ENOSYS : nr;
+	}
+
+	if (nr < NR_HOSTS)
+		smokey_note("route_lookup: only %d host routes available, "
+			    "raise host_routes", nr);
+
+	/* The host hash table grows in background. */
+	usleep(100000);
+	get_hash_size(hash_size, sizeof(hash_size));
+
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	/* Plain Linux sockets don't know about this one. */
+	if (ioctl(s, RTNET_RTIOC_EXTPOOL, &pool) < 0) {
+		ret = errno == ENOTTY || errno == EINVAL ? -ENOSYS : -errno;
+		goto close;
+	}
+
+	ret = run_sends(s, 1, &cached_cost);
+	if (ret == 0)
+		ret = run_sends(s, nr, &lookup_cost);
+	if (ret)
+		goto close;
+
+	smokey_note("route_lookup: %d routes, %s hash buckets: "
+		    "%lld ns/datagram (cached), %lld ns/datagram (lookup)",
+		    nr, hash_size, cached_cost, lookup_cost);
+close:
+	close(s);
+out:
+	del_routes(f, nr);
+	close(f);
+
+	return ret;
+}
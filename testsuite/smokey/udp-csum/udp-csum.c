@@ -0,0 +1,213 @@
+/*
+ * RTnet UDP checksum and throughput test over the loopback device.
+ *
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <smokey/smokey.h>
+#include <rtnet.h>
+
+smokey_test_plugin(udp_csum,
+		   SMOKEY_NOARGS,
+		   "Check and benchmark UDP checksumming (needs rtlo up as 127.0.0.1)."
+);
+
+#define UDP_PORT	37200
+#define NR_LOOPS	2000
+#define BATCH		4	/* datagrams in flight */
+#define MAX_DGRAM	8192
+#define POOL_EXTENSION	64	/* rtskbs, fragments included */
+
+#define OFFLOAD_PARAM	"/sys/module/rt_loopback/parameters/csum_offload"
+
+static char txbuf[MAX_DGRAM], rxbuf[MAX_DGRAM];
+
+static long long elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+		now.tv_nsec - start->tv_nsec;
+}
+
+static int csum_offloaded(void)
+{
+	int c = '0';
+	FILE *fp;
+
+	fp = fopen(OFFLOAD_PARAM, "r");
+	if (fp) {
+		c = fgetc(fp);
+		fclose(fp);
+	}
+
+	return c != '0' && c != EOF;
+}
+
+/*
+ * Split the buffer into three odd-sized chunks, so that the checksum
+ * has to be carried over unaligned boundaries.
+ */
+static void split(struct iovec *iov, void *buf, size_t len)
+{
+	size_t a = len / 3 | 1, b = len / 5 | 1;
+
+	if (a + b > len)
+		a = b = 0;
+
+	iov[0].iov_base = buf;
+	iov[0].iov_len = a;
+	iov[1].iov_base = buf + a;
+	iov[1].iov_len = b;
+	iov[2].iov_base = buf + a + b;
+	iov[2].iov_len = len - a - b;
+}
+
+static int transfer(int s, const struct sockaddr_in *sin,
+		    size_t len, int seq)
+{
+	struct msghdr msg;
+	struct iovec iov[3];
+	ssize_t ret;
+
+	memset(txbuf, seq, len);
+	txbuf[0] = ~seq;
+	txbuf[len - 1] = seq + 1;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = (void *)sin;
+	msg.msg_namelen = sizeof(*sin);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 3;
+	split(iov, txbuf, len);
+
+	ret = sendmsg(s, &msg, 0);
+	if (ret != len)
+		return ret < 0 ? -errno : -EPROTO;
+
+	return 0;
+}
+
+static int check(int s, size_t len, int seq)
+{
+	struct msghdr msg;
+	struct iovec iov[3];
+	ssize_t ret;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 3;
+	split(iov, rxbuf, len);
+
+	/*
+	 * rtlo delivers synchronously, a missing datagram was
+	 * dropped on checksum error.
+	 */
+	ret = recvmsg(s, &msg, MSG_DONTWAIT);
+	if (ret < 0) {
+		if (errno == EWOULDBLOCK)
+			smokey_note("udp_csum: %zu bytes datagram #%d dropped",
+				    len, seq);
+		return -errno;
+	}
+
+	if (ret != len || rxbuf[0] != (char)~seq ||
+	    rxbuf[len - 1] != (char)(seq + 1) ||
+	    rxbuf[len / 2] != (char)seq) {
+		smokey_note("udp_csum: %zu bytes datagram #%d corrupted",
+			    len, seq);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int run_size(int s, const struct sockaddr_in *sin,
+		    size_t len, long long *mbps)
+{
+	struct timespec start;
+	int loop, n, ret;
+	long long ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (loop = 0; loop < NR_LOOPS; loop++) {
+		for (n = 0; n < BATCH; n++) {
+			ret = transfer(s, sin, len, loop * BATCH + n);
+			if (ret)
+				return ret;
+		}
+		for (n = 0; n < BATCH; n++) {
+			ret = check(s, len, loop * BATCH + n);
+			if (ret)
+				return ret;
+		}
+	}
+
+	ns = elapsed(&start);
+	/* bytes per microsecond, i.e. MB/s */
+	*mbps = ns > 0 ? (long long)len * NR_LOOPS * BATCH * 1000 / ns : 0;
+
+	return 0;
+}
+
+static int run_udp_csum(struct smokey_test *t, int argc, char *const argv[])
+{
+	static const size_t sizes[] = { 64, 1471, 1472, 4097, MAX_DGRAM };
+	unsigned int pool = POOL_EXTENSION;
+	struct sockaddr_in sin;
+	long long mbps;
+	int s, n, ret;
+
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0)
+		return -errno;
+
+	/* Plain Linux sockets don't know about this one. */
+	if (ioctl(s, RTNET_RTIOC_EXTPOOL, &pool) < 0) {
+		ret = errno == ENOTTY || errno == EINVAL ? -ENOSYS : -errno;
+		goto out;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(UDP_PORT);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(s, (struct sockaddr *)&sin, sizeof(sin))) {
+		ret = errno == EADDRNOTAVAIL ? -ENOSYS : -errno;
+		goto out;
+	}
+
+	for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		ret = run_size(s, &sin, sizes[n], &mbps);
+		if (ret == -ENETUNREACH || ret == -EHOSTUNREACH) {
+			ret = -ENOSYS;
+			goto out;
+		}
+		if (ret)
+			goto out;
+		smokey_note("udp_csum: %5zu bytes, %lld MB/s (%s checksum)",
+			    sizes[n], mbps,
+			    csum_offloaded() ? "offloaded" : "software");
+	}
+
+	ret = 0;
+out:
+	close(s);
+
+	return ret;
+}
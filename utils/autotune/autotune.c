@@ -25,13 +25,20 @@
 #include <pthread.h>
 #include <limits.h>
 #include <time.h>
+#include <sched.h>
+#include <string.h>
+#include <errno.h>
 #include <error.h>
 #include <sys/cobalt.h>
 #include <rtdm/autotune.h>
 
 static int tune_irqlat, tune_kernlat, tune_userlat;
 
-static int reset, noload, quiet, background;
+static int reset, noload, quiet, background, percpu;
+
+static const char *save_file, *load_file;
+
+#define PROFILE_HEADER  "# xenomai autotune gravity profile (ns): cpu irq kernel user"
 
 static const struct option base_options[] = {
 	{
@@ -94,6 +101,22 @@ static const struct option base_options[] = {
 		.flag = &background,
 		.val = 1,
 	},
+	{
+#define percpu_opt	10
+		.name = "percpu",
+		.flag = &percpu,
+		.val = 1,
+	},
+	{
+#define save_opt	11
+		.name = "save",
+		.has_arg = 1,
+	},
+	{
+#define load_opt	12
+		.name = "load",
+		.has_arg = 1,
+	},
 	{
 		.name = NULL,
 	}
@@ -215,6 +238,9 @@ static void usage(void)
 	fprintf(stderr, "   --semi-quiet	tame down verbosity\n");
 	fprintf(stderr, "   --quiet		disable all output\n");
 	fprintf(stderr, "   --background	run in the background\n");
+	fprintf(stderr, "   --percpu		tune each real-time CPU separately\n");
+	fprintf(stderr, "   --save=<file>	save the gravity profile to <file>\n");
+	fprintf(stderr, "   --load=<file>	apply the gravity profile from <file>\n");
 	fprintf(stderr, "   --help		print this help\n\n");
 	fprintf(stderr, "if no option is given, tune for all contexts using the default period.\n");
 }
@@ -251,10 +277,111 @@ static void run_tuner(int fd, unsigned int op, int period, const char *type)
 		printf("%u ns\n", gravity);
 }
 
+static void run_tuners(int fd, int period)
+{
+	if (tune_irqlat)
+		run_tuner(fd, AUTOTUNE_RTIOC_IRQ, period, "irq");
+
+	if (tune_kernlat)
+		run_tuner(fd, AUTOTUNE_RTIOC_KERN, period, "kernel");
+
+	if (tune_userlat)
+		run_tuner(fd, AUTOTUNE_RTIOC_USER, period, "user");
+}
+
+/*
+ * The driver refuses to report the gravity of CPUs which are not
+ * part of the real-time set.
+ */
+static int get_cpu_gravity(int fd, int cpu, struct autotune_gravity *ag)
+{
+	ag->cpu = cpu;
+
+	return ioctl(fd, AUTOTUNE_RTIOC_GET_GRAVITY, ag) ? -errno : 0;
+}
+
+/*
+ * Run the tuners on each real-time CPU in turn: the driver tunes
+ * the gravity of the only CPU the caller may run on.
+ */
+static void run_percpu_tuners(int fd, int period, const cpu_set_t *cpus)
+{
+	struct autotune_gravity ag;
+	cpu_set_t pinned;
+	int cpu;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, cpus) || get_cpu_gravity(fd, cpu, &ag))
+			continue;
+		CPU_ZERO(&pinned);
+		CPU_SET(cpu, &pinned);
+		if (sched_setaffinity(0, sizeof(pinned), &pinned))
+			error(1, errno, "cannot pin to CPU%d", cpu);
+		if (!quiet)
+			printf("== CPU%d\n", cpu);
+		run_tuners(fd, period);
+	}
+
+	if (sched_setaffinity(0, sizeof(*cpus), cpus))
+		error(1, errno, "cannot restore CPU affinity");
+}
+
+static void save_profile(int fd, const char *path, const cpu_set_t *cpus)
+{
+	struct autotune_gravity ag;
+	FILE *fp;
+	int cpu;
+
+	fp = fopen(path, "w");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", path);
+
+	fprintf(fp, "%s\n", PROFILE_HEADER);
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, cpus) || get_cpu_gravity(fd, cpu, &ag))
+			continue;
+		fprintf(fp, "%d %u %u %u\n", cpu, ag.irq, ag.kernel, ag.user);
+	}
+
+	if (fclose(fp))
+		error(1, errno, "cannot write %s", path);
+}
+
+static void load_profile(int fd, const char *path)
+{
+	struct autotune_gravity ag;
+	int lineno = 0;
+	char line[256];
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", path);
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%u %u %u %u",
+			   &ag.cpu, &ag.irq, &ag.kernel, &ag.user) != 4)
+			error(1, EINVAL, "%s:%d: malformed entry", path, lineno);
+		if (ioctl(fd, AUTOTUNE_RTIOC_SET_GRAVITY, &ag))
+			error(1, errno, "%s:%d: cannot set gravity of CPU%u",
+			      path, lineno, ag.cpu);
+		if (!quiet)
+			printf("CPU%u gravity: irq=%u kernel=%u user=%u ns\n",
+			       ag.cpu, ag.irq, ag.kernel, ag.user);
+	}
+
+	fclose(fp);
+}
+
 int main(int argc, char *const argv[])
 {
 	int fd, period, ret, c, lindex, tuned = 0;
 	pthread_t load_pth;
+	cpu_set_t cpus;
 	time_t start;
 
 	period = CONFIG_XENO_DEFAULT_PERIOD;
@@ -280,10 +407,18 @@ int main(int argc, char *const argv[])
 				error(1, EINVAL, "invalid sampling period (default %d)",
 				      CONFIG_XENO_DEFAULT_PERIOD);
 			break;
+		case save_opt:
+			save_file = optarg;
+			break;
+		case load_opt:
+			load_file = optarg;
+			tuned = 1;
+			break;
 		case noload_opt:
 		case quiet_opt:
 		case semiquiet_opt:
 		case background_opt:
+		case percpu_opt:
 			break;
 		case irq_opt:
 		case kernel_opt:
@@ -309,12 +444,18 @@ int main(int argc, char *const argv[])
 	if (!tuned)
 		tune_irqlat = tune_kernlat = tune_userlat = 1;
 
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		error(1, errno, "cannot get CPU affinity");
+
 	if (reset) {
 		ret = ioctl(fd, AUTOTUNE_RTIOC_RESET);
 		if (ret)
 			error(1, errno, "reset failed");
 	}
 
+	if (load_file)
+		load_profile(fd, load_file);
+
 	if (tune_irqlat || tune_kernlat || tune_userlat) {
 		if (!noload)
 			create_load(&load_pth);
@@ -326,14 +467,10 @@ int main(int argc, char *const argv[])
 
 	time(&start);
 
-	if (tune_irqlat)
-		run_tuner(fd, AUTOTUNE_RTIOC_IRQ, period, "irq");
-
-	if (tune_kernlat)
-		run_tuner(fd, AUTOTUNE_RTIOC_KERN, period, "kernel");
-
-	if (tune_userlat)
-		run_tuner(fd, AUTOTUNE_RTIOC_USER, period, "user");
+	if (percpu)
+		run_percpu_tuners(fd, period, &cpus);
+	else
+		run_tuners(fd, period);
 
 	if (!quiet && (tune_userlat || tune_kernlat || tune_userlat))
 		printf("== auto-tuning completed after %ds\n",
@@ -342,6 +479,9 @@ int main(int argc, char *const argv[])
 	if (!noload)
 		pthread_cancel(load_pth);
 
+	if (save_file)
+		save_profile(fd, save_file, &cpus);
+
 	close(fd);
 
 	return 0;
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 Philippe Gerum <rpm@xenomai.org>.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * Decode the binary log written by rt_bprintf() and friends when
+ * RT_PRINT_BINARY_DUMP is set. Records must be decoded on the same
+ * architecture they were produced on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <error.h>
+#include <errno.h>
+#include <boilerplate/binprintf.h>
+
+static void usage(void)
+{
+	fprintf(stderr,
+"usage: rtprintdump [options] <dump-file>\n"
+"  [-t]                         # prefix lines with timestamps (s.us)\n"
+"  [-s]                         # prefix lines with sequence numbers\n");
+}
+
+static void *grow(void *ptr, size_t *size, size_t needed)
+{
+	if (needed <= *size)
+		return ptr;
+
+	ptr = realloc(ptr, needed);
+	if (ptr == NULL)
+		error(1, ENOMEM, "cannot allocate %zu bytes", needed);
+
+	*size = needed;
+
+	return ptr;
+}
+
+int main(int argc, char *const argv[])
+{
+	size_t fmtsz = 0, argsz = 0, outsz = BUFSIZ;
+	char magic[sizeof(BINPRINTF_MAGIC) - 1];
+	char *format = NULL, *args = NULL, *out;
+	int c, ret, timestamps = 0, seqnums = 0;
+	struct binprintf_record rec;
+	unsigned long long origin;
+	FILE *fp;
+
+	while ((c = getopt(argc, argv, "ts")) != EOF) {
+		switch (c) {
+		case 't':
+			timestamps = 1;
+			break;
+		case 's':
+			seqnums = 1;
+			break;
+		default:
+			usage();
+			return 2;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return 2;
+	}
+
+	fp = fopen(argv[optind], "r");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", argv[optind]);
+
+	if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+	    memcmp(magic, BINPRINTF_MAGIC, sizeof(magic)))
+		error(1, 0, "%s: not a binary rt_print dump", argv[optind]);
+
+	out = malloc(outsz);
+	if (out == NULL)
+		error(1, ENOMEM, "cannot allocate output buffer");
+
+	origin = 0;
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		format = grow(format, &fmtsz, rec.fmtlen + 1);
+		args = grow(args, &argsz, rec.argsz + 1);
+		if ((rec.fmtlen > 0 && fread(format, rec.fmtlen, 1, fp) != 1) ||
+		    (rec.argsz > 0 && fread(args, rec.argsz, 1, fp) != 1))
+			error(1, 0, "%s: truncated record", argv[optind]);
+		format[rec.fmtlen] = '\0';
+
+		ret = binprintf_format(out, outsz, format, args, rec.argsz);
+		if (ret >= (int)outsz) {
+			out = grow(out, &outsz, ret + 1);
+			ret = binprintf_format(out, outsz, format,
+					       args, rec.argsz);
+		}
+		if (ret < 0) {
+			fprintf(stderr, "rtprintdump: record #%u: "
+				"invalid arguments for \"%s\"\n",
+				rec.seq_no, format);
+			continue;
+		}
+
+		if (origin == 0)
+			origin = rec.timestamp;
+
+		if (seqnums)
+			printf("#%-8u ", rec.seq_no);
+		if (timestamps)
+			printf("[%6llu.%06llu] ",
+			       (rec.timestamp - origin) / 1000000000ULL,
+			       (rec.timestamp - origin) % 1000000000ULL / 1000);
+
+		fwrite(out, ret, 1, stdout);
+	}
+
+	if (ferror(fp))
+		error(1, errno, "%s: read error", argv[optind]);
+
+	fclose(fp);
+	free(format);
+	free(args);
+	free(out);
+
+	return 0;
+}